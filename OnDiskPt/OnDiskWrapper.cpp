@@ -22,6 +22,8 @@
 #endif
 #include <sys/stat.h>
 #include "util/check.hh"
+#include "util/file.hh"
+#include <iostream>
 #include <string>
 #include "OnDiskWrapper.h"
 
@@ -30,7 +32,16 @@ using namespace std;
 namespace OnDiskPt
 {
 
-int OnDiskWrapper::VERSION_NUM = 5;
+int OnDiskWrapper::VERSION_NUM = 6;
+
+namespace
+{
+void MapForLoad(const std::string &filePath, util::scoped_memory &mem)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+  util::MapRead(util::LAZY, file.get(), 0, util::SizeFile(file.get()), mem);
+}
+}
 
 OnDiskWrapper::OnDiskWrapper()
 {
@@ -46,6 +57,12 @@ bool OnDiskWrapper::BeginLoad(const std::string &filePath)
   if (!OpenForLoad(filePath))
     return false;
 
+  if (GetMisc("Version") != (UINT64) VERSION_NUM) {
+    std::cerr << "Binary rule table " << filePath << " has version " << GetMisc("Version")
+              << " but version " << VERSION_NUM << " is needed. Create it again with CreateOnDiskPt" << std::endl;
+    return false;
+  }
+
   if (!m_vocab.Load(*this))
     return false;
 
@@ -57,14 +74,9 @@ bool OnDiskWrapper::BeginLoad(const std::string &filePath)
 
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileSource.is_open());
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileTargetInd.is_open());
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  CHECK(m_fileTargetColl.is_open());
+  MapForLoad(filePath + "/Source.dat", m_memSource);
+  MapForLoad(filePath + "/TargetInd.dat", m_memTargetInd);
+  MapForLoad(filePath + "/TargetColl.dat", m_memTargetColl);
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   CHECK(m_fileVocab.is_open());
@@ -126,9 +138,12 @@ bool OnDiskWrapper::BeginSave(const std::string &filePath
   CHECK(m_fileMisc.is_open());
 
   // offset by 1. 0 offset is reserved
+  // source nodes are read in place, so they start at multiples of 8 bytes
   char c = 0xff;
-  m_fileSource.write(&c, 1);
-  CHECK(1 == m_fileSource.tellp());
+  for (size_t i = 0; i < sizeof(UINT64); ++i) {
+    m_fileSource.write(&c, 1);
+  }
+  CHECK(sizeof(UINT64) == m_fileSource.tellp());
 
   m_fileTargetInd.write(&c, 1);
   CHECK(1 == m_fileTargetInd.tellp());
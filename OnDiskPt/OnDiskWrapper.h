@@ -20,6 +20,7 @@
  ***********************************************************************/
 #include <string>
 #include <fstream>
+#include "util/mmap.hh"
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "../moses/src/Word.h"
@@ -31,6 +32,10 @@ const float DEFAULT_COUNT = 66666;
 /** Global class with misc information need to create and use the on-disk rule table. 
  * 1 object of this class should be instantiated per rule table.
  * Currently only hierarchical/syntax models use this, but can & should be used with pb models too
+ *
+ * When loading, the source, target and target collection files are mapped
+ * into memory read-only and read in place, so that processes using the same
+ * table share its pages, and lookups don't seek or copy.
  */
 class OnDiskWrapper
 {
@@ -39,6 +44,7 @@ protected:
   std::string m_filePath;
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl; //! when loaded
 
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
@@ -81,6 +87,19 @@ public:
     return m_fileVocab;
   }
 
+  //! mapped Source.dat, when loaded
+  const char *GetMemSource() const {
+    return (const char*) m_memSource.get();
+  }
+  //! mapped TargetInd.dat, when loaded
+  const char *GetMemTargetInd() const {
+    return (const char*) m_memTargetInd.get();
+  }
+  //! mapped TargetColl.dat, when loaded
+  const char *GetMemTargetColl() const {
+    return (const char*) m_memTargetColl.get();
+  }
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
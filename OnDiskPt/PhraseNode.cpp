@@ -17,6 +17,8 @@
  License along with this library; if not, write to the Free Software
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
+#include <algorithm>
+#include <cstring>
 #include "util/check.hh"
 #include "PhraseNode.h"
 #include "OnDiskWrapper.h"
@@ -29,11 +31,14 @@ using namespace std;
 namespace OnDiskPt
 {
 
-size_t PhraseNode::GetNodeSize(size_t numChildren, size_t wordSize, size_t countSize)
+size_t PhraseNode::GetNodeSize(size_t numChildren, size_t countSize)
 {
+  size_t countMem = sizeof(float) * countSize;
+  countMem = (countMem + sizeof(UINT64) - 1) / sizeof(UINT64) * sizeof(UINT64);
+
   size_t ret = sizeof(UINT64) * 2 // num children, value
-               + (wordSize + sizeof(UINT64)) * numChildren // word + ptr to next source node
-               + sizeof(float) * countSize; // count info
+               + countMem // count info, padded
+               + sizeof(UINT64) * 2 * numChildren; // word keys, then ptrs to next source nodes
   return ret;
 }
 
@@ -42,49 +47,40 @@ PhraseNode::PhraseNode()
   ,m_currChild(NULL)
   ,m_saved(false)
   ,m_memLoad(NULL)
+  ,m_numChildrenLoad(0)
+  ,m_childKeys(NULL)
+  ,m_childFilePos(NULL)
 {
 }
 
 PhraseNode::PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper)
   :m_counts(onDiskWrapper.GetNumCounts())
 {
-  // load saved node
+  // load saved node, in place
   m_filePos = filePos;
+  CHECK(filePos % sizeof(UINT64) == 0);
 
   size_t countSize = onDiskWrapper.GetNumCounts();
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  file.seekg(filePos);
-  CHECK(filePos == (UINT64)file.tellg());
-
-  file.read((char*) &m_numChildrenLoad, sizeof(UINT64));
-  
-  size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
-  m_memLoad = (char*) malloc(memAlloc);
-
-  // go to start of node again
-  file.seekg(filePos);
-  CHECK(filePos == (UINT64)file.tellg());
-
-  // read everything into memory
-  file.read(m_memLoad, memAlloc);
-  CHECK(filePos + memAlloc == (UINT64)file.tellg());
+  m_memLoad = onDiskWrapper.GetMemSource() + filePos;
+  const UINT64 *memArray = (const UINT64*) m_memLoad;
+  m_numChildrenLoad = memArray[0];
 
   // get value
-  m_value = ((UINT64*)m_memLoad)[1];
+  m_value = memArray[1];
 
   // get counts
-  float *memFloat = (float*) (m_memLoad + sizeof(UINT64) * 2);
+  const float *memFloat = (const float*) (m_memLoad + sizeof(UINT64) * 2);
 
   CHECK(countSize == 1);
   m_counts[0] = memFloat[0];
 
-  m_memLoadLast = m_memLoad + memAlloc;
+  m_childKeys = (const UINT64*) (m_memLoad + GetNodeSize(0, countSize));
+  m_childFilePos = m_childKeys + m_numChildrenLoad;
 }
 
 PhraseNode::~PhraseNode()
 {
-  free(m_memLoad);
   //CHECK(m_saved);
 }
 
@@ -104,9 +100,9 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
 
   size_t numCounts = onDiskWrapper.GetNumCounts();
 
-  size_t memAlloc = GetNodeSize(GetSize(), onDiskWrapper.GetSourceWordSize(), numCounts);
+  size_t memAlloc = GetNodeSize(GetSize(), numCounts);
   char *mem = (char*) malloc(memAlloc);
-  //memset(mem, 0xfe, memAlloc);
+  memset(mem, 0, memAlloc);
 
   size_t memUsed = 0;
   UINT64 *memArray = (UINT64*) mem;
@@ -118,11 +114,14 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
   float *memFloat = (float*) (mem + memUsed);
   CHECK(numCounts == 1);
   memFloat[0] = (m_counts.size() == 0) ? DEFAULT_COUNT : m_counts[0]; // if count = 0, put in very large num to make sure its still used. HACK
-  memUsed += sizeof(float) * numCounts;
+  memUsed = GetNodeSize(0, numCounts);
 
-  // recursively save chm_countsildren
+  // recursively save children. The map is ordered by word, so the keys come out sorted
+  UINT64 *childKeys = (UINT64*) (mem + memUsed);
+  UINT64 *childFilePos = childKeys + GetSize();
+  size_t ind = 0;
   ChildColl::iterator iter;
-  for (iter = m_children.begin(); iter != m_children.end(); ++iter) {
+  for (iter = m_children.begin(); iter != m_children.end(); ++iter, ++ind) {
     const Word &childWord = iter->first;
     PhraseNode &childNode = iter->second;
 
@@ -130,15 +129,10 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
     if (!childNode.Saved())
       childNode.Save(onDiskWrapper, pos + 1, tableLimit);
 
-    char *currMem = mem + memUsed;
-    size_t wordMemUsed = childWord.WriteToMemory(currMem);
-    memUsed += wordMemUsed;
-
-    UINT64 *memArray = (UINT64*) (mem + memUsed);
-    memArray[0] = childNode.GetFilePos();
-    memUsed += sizeof(UINT64);
-
+    childKeys[ind] = childWord.GetKey();
+    childFilePos[ind] = childNode.GetFilePos();
   }
+  memUsed += sizeof(UINT64) * 2 * GetSize();
 
   // save this node
   //Moses::DebugMem(mem, memAlloc);
@@ -146,6 +140,7 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
 
   std::fstream &file = onDiskWrapper.GetFileSource();
   m_filePos = file.tellp();
+  CHECK(m_filePos % sizeof(UINT64) == 0);
   file.seekp(0, ios::end);
   file.write(mem, memUsed);
 
@@ -197,57 +192,13 @@ void PhraseNode::AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
 
 const PhraseNode *PhraseNode::GetChild(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const
 {
-  const PhraseNode *ret = NULL;
-
-  int l = 0;
-  int r = m_numChildrenLoad - 1;
-  int x;
-
-  while (r >= l) {
-    x = (l + r) / 2;
-
-    Word wordFound;
-    UINT64 childFilePos;
-    GetChild(wordFound, childFilePos, x, onDiskWrapper);
-
-    if (wordSought == wordFound) {
-      ret = new PhraseNode(childFilePos, onDiskWrapper);
-      break;
-    }
-    if (wordSought < wordFound)
-      r = x - 1;
-    else
-      l = x + 1;
-  }
-
-  return ret;
-}
-
-void PhraseNode::GetChild(Word &wordFound, UINT64 &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const
-{
-
-  size_t wordSize = onDiskWrapper.GetSourceWordSize();
-  size_t childSize = wordSize + sizeof(UINT64);
-
-  char *currMem = m_memLoad
-                  + sizeof(UINT64) * 2 // size & file pos of target phrase coll
-                  + sizeof(float) * onDiskWrapper.GetNumCounts() // count info
-                  + childSize * ind;
-
-  size_t memRead = ReadChild(wordFound, childFilePos, currMem);
-  CHECK(memRead == childSize);
-}
-
-size_t PhraseNode::ReadChild(Word &wordFound, UINT64 &childFilePos, const char *mem) const
-{
-  size_t memRead = wordFound.ReadFromMemory(mem);
-
-  const char *currMem = mem + memRead;
-  UINT64 *memArray = (UINT64*) (currMem);
-  childFilePos = memArray[0];
+  const UINT64 key = wordSought.GetKey();
+  const UINT64 *end = m_childKeys + m_numChildrenLoad;
+  const UINT64 *found = std::lower_bound(m_childKeys, end, key);
+  if (found == end || *found != key)
+    return NULL;
 
-  memRead += sizeof(UINT64);
-  return memRead;
+  return new PhraseNode(m_childFilePos[found - m_childKeys], onDiskWrapper);
 }
 
 const TargetPhraseCollection *PhraseNode::GetTargetPhraseCollection(size_t tableLimit, OnDiskWrapper &onDiskWrapper) const
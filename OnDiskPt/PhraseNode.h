@@ -31,7 +31,12 @@ namespace OnDiskPt
 class OnDiskWrapper;
 class SourcePhrase;
 
-/** A node in the source tree trie */
+/** A node in the source tree trie.
+ *  A saved node is the number of children, the position of its target
+ *  phrases, its counts padded to 8 bytes, then the keys (Word::GetKey()) of
+ *  the children in ascending order and the positions of the child nodes, all
+ *  as 8 byte numbers. Loaded nodes point into the mapped file.
+ */
 class PhraseNode
 {
   friend std::ostream& operator<<(std::ostream&, const PhraseNode&);
@@ -47,17 +52,16 @@ protected:
 
   TargetPhraseCollection m_targetPhraseColl;
 
-  char *m_memLoad, *m_memLoadLast;
+  const char *m_memLoad;
   UINT64 m_numChildrenLoad;
+  const UINT64 *m_childKeys, *m_childFilePos;
 
   void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
                        , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
                        , size_t tableLimit, const std::vector<float> &counts, OnDiskPt::PhrasePtr spShort);
-  size_t ReadChild(Word &wordFound, UINT64 &childFilePos, const char *mem) const; 
-  void GetChild(Word &wordFound, UINT64 &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const;
 
 public:
-  static size_t GetNodeSize(size_t numChildren, size_t wordSize, size_t countSize);
+  static size_t GetNodeSize(size_t numChildren, size_t countSize);
 
   PhraseNode(); // unsaved node
   PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper); // load saved node
@@ -59,8 +59,8 @@ protected:
   size_t WriteAlignToMemory(char *mem) const;
   size_t WriteScoresToMemory(char *mem) const;
 
-  UINT64 ReadAlignFromFile(std::fstream &fileTPColl);
-  UINT64 ReadScoresFromFile(std::fstream &fileTPColl);
+  UINT64 ReadAlignFromMemory(const char *mem);
+  UINT64 ReadScoresFromMemory(const char *mem);
 
 public:
   TargetPhrase(size_t numScores);
@@ -103,8 +103,10 @@ public:
                                       , const std::vector<float> &weightT
                                       , const Moses::WordPenaltyProducer* wpProducer
                                       , const Moses::LMList &lmList) const;
-  UINT64 ReadOtherInfoFromFile(UINT64 filePos, std::fstream &fileTPColl);
-  UINT64 ReadFromFile(std::fstream &fileTP);
+  //! read the entry in a target phrase collection, in the mapped TargetColl.dat
+  UINT64 ReadOtherInfoFromMemory(const char *mem);
+  //! read the words, in the mapped TargetInd.dat at GetFilePos()
+  UINT64 ReadFromMemory(const char *mem);
 
 	virtual void DebugPrint(std::ostream &out, const Vocab &vocab) const;
 
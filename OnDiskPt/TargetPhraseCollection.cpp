@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "../moses/src/Util.h"
 #include "../moses/src/TargetPhraseCollection.h"
@@ -152,30 +153,25 @@ Moses::TargetPhraseCollection *TargetPhraseCollection::ConvertToMoses(const std:
 
 void TargetPhraseCollection::ReadFromFile(size_t tableLimit, UINT64 filePos, OnDiskWrapper &onDiskWrapper)
 {
-  fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
-  fstream &fileTP = onDiskWrapper.GetFileTargetInd();
-    
+  // both files are mapped, so the phrases are read in place
+  const char *memTPColl = onDiskWrapper.GetMemTargetColl() + filePos;
+  const char *memTP = onDiskWrapper.GetMemTargetInd();
+
   size_t numScores = onDiskWrapper.GetNumScores();
-    
 
   UINT64 numPhrases;
-
-  UINT64 currFilePos = filePos;
-  fileTPColl.seekg(filePos);
-  fileTPColl.read((char*) &numPhrases, sizeof(UINT64));
+  memcpy(&numPhrases, memTPColl, sizeof(UINT64));
+  memTPColl += sizeof(UINT64);
 
   // table limit
   numPhrases = std::min(numPhrases, (UINT64) tableLimit);
 
-  currFilePos += sizeof(UINT64);
- 
+  m_coll.reserve(numPhrases);
   for (size_t ind = 0; ind < numPhrases; ++ind) {
-    TargetPhrase *tp = new TargetPhrase(numScores);    
-
-    UINT64 sizeOtherInfo = tp->ReadOtherInfoFromFile(currFilePos, fileTPColl);
-    tp->ReadFromFile(fileTP);
+    TargetPhrase *tp = new TargetPhrase(numScores);
 
-    currFilePos += sizeOtherInfo;
+    memTPColl += tp->ReadOtherInfoFromMemory(memTPColl);
+    tp->ReadFromMemory(memTP + tp->GetFilePos());
 
     m_coll.push_back(tp);
   }
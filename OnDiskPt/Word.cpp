@@ -18,6 +18,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
 
+#include <cstring>
 #include "../moses/src/FactorCollection.h"
 #include "../moses/src/Util.h"
 #include "../moses/src/Word.h"
@@ -70,8 +71,8 @@ size_t Word::WriteToMemory(char *mem) const
 
 size_t Word::ReadFromMemory(const char *mem)
 {
-  UINT64 *vocabMem = (UINT64*) mem;
-  m_vocabId = vocabMem[0];
+  // may not be aligned
+  memcpy(&m_vocabId, mem, sizeof(UINT64));
 
   size_t memUsed = sizeof(UINT64);
 
@@ -84,18 +85,6 @@ size_t Word::ReadFromMemory(const char *mem)
   return memUsed;
 }
 
-size_t Word::ReadFromFile(std::fstream &file)
-{
-  const size_t memAlloc = sizeof(UINT64) + sizeof(char);
-  char mem[sizeof(UINT64) + sizeof(char)];
-  file.read(mem, memAlloc);
-
-  size_t memUsed = ReadFromMemory(mem);
-  CHECK(memAlloc == memUsed);
-
-  return memAlloc;
-}
-
 void Word::ConvertToMoses(
     const std::vector<Moses::FactorType> &outputFactorsVec, 
     const Vocab &vocab,
@@ -65,7 +65,11 @@ public:
 
   size_t WriteToMemory(char *mem) const;
   size_t ReadFromMemory(const char *mem);
-  size_t ReadFromFile(std::fstream &file);
+
+  //! vocab id and type in one number, which sorts the same way as the words
+  UINT64 GetKey() const {
+    return (m_isNonTerminal ? 0 : ((UINT64) 1 << 63)) | m_vocabId;
+  }
 
   void SetVocabId(UINT32 vocabId) {
     m_vocabId = vocabId;
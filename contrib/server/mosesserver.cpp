@@ -1,7 +1,13 @@
 #include "util/check.hh"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
+#include <boost/scoped_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
 #include <xmlrpc-c/base.hpp>
 #include <xmlrpc-c/registry.hpp>
 #include <xmlrpc-c/server_abyss.hpp>
@@ -11,6 +17,8 @@
 #include "Manager.h"
 #include "StaticData.h"
 #include "PhraseDictionaryDynSuffixArray.h"
+#include "ThreadPool.h"
+#include "Timer.h"
 #include "TranslationSystem.h"
 #include "TreeInput.h"
 #include "LMList.h"
@@ -129,17 +137,190 @@ public:
   }
 };
 
+/** Options of one translation request. They are passed to the decoding of
+ * its sentences, rather than set in StaticData, so that concurrent requests
+ * don't see each other's options */
+struct RequestOptions {
+  const TranslationSystem *system;
+  bool addAlignInfo;
+  bool addGraphInfo;
+  bool addTopts;
+  bool reportAllFactors;
+};
+
+/** Counters of the requests served, and of their latencies */
+class ServerStats
+{
+public:
+  ServerStats()
+    : m_requests(0), m_activeRequests(0), m_failedRequests(0), m_sentences(0)
+    , m_latencySeconds(0), m_maxLatencySeconds(0)
+    , m_queueSeconds(0), m_decodeSeconds(0), m_nextLatency(0) {
+    m_uptime.start();
+  }
+
+  void StartRequest() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    ++m_activeRequests;
+  }
+
+  void EndRequest(double seconds, bool failed) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    --m_activeRequests;
+    ++m_requests;
+    if (failed) ++m_failedRequests;
+    m_latencySeconds += seconds;
+    m_maxLatencySeconds = std::max(m_maxLatencySeconds, seconds);
+    if (m_recentLatencies.size() < RECENT_LATENCIES) {
+      m_recentLatencies.push_back(seconds);
+    } else {
+      m_recentLatencies[m_nextLatency] = seconds;
+    }
+    m_nextLatency = (m_nextLatency + 1) % RECENT_LATENCIES;
+  }
+
+  void AddSentence(double queueSeconds, double decodeSeconds) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    ++m_sentences;
+    m_queueSeconds += queueSeconds;
+    m_decodeSeconds += decodeSeconds;
+  }
+
+  void Insert(map<string, xmlrpc_c::value>& retData) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    const double uptime = m_uptime.get_elapsed_time();
+    retData["uptime"] = xmlrpc_c::value_double(uptime);
+    retData["requests"] = xmlrpc_c::value_int(m_requests);
+    retData["active-requests"] = xmlrpc_c::value_int(m_activeRequests);
+    retData["failed-requests"] = xmlrpc_c::value_int(m_failedRequests);
+    retData["sentences"] = xmlrpc_c::value_int(m_sentences);
+    retData["sentences-per-second"] = xmlrpc_c::value_double(uptime > 0 ? m_sentences / uptime : 0);
+
+    // per request, from its arrival to its answer; the percentiles are of
+    // the last RECENT_LATENCIES requests
+    vector<double> recent(m_recentLatencies);
+    sort(recent.begin(), recent.end());
+    retData["latency-mean-ms"] = xmlrpc_c::value_double(m_requests ? 1000 * m_latencySeconds / m_requests : 0);
+    retData["latency-p50-ms"] = xmlrpc_c::value_double(Percentile(recent, 0.5));
+    retData["latency-p95-ms"] = xmlrpc_c::value_double(Percentile(recent, 0.95));
+    retData["latency-max-ms"] = xmlrpc_c::value_double(1000 * m_maxLatencySeconds);
+
+    // per sentence, waiting for a decoder and being decoded
+    retData["queue-wait-mean-ms"] = xmlrpc_c::value_double(m_sentences ? 1000 * m_queueSeconds / m_sentences : 0);
+    retData["decode-mean-ms"] = xmlrpc_c::value_double(m_sentences ? 1000 * m_decodeSeconds / m_sentences : 0);
+  }
+
+private:
+  static const size_t RECENT_LATENCIES = 1000;
+
+  static double Percentile(const vector<double> &sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    return 1000 * sorted[std::min(sorted.size() - 1, (size_t) (fraction * sorted.size()))];
+  }
+
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+  Timer m_uptime;
+  size_t m_requests, m_activeRequests, m_failedRequests, m_sentences;
+  double m_latencySeconds, m_maxLatencySeconds;
+  double m_queueSeconds, m_decodeSeconds;
+  vector<double> m_recentLatencies;
+  size_t m_nextLatency;
+};
+
+class Translator;
+
+/** The sentences of a request which are still being decoded */
+class PendingSentences
+{
+public:
+  explicit PendingSentences(size_t count) : m_count(count) {}
+
+  void Done() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    --m_count;
+#ifdef WITH_THREADS
+    m_done.notify_all();
+#endif
+  }
+
+  void Wait() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_count > 0) m_done.wait(lock);
+#endif
+  }
+
+private:
+  size_t m_count;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+#endif
+};
+
+/** What the decoding of one sentence of a request gave */
+struct SentenceResult {
+  map<string, xmlrpc_c::value> result;
+  string error; //! what the decoding threw, if anything
+};
+
+/** Decodes one sentence of a request on the worker pool, which deletes it.
+ * The result is written to the request before it is told the sentence is
+ * done, and the task doesn't touch the request after that */
+class SentenceTask : public Task
+{
+public:
+  SentenceTask(const Translator &translator, const string &source,
+               const RequestOptions &options, size_t lineNumber,
+               ServerStats &stats, SentenceResult &result, PendingSentences &pending)
+    : m_translator(translator), m_source(source), m_options(options)
+    , m_lineNumber(lineNumber), m_stats(stats), m_result(result), m_pending(pending) {
+    m_queued.start();
+  }
+
+  void Run();
+
+private:
+  const Translator &m_translator;
+  const string &m_source;
+  const RequestOptions &m_options;
+  size_t m_lineNumber;
+  ServerStats &m_stats;
+  SentenceResult &m_result;
+  PendingSentences &m_pending;
+  Timer m_queued;
+};
+
+/** Translates a sentence, or a document of one sentence a line, whose
+ * sentences are decoded in parallel by a pool of decoders shared by all the
+ * connections */
 class Translator : public xmlrpc_c::method
 {
 public:
-  Translator() {
+  Translator(size_t threads, size_t queueLimit)
+    : m_nextLineNumber(0) {
     // signature and help strings are documentation -- the client
     // can query this information with a system.methodSignature and
     // system.methodHelp RPC.
     this->_signature = "S:S";
     this->_help = "Does translation";
+#ifdef WITH_THREADS
+    m_pool.reset(new ThreadPool(threads));
+    m_pool->SetQueueLimit(queueLimit);
+#endif
   }
-
   void
   execute(xmlrpc_c::paramList const& paramList,
           xmlrpc_c::value *   const  retvalP) {
@@ -155,25 +336,92 @@ public:
     const string source(
       (xmlrpc_c::value_string(si->second)));
 
-    cerr << "Input: " << source << endl;
-    si = params.find("align");
-    bool addAlignInfo = (si != params.end());
-    si = params.find("sg");
-    bool addGraphInfo = (si != params.end());
-    si = params.find("topt");
-    bool addTopts = (si != params.end());
-    si = params.find("report-all-factors");
-    bool reportAllFactors = (si != params.end());
+    RequestOptions options;
+    options.system = &getTranslationSystem(params);
+    options.addAlignInfo = (params.find("align") != params.end());
+    options.addGraphInfo = (params.find("sg") != params.end());
+    options.addTopts = (params.find("topt") != params.end());
+    options.reportAllFactors = (params.find("report-all-factors") != params.end());
+
+    Timer latency;
+    latency.start();
+    m_stats.StartRequest();
+
+    // one sentence a line. Empty lines are kept, so that the translation
+    // has the lines of the source
+    vector<string> sentences;
+    size_t begin = 0;
+    for (;;) {
+      const size_t end = source.find('\n', begin);
+      if (end == string::npos) {
+        if (begin < source.size() || sentences.empty()) {
+          sentences.push_back(source.substr(begin));
+        }
+        break;
+      }
+      sentences.push_back(source.substr(begin, end - begin));
+      begin = end + 1;
+    }
+    size_t lineNumber;
+    {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_mutex);
+#endif
+      lineNumber = m_nextLineNumber;
+      m_nextLineNumber += sentences.size();
+    }
 
-    const StaticData &staticData = StaticData::Instance();
+    // the results outlive the tasks, which the pool deletes once they have run
+    vector<SentenceResult> results(sentences.size());
+    PendingSentences pending(sentences.size());
+    for (size_t i = 0; i < sentences.size(); ++i) {
+      SentenceTask *task = new SentenceTask(*this, sentences[i], options, lineNumber + i, m_stats, results[i], pending);
+#ifdef WITH_THREADS
+      // blocks while the queue of the pool is full
+      m_pool->Submit(task);
+#else
+      task->Run();
+      delete task;
+#endif
+    }
+    pending.Wait();
 
-    if (addGraphInfo) {
-      (const_cast<StaticData&>(staticData)).SetOutputSearchGraph(true);
+    string error;
+    for (size_t i = 0; i < results.size(); ++i) {
+      if (error.empty()) error = results[i].error;
+    }
+    if (!error.empty()) {
+      m_stats.EndRequest(latency.get_elapsed_time(), true);
+      throw xmlrpc_c::fault(error, xmlrpc_c::fault::CODE_INTERNAL);
     }
 
-    const TranslationSystem& system = getTranslationSystem(params);
-    stringstream out, graphInfo, transCollOpts;
     map<string, xmlrpc_c::value> retData;
+    if (results.size() == 1) {
+      retData = results[0].result;
+    } else {
+      // the translations of the lines, and the details of each sentence
+      stringstream out;
+      vector<xmlrpc_c::value> sentencesXml;
+      for (size_t i = 0; i < results.size(); ++i) {
+        map<string, xmlrpc_c::value> &result = results[i].result;
+        if (i > 0) out << "\n";
+        out << xmlrpc_c::value_string(result["text"]).cvalue();
+        sentencesXml.push_back(xmlrpc_c::value_struct(result));
+      }
+      retData.insert(pair<string, xmlrpc_c::value>("text", xmlrpc_c::value_string(out.str())));
+      retData.insert(pair<string, xmlrpc_c::value>("sentences", xmlrpc_c::value_array(sentencesXml)));
+    }
+    m_stats.EndRequest(latency.get_elapsed_time(), false);
+    *retvalP = xmlrpc_c::value_struct(retData);
+  }
+
+  //! decode one sentence, with the options of its request
+  void TranslateSentence(const string &source, const RequestOptions &options, size_t lineNumber,
+                         map<string, xmlrpc_c::value> &retData) const {
+    cerr << "Input: " << source << endl;
+    const StaticData &staticData = StaticData::Instance();
+    const TranslationSystem& system = *options.system;
+    stringstream out;
 
     if (staticData.IsChart()) {
        TreeInput tinput; 
@@ -191,22 +439,20 @@ public:
           staticData.GetInputFactorOrder();
         stringstream in(source + "\n");
         sentence.Read(in,inputFactorOrder);
-	size_t lineNumber = 0; // TODO: Include sentence request number here?
-        Manager manager(lineNumber, sentence, staticData.GetSearchAlgorithm(), &system);
+        Manager manager(lineNumber, sentence, staticData.GetSearchAlgorithm(), &system, options.addGraphInfo);
         manager.ProcessSentence();
         const Hypothesis* hypo = manager.GetBestHypothesis();
 
         vector<xmlrpc_c::value> alignInfo;
-        outputHypo(out,hypo,addAlignInfo,alignInfo,reportAllFactors);
-        if (addAlignInfo) {
+        outputHypo(out,hypo,options.addAlignInfo,alignInfo,options.reportAllFactors);
+        if (options.addAlignInfo) {
           retData.insert(pair<string, xmlrpc_c::value>("align", xmlrpc_c::value_array(alignInfo)));
         }
 
-        if(addGraphInfo) {
+        if (options.addGraphInfo) {
           insertGraphInfo(manager,retData);
-            (const_cast<StaticData&>(staticData)).SetOutputSearchGraph(false);
         }
-        if (addTopts) {
+        if (options.addTopts) {
           insertTranslationOptions(manager,retData);
         }
     }
@@ -214,10 +460,19 @@ public:
     text("text", xmlrpc_c::value_string(out.str()));
     retData.insert(text);
     cerr << "Output: " << out.str() << endl;
-    *retvalP = xmlrpc_c::value_struct(retData);
   }
 
-  void outputHypo(ostream& out, const Hypothesis* hypo, bool addAlignmentInfo, vector<xmlrpc_c::value>& alignInfo, bool reportAllFactors = false) {
+  ServerStats &GetStats() {
+    return m_stats;
+  }
+
+#ifdef WITH_THREADS
+  ThreadPoolStats GetPoolStats() const {
+    return m_pool->GetStats();
+  }
+#endif
+
+  void outputHypo(ostream& out, const Hypothesis* hypo, bool addAlignmentInfo, vector<xmlrpc_c::value>& alignInfo, bool reportAllFactors = false) const {
     if (hypo->GetPrevHypo() != NULL) {
       outputHypo(out,hypo->GetPrevHypo(),addAlignmentInfo, alignInfo, reportAllFactors);
       Phrase p = hypo->GetCurrTargetPhrase();
@@ -244,7 +499,7 @@ public:
     }
   }
 
-  void outputChartHypo(ostream& out, const ChartHypothesis* hypo) {
+  void outputChartHypo(ostream& out, const ChartHypothesis* hypo) const {
     Phrase outPhrase(20);
     hypo->CreateOutputPhrase(outPhrase);
 
@@ -259,7 +514,7 @@ public:
 
   }
 
-  void insertGraphInfo(Manager& manager, map<string, xmlrpc_c::value>& retData) {
+  void insertGraphInfo(Manager& manager, map<string, xmlrpc_c::value>& retData) const {
     vector<xmlrpc_c::value> searchGraphXml;
     vector<SearchGraphNode> searchGraph;
     manager.GetSearchGraph(searchGraph);
@@ -288,7 +543,7 @@ public:
     retData.insert(pair<string, xmlrpc_c::value>("sg", xmlrpc_c::value_array(searchGraphXml)));
   }
 
-  void insertTranslationOptions(Manager& manager, map<string, xmlrpc_c::value>& retData) {
+  void insertTranslationOptions(Manager& manager, map<string, xmlrpc_c::value>& retData) const {
     const TranslationOptionCollection* toptsColl = manager.getSntTranslationOptions();
     vector<xmlrpc_c::value> toptsXml;
     for (size_t startPos = 0 ; startPos < toptsColl->GetSize() ; ++startPos) {
@@ -308,8 +563,8 @@ public:
           toptXml["start"] =  xmlrpc_c::value_int(startPos);
           toptXml["end"] =  xmlrpc_c::value_int(endPos);
           vector<xmlrpc_c::value> scoresXml;
-          ScoreComponentCollection scores = topt->GetScoreBreakdown();
-          for (size_t j = 0; j < scores.size(); ++j) {
+          const FVector &scores = topt->GetScoreBreakdown().GetScoresVector();
+          for (size_t j = 0; j < scores.coreSize(); ++j) {
             scoresXml.push_back(xmlrpc_c::value_double(scores[j]));
           }
           toptXml["scores"] = xmlrpc_c::value_array(scoresXml);
@@ -320,8 +575,57 @@ public:
     retData.insert(pair<string, xmlrpc_c::value>("topt", xmlrpc_c::value_array(toptsXml)));
   }
 
+private:
+#ifdef WITH_THREADS
+  boost::scoped_ptr<ThreadPool> m_pool;
+  boost::mutex m_mutex; //! guards m_nextLineNumber
+#endif
+  size_t m_nextLineNumber;
+  ServerStats m_stats;
+};
+
+void SentenceTask::Run()
+{
+  const double queueSeconds = m_queued.get_elapsed_time();
+  Timer decoding;
+  decoding.start();
+  try {
+    m_translator.TranslateSentence(m_source, m_options, m_lineNumber, m_result.result);
+  } catch (const std::exception &e) {
+    m_result.error = e.what();
+  }
+  m_stats.AddSentence(queueSeconds, decoding.get_elapsed_time());
+  m_pending.Done();
+}
+
+/** Reports the requests and sentences served, their latencies, and the
+ * state of the decoder pool */
+class Stats : public xmlrpc_c::method
+{
+public:
+  explicit Stats(Translator &translator) : m_translator(translator) {
+    this->_signature = "S:";
+    this->_help = "Returns the statistics of the translation service";
+  }
 
+  void
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP) {
+    paramList.verifyEnd(0);
+    map<string, xmlrpc_c::value> retData;
+    m_translator.GetStats().Insert(retData);
+#ifdef WITH_THREADS
+    const ThreadPoolStats pool = m_translator.GetPoolStats();
+    retData["threads"] = xmlrpc_c::value_int(pool.threads);
+    retData["queued"] = xmlrpc_c::value_int(pool.queued);
+    retData["max-queued"] = xmlrpc_c::value_int(pool.maxQueued);
+    retData["utilization"] = xmlrpc_c::value_double(pool.Utilization());
+#endif
+    *retvalP = xmlrpc_c::value_struct(retData);
+  }
 
+private:
+  Translator &m_translator;
 };
 
 
@@ -334,6 +638,8 @@ int main(int argc, char** argv)
   int port = 8080;
   const char* logfile = "/dev/null";
   bool isSerial = false;
+  size_t queueLimit = 0;
+  bool hasQueueLimit = false;
 
   for (int i = 0; i < argc; ++i) {
     if (!strcmp(argv[i],"--server-port")) {
@@ -352,6 +658,15 @@ int main(int argc, char** argv)
       } else {
         logfile = argv[i];
       }
+    } else if (!strcmp(argv[i],"--server-queue-limit")) {
+      ++i;
+      if (i >= argc) {
+        cerr << "Error: Missing argument to --server-queue-limit" << endl;
+        exit(1);
+      } else {
+        queueLimit = atoi(argv[i]);
+        hasQueueLimit = true;
+      }
     } else if (!strcmp(argv[i], "--serial")) {
       cerr << "Running single-threaded server" << endl;
       isSerial = true;
@@ -373,11 +688,26 @@ int main(int argc, char** argv)
 
   xmlrpc_c::registry myRegistry;
 
-  xmlrpc_c::methodPtr const translator(new Translator);
+  // the -threads decoders are shared by all the connections, which Abyss
+  // serves concurrently unless --serial. By default, a few sentences a thread
+  // wait for one, and further requests wait to be queued
+  size_t threads = StaticData::Instance().ThreadCount();
+  if (!isSerial && threads == 1) {
+    cerr << "Warning: decoding with one thread, so concurrent requests wait for each other."
+         << " Use -threads to decode several sentences at once, or --serial" << endl;
+  }
+  if (!hasQueueLimit) {
+    queueLimit = 4 * threads;
+  }
+  cerr << "Decoding with " << threads << " threads, queueing up to " << queueLimit << " sentences" << endl;
+  Translator *translatorMethod = new Translator(threads, queueLimit);
+  xmlrpc_c::methodPtr const translator(translatorMethod);
   xmlrpc_c::methodPtr const updater(new Updater);
+  xmlrpc_c::methodPtr const stats(new Stats(*translatorMethod));
 
   myRegistry.addMethod("translate", translator);
   myRegistry.addMethod("updater", updater);
+  myRegistry.addMethod("stats", stats);
 
   xmlrpc_c::serverAbyss myAbyssServer(
     myRegistry,
@@ -58,6 +58,10 @@ struct Config {
   // models.
   std::size_t building_memory;
 
+  // Number of threads that parse and sort the n-grams and train quantization
+  // when building a trie.  The sort buffer is shared between them.  
+  unsigned int building_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.  
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If NULL, defaults to write_mmap.  If that's NULL,
@@ -28,6 +28,14 @@ template <class Child, class StateT, class VocabularyT> class ModelFacade : publ
           new_word,
           *reinterpret_cast<State*>(out_state));
     }
+    void FullScoreBatch(const void *const *in_states, const WordIndex *new_words, std::size_t count, void *out_states, FullScoreReturn *out) const {
+      static_cast<const Child*>(this)->FullScoreBatch(
+          reinterpret_cast<const State *const *>(in_states),
+          new_words,
+          count,
+          reinterpret_cast<State*>(out_states),
+          out);
+    }
     float Score(const void *in_state, const WordIndex new_word, void *out_state) const {
       return static_cast<const Child*>(this)->Score(
           *reinterpret_cast<const State*>(in_state),
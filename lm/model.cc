@@ -119,6 +119,22 @@ template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search,
   return ret;
 }
 
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::FullScoreBatch(const State *const *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *out) const {
+  // How many queries ahead to prefetch.  Enough to cover a miss to memory, but
+  // the entries have to stay in cache until the query is scored.  
+  const std::size_t kLookahead = 8;
+  for (std::size_t i = 0; i < std::min(count, kLookahead); ++i) {
+    search_.Prefetch(in_states[i]->words, in_states[i]->words + in_states[i]->length, new_words[i]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i + kLookahead < count) {
+      const State &ahead = *in_states[i + kLookahead];
+      search_.Prefetch(ahead.words, ahead.words + ahead.length, new_words[i + kLookahead]);
+    }
+    out[i] = FullScore(*in_states[i], new_words[i], out_states[i]);
+  }
+}
+
 template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search, VocabularyT>::FullScoreForgotState(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word, State &out_state) const {
   context_rend = std::min(context_rend, context_rbegin + P::Order() - 1);
   FullScoreReturn ret = ScoreExceptBackoff(context_rbegin, context_rend, new_word, out_state);
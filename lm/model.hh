@@ -57,6 +57,14 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     FullScoreReturn FullScore(const State &in_state, const WordIndex new_word, State &out_state) const;
 
+    /* Score a batch of independent queries: p(new_words[i] | *in_states[i])
+     * into out[i], with the state in out_states[i].  The results are those of
+     * FullScore, but the memory the next few queries will look up is
+     * prefetched while a query is scored, so their cache misses overlap.
+     * None of out_states may be one of in_states.  
+     */
+    void FullScoreBatch(const State *const *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *out) const;
+
     /* Slower call without in_state.  Try to remember state, but sometimes it
      * would cost too much memory or your decoder isn't setup properly.  
      * To use this function, make an array of WordIndex containing the context
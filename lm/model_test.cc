@@ -274,6 +274,36 @@ template <class M> void Stateless(const M &model) {
   BOOST_CHECK_EQUAL(static_cast<WordIndex>(0), state.words[0]);
 }
 
+template <class M> void Batch(const M &model) {
+  const char *words[] = {"<s>", "looking", "on", "a", "little", "the", "biarritz", "not_found", "more", ".", "</s>"};
+  const size_t num_words = sizeof(words) / sizeof(const char*);
+  // The states after each prefix of the sentence.
+  std::vector<State> contexts(1, model.BeginSentenceState());
+  State out;
+  for (size_t i = 1; i < num_words; ++i) {
+    model.FullScore(contexts.back(), model.GetVocabulary().Index(words[i]), out);
+    contexts.push_back(out);
+  }
+  // Every word after every context, more than are prefetched ahead.
+  std::vector<const State*> in_states;
+  std::vector<WordIndex> new_words;
+  for (size_t c = 0; c < contexts.size(); ++c) {
+    for (size_t i = 0; i < num_words; ++i) {
+      in_states.push_back(&contexts[c]);
+      new_words.push_back(model.GetVocabulary().Index(words[i]));
+    }
+  }
+  std::vector<State> out_states(in_states.size());
+  std::vector<FullScoreReturn> rets(in_states.size());
+  model.FullScoreBatch(&in_states[0], &new_words[0], in_states.size(), &out_states[0], &rets[0]);
+  for (size_t i = 0; i < in_states.size(); ++i) {
+    FullScoreReturn ret = model.FullScore(*in_states[i], new_words[i], out);
+    BOOST_CHECK_EQUAL(ret.prob, rets[i].prob);
+    BOOST_CHECK_EQUAL(ret.ngram_length, rets[i].ngram_length);
+    BOOST_CHECK_EQUAL(out, out_states[i]);
+  }
+}
+
 template <class M> void NoUnkCheck(const M &model) {
   WordIndex unk_index = 0;
   State state;
@@ -290,6 +320,7 @@ template <class M> void Everything(const M &m) {
   MinimalState(m);
   ExtendLeftTest(m);
   Stateless(m);
+  Batch(m);
 }
 
 class ExpectEnumerateVocab : public EnumerateVocab {
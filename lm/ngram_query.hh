@@ -10,6 +10,8 @@
 #include <ostream>
 #include <istream>
 #include <string>
+#include <sstream>
+#include <vector>
 
 namespace lm {
 namespace ngram {
@@ -58,10 +60,95 @@ template <class Model> void Query(const Model &model, bool sentence_context, std
   util::PrintUsage(std::cerr);
 }
 
-template <class M> void Query(const char *file, bool sentence_context, std::istream &in_stream, std::ostream &out_stream) {
+/* Same output as Query, but sentences are read batch_size at a time and
+ * scored in lockstep: the i-th words of all of them form one batch for
+ * FullScoreBatch, as they don't depend on each other.  
+ */
+template <class Model> void BatchQuery(const Model &model, bool sentence_context, std::istream &in_stream, std::ostream &out_stream, std::size_t batch_size = 4096) {
+  std::cerr << "Loading statistics:\n";
+  util::PrintUsage(std::cerr);
+  const typename Model::State &begin = sentence_context ? model.BeginSentenceState() : model.NullContextState();
+  std::vector<std::vector<std::string> > words;
+  std::vector<std::vector<lm::WordIndex> > vocabs;
+  std::vector<std::vector<lm::FullScoreReturn> > rets;
+  std::vector<typename Model::State> states, out_states;
+  std::vector<const typename Model::State*> in_states;
+  std::vector<lm::WordIndex> batch_words;
+  std::vector<lm::FullScoreReturn> batch_rets;
+  std::vector<std::size_t> active;
+  std::string line, word;
+
+  while (in_stream) {
+    // Blank lines are skipped, as in Query.  
+    words.clear();
+    while (words.size() < batch_size && std::getline(in_stream, line)) {
+      std::istringstream tokens(line);
+      std::vector<std::string> sentence;
+      while (tokens >> word) sentence.push_back(word);
+      if (!sentence.empty()) words.push_back(sentence);
+    }
+    vocabs.resize(words.size());
+    rets.resize(words.size());
+    std::size_t longest = 0;
+    for (std::size_t s = 0; s < words.size(); ++s) {
+      vocabs[s].clear();
+      rets[s].clear();
+      for (std::size_t i = 0; i < words[s].size(); ++i) {
+        vocabs[s].push_back(model.GetVocabulary().Index(words[s][i]));
+      }
+      if (sentence_context) vocabs[s].push_back(model.GetVocabulary().EndSentence());
+      longest = std::max(longest, vocabs[s].size());
+    }
+
+    states.assign(words.size(), begin);
+    out_states.resize(words.size());
+    for (std::size_t position = 0; position < longest; ++position) {
+      active.clear();
+      in_states.clear();
+      batch_words.clear();
+      for (std::size_t s = 0; s < vocabs.size(); ++s) {
+        if (position >= vocabs[s].size()) continue;
+        active.push_back(s);
+        in_states.push_back(&states[s]);
+        batch_words.push_back(vocabs[s][position]);
+      }
+      batch_rets.resize(active.size());
+      model.FullScoreBatch(&in_states[0], &batch_words[0], active.size(), &out_states[0], &batch_rets[0]);
+      for (std::size_t i = 0; i < active.size(); ++i) {
+        states[active[i]] = out_states[i];
+        rets[active[i]].push_back(batch_rets[i]);
+      }
+    }
+
+    for (std::size_t s = 0; s < words.size(); ++s) {
+      float total = 0.0;
+      unsigned int oov = 0;
+      for (std::size_t i = 0; i < vocabs[s].size(); ++i) {
+        const lm::FullScoreReturn &ret = rets[s][i];
+        total += ret.prob;
+        if (i < words[s].size()) {
+          if (vocabs[s][i] == 0) ++oov;
+          out_stream << words[s][i];
+        } else {
+          out_stream << "</s>";
+        }
+        out_stream << '=' << vocabs[s][i] << ' ' << static_cast<unsigned int>(ret.ngram_length)  << ' ' << ret.prob << '\t';
+      }
+      out_stream << "Total: " << total << " OOV: " << oov << '\n';
+    }
+  }
+  std::cerr << "After queries:\n";
+  util::PrintUsage(std::cerr);
+}
+
+template <class M> void Query(const char *file, bool sentence_context, bool batch, std::istream &in_stream, std::ostream &out_stream) {
   Config config;
   M model(file, config);
-  Query(model, sentence_context, in_stream, out_stream);
+  if (batch) {
+    BatchQuery(model, sentence_context, in_stream, out_stream);
+  } else {
+    Query(model, sentence_context, in_stream, out_stream);
+  }
 }
 
 } // namespace ngram
@@ -41,6 +41,16 @@ uint64_t ReadCount(const std::string &from) {
   return ret;
 }
 
+void CheckBackoff(float backoff) {
+#ifdef WIN32
+  int float_class = _fpclass(backoff);
+  UTIL_THROW_IF(float_class == _FPCLASS_SNAN || float_class == _FPCLASS_QNAN || float_class == _FPCLASS_NINF || float_class == _FPCLASS_PINF, FormatLoadException, "Bad backoff " << backoff);
+#else
+  int float_class = std::fpclassify(backoff);
+  UTIL_THROW_IF(float_class == FP_NAN || float_class == FP_INFINITE, FormatLoadException, "Bad backoff " << backoff);
+#endif
+}
+
 } // namespace
 
 void ReadARPACounts(util::FilePiece &in, std::vector<uint64_t> &number) {
@@ -104,15 +114,7 @@ void ReadBackoff(util::FilePiece &in, float &backoff) {
     case '\t':
       backoff = in.ReadFloat();
       if (backoff == ngram::kExtensionBackoff) backoff = ngram::kNoExtensionBackoff;
-      {
-#ifdef WIN32
-		int float_class = _fpclass(backoff);
-        UTIL_THROW_IF(float_class == _FPCLASS_SNAN || float_class == _FPCLASS_QNAN || float_class == _FPCLASS_NINF || float_class == _FPCLASS_PINF, FormatLoadException, "Bad backoff " << backoff);
-#else
-        int float_class = std::fpclassify(backoff);
-        UTIL_THROW_IF(float_class == FP_NAN || float_class == FP_INFINITE, FormatLoadException, "Bad backoff " << backoff);
-#endif
-      }
+      CheckBackoff(backoff);
       UTIL_THROW_IF(in.get() != '\n', FormatLoadException, "Expected newline after backoff");
       break;
     case '\n':
@@ -123,6 +125,65 @@ void ReadBackoff(util::FilePiece &in, float &backoff) {
   }
 }
 
+float ReadFloat(StringPiece &line) {
+  const char *begin = line.data(), *end = line.data() + line.size();
+  for (; begin != end && util::kSpaces[static_cast<unsigned char>(*begin)]; ++begin) {}
+  // strtof wants a terminator, so copy the number.  
+  char buffer[64];
+  std::size_t length = 0;
+  for (; begin + length != end && length < sizeof(buffer) - 1 && !util::kSpaces[static_cast<unsigned char>(begin[length])]; ++length) {
+    buffer[length] = begin[length];
+  }
+  buffer[length] = 0;
+  char *parsed;
+#if defined(sun) || defined(WIN32)
+  float ret = static_cast<float>(strtod(buffer, &parsed));
+#else
+  float ret = strtof(buffer, &parsed);
+#endif
+  if (parsed == buffer) throw util::ParseNumberException(StringPiece(begin, length));
+  begin += parsed - buffer;
+  line = StringPiece(begin, end - begin);
+  return ret;
+}
+
+StringPiece ReadWord(StringPiece &line) {
+  const char *begin = line.data(), *end = line.data() + line.size();
+  for (; begin != end && kARPASpaces[static_cast<unsigned char>(*begin)]; ++begin) {}
+  const char *word_end = begin;
+  for (; word_end != end && !kARPASpaces[static_cast<unsigned char>(*word_end)]; ++word_end) {}
+  UTIL_THROW_IF(begin == word_end, FormatLoadException, "Too few words");
+  line = StringPiece(word_end, end - word_end);
+  return StringPiece(begin, word_end - begin);
+}
+
+void ReadBackoff(StringPiece &line, Prob &/*weights*/) {
+  if (line.empty()) return;
+  UTIL_THROW_IF(line.data()[0] != '\t', FormatLoadException, "Expected tab or newline for backoff");
+  line = StringPiece(line.data() + 1, line.size() - 1);
+  float got = ReadFloat(line);
+  if (got != 0.0)
+    UTIL_THROW(FormatLoadException, "Non-zero backoff " << got << " provided for an n-gram that should have no backoff");
+  // Like the FilePiece version, which leaves the rest for the next ReadFloat to skip.  
+  for (const char *i = line.data(); i != line.data() + line.size(); ++i) {
+    UTIL_THROW_IF(!util::kSpaces[static_cast<unsigned char>(*i)], FormatLoadException, "Expected newline after backoff");
+  }
+}
+
+void ReadBackoff(StringPiece &line, float &backoff) {
+  // See the FilePiece version about negative zero.  
+  if (line.empty()) {
+    backoff = ngram::kNoExtensionBackoff;
+    return;
+  }
+  UTIL_THROW_IF(line.data()[0] != '\t', FormatLoadException, "Expected tab or newline for backoff");
+  line = StringPiece(line.data() + 1, line.size() - 1);
+  backoff = ReadFloat(line);
+  if (backoff == ngram::kExtensionBackoff) backoff = ngram::kNoExtensionBackoff;
+  CheckBackoff(backoff);
+  UTIL_THROW_IF(!line.empty(), FormatLoadException, "Expected newline after backoff");
+}
+
 void ReadEnd(util::FilePiece &in) {
   StringPiece line;
   do {
@@ -24,6 +24,19 @@ inline void ReadBackoff(util::FilePiece &in, RestWeights &weights) {
   ReadBackoff(in, weights.backoff);
 }
 
+// The same, for an n-gram line already in memory, without its newline.  Each
+// consumes what it parsed from the front of line.  
+float ReadFloat(StringPiece &line);
+StringPiece ReadWord(StringPiece &line);
+void ReadBackoff(StringPiece &line, Prob &weights);
+void ReadBackoff(StringPiece &line, float &backoff);
+inline void ReadBackoff(StringPiece &line, ProbBackoff &weights) {
+  ReadBackoff(line, weights.backoff);
+}
+inline void ReadBackoff(StringPiece &line, RestWeights &weights) {
+  ReadBackoff(line, weights.backoff);
+}
+
 void ReadEnd(util::FilePiece &in);
 
 extern const bool kARPASpaces[256];
@@ -37,6 +50,12 @@ class PositiveProbWarn {
 
     void Warn(float prob);
 
+    // Threads warn through their own copies.  A complaint from any of them
+    // silences the rest.  
+    void Merge(const PositiveProbWarn &other) {
+      if (other.action_ == SILENT) action_ = SILENT;
+    }
+
   private:
     WarningAction action_;
 };
@@ -85,6 +104,26 @@ template <class Voc, class Weights> void ReadNGram(util::FilePiece &f, const uns
   }
 }
 
+// Parse one line of n-grams.  This only reads from the vocabulary, so several
+// threads can parse the lines of an order at once, each with its own warn.  
+template <class Voc, class Weights> void ReadNGram(const StringPiece &line, const unsigned char n, const Voc &vocab, WordIndex *const reverse_indices, Weights &weights, PositiveProbWarn &warn) {
+  try {
+    StringPiece rest(line);
+    weights.prob = ReadFloat(rest);
+    if (weights.prob > 0.0) {
+      warn.Warn(weights.prob);
+      weights.prob = 0.0;
+    }
+    for (WordIndex *vocab_out = reverse_indices + n - 1; vocab_out >= reverse_indices; --vocab_out) {
+      *vocab_out = vocab.Index(ReadWord(rest));
+    }
+    ReadBackoff(rest, weights);
+  } catch(util::Exception &e) {
+    e << " in the " << static_cast<unsigned int>(n) << "-gram \"" << line << '"';
+    throw;
+  }
+}
+
 } // namespace lm
 
 #endif // LM_READ_ARPA__
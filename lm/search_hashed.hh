@@ -132,6 +132,22 @@ template <class Value> class HashedSearch {
       return LongestPointer(found->value.prob);
     }
 
+    // Prefetch the entries a query of new_word after context may look up.  The
+    // hashes of all the orders only depend on the words, so this needs no lookups.  
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, WordIndex new_word) const {
+      unigram_.Prefetch(new_word);
+      Node node = static_cast<Node>(new_word);
+      unsigned char order_minus_2 = 0;
+      for (const WordIndex *i = context_rbegin; i < context_rend; ++i, ++order_minus_2) {
+        node = CombineWordHash(node, *i);
+        if (order_minus_2 == middle_.size()) {
+          longest_.Prefetch(node);
+          return;
+        }
+        middle_[order_minus_2].Prefetch(node);
+      }
+    }
+
     // Generate a node without necessarily checking that it actually exists.  
     // Optionally return false if it's know to not exist.  
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
@@ -171,6 +187,12 @@ template <class Value> class HashedSearch {
           return unigram_[index];
         }
 
+        void Prefetch(WordIndex index) const {
+#ifdef __GNUC__
+          __builtin_prefetch(unigram_ + index);
+#endif
+        }
+
         typename Value::Weights &Unknown() { return unigram_[0]; }
 
         void LoadedBinary() {}
@@ -25,8 +25,13 @@
 #include <queue>
 #include <limits>
 #include <numeric>
+#include <string>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/thread/thread.hpp>
+#endif
+
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 #endif
@@ -450,6 +455,58 @@ template <class Quant> void TrainProbQuantizer(uint8_t order, uint64_t count, Re
   quant.TrainProb(order, probs);
 }
 
+#ifdef WITH_THREADS
+// Trains the quantizer of one order.  Orders have their own files and tables, so
+// they can be trained by several threads at once.  
+template <class Quant> class TrainWorker {
+  public:
+    // additional is NULL for the longest order, which has no backoff.  
+    TrainWorker(uint8_t order, uint64_t count, const std::vector<float> *additional, RecordReader &reader, Quant &quant, std::string &error)
+      : order_(order), count_(count), additional_(additional), reader_(reader), quant_(quant), error_(error) {}
+
+    void operator()() {
+      try {
+        util::ErsatzProgress silent;
+        if (additional_) {
+          TrainQuantizer(order_, count_, *additional_, reader_, silent, quant_);
+        } else {
+          TrainProbQuantizer(order_, count_, reader_, silent, quant_);
+        }
+      } catch (const std::exception &e) {
+        error_ = e.what();
+      }
+    }
+
+  private:
+    uint8_t order_;
+    uint64_t count_;
+    const std::vector<float> *additional_;
+    RecordReader &reader_;
+    Quant &quant_;
+    std::string &error_;
+};
+
+template <class Quant> void TrainInParallel(const std::vector<uint64_t> &counts, const SRISucks &sri, RecordReader *inputs, unsigned int threads, Quant &quant) {
+  const unsigned char order = counts.size();
+  std::vector<std::string> errors(order - 1);
+  for (unsigned int start = 2; start <= order; start += threads) {
+    // Each holds the values of its order in memory, so only run as many as threads.  
+    boost::thread_group group;
+    for (unsigned int i = start; i <= order && i < start + threads; ++i) {
+      group.create_thread(TrainWorker<Quant>(i, counts[i-1], i == order ? NULL : &sri.Values(i), inputs[i-2], quant, errors[i-2]));
+    }
+    group.join_all();
+  }
+  for (std::vector<std::string>::const_iterator i = errors.begin(); i != errors.end(); ++i) {
+    if (!i->empty()) {
+      FormatLoadException e;
+      e << *i;
+      throw e;
+    }
+  }
+}
+#endif // WITH_THREADS
+
 void PopulateUnigramWeights(FILE *file, WordIndex unigram_count, RecordReader &contexts, UnigramValue *unigrams) {
   // Fill unigram probabilities.  
   try {
@@ -505,10 +562,18 @@ template <class Quant, class Bhiksha> void BuildTrie(SortedFiles &files, std::ve
   }
   if (Quant::kTrain) {
     util::ErsatzProgress progress(std::accumulate(counts.begin() + 1, counts.end(), 0), config.messages, "Quantizing");
-    for (unsigned char i = 2; i < counts.size(); ++i) {
-      TrainQuantizer(i, counts[i-1], sri.Values(i), inputs[i-2], progress, quant);
+#ifdef WITH_THREADS
+    if (config.building_threads > 1) {
+      TrainInParallel(counts, sri, inputs, config.building_threads, quant);
+      progress.Finished();
+    } else
+#endif
+    {
+      for (unsigned char i = 2; i < counts.size(); ++i) {
+        TrainQuantizer(i, counts[i-1], sri.Values(i), inputs[i-2], progress, quant);
+      }
+      TrainProbQuantizer(counts.size(), counts.back(), inputs[counts.size() - 2], progress, quant);
     }
-    TrainProbQuantizer(counts.size(), counts.back(), inputs[counts.size() - 2], progress, quant);
     quant.FinishedLoading(config);
   }
 
@@ -89,6 +89,11 @@ template <class Quant, class Bhiksha> class TrieSearch {
       return LongestPointer(quant_, longest_.Find(word, node));
     }
 
+    // Where the middle orders are depends on the unigram, so only it can be prefetched.  
+    void Prefetch(const WordIndex * /*context_rbegin*/, const WordIndex * /*context_rend*/, WordIndex new_word) const {
+      unigram_.Prefetch(new_word);
+    }
+
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
       assert(begin != end);
       bool independent_left;
@@ -71,6 +71,14 @@ class Unigram {
       return UnigramPointer(val->weights);
     }
 
+    void Prefetch(WordIndex word) const {
+#ifdef __GNUC__
+      // Find also reads the next entry.  
+      __builtin_prefetch(unigram_ + word);
+      __builtin_prefetch(unigram_ + word + 1);
+#endif
+    }
+
   private:
     UnigramValue *unigram_;
 };  
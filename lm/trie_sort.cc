@@ -9,6 +9,7 @@
 #include "util/file_piece.hh"
 #include "util/mmap.hh"
 #include "util/proxy_iterator.hh"
+#include "util/scoped.hh"
 #include "util/sized_iterator.hh"
 
 #include <algorithm>
@@ -16,9 +17,17 @@
 #include <cstdio>
 #include <cstdlib>
 #include <deque>
+#include <exception>
 #include <limits>
+#include <queue>
+#include <string>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 namespace lm {
 namespace ngram {
 namespace trie {
@@ -101,40 +110,195 @@ FILE *WriteContextFile(uint8_t *begin, uint8_t *end, const util::TempMaker &make
   return out.release();
 }
 
+void SortEntries(uint8_t *begin, uint8_t *end, std::size_t entry_size, unsigned char order) {
+  util::SizedProxy proxy_begin(begin, entry_size), proxy_end(end, entry_size);
+  // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.  
+#if defined(_WIN32) || defined(_WIN64)
+  std::stable_sort
+#else
+  std::sort
+#endif
+      (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
+}
+
+// Runs the workers, each in its own thread if there are threads.  
+template <class Worker> void RunWorkers(std::vector<Worker> &workers) {
+#ifdef WITH_THREADS
+  if (workers.size() > 1) {
+    boost::thread_group group;
+    for (typename std::vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i) {
+      group.create_thread(boost::ref(*i));
+    }
+    group.join_all();
+    return;
+  }
+#endif
+  for (typename std::vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i) {
+    (*i)();
+  }
+}
+
+// Exceptions don't cross threads, so workers keep the message.  
+void ThrowWorkerErrors(const std::vector<std::string> &errors) {
+  for (std::vector<std::string>::const_iterator i = errors.begin(); i != errors.end(); ++i) {
+    if (!i->empty()) {
+      FormatLoadException e;
+      e << *i;
+      throw e;
+    }
+  }
+}
+
+// Parses some of the lines of an order into entries.  
+template <class Weights> class ParseWorker {
+  public:
+    ParseWorker(const StringPiece *begin, const StringPiece *end, unsigned char order, const SortedVocabulary &vocab, uint8_t *out, std::size_t entry_size, PositiveProbWarn &warn, std::string &error)
+      : begin_(begin), end_(end), order_(order), vocab_(vocab), out_(out), entry_size_(entry_size), warn_(warn), error_(error) {}
+
+    void operator()() {
+      try {
+        uint8_t *out = out_;
+        for (const StringPiece *i = begin_; i != end_; ++i, out += entry_size_) {
+          ReadNGram(*i, order_, vocab_, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Weights*>(out + sizeof(WordIndex) * order_), warn_);
+        }
+      } catch (const std::exception &e) {
+        error_ = e.what();
+      }
+    }
+
+  private:
+    const StringPiece *begin_, *end_;
+    unsigned char order_;
+    const SortedVocabulary &vocab_;
+    uint8_t *out_;
+    std::size_t entry_size_;
+    PositiveProbWarn &warn_;
+    std::string &error_;
+};
+
+bool IsBlank(const StringPiece &line) {
+  for (const char *i = line.data(); i != line.data() + line.size(); ++i) {
+    if (!util::kSpaces[static_cast<unsigned char>(*i)]) return false;
+  }
+  return true;
+}
+
+// Fill [out, out_end) with n-grams parsed by several threads.  Reading is
+// serial, so lines are copied a few at a time and parsed in parallel.  
+template <class Weights> void ParseInParallel(util::FilePiece &f, unsigned char order, const SortedVocabulary &vocab, PositiveProbWarn &warn, unsigned int threads, uint8_t *out, uint8_t *out_end, std::size_t entry_size) {
+  const std::size_t kLinesPerThread = 65536;
+  std::string text;
+  std::vector<std::size_t> line_ends;
+  std::vector<StringPiece> lines;
+  while (out != out_end) {
+    const std::size_t count = std::min<std::size_t>((out_end - out) / entry_size, kLinesPerThread * threads);
+    text.clear();
+    line_ends.clear();
+    while (line_ends.size() < count) {
+      // FilePiece parsing skips blank lines as spaces.  
+      StringPiece line(f.ReadLine());
+      if (IsBlank(line)) continue;
+      text.append(line.data(), line.size());
+      line_ends.push_back(text.size());
+    }
+    lines.clear();
+    for (std::size_t i = 0, start = 0; i < count; start = line_ends[i++]) {
+      lines.push_back(StringPiece(text.data() + start, line_ends[i] - start));
+    }
+
+    const unsigned int workers_count = std::min<std::size_t>(threads, count);
+    std::vector<PositiveProbWarn> warns(workers_count, warn);
+    std::vector<std::string> errors(workers_count);
+    std::vector<ParseWorker<Weights> > workers;
+    workers.reserve(workers_count);
+    for (unsigned int i = 0; i < workers_count; ++i) {
+      std::size_t begin = count * i / workers_count, end = count * (i + 1) / workers_count;
+      workers.push_back(ParseWorker<Weights>(&lines[0] + begin, &lines[0] + end, order, vocab, out + begin * entry_size, entry_size, warns[i], errors[i]));
+    }
+    RunWorkers(workers);
+    for (unsigned int i = 0; i < workers_count; ++i) {
+      warn.Merge(warns[i]);
+    }
+    ThrowWorkerErrors(errors);
+    out += count * entry_size;
+  }
+}
+
+// Sorts part of a batch, then writes it and its contexts to files.  
+class SortWorker {
+  public:
+    SortWorker(uint8_t *begin, uint8_t *end, const util::TempMaker &maker, std::size_t entry_size, unsigned char order, FILE *&full, FILE *&context, std::string &error)
+      : begin_(begin), end_(end), maker_(maker), entry_size_(entry_size), order_(order), full_(full), context_(context), error_(error) {}
+
+    void operator()() {
+      try {
+        SortEntries(begin_, end_, entry_size_, order_);
+        full_ = DiskFlush(begin_, end_, maker_);
+        context_ = WriteContextFile(begin_, end_, maker_, entry_size_, order_);
+      } catch (const std::exception &e) {
+        error_ = e.what();
+      }
+    }
+
+  private:
+    uint8_t *begin_, *end_;
+    const util::TempMaker &maker_;
+    std::size_t entry_size_;
+    unsigned char order_;
+    FILE *&full_, *&context_;
+    std::string &error_;
+};
+
+// Called with a record equal to the one just written.  
 struct ThrowCombine {
-  void operator()(std::size_t /*entry_size*/, const void * /*first*/, const void * /*second*/, FILE * /*out*/) const {
+  void operator()(std::size_t /*entry_size*/, const void * /*written*/, const void * /*duplicate*/) const {
     UTIL_THROW(FormatLoadException, "Duplicate n-gram detected.");
   }
 };
 
-// Useful for context files that just contain records with no value.  
+// Useful for context files that just contain records with no value.  The first
+// copy has already been written.  
 struct FirstCombine {
-  void operator()(std::size_t entry_size, const void *first, const void * /*second*/, FILE *out) const {
-    util::WriteOrThrow(out, first, entry_size);
-  }
+  void operator()(std::size_t /*entry_size*/, const void * /*written*/, const void * /*duplicate*/) const {}
+};
+
+class GreaterRecord : public std::binary_function<const RecordReader*, const RecordReader*, bool> {
+  public:
+    explicit GreaterRecord(unsigned char order) : less_(order) {}
+
+    bool operator()(const RecordReader *first, const RecordReader *second) const {
+      return less_(second->Data(), first->Data());
+    }
+
+  private:
+    EntryCompare less_;
 };
 
-template <class Combine> FILE *MergeSortedFiles(FILE *first_file, FILE *second_file, const util::TempMaker &maker, std::size_t weights_size, unsigned char order, const Combine &combine) {
+// Merge all the sorted files in one pass, taking the least record with a heap.  
+template <class Combine> FILE *MergeSortedFiles(const std::deque<FILE*> &files, const util::TempMaker &maker, std::size_t weights_size, unsigned char order, const Combine &combine) {
   std::size_t entry_size = sizeof(WordIndex) * order + weights_size;
-  RecordReader first, second;
-  first.Init(first_file, entry_size);
-  second.Init(second_file, entry_size);
+  util::scoped_array<RecordReader> readers(new RecordReader[files.size()]);
+  std::priority_queue<RecordReader*, std::vector<RecordReader*>, GreaterRecord> queue((GreaterRecord(order)));
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    readers[i].Init(files[i], entry_size);
+    if (readers[i]) queue.push(&readers[i]);
+  }
   util::scoped_FILE out_file(maker.MakeFile());
+  util::scoped_malloc written(malloc(entry_size));
+  UTIL_THROW_IF(!written.get(), util::ErrnoException, "Failed to malloc merge buffer");
   EntryCompare less(order);
-  while (first && second) {
-    if (less(first.Data(), second.Data())) {
-      util::WriteOrThrow(out_file.get(), first.Data(), entry_size);
-      ++first;
-    } else if (less(second.Data(), first.Data())) {
-      util::WriteOrThrow(out_file.get(), second.Data(), entry_size);
-      ++second;
+  bool any = false;
+  while (!queue.empty()) {
+    RecordReader *top = queue.top();
+    queue.pop();
+    if (any && !less(written.get(), top->Data())) {
+      combine(entry_size, written.get(), top->Data());
     } else {
-      combine(entry_size, first.Data(), second.Data(), out_file.get());
-      ++first; ++second;
+      util::WriteOrThrow(out_file.get(), top->Data(), entry_size);
+      memcpy(written.get(), top->Data(), entry_size);
+      any = true;
     }
-  }
-  for (RecordReader &remains = (first ? first : second); remains; ++remains) {
-    util::WriteOrThrow(out_file.get(), remains.Data(), entry_size);
+    if (++*top) queue.push(top);
   }
   return out_file.release();
 }
@@ -201,8 +365,9 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
   mem.reset(malloc(buffer));
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
+  const unsigned int threads = std::max(1U, config.building_threads);
   for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, maker, order, warn, mem.get(), buffer);
+    ConvertToSorted(f, vocab, counts, maker, order, warn, threads, mem.get(), buffer);
   }
   ReadEnd(f);
 }
@@ -217,17 +382,12 @@ class Closer {
         util::scoped_FILE deleter(*i);
       }
     }
-
-    void PopFront() {
-      util::scoped_FILE deleter(files_.front());
-      files_.pop_front();
-    }
   private:
     std::deque<FILE*> &files_;
 };
 } // namespace
 
-void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
+void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, unsigned int threads, void *mem, std::size_t mem_size) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
   // Size of weights.  Does it include backoff?  
@@ -243,7 +403,13 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
   for (std::size_t batch = 0, done = 0; done < count; ++batch) {
     uint8_t *out = begin;
     uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
-    if (order == counts.size()) {
+    if (threads > 1) {
+      if (order == counts.size()) {
+        ParseInParallel<Prob>(f, order, vocab, warn, threads, out, out_end, entry_size);
+      } else {
+        ParseInParallel<ProbBackoff>(f, order, vocab, warn, threads, out, out_end, entry_size);
+      }
+    } else if (order == counts.size()) {
       for (; out != out_end; out += entry_size) {
         ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
       }
@@ -252,33 +418,33 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
         ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
       }
     }
-    // Sort full records by full n-gram.  
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.  
-#if defined(_WIN32) || defined(_WIN64)
-    std::stable_sort
-#else
-    std::sort
-#endif
-        (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, maker));
-    contexts.push_back(WriteContextFile(begin, out_end, maker, entry_size, order));
+    // Sort full records by full n-gram, in a run per thread.  The runs are
+    // merged with the other batches.  
+    const std::size_t entries = (out_end - begin) / entry_size;
+    const unsigned int runs = std::min<std::size_t>(threads, entries);
+    std::vector<FILE*> run_files(runs), run_contexts(runs);
+    std::vector<std::string> errors(runs);
+    std::vector<SortWorker> workers;
+    workers.reserve(runs);
+    for (unsigned int i = 0; i < runs; ++i) {
+      workers.push_back(SortWorker(begin + entries * i / runs * entry_size, begin + entries * (i + 1) / runs * entry_size, maker, entry_size, order, run_files[i], run_contexts[i], errors[i]));
+    }
+    RunWorkers(workers);
+    for (unsigned int i = 0; i < runs; ++i) {
+      if (run_files[i]) files.push_back(run_files[i]);
+      if (run_contexts[i]) contexts.push_back(run_contexts[i]);
+    }
+    ThrowWorkerErrors(errors);
 
-    done += (out_end - begin) / entry_size;
+    done += entries;
   }
 
   // All individual files created.  Merge them.  
 
-  while (files.size() > 1) {
-    files.push_back(MergeSortedFiles(files[0], files[1], maker, weights_size, order, ThrowCombine()));
-    files_closer.PopFront();
-    files_closer.PopFront();
-    contexts.push_back(MergeSortedFiles(contexts[0], contexts[1], maker, 0, order - 1, FirstCombine()));
-    contexts_closer.PopFront();
-    contexts_closer.PopFront();
-  }
-
-  if (!files.empty()) {
+  if (files.size() > 1) {
+    full_[order - 2].reset(MergeSortedFiles(files, maker, weights_size, order, ThrowCombine()));
+    context_[order - 2].reset(MergeSortedFiles(contexts, maker, 0, order - 1, FirstCombine()));
+  } else if (!files.empty()) {
     // Steal from closers.
     full_[order - 2].reset(files.front());
     files.pop_front();
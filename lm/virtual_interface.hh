@@ -127,6 +127,10 @@ class Model {
     // Requires in_state != out_state
     virtual FullScoreReturn FullScore(const void *in_state, const WordIndex new_word, void *out_state) const = 0;
 
+    // Independent queries, scored as by FullScore, but faster.  out_states is
+    // count * StateSize() bytes of memory, none of which is any of in_states.  
+    virtual void FullScoreBatch(const void *const *in_states, const WordIndex *new_words, std::size_t count, void *out_states, FullScoreReturn *out) const = 0;
+
     unsigned char Order() const { return order_; }
 
     const Vocabulary &BaseVocabulary() const { return *base_vocab_; }
@@ -9,9 +9,11 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <set>
 
 #include "Data.h"
 #include "FileStream.h"
+#include "IndexedData.h"
 #include "Scorer.h"
 #include "ScorerFactory.h"
 #include "Util.h"
@@ -22,6 +24,35 @@ using namespace std;
 namespace MosesTuning
 {
 
+namespace {
+
+typedef vector<pair<string, float> > NamedSparse;
+
+void AppendFloats(string& key, const vector<float>& values)
+{
+  // values may be empty, e.g. without dense features
+  if (!values.empty()) {
+    key.append(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(float));
+  }
+}
+
+// the statistics of a hypothesis, as a string, to find duplicates in a file
+string HypothesisKey(const vector<float>& scores, const vector<float>& dense, NamedSparse& sparse)
+{
+  string key;
+  AppendFloats(key, scores);
+  AppendFloats(key, dense);
+  sort(sparse.begin(), sparse.end());
+  for (NamedSparse::const_iterator i = sparse.begin(); i != sparse.end(); ++i) {
+    key.append(i->first);
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&i->second), sizeof(float));
+  }
+  return key;
+}
+
+}
+
 Data::Data(Scorer* scorer, const string& sparse_weights_file)
     : m_scorer(scorer),
       m_score_type(m_scorer->getName()),
@@ -177,14 +208,111 @@ void Data::loadNBest(const string &file)
   inp.close();
 }
 
-void Data::save(const std::string &featfile, const std::string &scorefile, bool bin) {
+void Data::save(const std::string &featfile, const std::string &scorefile, bool bin, bool append) {
   if (bin)
     cerr << "Binary write mode is selected" << endl;
   else
     cerr << "Binary write mode is NOT selected" << endl;
 
-  m_feature_data->save(featfile, bin);
-  m_score_data->save(scorefile, bin);
+  if (bin) {
+    saveIndexed(featfile, scorefile, append);
+  } else {
+    m_feature_data->save(featfile, bin);
+    m_score_data->save(scorefile, bin);
+  }
+}
+
+void Data::saveIndexed(const std::string &featfile, const std::string &scorefile, bool append) {
+  size_t nSentences = m_feature_data->size();
+  assert(m_score_data->size() == nSentences);
+
+  // the hypotheses already in the files, by sentence
+  vector<set<string> > existing;
+  if (append && IndexedData::IsIndexed(featfile) != IndexedData::IsIndexed(scorefile)) {
+    throw runtime_error("Can't append to " + featfile + " and " + scorefile + ": only one of them exists");
+  }
+  if (append && IndexedData::IsIndexed(featfile)) {
+    IndexedData feats(featfile);
+    IndexedData scores(scorefile);
+    existing.resize(feats.NumSentences());
+    for (size_t s = 0; s < feats.NumSentences(); ++s) {
+      const vector<IndexedData::Block>& feat_blocks = feats.GetBlocks(s);
+      if (feat_blocks.empty()) continue;
+      if (s >= scores.NumSentences() || scores.GetBlocks(s).size() != feat_blocks.size()) {
+        throw runtime_error(featfile + " and " + scorefile + " don't match");
+      }
+      const vector<IndexedData::Block>& score_blocks = scores.GetBlocks(s);
+      for (size_t b = 0; b < feat_blocks.size(); ++b) {
+        const IndexedData::Block& fb = feat_blocks[b];
+        for (size_t h = 0; h < fb.count; ++h) {
+          const float* score = score_blocks[b].Dense(h, scores.NumDense());
+          const float* dense = fb.Dense(h, feats.NumDense());
+          NamedSparse sparse;
+          for (const IndexedData::SparseEntry* i = fb.SparseBegin(h); i != fb.SparseEnd(h); ++i) {
+            sparse.push_back(make_pair(feats.SparseNames()[i->id], i->value));
+          }
+          existing[s].insert(HypothesisKey(vector<float>(score, score + scores.NumDense()),
+                                           vector<float>(dense, dense + feats.NumDense()), sparse));
+        }
+      }
+    }
+  }
+
+  size_t num_features = m_feature_data->NumberOfFeatures();
+  size_t num_scores = m_score_data->NumberOfScores();
+  if (nSentences > 0 && m_feature_data->get(0).size() > 0) {
+    num_features = m_feature_data->get(0, 0).size();
+    num_scores = m_score_data->get(0, 0).size();
+  }
+  IndexedDataWriter feat_writer(featfile, IndexedData::FEATURES, num_features,
+                                m_feature_data->Features(), append);
+  IndexedDataWriter score_writer(scorefile, IndexedData::SCORES, num_scores,
+                                 m_score_type, append);
+
+  size_t nAdded = 0, nExisting = 0;
+  vector<float> dense, scores;
+  for (size_t s = 0; s < nSentences; s++) {
+    const FeatureArray& feat_array = m_feature_data->get(s);
+    const ScoreArray& score_array = m_score_data->get(s);
+    assert(feat_array.size() == score_array.size());
+    const size_t sentence = atoi(feat_array.getIndex().c_str());
+    const set<string>* seen = sentence < existing.size() ? &existing[sentence] : NULL;
+
+    bool added = false;
+    for (size_t k = 0; k < feat_array.size(); k++) {
+      const FeatureStats& feats = feat_array.get(k);
+      const ScoreStats& stats = score_array.get(k);
+      dense.assign(feats.getArray(), feats.getArray() + feats.size());
+      scores.clear();
+      for (size_t l = 0; l < stats.size(); l++) {
+        scores.push_back(stats.get(l));
+      }
+      if (seen && !seen->empty()) {
+        NamedSparse sparse;
+        const vector<size_t> ids = feats.getSparse().feats();
+        for (size_t l = 0; l < ids.size(); l++) {
+          sparse.push_back(make_pair(SparseVector::decode(ids[l]), feats.getSparse().get(ids[l])));
+        }
+        if (seen->count(HypothesisKey(scores, dense, sparse))) {
+          ++nExisting;
+          continue;
+        }
+      }
+      if (!added) {
+        feat_writer.AddSentence(sentence);
+        score_writer.AddSentence(sentence);
+        added = true;
+      }
+      feat_writer.AddHypothesis(dense, feats.getSparse());
+      score_writer.AddHypothesis(scores);
+      ++nAdded;
+    }
+  }
+  feat_writer.Write();
+  score_writer.Write();
+  if (append) {
+    TRACE_ERR("Appended " << nAdded << " hypotheses, " << nExisting << " were already there" << endl);
+  }
 }
 
 void Data::InitFeatureMap(const string& str) {
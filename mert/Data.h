@@ -61,7 +61,13 @@ public:
 
   void load(const std::string &featfile, const std::string &scorefile);
 
-  void save(const std::string &featfile, const std::string &scorefile, bool bin=false);
+  /**
+   * Save the statistics, in text or as IndexedData. With append, the
+   * hypotheses not already in the IndexedData files are added to them.
+   */
+  void save(const std::string &featfile, const std::string &scorefile, bool bin=false, bool append=false);
+
+  void saveIndexed(const std::string &featfile, const std::string &scorefile, bool append);
 
   //ADDED BY TS
   void removeDuplicates();
@@ -10,6 +10,7 @@
 
 #include <limits>
 #include "FileStream.h"
+#include "IndexedData.h"
 #include "Util.h"
 
 using namespace std;
@@ -69,6 +70,10 @@ void FeatureData::load(istream* is, const SparseVector& sparseWeights)
 void FeatureData::load(const string &file, const SparseVector& sparseWeights)
 {
   TRACE_ERR("loading feature data from " << file << endl);
+  if (IndexedData::IsIndexed(file)) {
+    load(IndexedData(file), sparseWeights);
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open feature file: " + file);
@@ -78,6 +83,49 @@ void FeatureData::load(const string &file, const SparseVector& sparseWeights)
   input_stream.close();
 }
 
+void FeatureData::load(const IndexedData& data, const SparseVector& sparseWeights)
+{
+  if (data.GetKind() != IndexedData::FEATURES) {
+    throw runtime_error("Not a feature data file");
+  }
+  const size_t num_dense = data.NumDense();
+  vector<size_t> sparse_ids;
+  for (size_t i = 0; i < data.SparseNames().size(); ++i) {
+    sparse_ids.push_back(SparseVector::encode(data.SparseNames()[i]));
+  }
+
+  FeatureArray entry;
+  for (size_t s = 0; s < data.NumSentences(); ++s) {
+    const vector<IndexedData::Block>& blocks = data.GetBlocks(s);
+    if (blocks.empty()) continue;
+    entry.clear();
+    entry.setIndex(stringify(s));
+    entry.NumberOfFeatures(num_dense);
+    entry.Features(data.Names());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      const IndexedData::Block& block = blocks[b];
+      for (size_t h = 0; h < block.count; ++h) {
+        FeatureStats stats;
+        const float* dense = block.Dense(h, num_dense);
+        for (size_t k = 0; k < num_dense; ++k) {
+          stats.add(dense[k]);
+        }
+        for (const IndexedData::SparseEntry* sparse = block.SparseBegin(h);
+             sparse != block.SparseEnd(h); ++sparse) {
+          stats.addSparse(sparse_ids.at(sparse->id), sparse->value);
+        }
+        stats.mergeSparse(sparseWeights);
+        entry.add(stats);
+      }
+    }
+
+    if (size() == 0)
+      setFeatureMap(entry.Features());
+
+    add(entry);
+  }
+}
+
 void FeatureData::add(FeatureArray& e)
 {
   if (exists(e.getIndex())) { // array at position e.getIndex() already exists
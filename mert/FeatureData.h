@@ -17,6 +17,7 @@
 namespace MosesTuning
 {
   
+class IndexedData;
 
 class FeatureData
 {
@@ -78,6 +79,7 @@ public:
 
   void load(std::istream* is, const SparseVector& sparseWeights);
   void load(const std::string &file, const SparseVector& sparseWeights);
+  void load(const IndexedData& data, const SparseVector& sparseWeights);
 
   bool check_consistency() const;
 
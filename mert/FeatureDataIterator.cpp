@@ -64,14 +64,57 @@ size_t hash_value(FeatureDataItem const& item) {
 }
 
 
-FeatureDataIterator::FeatureDataIterator() {}
+FeatureDataIterator::FeatureDataIterator() : m_sentence(0) {}
 
-FeatureDataIterator::FeatureDataIterator(const string& filename) {
-  m_in.reset(new FilePiece(filename.c_str()));
+FeatureDataIterator::FeatureDataIterator(const string& filename) : m_sentence(0) {
+  if (IndexedData::IsIndexed(filename)) {
+    m_bin.reset(new IndexedData(filename));
+    if (m_bin->GetKind() != IndexedData::FEATURES) {
+      throw runtime_error("Not a feature data file: " + filename);
+    }
+    const vector<string>& names = m_bin->SparseNames();
+    for (size_t i = 0; i < names.size(); ++i) {
+      m_sparse_ids.push_back(SparseVector::encode(names[i]));
+    }
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
+void FeatureDataIterator::readNextIndexed() {
+  m_next.clear();
+  // as in the text format, there's nothing for sentences without hypotheses
+  while (m_sentence < m_bin->NumSentences() && m_bin->GetBlocks(m_sentence).empty()) {
+    ++m_sentence;
+  }
+  if (m_sentence == m_bin->NumSentences()) {
+    m_bin.reset();
+    return;
+  }
+  const size_t num_dense = m_bin->NumDense();
+  const vector<IndexedData::Block>& blocks = m_bin->GetBlocks(m_sentence);
+  m_next.reserve(m_bin->NumHypotheses(m_sentence));
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const IndexedData::Block& block = blocks[b];
+    for (size_t h = 0; h < block.count; ++h) {
+      m_next.push_back(FeatureDataItem());
+      const float* dense = block.Dense(h, num_dense);
+      m_next.back().dense.assign(dense, dense + num_dense);
+      for (const IndexedData::SparseEntry* sparse = block.SparseBegin(h);
+           sparse != block.SparseEnd(h); ++sparse) {
+        m_next.back().sparse.set(m_sparse_ids[sparse->id], sparse->value);
+      }
+    }
+  }
+  ++m_sentence;
+}
+
 void FeatureDataIterator::readNext() {
+  if (m_bin) {
+    readNextIndexed();
+    return;
+  }
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
@@ -119,6 +162,9 @@ void FeatureDataIterator::increment() {
 }
 
 bool FeatureDataIterator::equal(const FeatureDataIterator& rhs) const {
+  if (m_bin || rhs.m_bin) {
+    return m_bin == rhs.m_bin && m_sentence == rhs.m_sentence;
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
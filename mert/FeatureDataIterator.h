@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/string_piece.hh"
 
 #include "FeatureStats.h"
+#include "IndexedData.h"
 
 namespace MosesTuning
 {
@@ -90,7 +91,13 @@ class FeatureDataIterator :
 
     void readNext();
 
+    void readNextIndexed();
+
     boost::shared_ptr<util::FilePiece> m_in;
+    // the file, if it's an IndexedData, and the next sentence to read from it
+    boost::shared_ptr<IndexedData> m_bin;
+    std::size_t m_sentence;
+    std::vector<std::size_t> m_sparse_ids; // of the sparse features of m_bin
     std::vector<FeatureDataItem> m_next;
 };
 
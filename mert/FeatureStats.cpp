@@ -55,6 +55,10 @@ void SparseVector::set(const string& name, FeatureStatsType value) {
   m_fvector[id] = value;
 }
 
+void SparseVector::set(size_t id, FeatureStatsType value) {
+  m_fvector[id] = value;
+}
+
 void SparseVector::write(ostream& out, const string& sep) const {
   for (fvector_t::const_iterator i = m_fvector.begin(); i != m_fvector.end(); ++i) {
     if (abs(i->second) < 0.00001) continue;
@@ -212,6 +216,11 @@ void FeatureStats::addSparse(const string& name, FeatureStatsType v)
   m_map.set(name,v);
 }
 
+void FeatureStats::addSparse(size_t id, FeatureStatsType v)
+{
+  m_map.set(id,v);
+}
+
 void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
 {
   string substring, stringBuf;
@@ -230,6 +239,17 @@ void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
     }
   }
 
+  mergeSparse(sparseWeights);
+  /*
+  cerr << "FS: ";
+  for (size_t i = 0; i < entries_; ++i) {
+    cerr << array_[i] << " ";
+  }
+  cerr << endl;*/
+}
+
+void FeatureStats::mergeSparse(const SparseVector& sparseWeights)
+{
   if (sparseWeights.size()) {
     //Merge the sparse features
     FeatureStatsType merged = inner_product(sparseWeights, m_map);
@@ -243,12 +263,6 @@ void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
     */
     m_map.clear();
   }
-  /*
-  cerr << "FS: ";
-  for (size_t i = 0; i < entries_; ++i) {
-    cerr << array_[i] << " ";
-  }
-  cerr << endl;*/
 }
 
 void FeatureStats::loadbin(istream* is)
@@ -30,6 +30,7 @@ public:
   FeatureStatsType get(const std::string& name) const;
   FeatureStatsType get(std::size_t id) const;
   void set(const std::string& name, FeatureStatsType value);
+  void set(std::size_t id, FeatureStatsType value);
   void clear();
   void load(const std::string& file);
   std::size_t size() const { return m_fvector.size(); }
@@ -82,6 +83,13 @@ public:
   void expand();
   void add(FeatureStatsType v);
   void addSparse(const std::string& name, FeatureStatsType v);
+  void addSparse(std::size_t id, FeatureStatsType v);
+
+  /**
+   * If there are sparse weights, replace the sparse features by a
+   * single dense one, their weighted sum.
+   */
+  void mergeSparse(const SparseVector& sparseWeights);
 
   void clear() {
     memset((void*)m_array, 0, GetArraySizeWithBytes());
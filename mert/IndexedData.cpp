@@ -0,0 +1,289 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "IndexedData.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "util/file.hh"
+
+#include "FeatureStats.h"
+
+using namespace std;
+
+namespace MosesTuning
+{
+
+namespace {
+
+const char kMagic[8] = { 'M', 'E', 'R', 'T', 'I', 'D', 'X', '1' };
+
+struct FileHeader {
+  char magic[8];
+  uint32_t kind;
+  uint32_t num_dense;
+  uint32_t names_size;  // followed by the names, padded to 8 bytes
+  uint32_t reserved;
+};
+
+struct SegmentHeader {
+  uint64_t size;           // in bytes, including this header
+  uint32_t num_sentences;
+  uint32_t num_sparse;     // new sparse feature names, which follow
+};
+
+struct SentenceEntry {
+  uint32_t sentence;
+  uint32_t count;
+  uint64_t offset;         // of the data of the sentence, from the segment start
+};
+
+inline size_t Padded(size_t size)
+{
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+template <class T> void Append(vector<char>& out, const T* data, size_t count)
+{
+  const char* begin = reinterpret_cast<const char*>(data);
+  out.insert(out.end(), begin, begin + count * sizeof(T));
+}
+
+void Pad(vector<char>& out)
+{
+  out.resize(Padded(out.size()), 0);
+}
+
+void Truncated(const string& filename)
+{
+  throw runtime_error("Truncated or corrupt statistics file: " + filename);
+}
+
+} // namespace
+
+bool IndexedData::IsIndexed(const string& filename)
+{
+  ifstream in(filename.c_str(), ios::in | ios::binary);
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic))) return false;
+  return memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+IndexedData::IndexedData(const string& filename)
+  : m_filename(filename)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(filename.c_str()));
+  const uint64_t size = util::SizeFile(fd.get());
+  if (size < sizeof(FileHeader)) Truncated(filename);
+  util::MapRead(util::LAZY, fd.get(), 0, size, m_mem);
+
+  const char* begin = static_cast<const char*>(m_mem.get());
+  const char* end = begin + size;
+  FileHeader header;
+  memcpy(&header, begin, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw runtime_error("Not an indexed statistics file: " + filename);
+  }
+  m_kind = static_cast<Kind>(header.kind);
+  m_num_dense = header.num_dense;
+  const char* pos = begin + sizeof(header);
+  if (pos + Padded(header.names_size) > end) Truncated(filename);
+  m_names.assign(pos, header.names_size);
+  pos += Padded(header.names_size);
+
+  while (pos < end) {
+    SegmentHeader segment;
+    if (pos + sizeof(segment) > end) Truncated(filename);
+    memcpy(&segment, pos, sizeof(segment));
+    if (segment.size < sizeof(segment) || pos + segment.size > end) Truncated(filename);
+    ReadSegment(pos, pos + segment.size);
+    pos += segment.size;
+  }
+}
+
+void IndexedData::ReadSegment(const char* begin, const char* end)
+{
+  SegmentHeader segment;
+  memcpy(&segment, begin, sizeof(segment));
+  const char* pos = begin + sizeof(segment);
+
+  for (uint32_t i = 0; i < segment.num_sparse; ++i) {
+    uint32_t length;
+    if (pos + sizeof(length) > end) Truncated(m_filename);
+    memcpy(&length, pos, sizeof(length));
+    pos += sizeof(length);
+    if (pos + length > end) Truncated(m_filename);
+    m_sparse_names.push_back(string(pos, length));
+    pos += length;
+  }
+  pos = begin + Padded(pos - begin);
+
+  const SentenceEntry* entries = reinterpret_cast<const SentenceEntry*>(pos);
+  if (pos + segment.num_sentences * sizeof(SentenceEntry) > end) Truncated(m_filename);
+  for (uint32_t i = 0; i < segment.num_sentences; ++i) {
+    const SentenceEntry& entry = entries[i];
+    Block block;
+    block.count = entry.count;
+    const char* data = begin + entry.offset;
+    block.dense = reinterpret_cast<const float*>(data);
+    data += Padded(entry.count * m_num_dense * sizeof(float));
+    block.sparseBegin = reinterpret_cast<const uint32_t*>(data);
+    data += Padded((entry.count + 1) * sizeof(uint32_t));
+    if (data > end) Truncated(m_filename);
+    block.sparse = reinterpret_cast<const SparseEntry*>(data);
+    if (data + block.sparseBegin[entry.count] * sizeof(SparseEntry) > end) Truncated(m_filename);
+
+    if (entry.sentence >= m_sentences.size()) {
+      m_sentences.resize(entry.sentence + 1);
+    }
+    m_sentences[entry.sentence].push_back(block);
+  }
+}
+
+size_t IndexedData::NumHypotheses(size_t sentence) const
+{
+  size_t count = 0;
+  const vector<Block>& blocks = m_sentences[sentence];
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    count += blocks[i].count;
+  }
+  return count;
+}
+
+IndexedDataWriter::IndexedDataWriter(const string& filename, IndexedData::Kind kind,
+                                     size_t num_dense, const string& names, bool append)
+  : m_filename(filename)
+  , m_exists(append && IndexedData::IsIndexed(filename))
+  , m_kind(kind)
+  , m_num_dense(num_dense)
+  , m_names(names)
+{
+  if (m_exists) {
+    // the sparse features of the new segment are numbered after the old ones
+    IndexedData existing(filename);
+    if (existing.GetKind() != kind || existing.NumDense() != num_dense || existing.Names() != names) {
+      throw runtime_error("Can't append statistics of a different kind or with different features to " + filename);
+    }
+    const vector<string>& sparse_names = existing.SparseNames();
+    for (size_t i = 0; i < sparse_names.size(); ++i) {
+      m_sparse_ids[sparse_names[i]] = i;
+    }
+  }
+}
+
+void IndexedDataWriter::AddSentence(size_t sentence)
+{
+  m_sentences.push_back(Sentence());
+  m_sentences.back().sentence = sentence;
+  m_sentences.back().sparseBegin.push_back(0);
+}
+
+void IndexedDataWriter::AddHypothesis(const vector<float>& dense)
+{
+  if (dense.size() != m_num_dense) {
+    throw runtime_error("Wrong number of dense values for " + m_filename);
+  }
+  Sentence& sentence = m_sentences.back();
+  sentence.dense.insert(sentence.dense.end(), dense.begin(), dense.end());
+  sentence.sparseBegin.push_back(sentence.sparse.size());
+}
+
+void IndexedDataWriter::AddHypothesis(const vector<float>& dense, const SparseVector& sparse)
+{
+  // checked before anything is added, so that a rejected hypothesis leaves
+  // neither sparse entries nor feature names behind
+  if (dense.size() != m_num_dense) {
+    throw runtime_error("Wrong number of dense values for " + m_filename);
+  }
+  Sentence& sentence = m_sentences.back();
+  const vector<size_t> feats = sparse.feats();
+  for (size_t i = 0; i < feats.size(); ++i) {
+    const string name = SparseVector::decode(feats[i]);
+    map<string, uint32_t>::iterator iter = m_sparse_ids.find(name);
+    if (iter == m_sparse_ids.end()) {
+      iter = m_sparse_ids.insert(make_pair(name, (uint32_t) m_sparse_ids.size())).first;
+      m_new_sparse_names.push_back(name);
+    }
+    IndexedData::SparseEntry entry = { iter->second, sparse.get(feats[i]) };
+    sentence.sparse.push_back(entry);
+  }
+  AddHypothesis(dense);
+}
+
+void IndexedDataWriter::Write()
+{
+  vector<char> segment(sizeof(SegmentHeader));
+  for (size_t i = 0; i < m_new_sparse_names.size(); ++i) {
+    const uint32_t length = m_new_sparse_names[i].size();
+    Append(segment, &length, 1);
+    Append(segment, m_new_sparse_names[i].data(), length);
+  }
+  Pad(segment);
+
+  const size_t index = segment.size();
+  vector<SentenceEntry> entries(m_sentences.size());
+  segment.resize(index + entries.size() * sizeof(SentenceEntry));
+  for (size_t i = 0; i < m_sentences.size(); ++i) {
+    const Sentence& sentence = m_sentences[i];
+    entries[i].sentence = sentence.sentence;
+    entries[i].count = sentence.sparseBegin.size() - 1;
+    entries[i].offset = segment.size();
+    if (!sentence.dense.empty()) Append(segment, &sentence.dense[0], sentence.dense.size());
+    Pad(segment);
+    Append(segment, &sentence.sparseBegin[0], sentence.sparseBegin.size());
+    Pad(segment);
+    if (!sentence.sparse.empty()) Append(segment, &sentence.sparse[0], sentence.sparse.size());
+  }
+  if (!entries.empty()) {
+    memcpy(&segment[index], &entries[0], entries.size() * sizeof(SentenceEntry));
+  }
+  SegmentHeader header = { segment.size(), m_sentences.size(), m_new_sparse_names.size() };
+  memcpy(&segment[0], &header, sizeof(header));
+
+  FILE* file = fopen(m_filename.c_str(), m_exists ? "ab" : "wb");
+  if (!file) {
+    throw runtime_error("Unable to open statistics file: " + m_filename);
+  }
+  if (!m_exists) {
+    FileHeader file_header;
+    memcpy(file_header.magic, kMagic, sizeof(kMagic));
+    file_header.kind = m_kind;
+    file_header.num_dense = m_num_dense;
+    file_header.names_size = m_names.size();
+    file_header.reserved = 0;
+    vector<char> out;
+    Append(out, &file_header, 1);
+    Append(out, m_names.data(), m_names.size());
+    Pad(out);
+    util::WriteOrThrow(file, &out[0], out.size());
+  }
+  util::WriteOrThrow(file, &segment[0], segment.size());
+  if (fclose(file)) {
+    throw runtime_error("Error writing statistics file: " + m_filename);
+  }
+
+  m_exists = true;
+  m_new_sparse_names.clear();
+  m_sentences.clear();
+}
+
+}
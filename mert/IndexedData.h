@@ -0,0 +1,150 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef MERT_INDEXED_DATA_H_
+#define MERT_INDEXED_DATA_H_
+
+/**
+ * Binary container of the feature or score statistics of n-best lists,
+ * which is mapped into memory and read in place.
+ *
+ * The file starts with a header: the kind of statistics, the number of
+ * dense values of each hypothesis and their names (the feature names, or
+ * the score type). It is followed by one or more segments, each written in
+ * one go, so that the hypotheses of a new tuning iteration can be appended
+ * to the file without rewriting it. A segment has
+ *  - the names of the sparse features first used in it. A sparse feature
+ *    is referred to by its position in the names of all the segments;
+ *  - an index of its sentences: the sentence id, the number of hypotheses
+ *    and the offset of the data of the sentence;
+ *  - for each sentence, a block of the dense values of all the hypotheses,
+ *    the start of the sparse features of each hypothesis and the sparse
+ *    features themselves, as (id, value) pairs.
+ * The same sentence may have a block in several segments.
+ */
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/mmap.hh"
+
+namespace MosesTuning
+{
+
+class SparseVector;
+
+class IndexedData
+{
+public:
+  enum Kind { FEATURES = 0, SCORES = 1 };
+
+  struct SparseEntry {
+    uint32_t id;
+    float value;
+  };
+
+  //! the hypotheses of a sentence in one segment
+  struct Block {
+    std::size_t count;
+    const float* dense;            // count * NumDense() values
+    const uint32_t* sparseBegin;   // count + 1 indexes into sparse
+    const SparseEntry* sparse;
+
+    const float* Dense(std::size_t hyp, std::size_t num_dense) const {
+      return dense + hyp * num_dense;
+    }
+    const SparseEntry* SparseBegin(std::size_t hyp) const {
+      return sparse + sparseBegin[hyp];
+    }
+    const SparseEntry* SparseEnd(std::size_t hyp) const {
+      return sparse + sparseBegin[hyp + 1];
+    }
+  };
+
+  explicit IndexedData(const std::string& filename);
+
+  //! whether filename is in this format, rather than the text one
+  static bool IsIndexed(const std::string& filename);
+
+  Kind GetKind() const { return m_kind; }
+  std::size_t NumDense() const { return m_num_dense; }
+  const std::string& Names() const { return m_names; }
+  const std::vector<std::string>& SparseNames() const { return m_sparse_names; }
+
+  //! one more than the largest sentence id
+  std::size_t NumSentences() const { return m_sentences.size(); }
+  std::size_t NumHypotheses(std::size_t sentence) const;
+  const std::vector<Block>& GetBlocks(std::size_t sentence) const {
+    return m_sentences[sentence];
+  }
+
+private:
+  std::string m_filename;
+  util::scoped_memory m_mem;
+  Kind m_kind;
+  std::size_t m_num_dense;
+  std::string m_names;
+  std::vector<std::string> m_sparse_names;
+  std::vector<std::vector<Block> > m_sentences;
+
+  void ReadSegment(const char* begin, const char* end);
+};
+
+/**
+ * Writes a segment to an IndexedData file. When appending, the segment is
+ * added at the end of the file, if it is already in this format; otherwise
+ * the file is replaced.
+ */
+class IndexedDataWriter
+{
+public:
+  IndexedDataWriter(const std::string& filename, IndexedData::Kind kind,
+                    std::size_t num_dense, const std::string& names, bool append);
+
+  //! the following hypotheses are of sentence
+  void AddSentence(std::size_t sentence);
+  void AddHypothesis(const std::vector<float>& dense);
+  void AddHypothesis(const std::vector<float>& dense, const SparseVector& sparse);
+
+  //! write the segment, after which another one can be added
+  void Write();
+
+private:
+  struct Sentence {
+    uint32_t sentence;
+    std::vector<float> dense;
+    std::vector<uint32_t> sparseBegin;
+    std::vector<IndexedData::SparseEntry> sparse;
+  };
+
+  std::string m_filename;
+  bool m_exists;
+  IndexedData::Kind m_kind;
+  std::size_t m_num_dense;
+  std::string m_names;
+  std::map<std::string, uint32_t> m_sparse_ids;
+  std::vector<std::string> m_new_sparse_names;
+  std::vector<Sentence> m_sentences;
+};
+
+}
+
+#endif  // MERT_INDEXED_DATA_H_
@@ -0,0 +1,113 @@
+#include "IndexedData.h"
+#include "FeatureStats.h"
+
+#define BOOST_TEST_MODULE IndexedData
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace MosesTuning;
+
+namespace {
+
+std::string TempFile() {
+  char name[] = "/tmp/indexed_data_test.XXXXXX";
+  int fd = mkstemp(name);
+  BOOST_REQUIRE(fd != -1);
+  close(fd);
+  return name;
+}
+
+std::vector<float> Dense(float a, float b) {
+  std::vector<float> dense;
+  dense.push_back(a);
+  dense.push_back(b);
+  return dense;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(write_and_append) {
+  const std::string file = TempFile();
+  {
+    IndexedDataWriter writer(file, IndexedData::FEATURES, 2, "lm_0 tm_0 ", false);
+    writer.AddSentence(0);
+    SparseVector sparse;
+    sparse.set("pp_a", 1.5);
+    writer.AddHypothesis(Dense(1, 2), sparse);
+    writer.AddHypothesis(Dense(3, 4));
+    writer.AddSentence(2);
+    writer.AddHypothesis(Dense(5, 6));
+    writer.Write();
+  }
+  BOOST_CHECK(IndexedData::IsIndexed(file));
+  {
+    IndexedDataWriter writer(file, IndexedData::FEATURES, 2, "lm_0 tm_0 ", true);
+    writer.AddSentence(0);
+    SparseVector sparse;
+    sparse.set("pp_b", 2.5);
+    sparse.set("pp_a", 0.5);
+    writer.AddHypothesis(Dense(7, 8), sparse);
+    writer.Write();
+  }
+
+  IndexedData data(file);
+  BOOST_CHECK_EQUAL(data.GetKind(), IndexedData::FEATURES);
+  BOOST_CHECK_EQUAL(data.NumDense(), (std::size_t)2);
+  BOOST_CHECK_EQUAL(data.Names(), "lm_0 tm_0 ");
+  BOOST_REQUIRE_EQUAL(data.SparseNames().size(), (std::size_t)2);
+  BOOST_CHECK_EQUAL(data.SparseNames()[0], "pp_a");
+  BOOST_CHECK_EQUAL(data.SparseNames()[1], "pp_b");
+
+  BOOST_REQUIRE_EQUAL(data.NumSentences(), (std::size_t)3);
+  BOOST_CHECK_EQUAL(data.NumHypotheses(0), (std::size_t)3);
+  BOOST_CHECK_EQUAL(data.NumHypotheses(1), (std::size_t)0);
+  BOOST_CHECK_EQUAL(data.NumHypotheses(2), (std::size_t)1);
+
+  const std::vector<IndexedData::Block>& blocks = data.GetBlocks(0);
+  BOOST_REQUIRE_EQUAL(blocks.size(), (std::size_t)2);
+  BOOST_REQUIRE_EQUAL(blocks[0].count, (std::size_t)2);
+  BOOST_CHECK_EQUAL(blocks[0].Dense(1, 2)[0], 3);
+  BOOST_CHECK_EQUAL(blocks[0].Dense(1, 2)[1], 4);
+  BOOST_REQUIRE_EQUAL(blocks[0].SparseEnd(0) - blocks[0].SparseBegin(0), 1);
+  BOOST_CHECK_EQUAL(blocks[0].SparseBegin(0)->id, (uint32_t)0);
+  BOOST_CHECK_EQUAL(blocks[0].SparseBegin(0)->value, 1.5);
+  BOOST_CHECK(blocks[0].SparseBegin(1) == blocks[0].SparseEnd(1));
+
+  BOOST_REQUIRE_EQUAL(blocks[1].count, (std::size_t)1);
+  BOOST_CHECK_EQUAL(blocks[1].Dense(0, 2)[0], 7);
+  BOOST_REQUIRE_EQUAL(blocks[1].SparseEnd(0) - blocks[1].SparseBegin(0), 2);
+
+  BOOST_CHECK_EQUAL(data.GetBlocks(2)[0].Dense(0, 2)[1], 6);
+
+  // a different kind of statistics can't be appended
+  BOOST_CHECK_THROW(IndexedDataWriter(file, IndexedData::SCORES, 2, "BLEU", true),
+                    std::runtime_error);
+
+  std::remove(file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(wrong_dense_size_adds_nothing) {
+  const std::string file = TempFile();
+  {
+    IndexedDataWriter writer(file, IndexedData::FEATURES, 2, "lm_0 tm_0 ", false);
+    writer.AddSentence(0);
+    SparseVector sparse;
+    sparse.set("pp_a", 1.5);
+    std::vector<float> dense(3, 1);
+    BOOST_CHECK_THROW(writer.AddHypothesis(dense, sparse), std::runtime_error);
+    writer.AddHypothesis(Dense(1, 2));
+    writer.Write();
+  }
+
+  IndexedData data(file);
+  BOOST_CHECK(data.SparseNames().empty());
+  BOOST_REQUIRE_EQUAL(data.NumHypotheses(0), (std::size_t)1);
+  const IndexedData::Block& block = data.GetBlocks(0)[0];
+  BOOST_CHECK_EQUAL(block.Dense(0, 2)[0], 1);
+  BOOST_CHECK(block.SparseBegin(0) == block.SparseEnd(0));
+
+  std::remove(file.c_str());
+}
@@ -7,10 +7,18 @@
 #include <map>
 #include <cfloat>
 #include <iostream>
+#include <algorithm>
 #include <stdint.h>
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#endif
+
 #include "Point.h"
 #include "Util.h"
+#include "../moses/src/ThreadPool.h"
 
 using namespace std;
 
@@ -37,8 +45,264 @@ namespace MosesTuning
 {
   
 
+namespace {
+
+/**
+ * A point on the line where the 1best of a sentence changes.
+ */
+struct Threshold {
+  float x;
+  unsigned int sentence;
+  unsigned int nbest;   // the new 1best of the sentence
+};
+
+inline bool operator<(const Threshold& a, const Threshold& b)
+{
+  if (a.x != b.x) return a.x < b.x;
+  return a.sentence < b.sentence;
+}
+
+typedef vector<Threshold> Thresholds;
+
+/**
+ * Append the thresholds of sentence S on the line origin + x * direction to
+ * thresholds, and return the 1best of the sentence for x = -inf.
+ */
+unsigned int SentenceThresholds(const FeatureData& data, const Point& origin, const Point& direction,
+                                unsigned int S, Thresholds& thresholds)
+{
+  const float min_int = 0.0001;
+  const size_t first_threshold = thresholds.size();
+
+  // First, we determine the translation with the best feature score
+  // for each sentence and each value of x.
+  // gradient holds the gradient of the feature function of each candidate,
+  // in increasing order, and f0 the feature function at the origin point.
+  const size_t num_candidates = data.get(S).size();
+  vector<pair<float, unsigned> > gradient(num_candidates);
+  vector<float> f0(num_candidates);
+  for (unsigned j = 0; j < num_candidates; j++) {
+    gradient[j] = pair<float, unsigned>(direction * data.get(S, j), j);
+    f0[j] = origin * data.get(S, j);
+  }
+  sort(gradient.begin(), gradient.end());
+
+  // Now let's compute the 1best for each value of x.
+  // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
+  // The highest line is the one with the highest f0.
+  size_t gradientit = 0;
+  size_t highest_f0 = 0;
+  for (size_t i = 1; i < num_candidates && gradient[i].first == gradient[0].first; ++i) {
+    if (f0[gradient[i].second] > f0[gradient[highest_f0].second])
+      highest_f0 = i;
+  }
+  gradientit = highest_f0;
+
+  // Now we look for the intersections points indicating a change of 1 best.
+  // We use the fact that the function is convex, which means that the gradient can only go up.
+  while (true) {
+    size_t leftmost = gradientit;
+    const float m = gradient[gradientit].first;
+    const float b = f0[gradient[gradientit].second];
+    float leftmostx = MAX_FLOAT;
+    for (size_t gradientit2 = gradientit + 1; gradientit2 < num_candidates; ++gradientit2) {
+      // Look for all candidate with a gradient bigger than the current one, and
+      // find the one with the leftmost intersection.
+      if (m != gradient[gradientit2].first) {
+        const float curintersect = intersect(m, b, gradient[gradientit2].first, f0[gradient[gradientit2].second]);
+        if (curintersect <= leftmostx) {
+          // We have found an intersection to the left of the leftmost we had so far.
+          // We might have curintersect==leftmostx for example is 2 candidates are the same
+          // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
+          leftmostx = curintersect;
+          leftmost = gradientit2; // this is the new reference
+        }
+      }
+    }
+    if (leftmost == gradientit) {
+      // We didn't find any more intersections.
+      // The rightmost bestindex is the one with the highest slope.
+
+      // They should be equal but there might be.
+      CHECK(abs(gradient[leftmost].first - gradient.back().first) < 0.0001);
+      // A small difference due to rounding error
+      break;
+    }
+
+    // We have found the next intersection!
+    // new onebest for Sentence S is leftmost->second
+    const Threshold threshold = { leftmostx, S, gradient[leftmost].second };
+    if (thresholds.size() > first_threshold && leftmostx - thresholds.back().x < min_int) {
+      // Require that the intersection Point be at least min_int to the right of the previous
+      // one (for this sentence). If not, we replace the previous intersection Point with
+      // this one.
+      // Yes, it can even happen that the new intersection Point is slightly to the left of
+      // the old one, because of numerical imprecision. We do not want to keep
+      // 2 very close threshold: if the minima is there it could be an artifact.
+      thresholds.back() = threshold;
+    } else {
+      thresholds.push_back(threshold);
+    }
+    gradientit = leftmost;
+  }
+
+  return gradient[highest_f0].second;
+}
+
+/**
+ * Find the thresholds of sentences [begin, end), sorted.
+ */
+void FindThresholds(const FeatureData& data, const Point& origin, const Point& direction,
+                    unsigned int begin, unsigned int end,
+                    Thresholds& thresholds, vector<unsigned>& first1best)
+{
+  for (unsigned int S = begin; S < end; ++S) {
+    first1best[S] = SentenceThresholds(data, origin, direction, S, thresholds);
+  }
+  sort(thresholds.begin(), thresholds.end());
+}
+
+typedef pair<Threshold, size_t> MergeEntry; // and the block it is from
+
+struct MergeEntryOrderer {
+  bool operator()(const MergeEntry& a, const MergeEntry& b) const {
+    return b.first < a.first;
+  }
+};
+
+/**
+ * k-way merge of the parts [begins[i], ends[i]) of sorted blocks into out.
+ */
+void MergeRanges(const vector<Thresholds>& blocks, vector<size_t> begins, const vector<size_t>& ends,
+                 Threshold* out)
+{
+  // heap of the next threshold of each block, smallest on top
+  vector<MergeEntry> heap;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (begins[i] < ends[i]) {
+      heap.push_back(MergeEntry(blocks[i][begins[i]], i));
+    }
+  }
+  make_heap(heap.begin(), heap.end(), MergeEntryOrderer());
+  while (!heap.empty()) {
+    pop_heap(heap.begin(), heap.end(), MergeEntryOrderer());
+    const size_t i = heap.back().second;
+    *out++ = heap.back().first;
+    if (++begins[i] < ends[i]) {
+      heap.back().first = blocks[i][begins[i]];
+      push_heap(heap.begin(), heap.end(), MergeEntryOrderer());
+    } else {
+      heap.pop_back();
+    }
+  }
+}
+
+#ifdef WITH_THREADS
+/**
+ * Functions run on a ThreadPool, which can be waited for. Several
+ * LineOptimize() calls may share the pool, so each waits for its own.
+ */
+class TaskGroup
+{
+public:
+  explicit TaskGroup(Moses::ThreadPool& pool) : m_pool(pool), m_pending(0) {}
+
+  void Submit(const boost::function<void()>& function) {
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool.Submit(new FunctionTask(function, *this));
+  }
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_pending > 0) m_done.wait(lock);
+  }
+
+private:
+  class FunctionTask : public Moses::Task
+  {
+  public:
+    FunctionTask(const boost::function<void()>& function, TaskGroup& group)
+      : m_function(function), m_group(group) {}
+
+    void Run() {
+      m_function();
+      boost::mutex::scoped_lock lock(m_group.m_mutex);
+      --m_group.m_pending;
+      m_group.m_done.notify_all();
+    }
+
+  private:
+    boost::function<void()> m_function;
+    TaskGroup& m_group;
+  };
+
+  Moses::ThreadPool& m_pool;
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+  size_t m_pending;
+};
+#endif
+
+/**
+ * Merge the sorted blocks into merged, in up to num_threads parts. The
+ * blocks are cut at num_threads - 1 thresholds of the largest block, and the
+ * parts in between merged in parallel on pool, if there is one.
+ */
+void MergeThresholds(vector<Thresholds>& blocks, unsigned int num_threads, Moses::ThreadPool* pool, Thresholds& merged)
+{
+  if (blocks.size() == 1) {
+    merged.swap(blocks[0]);
+    return;
+  }
+  size_t total = 0;
+  size_t largest = 0;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    total += blocks[i].size();
+    if (blocks[i].size() > blocks[largest].size()) largest = i;
+  }
+  merged.resize(total);
+  if (total == 0) return;
+
+  // cuts[p][i] is where part p starts in block i
+  const size_t num_parts = max(1u, min(num_threads, (unsigned int) blocks[largest].size()));
+  vector<vector<size_t> > cuts(num_parts + 1, vector<size_t>(blocks.size()));
+  vector<size_t> offsets(num_parts + 1, 0);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    cuts[num_parts][i] = blocks[i].size();
+  }
+  offsets[num_parts] = total;
+  for (size_t p = 1; p < num_parts; ++p) {
+    const Threshold& cut = blocks[largest][p * blocks[largest].size() / num_parts];
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      cuts[p][i] = lower_bound(blocks[i].begin(), blocks[i].end(), cut) - blocks[i].begin();
+      offsets[p] += cuts[p][i];
+    }
+  }
+
+#ifdef WITH_THREADS
+  if (num_parts > 1 && pool) {
+    TaskGroup group(*pool);
+    for (size_t p = 0; p < num_parts; ++p) {
+      group.Submit(boost::bind(&MergeRanges, boost::cref(blocks), cuts[p], cuts[p + 1],
+                               &merged[0] + offsets[p]));
+    }
+    group.Wait();
+    return;
+  }
+#endif
+  for (size_t p = 0; p < num_parts; ++p) {
+    MergeRanges(blocks, cuts[p], cuts[p + 1], &merged[0] + offsets[p]);
+  }
+}
+
+} // namespace
+
+
 Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool>& pos, const vector<parameter_t>& start, unsigned int nrandom)
-  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_positive(pos)
+  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_num_threads(1), m_positive(pos)
 {
   // Warning: the init vector is a full set of parameters, of dimension m_pdim!
   Point::m_pdim = Pd;
@@ -62,6 +326,16 @@ Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool
 
 Optimizer::~Optimizer() {}
 
+void Optimizer::SetNumThreads(unsigned int num_threads)
+{
+  m_num_threads = num_threads;
+#ifdef WITH_THREADS
+  // the pool lives as long as the optimizer, rather than threads being
+  // started for each of the many line optimizations
+  m_pool.reset(num_threads > 1 ? new Moses::ThreadPool(num_threads) : NULL);
+#endif
+}
+
 statscore_t Optimizer::GetStatScore(const Point& param) const
 {
   vector<unsigned> bests;
@@ -70,187 +344,78 @@ statscore_t Optimizer::GetStatScore(const Point& param) const
   return score;
 }
 
-map<float,diff_t >::iterator AddThreshold(map<float,diff_t >& thresholdmap, float newt, const pair<unsigned,unsigned>& newdiff)
-{
-  map<float,diff_t>::iterator it = thresholdmap.find(newt);
-  if (it != thresholdmap.end()) {
-    // the threshold already exists!! this is very unlikely
-    if (it->second.back().first == newdiff.first)
-      // there was already a diff for this sentence, we change the 1 best;
-      it->second.back().second = newdiff.second;
-    else
-      it->second.push_back(newdiff);
-  } else {
-    // normal case
-    pair<map<float,diff_t>::iterator, bool> ins = thresholdmap.insert(threshold(newt, diff_t(1, newdiff)));
-    CHECK(ins.second);                // we really inserted something
-    it = ins.first;
-  }
-  return it;
-}
-
 statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
 {
   // We are looking for the best Point on the line y=Origin+x*direction
-  float min_int = 0.0001;
-  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
-  //list<threshold> thresholdlist;
-
-  map<float,diff_t> thresholdmap;
-  thresholdmap[MIN_FLOAT] = diff_t();
-  vector<unsigned> first1best;       // the vector of nbests for x=-inf
-  for (unsigned int S = 0; S < size(); S++) {
-    map<float,diff_t >::iterator previnserted = thresholdmap.begin();
-    // First, we determine the translation with the best feature score
-    // for each sentence and each value of x.
-    //cerr << "Sentence " << S << endl;
-    multimap<float, unsigned> gradient;
-    vector<float> f0;
-    f0.resize(m_feature_data->get(S).size());
-    for (unsigned j = 0; j < m_feature_data->get(S).size(); j++) {
-      // gradient of the feature function for this particular target sentence
-      gradient.insert(pair<float, unsigned>(direction * (m_feature_data->get(S,j)), j));
-      // compute the feature function at the origin point
-      f0[j] = origin * m_feature_data->get(S, j);
+  const unsigned int num_sentences = size();
+
+  // The thresholds of blocks of consecutive sentences are found in parallel,
+  // each sorted, and merged.
+  vector<unsigned> first1best(num_sentences);       // the vector of nbests for x=-inf
+  const unsigned int num_blocks = max(1u, min(m_num_threads, num_sentences));
+  vector<Thresholds> blocks(num_blocks);
+  Moses::ThreadPool* pool = NULL;
+#ifdef WITH_THREADS
+  pool = m_pool.get();
+  if (num_blocks > 1 && pool) {
+    TaskGroup group(*pool);
+    for (unsigned int i = 0; i < num_blocks; ++i) {
+      group.Submit(boost::bind(&FindThresholds, boost::cref(*m_feature_data),
+                               boost::cref(origin), boost::cref(direction),
+                               i * num_sentences / num_blocks, (i + 1) * num_sentences / num_blocks,
+                               boost::ref(blocks[i]), boost::ref(first1best)));
     }
-    // Now let's compute the 1best for each value of x.
-
-    //    vector<pair<float,unsigned> > onebest;
-
-
-    multimap<float,unsigned>::iterator gradientit = gradient.begin();
-    multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
-
-    float smallest = gradientit->first;//smallest gradient
-    // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
+    group.Wait();
+  } else
+#endif
+  {
+    blocks.resize(1);
+    FindThresholds(*m_feature_data, origin, direction, 0, num_sentences, blocks[0], first1best);
+  }
+  Thresholds thresholds;
+  MergeThresholds(blocks, m_num_threads, pool, thresholds);
 
-    gradientit++;
-    while (gradientit != gradient.end() && gradientit->first == smallest) {
-      //   cerr<<"ni"<<gradientit->second<<endl;;
-      //cerr<<"fos"<<f0[gradientit->second]<<" "<<f0[index]<<" "<<index<<endl;
-      if (f0[gradientit->second] > f0[highest_f0->second])
-        highest_f0 = gradientit;//the highest line is the one with he highest f0
-      gradientit++;
+  // Group the changes of 1best by threshold. thresholdx[i] is where the
+  // (i-1)th diff applies, the first threshold corresponds to first1best.
+  vector<float> thresholdx(1, MIN_FLOAT);
+  diffs_t diffs;
+  for (size_t i = 0; i < thresholds.size(); ++i) {
+    if (thresholdx.size() == 1 || thresholds[i].x != thresholdx.back()) {
+      thresholdx.push_back(thresholds[i].x);
+      diffs.push_back(diff_t());
     }
+    diffs.back().push_back(make_pair(thresholds[i].sentence, thresholds[i].nbest));
+  }
 
-    gradientit = highest_f0;
-    first1best.push_back(highest_f0->second);
-
-    // Now we look for the intersections points indicating a change of 1 best.
-    // We use the fact that the function is convex, which means that the gradient can only go up.
-    while (gradientit != gradient.end()) {
-      map<float,unsigned>::iterator leftmost = gradientit;
-      float m = gradientit->first;
-      float b = f0[gradientit->second];
-      multimap<float,unsigned>::iterator gradientit2 = gradientit;
-      gradientit2++;
-      float leftmostx = MAX_FLOAT;
-      for (; gradientit2 != gradient.end(); gradientit2++) {
-        //cerr<<"--"<<d++<<' '<<gradientit2->first<<' '<<gradientit2->second<<endl;
-        // Look for all candidate with a gradient bigger than the current one, and
-        // find the one with the leftmost intersection.
-        float curintersect;
-        if (m != gradientit2->first) {
-          curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
-          //cerr << "curintersect: " << curintersect << " leftmostx: " << leftmostx << endl;
-          if (curintersect<=leftmostx) {
-            // We have found an intersection to the left of the leftmost we had so far.
-            // We might have curintersect==leftmostx for example is 2 candidates are the same
-            // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
-            leftmostx = curintersect;
-            leftmost = gradientit2; // this is the new reference
-          }
-        }
-      }
-      if (leftmost == gradientit) {
-        // We didn't find any more intersections.
-        // The rightmost bestindex is the one with the highest slope.
-
-        // They should be equal but there might be.
-        CHECK(abs(leftmost->first-gradient.rbegin()->first) < 0.0001);
-        // A small difference due to rounding error
-        break;
-      }
-      // We have found the next intersection!
-
-      pair<unsigned,unsigned> newd(S, leftmost->second);//new onebest for Sentence S is leftmost->second
-
-      if (leftmostx-previnserted->first < min_int) {
-        // Require that the intersection Point be at least min_int to the right of the previous
-        // one (for this sentence). If not, we replace the previous intersection Point with
-        // this one.
-        // Yes, it can even happen that the new intersection Point is slightly to the left of
-        // the old one, because of numerical imprecision. We do not check that we are to the
-        // right of the penultimate point also. It this happen the 1best the interval will
-        // be wrong we are going to replace previnsert by the new one because we do not want to keep
-        // 2 very close threshold: if the minima is there it could be an artifact.
-
-        map<float,diff_t>::iterator tit = thresholdmap.find(leftmostx);
-        if (tit == previnserted) {
-          // The threshold is the same as before can happen if 2 candidates are the same for example.
-          CHECK(previnserted->second.back().first == newd.first);
-          previnserted->second.back()=newd; // just replace the 1 best for sentence S
-          // previnsert doesn't change
-        } else {
-
-          if (tit == thresholdmap.end()) {
-            thresholdmap[leftmostx]=previnserted->second; // We keep the diffs at previnsert
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = thresholdmap.find(leftmostx); // point previnsert to the new threshold
-            previnserted->second.back()=newd; // We update the diff for sentence S
-          // Threshold already exists but is not the previous one.
-          } else {
-            // We append the diffs in previnsert to tit before destroying previnsert.
-            tit->second.insert(tit->second.end(),previnserted->second.begin(),previnserted->second.end());
-            CHECK(tit->second.back().first == newd.first);
-            tit->second.back()=newd;    // change diff for sentence S
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = tit;  // point previnsert to the new threshold
-          }
-        }
-
-        CHECK(previnserted != thresholdmap.end());
-      } else { //normal insertion process
-        previnserted = AddThreshold(thresholdmap, leftmostx, newd);
-      }
-      gradientit = leftmost;
-    } // while (gradientit!=gradient.end()){
-  }   // loop on S
-
-  // Now the thresholdlist is up to date: it contains a list of all the parameter_ts where
-  // the function changed its value, along with the nbest list for the interval after each threshold.
+  // Now the thresholds are known: all the parameter_ts where the function
+  // changed its value, along with the nbest list for the interval after each threshold.
 
-  map<float,diff_t >::iterator thrit;
   if (verboselevel() > 6) {
-    cerr << "Thresholds:(" << thresholdmap.size() << ")" << endl;
-    for (thrit = thresholdmap.begin(); thrit != thresholdmap.end(); thrit++) {
-      cerr << "x: " << thrit->first << " diffs";
-      for (size_t j = 0; j < thrit->second.size(); ++j) {
-        cerr << " " <<thrit->second[j].first << "," << thrit->second[j].second;
+    cerr << "Thresholds:(" << thresholdx.size() << ")" << endl;
+    for (size_t i = 0; i < thresholdx.size(); ++i) {
+      cerr << "x: " << thresholdx[i] << " diffs";
+      if (i > 0) {
+        for (size_t j = 0; j < diffs[i - 1].size(); ++j) {
+          cerr << " " << diffs[i - 1][j].first << "," << diffs[i - 1][j].second;
+        }
       }
       cerr << endl;
     }
   }
 
   // Last thing to do is compute the Stat score (i.e., BLEU) and find the minimum.
-  thrit = thresholdmap.begin();
-  ++thrit;       // first diff corrrespond to MIN_FLOAT and first1best
-  diffs_t diffs;
-  for (; thrit != thresholdmap.end(); thrit++)
-    diffs.push_back(thrit->second);
   vector<statscore_t> scores = GetIncStatScore(first1best, diffs);
 
-  thrit = thresholdmap.begin();
   statscore_t bestscore = MIN_FLOAT;
   float bestx = MIN_FLOAT;
 
-  // We skipped the first el of thresholdlist but GetIncStatScore return 1 more for first1best.
-  CHECK(scores.size() == thresholdmap.size());
+  // GetIncStatScore returns 1 more than diffs, for first1best.
+  CHECK(scores.size() == thresholdx.size());
   for (unsigned int sc = 0; sc != scores.size(); sc++) {
-    //cerr << "x=" << thrit->first << " => " << scores[sc] << endl;
+    //cerr << "x=" << thresholdx[sc] << " => " << scores[sc] << endl;
 
     //enforce positivity
-    Point respoint = origin + direction * thrit->first;
+    Point respoint = origin + direction * thresholdx[sc];
     bool is_valid = true;
     for (unsigned int k=0; k < respoint.getdim(); k++) {
       if (m_positive[k] && respoint[k] <= 0.0)
@@ -258,9 +423,9 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
     }
 
     if (is_valid && scores[sc] > bestscore) {
-      // This is the score for the interval [lit2->first, (lit2+1)->first]
+      // This is the score for the interval [thresholdx[sc], thresholdx[sc+1]]
       // unless we're at the last score, when it's the score
-      // for the interval [lit2->first,+inf].
+      // for the interval [thresholdx[sc],+inf].
       bestscore = scores[sc];
 
       // If we're not in [-inf,x1] or [xn,+inf], then just take the value
@@ -268,16 +433,14 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       // take x to be the last interval boundary + 0.1, and for the leftmost
       // interval, take x to be the first interval boundary - 1000.
       // These values are taken from cmert.
-      float leftx = thrit->first;
-      if (thrit == thresholdmap.begin()) {
+      float leftx = thresholdx[sc];
+      if (sc == 0) {
         leftx = MIN_FLOAT;
       }
-      ++thrit;
       float rightx = MAX_FLOAT;
-      if (thrit != thresholdmap.end()) {
-        rightx = thrit->first;
+      if (sc + 1 < thresholdx.size()) {
+        rightx = thresholdx[sc + 1];
       }
-      --thrit;
       //cerr << "leftx: " << leftx << " rightx: " << rightx << endl;
       if (leftx == MIN_FLOAT) {
         bestx = rightx-1000;
@@ -288,7 +451,6 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       }
       //cerr << "x = " << "set new bestx to: " << bestx << endl;
     }
-    ++thrit;
   }
 
   if (abs(bestx) < 0.00015) {
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <boost/scoped_ptr.hpp>
 #include "Data.h"
 #include "FeatureData.h"
 #include "Scorer.h"
@@ -10,6 +11,11 @@
 
 static const float kMaxFloat = std::numeric_limits<float>::max();
 
+namespace Moses
+{
+class ThreadPool;
+}
+
 namespace MosesTuning
 {
   
@@ -25,6 +31,10 @@ protected:
   Scorer *m_scorer;      // no accessor for them only child can use them
   FeatureDataHandle m_feature_data;  // no accessor for them only child can use them
   unsigned int m_num_random_directions;
+  unsigned int m_num_threads;   // for the thresholds in LineOptimize
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> m_pool;   // runs them, if m_num_threads > 1
+#endif
 
   const std::vector<bool>& m_positive;
 
@@ -33,6 +43,11 @@ public:
 
   void SetScorer(Scorer *scorer) { m_scorer = scorer; }
   void SetFeatureData(FeatureDataHandle feature_data) { m_feature_data = feature_data; }
+  /**
+   * Number of threads LineOptimize() computes and merges the thresholds of
+   * the sentences with.
+   */
+  void SetNumThreads(unsigned int num_threads);
   virtual ~Optimizer();
 
   unsigned size() const {
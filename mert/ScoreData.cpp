@@ -13,6 +13,7 @@
 #include "Scorer.h"
 #include "Util.h"
 #include "FileStream.h"
+#include "IndexedData.h"
 
 using namespace std;
 
@@ -74,6 +75,10 @@ void ScoreData::load(istream* is)
 void ScoreData::load(const string &file)
 {
   TRACE_ERR("loading score data from " << file << endl);
+  if (IndexedData::IsIndexed(file)) {
+    load(IndexedData(file));
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open score file: " + file);
@@ -83,6 +88,37 @@ void ScoreData::load(const string &file)
   input_stream.close();
 }
 
+void ScoreData::load(const IndexedData& data)
+{
+  if (data.GetKind() != IndexedData::SCORES) {
+    throw runtime_error("Not a score data file");
+  }
+  const size_t num_scores = data.NumDense();
+  string score_type = data.Names();
+
+  ScoreArray entry;
+  for (size_t s = 0; s < data.NumSentences(); ++s) {
+    const vector<IndexedData::Block>& blocks = data.GetBlocks(s);
+    if (blocks.empty()) continue;
+    entry.clear();
+    entry.setIndex(stringify(s));
+    entry.NumberOfScores(num_scores);
+    entry.name(score_type);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      const IndexedData::Block& block = blocks[b];
+      for (size_t h = 0; h < block.count; ++h) {
+        ScoreStats stats;
+        const float* scores = block.Dense(h, num_scores);
+        for (size_t k = 0; k < num_scores; ++k) {
+          stats.add(static_cast<ScoreStatsType>(scores[k]));
+        }
+        entry.add(stats);
+      }
+    }
+    add(entry);
+  }
+}
+
 void ScoreData::add(ScoreArray& e)
 {
   if (exists(e.getIndex())) { // array at position e.getIndex() already exists
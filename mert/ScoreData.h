@@ -20,6 +20,7 @@ namespace MosesTuning
 {
   
 
+class IndexedData;
 class Scorer;
 
 class ScoreData
@@ -88,6 +89,7 @@ public:
 
   void load(std::istream* is);
   void load(const std::string &file);
+  void load(const IndexedData& data);
 
   bool check_consistency() const;
 
@@ -30,14 +30,47 @@ namespace MosesTuning
 {
   
 
-ScoreDataIterator::ScoreDataIterator() {}
+ScoreDataIterator::ScoreDataIterator() : m_sentence(0) {}
 
-ScoreDataIterator::ScoreDataIterator(const string& filename) {
-  m_in.reset(new FilePiece(filename.c_str()));
+ScoreDataIterator::ScoreDataIterator(const string& filename) : m_sentence(0) {
+  if (IndexedData::IsIndexed(filename)) {
+    m_bin.reset(new IndexedData(filename));
+    if (m_bin->GetKind() != IndexedData::SCORES) {
+      throw runtime_error("Not a score data file: " + filename);
+    }
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
+void ScoreDataIterator::readNextIndexed() {
+  m_next.clear();
+  while (m_sentence < m_bin->NumSentences() && m_bin->GetBlocks(m_sentence).empty()) {
+    ++m_sentence;
+  }
+  if (m_sentence == m_bin->NumSentences()) {
+    m_bin.reset();
+    return;
+  }
+  const size_t num_scores = m_bin->NumDense();
+  const vector<IndexedData::Block>& blocks = m_bin->GetBlocks(m_sentence);
+  m_next.reserve(m_bin->NumHypotheses(m_sentence));
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const IndexedData::Block& block = blocks[b];
+    for (size_t h = 0; h < block.count; ++h) {
+      const float* scores = block.Dense(h, num_scores);
+      m_next.push_back(ScoreDataItem(scores, scores + num_scores));
+    }
+  }
+  ++m_sentence;
+}
+
 void ScoreDataIterator::readNext() {
+  if (m_bin) {
+    readNextIndexed();
+    return;
+  }
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
@@ -74,6 +107,9 @@ void ScoreDataIterator::increment() {
 
 
 bool ScoreDataIterator::equal(const ScoreDataIterator& rhs) const {
+  if (m_bin || rhs.m_bin) {
+    return m_bin == rhs.m_bin && m_sentence == rhs.m_sentence;
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
@@ -62,7 +62,12 @@ class ScoreDataIterator :
 
     void readNext();
 
+    void readNextIndexed();
+
     boost::shared_ptr<util::FilePiece> m_in;
+    // the file, if it's an IndexedData, and the next sentence to read from it
+    boost::shared_ptr<IndexedData> m_bin;
+    std::size_t m_sentence;
     std::vector<ScoreDataItem> m_next;
 };
 
@@ -65,10 +65,11 @@ void  StatisticsBasedScorer::score(const candidates_t& candidates, const diffs_t
   if (candidates.size() == 0) {
     throw runtime_error("No candidates supplied");
   }
+  // the statistics are summed up in totals, and updated in place for each diff
   int numCounts = m_score_data->get(0,candidates[0]).size();
   vector<int> totals(numCounts);
   for (size_t i = 0; i < candidates.size(); ++i) {
-    ScoreStats stats = m_score_data->get(i,candidates[i]);
+    const ScoreStats& stats = m_score_data->get(i,candidates[i]);
     if (stats.size() != totals.size()) {
       stringstream msg;
       msg << "Statistics for (" << "," << candidates[i] << ") have incorrect "
@@ -76,8 +77,9 @@ void  StatisticsBasedScorer::score(const candidates_t& candidates, const diffs_t
       << totals.size();
       throw runtime_error(msg.str());
     }
+    const ScoreStatsType* counts = stats.getArray();
     for (size_t k = 0; k < totals.size(); ++k) {
-      totals[k] += stats.get(k);
+      totals[k] += counts[k];
     }
   }
   scores.push_back(calculateScore(totals));
@@ -89,10 +91,10 @@ void  StatisticsBasedScorer::score(const candidates_t& candidates, const diffs_t
       size_t sid = diffs[i][j].first;
       size_t nid = diffs[i][j].second;
       size_t last_nid = last_candidates[sid];
+      const ScoreStatsType* counts = m_score_data->get(sid,nid).getArray();
+      const ScoreStatsType* last_counts = m_score_data->get(sid,last_nid).getArray();
       for (size_t k  = 0; k < totals.size(); ++k) {
-        int diff = m_score_data->get(sid,nid).get(k)
-        - m_score_data->get(sid,last_nid).get(k);
-        totals[k] += diff;
+        totals[k] += counts[k] - last_counts[k];
       }
       last_candidates[sid] = nid;
     }
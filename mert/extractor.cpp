@@ -29,7 +29,8 @@ void usage()
   cerr << "[--scconfig|-c] configuration string passed to scorer" << endl;
   cerr << "\tThis is of the form NAME1:VAL1,NAME2:VAL2 etc " << endl;
   cerr << "[--reference|-r] comma separated list of reference files" << endl;
-  cerr << "[--binary|-b] use binary output format (default to text )" << endl;
+  cerr << "[--binary|-b] use the indexed binary output format, which mert, pro and kbmira map into memory (default to text )" << endl;
+  cerr << "[--append|-a] add the new hypotheses to the existing binary output files, rather than rewriting them" << endl;
   cerr << "[--nbest|-n] the nbest file" << endl;
   cerr << "[--scfile|-S] the scorer data output file" << endl;
   cerr << "[--ffile|-F] the feature data output file" << endl;
@@ -50,6 +51,7 @@ static struct option long_options[] = {
   {"filter", required_argument,0, 'l'},
   {"reference", required_argument, 0, 'r'},
   {"binary", no_argument, 0, 'b'},
+  {"append", no_argument, 0, 'a'},
   {"nbest", required_argument, 0, 'n'},
   {"scfile", required_argument, 0, 'S'},
   {"ffile", required_argument, 0, 'F'},
@@ -74,6 +76,7 @@ struct ProgramOption {
   string prevScoreDataFile;
   string prevFeatureDataFile;
   bool binmode;
+  bool append;
   bool allowDuplicates;
   int verbosity;
 
@@ -89,6 +92,7 @@ struct ProgramOption {
         prevScoreDataFile(""),
         prevFeatureDataFile(""),
         binmode(false),
+        append(false),
         allowDuplicates(false),
         verbosity(0) { }
 };
@@ -97,7 +101,7 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt) {
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbad", long_options, &option_index)) != -1) {
     switch (c) {
       case 's':
         opt->scorerType = string(optarg);
@@ -117,6 +121,9 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt) {
       case 'b':
         opt->binmode = true;
         break;
+      case 'a':
+        opt->append = true;
+        break;
       case 'n':
         opt->nbestFile = string(optarg);
         break;
@@ -193,6 +200,10 @@ int main(int argc, char** argv)
       throw runtime_error("Error: there is a different number of previous score and feature files");
     }
 
+    if (option.append && !option.binmode) {
+      throw runtime_error("Error: only binary output files can be appended to");
+    }
+
     if (option.binmode) {
       cerr << "Binary write mode is selected" << endl;
     } else {
@@ -236,7 +247,7 @@ int main(int argc, char** argv)
     }
     //END_ADDED
 
-    data.save(option.featureDataFile, option.scoreDataFile, option.binmode);
+    data.save(option.featureDataFile, option.scoreDataFile, option.binmode, option.append);
     PrintUserTime("Stopping...");
 
     return EXIT_SUCCESS;
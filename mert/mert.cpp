@@ -3,6 +3,7 @@
 */
 
 #include <limits>
+#include <algorithm>
 #include <unistd.h>
 #include <cstdlib>
 #include <iostream>
@@ -466,6 +467,10 @@ int main(int argc, char **argv)
     Optimizer *optimizer = OptimizerFactory::BuildOptimizer(option.pdim, to_optimize, positive, start_list[0], option.optimize_type, option.nrandom);
     optimizer->SetScorer(data_ref.getScorer());
     optimizer->SetFeatureData(data_ref.getFeatureData());
+#ifdef WITH_THREADS
+    // the threads the start points leave over work on the line optimizations
+    optimizer->SetNumThreads(std::max<size_t>(1, option.num_threads / (startingPoints.size() * allTasks.size())));
+#endif
     // A task for each start point
     for (size_t j = 0; j < startingPoints.size(); ++j) {
       OptimizationTask* task = new OptimizationTask(optimizer, startingPoints[j]);
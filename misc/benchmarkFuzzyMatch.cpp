@@ -0,0 +1,146 @@
+// Time the fuzzy matching of a held-out set against a translation memory,
+// as the fuzzy-match rule table does it for each input sentence.
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "fuzzy-match/FuzzyMatchWrapper.h"
+#include "Util.h"
+
+void usage();
+
+namespace
+{
+
+double Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/** match all the sentences, and report the time they took. The best cost of
+ each sentence is put in costs */
+double Match(const tmmt::FuzzyMatchWrapper &wrapper, const std::vector<std::vector<std::string> > &sentences
+             , bool verbose, const char *label, std::vector<int> &costs)
+{
+  size_t totalRules = 0, matched = 0;
+  double slowest = 0;
+  double start = Now();
+  costs.clear();
+  for(size_t i = 0; i < sentences.size(); ++i) {
+    double sentenceStart = Now();
+    std::vector<tmmt::ExtractedRule> rules;
+    costs.push_back(wrapper.Extract(sentences[i], rules));
+    double seconds = Now() - sentenceStart;
+
+    if (seconds > slowest)
+      slowest = seconds;
+    totalRules += rules.size();
+    if (!rules.empty())
+      ++matched;
+    if (verbose)
+      std::cout << label << "\t" << i << "\t" << costs.back() << "\t" << rules.size() << "\t" << seconds << "\n";
+  }
+  double matching = Now() - start;
+
+  std::cout << label << " sentences: " << sentences.size() << ", with a match: " << matched << "\n"
+            << label << " rules: " << totalRules << "\n"
+            << label << " matching: " << matching << " s, "
+            << (sentences.empty() ? 0 : 1000 * matching / sentences.size()) << " ms/sentence, "
+            << "slowest " << (1000 * slowest) << " ms\n";
+  return matching;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  std::string source, target, alignment, input;
+  size_t threads = 1;
+  size_t limit = 0;
+  bool verbose = false;
+  bool plain = false;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-s") && i + 1 < argc) {
+      source = argv[++i];
+    } else if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+      target = argv[++i];
+    } else if(!strcmp(argv[i], "-a") && i + 1 < argc) {
+      alignment = argv[++i];
+    } else if(!strcmp(argv[i], "-i") && i + 1 < argc) {
+      input = argv[++i];
+    } else if(!strcmp(argv[i], "-threads") && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-n") && i + 1 < argc) {
+      limit = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-plain")) {
+      plain = true;
+    } else if(!strcmp(argv[i], "-v")) {
+      verbose = true;
+    } else {
+      usage();
+    }
+  }
+
+  if(source == "" || target == "" || alignment == "" || input == "" || threads == 0)
+    usage();
+
+  std::ifstream inStream(input.c_str());
+  if(!inStream) {
+    std::cerr << "Can't read " << input << std::endl;
+    exit(1);
+  }
+  std::vector<std::vector<std::string> > sentences;
+  std::string line;
+  while(getline(inStream, line) && (limit == 0 || sentences.size() < limit)) {
+    sentences.push_back(Moses::Tokenize(line));
+  }
+
+  double start = Now();
+  tmmt::FuzzyMatchWrapper wrapper(source, target, alignment, threads);
+  double loaded = Now();
+
+  std::cout << "threads: " << threads << "\n"
+            << "loading: " << (loaded - start) << " s\n";
+  std::vector<int> costs;
+  double bitParallel = Match(wrapper, sentences, verbose, "bit-parallel", costs);
+
+  if (plain) {
+    std::vector<int> plainCosts;
+    wrapper.SetPlainSed(true);
+    double dynamic = Match(wrapper, sentences, verbose, "plain", plainCosts);
+    size_t differ = 0;
+    for(size_t i = 0; i < costs.size(); ++i) {
+      if (costs[i] != plainCosts[i])
+        ++differ;
+    }
+    std::cout << "speed-up: " << (bitParallel > 0 ? dynamic / bitParallel : 0) << "\n"
+              << "best costs: " << (differ ? "differ" : "same") << " (" << differ << " sentences differ)\n";
+    if (differ)
+      return 1;
+  }
+  return 0;
+}
+
+void usage()
+{
+  std::cerr << "Usage: benchmarkFuzzyMatch -s <source> -t <target> -a <alignment> -i <input> [-threads <n>] [-n <sentences>] [-plain] [-v]\n"
+            "-s <source>       source side of the translation memory\n"
+            "-t <target>       target side, as read by the fuzzy-match rule table\n"
+            "-a <alignment>    word alignment\n"
+            "-i <input>        held-out sentences to match\n"
+            "-threads <n>      threads evaluating the candidate matches of a sentence (default: 1)\n"
+            "-n <sentences>    only match the first sentences of the input\n"
+            "-plain            match again with the dynamic programming edit distance, and\n"
+            "                  compare the times and the best costs\n"
+            "-v                print the best cost, the number of rules and the time of each sentence\n";
+  exit(1);
+}
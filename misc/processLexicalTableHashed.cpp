@@ -0,0 +1,57 @@
+#include <iostream>
+#include <string>
+
+#include "InputFileStream.h"
+#include "LexicalReorderingTableHashed.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input table file name\n"
+            "\t-out string -- prefix of binary table file, written to prefix.hashlexr\n"
+            "\t-quantize   -- store the scores in 8 bits each\n"
+            "If -in is not specified reads from stdin\n"
+            "\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::cerr << "processLexicalTableHashed\n";
+  std::string inFilePath;
+  std::string outFilePath("out");
+  bool quantize = false;
+  if(1 >= argc) {
+    printHelp();
+    return 1;
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else if("-quantize" == arg) {
+      quantize = true;
+    } else {
+      //somethings wrong... print help
+      printHelp();
+      return 1;
+    }
+  }
+
+  bool success;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << ".hashlexr\n";
+    success = LexicalReorderingTableHashed::Create(std::cin, outFilePath + ".hashlexr", quantize);
+  } else {
+    std::cerr << "processing " << inFilePath<< " to " << outFilePath << ".hashlexr\n";
+    InputFileStream file(inFilePath);
+    success = LexicalReorderingTableHashed::Create(file, outFilePath + ".hashlexr", quantize);
+  }
+  return (success ? 0 : 1);
+}
@@ -115,6 +115,7 @@ public:
     //       we still need to apply the decision rule (MAP, MBR, ...)
     if ((*m_source).GetSize() == 0) return;
     Manager manager(m_lineNumber, *m_source,staticData.GetSearchAlgorithm(), &system);
+    manager.SetCancellationToken(GetCancellationToken());
     manager.ProcessSentence();
 
     // output word graph
@@ -519,6 +520,9 @@ int main(int argc, char** argv)
                             unknownsCollector.get() );
       // execute task
 #ifdef WITH_THREADS
+    if (staticData.TranslateShortestFirst()) {
+      task->SetPriority(source->GetSize());
+    }
     pool.Submit(task);
 #else
       task->Run();
@@ -532,8 +536,13 @@ int main(int argc, char** argv)
   // we are done, finishing up
 #ifdef WITH_THREADS
     pool.Stop(true); //flush remaining jobs
+    VERBOSE(1, "Thread pool: " << pool.GetStats() << endl);
 #endif
 
+    if (staticData.GetUseTransOptCache()) {
+      VERBOSE(1, "Persistent translation option cache: " << staticData.GetTransOptCacheStats() << endl);
+    }
+
   } catch (const std::exception &e) {
     std::cerr << "Exception: " << e.what() << std::endl;
     return EXIT_FAILURE;
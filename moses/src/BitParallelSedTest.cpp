@@ -0,0 +1,158 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "fuzzy-match/BitParallelSed.h"
+
+using namespace std;
+using namespace tmmt;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(bit_parallel_sed)
+
+namespace
+{
+
+//! the dynamic programming edit distance, with unit costs, as the fuzzy matcher's sed()
+unsigned int PlainDistance(const vector< WORD_ID > &a, const vector< WORD_ID > &b)
+{
+  vector< unsigned int > prev(b.size() + 1), curr(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) {
+    prev[j] = j;
+  }
+  for (size_t i = 1; i <= a.size(); ++i) {
+    curr[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      const unsigned int diag = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+      curr[j] = min(diag, min(prev[j], curr[j - 1]) + 1);
+    }
+    prev.swap(curr);
+  }
+  return prev[b.size()];
+}
+
+struct SedFixture {
+  SedFixture() {
+    srand(1);
+  }
+
+  //! checks the distance, and the cut-off at each maximum cost around it
+  void Check(const vector< WORD_ID > &pattern, const vector< WORD_ID > &text) {
+    BitParallelSed sed;
+    sed.Init(pattern);
+    const unsigned int expected = PlainDistance(pattern, text);
+    BOOST_REQUIRE_EQUAL(sed.Distance(text, pattern.size() + text.size()), expected);
+    const unsigned int maxCosts[] = {0, 1, expected / 2, expected - 1, expected, expected + 1};
+    for (size_t i = 0; i < sizeof(maxCosts) / sizeof(maxCosts[0]); ++i) {
+      const unsigned int maxCost = maxCosts[i];
+      if (maxCost > expected + 1) continue; // expected - 1 of 0
+      BOOST_REQUIRE_EQUAL(sed.Distance(text, maxCost), expected <= maxCost ? expected : maxCost + 1);
+    }
+  }
+
+  //! count words from a small vocabulary, so that many of them match
+  static vector< WORD_ID > Random(size_t count) {
+    vector< WORD_ID > words(count);
+    for (size_t i = 0; i < count; ++i) {
+      words[i] = rand() % 4;
+    }
+    return words;
+  }
+
+  //! words with a few substitutions, insertions and deletions
+  static vector< WORD_ID > Edit(const vector< WORD_ID > &words, size_t edits) {
+    vector< WORD_ID > ret(words);
+    for (size_t e = 0; e < edits; ++e) {
+      const size_t pos = ret.empty() ? 0 : rand() % ret.size();
+      switch (rand() % 3) {
+      case 0:
+        if (!ret.empty()) ret[pos] = rand() % 6;
+        break;
+      case 1:
+        ret.insert(ret.begin() + pos, rand() % 6);
+        break;
+      default:
+        if (!ret.empty()) ret.erase(ret.begin() + pos);
+      }
+    }
+    return ret;
+  }
+};
+
+}
+
+BOOST_FIXTURE_TEST_CASE(empty, SedFixture)
+{
+  const vector< WORD_ID > none, some = Random(70);
+  Check(none, none);
+  Check(none, some);
+  Check(some, none);
+}
+
+BOOST_FIXTURE_TEST_CASE(block_boundaries, SedFixture)
+{
+  // patterns of one block, just filling it, just over it, and several
+  const size_t lengths[] = {1, 63, 64, 65, 127, 128, 129, 200};
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    for (size_t round = 0; round < 20; ++round) {
+      const vector< WORD_ID > pattern = Random(lengths[l]);
+      Check(pattern, pattern);
+      Check(pattern, Edit(pattern, 1 + round % 5));
+      Check(pattern, Edit(pattern, 3 * round));
+      Check(pattern, Random(lengths[l]));
+      Check(pattern, Random(rand() % 250));
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(early_exit, SedFixture)
+{
+  BitParallelSed sed;
+  const vector< WORD_ID > pattern = Random(130);
+  sed.Init(pattern);
+
+  // the lengths alone are further apart than the maximum cost
+  BOOST_CHECK_EQUAL(sed.Distance(Random(10), 100), 101);
+  BOOST_CHECK_EQUAL(sed.Distance(vector< WORD_ID >(), 129), 130);
+  BOOST_CHECK_EQUAL(sed.Distance(vector< WORD_ID >(), 130), 130);
+
+  // no word matches: every block is dropped long before the end
+  const vector< WORD_ID > other(130, 9);
+  BOOST_CHECK_EQUAL(sed.Distance(other, 5), 6);
+  BOOST_CHECK_EQUAL(sed.Distance(other, 130), 130);
+}
+
+BOOST_FIXTURE_TEST_CASE(random_pairs, SedFixture)
+{
+  for (size_t round = 0; round < 2000; ++round) {
+    const vector< WORD_ID > pattern = Random(rand() % 160);
+    Check(pattern, (round % 2) ? Edit(pattern, rand() % 20) : Random(rand() % 160));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
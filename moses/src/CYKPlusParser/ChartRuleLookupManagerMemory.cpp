@@ -22,7 +22,7 @@
 #include "RuleTable/PhraseDictionarySCFG.h"
 #include "InputType.h"
 #include "ChartParserCallback.h"
-#include "DotChartInMemory.h"
+#include "DotChartCompact.h"
 #include "StaticData.h"
 #include "NonTerminal.h"
 #include "ChartCellCollection.h"
@@ -36,22 +36,29 @@ ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
   const PhraseDictionarySCFG &ruleTable)
   : ChartRuleLookupManagerCYKPlus(src, cellColl)
   , m_ruleTable(ruleTable)
+  , m_trie(ruleTable.GetTrie())
 {
   CHECK(m_dottedRuleColls.size() == 0);
   size_t sourceSize = src.GetSize();
   m_dottedRuleColls.resize(sourceSize);
 
-  const PhraseDictionaryNodeSCFG &rootNode = m_ruleTable.GetRootNode();
+  const CompactRuleTrie::Node &rootNode = m_trie.GetRootNode();
+
+  // the source words are looked up at every span which ends at them
+  m_sourceTermIds.resize(sourceSize);
+  for (size_t ind = 0; ind < sourceSize; ++ind) {
+    m_sourceTermIds[ind] = m_trie.GetTerminalId(GetSourceAt(ind).GetLabel());
+  }
 
   for (size_t ind = 0; ind < m_dottedRuleColls.size(); ++ind) {
 #ifdef USE_BOOST_POOL
-    DottedRuleInMemory *initDottedRule = m_dottedRulePool.malloc();
-    new (initDottedRule) DottedRuleInMemory(rootNode);
+    DottedRuleCompact *initDottedRule = m_dottedRulePool.malloc();
+    new (initDottedRule) DottedRuleCompact(rootNode);
 #else
-    DottedRuleInMemory *initDottedRule = new DottedRuleInMemory(rootNode);
+    DottedRuleCompact *initDottedRule = new DottedRuleCompact(rootNode);
 #endif
 
-    DottedRuleColl *dottedRuleColl = new DottedRuleColl(sourceSize - ind + 1);
+    DottedRuleCompactColl *dottedRuleColl = new DottedRuleCompactColl(sourceSize - ind + 1);
     dottedRuleColl->Add(0, initDottedRule); // init rule. stores the top node in tree
 
     m_dottedRuleColls[ind] = dottedRuleColl;
@@ -73,17 +80,18 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   // MAIN LOOP. create list of nodes of target phrases
 
   // get list of all rules that apply to spans at same starting position
-  DottedRuleColl &dottedRuleCol = *m_dottedRuleColls[range.GetStartPos()];
-  const DottedRuleList &expandableDottedRuleList = dottedRuleCol.GetExpandableDottedRuleList();
+  DottedRuleCompactColl &dottedRuleCol = *m_dottedRuleColls[range.GetStartPos()];
+  const DottedRuleCompactList &expandableDottedRuleList = dottedRuleCol.GetExpandableDottedRuleList();
   
   const ChartCellLabel &sourceWordLabel = GetSourceAt(absEndPos);
+  const UINT32 sourceTermId = m_sourceTermIds[absEndPos];
 
   // loop through the rules
   // (note that expandableDottedRuleList can be expanded as the loop runs 
   //  through calls to ExtendPartialRuleApplication())
   for (size_t ind = 0; ind < expandableDottedRuleList.size(); ++ind) {
     // rule we are about to extend
-    const DottedRuleInMemory &prevDottedRule = *expandableDottedRuleList[ind];
+    const DottedRuleCompact &prevDottedRule = *expandableDottedRuleList[ind];
     // we will now try to extend it, starting after where it ended
     size_t startPos = prevDottedRule.IsRoot()
                     ? range.GetStartPos()
@@ -91,24 +99,23 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
 
     // search for terminal symbol
     // (if only one more word position needs to be covered)
-    if (startPos == absEndPos) {
+    if (startPos == absEndPos && sourceTermId != CompactRuleTrie::NO_ID) {
 
       // look up in rule dictionary, if the current rule can be extended
       // with the source word in the last position
-      const Word &sourceWord = sourceWordLabel.GetLabel();
-      const PhraseDictionaryNodeSCFG *node = prevDottedRule.GetLastNode().GetChild(sourceWord);
+      const CompactRuleTrie::Node *node = m_trie.GetChild(prevDottedRule.GetLastNode(), sourceTermId);
 
       // if we found a new rule -> create it and add it to the list
       if (node != NULL) {
 				// create the rule
 #ifdef USE_BOOST_POOL
-        DottedRuleInMemory *dottedRule = m_dottedRulePool.malloc();
-        new (dottedRule) DottedRuleInMemory(*node, sourceWordLabel,
-                                            prevDottedRule);
+        DottedRuleCompact *dottedRule = m_dottedRulePool.malloc();
+        new (dottedRule) DottedRuleCompact(*node, sourceWordLabel,
+                                           prevDottedRule);
 #else
-        DottedRuleInMemory *dottedRule = new DottedRuleInMemory(*node,
-                                                                sourceWordLabel,
-                                                                prevDottedRule);
+        DottedRuleCompact *dottedRule = new DottedRuleCompact(*node,
+                                                              sourceWordLabel,
+                                                              prevDottedRule);
 #endif
         dottedRuleCol.Add(relEndPos+1, dottedRule);
       }
@@ -147,16 +154,16 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   }
 
   // list of rules that that cover the entire span
-  DottedRuleList &rules = dottedRuleCol.Get(relEndPos + 1);
+  DottedRuleCompactList &rules = dottedRuleCol.Get(relEndPos + 1);
 
   // look up target sides for the rules
-  DottedRuleList::const_iterator iterRule;
+  DottedRuleCompactList::const_iterator iterRule;
   for (iterRule = rules.begin(); iterRule != rules.end(); ++iterRule) {
-    const DottedRuleInMemory &dottedRule = **iterRule;
-    const PhraseDictionaryNodeSCFG &node = dottedRule.GetLastNode();
+    const DottedRuleCompact &dottedRule = **iterRule;
+    const CompactRuleTrie::Node &node = dottedRule.GetLastNode();
 
     // look up target sides
-    const TargetPhraseCollection *tpc = node.GetTargetPhraseCollection();
+    const TargetPhraseCollection *tpc = m_trie.GetTargetPhraseCollection(node);
 
     // add the fully expanded rule (with lexical target side)
     if (tpc != NULL) {
@@ -172,11 +179,11 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
 // determines the full or partial rule applications that can be produced through
 // extending the current rule application by a single non-terminal.
 void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
-  const DottedRuleInMemory &prevDottedRule,
+  const DottedRuleCompact &prevDottedRule,
   size_t startPos,
   size_t endPos,
   size_t stackInd,
-  DottedRuleColl & dottedRuleColl)
+  DottedRuleCompactColl & dottedRuleColl)
 {
   // source non-terminal labels for the remainder
   const NonTerminalSet &sourceNonTerms =
@@ -186,12 +193,9 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
   const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
 
   // note where it was found in the prefix tree of the rule dictionary
-  const PhraseDictionaryNodeSCFG &node = prevDottedRule.GetLastNode();
-
-  const PhraseDictionaryNodeSCFG::NonTerminalMap & nonTermMap =
-    node.GetNonTerminalMap();
+  const CompactRuleTrie::Node &node = prevDottedRule.GetLastNode();
 
-  const size_t numChildren = nonTermMap.size();
+  const size_t numChildren = node.GetNumNonTerminalChildren();
   if (numChildren == 0) {
     return;
   }
@@ -212,17 +216,24 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
     NonTerminalSet::const_iterator p = sourceNonTerms.begin();
     NonTerminalSet::const_iterator sEnd = sourceNonTerms.end();
     for (; p != sEnd; ++p) {
-      const Word & sourceNonTerm = *p;
+      const UINT32 sourceLabelId = m_trie.GetLabelId(*p);
+      if (sourceLabelId == CompactRuleTrie::NO_ID) {
+        continue;
+      }
 
       // loop over possible target non-terminal labels (as found in chart)
       ChartCellLabelSet::const_iterator q = targetNonTerms.begin();
       ChartCellLabelSet::const_iterator tEnd = targetNonTerms.end();
       for (; q != tEnd; ++q) {
         const ChartCellLabel &cellLabel = q->second;
+        const UINT32 targetLabelId = m_trie.GetLabelId(cellLabel.GetLabel());
+        if (targetLabelId == CompactRuleTrie::NO_ID) {
+          continue;
+        }
 
         // try to match both source and target non-terminal
-        const PhraseDictionaryNodeSCFG * child =
-          node.GetChild(sourceNonTerm, cellLabel.GetLabel());
+        const CompactRuleTrie::Node *child =
+          m_trie.GetChild(node, sourceLabelId, targetLabelId);
 
         // nothing found? then we are done
         if (child == NULL) {
@@ -231,11 +242,11 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
 
         // create new rule
 #ifdef USE_BOOST_POOL
-        DottedRuleInMemory *rule = m_dottedRulePool.malloc();
-        new (rule) DottedRuleInMemory(*child, cellLabel, prevDottedRule);
+        DottedRuleCompact *rule = m_dottedRulePool.malloc();
+        new (rule) DottedRuleCompact(*child, cellLabel, prevDottedRule);
 #else
-        DottedRuleInMemory *rule = new DottedRuleInMemory(*child, cellLabel,
-                                                          prevDottedRule);
+        DottedRuleCompact *rule = new DottedRuleCompact(*child, cellLabel,
+                                                        prevDottedRule);
 #endif
         dottedRuleColl.Add(stackInd, rule);
       }
@@ -244,30 +255,26 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
   else 
   {
     // loop over possible expansions of the rule
-    PhraseDictionaryNodeSCFG::NonTerminalMap::const_iterator p;
-    PhraseDictionaryNodeSCFG::NonTerminalMap::const_iterator end =
-      nonTermMap.end();
-    for (p = nonTermMap.begin(); p != end; ++p) {
+    for (size_t ind = 0; ind < numChildren; ++ind) {
       // does it match possible source and target non-terminals?
-      const PhraseDictionaryNodeSCFG::NonTerminalMapKey &key = p->first;
-      const Word &sourceNonTerm = key.first;
-      if (sourceNonTerms.find(sourceNonTerm) == sourceNonTerms.end()) {
+      const Word *sourceNonTerm, *targetNonTerm;
+      const CompactRuleTrie::Node &child =
+        m_trie.GetNonTerminalChild(node, ind, sourceNonTerm, targetNonTerm);
+      if (sourceNonTerms.find(*sourceNonTerm) == sourceNonTerms.end()) {
         continue;
       }
-      const Word &targetNonTerm = key.second;
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(targetNonTerm);
+      const ChartCellLabel *cellLabel = targetNonTerms.Find(*targetNonTerm);
       if (!cellLabel) {
         continue;
       }
 
       // create new rule
-      const PhraseDictionaryNodeSCFG &child = p->second;
 #ifdef USE_BOOST_POOL
-      DottedRuleInMemory *rule = m_dottedRulePool.malloc();
-      new (rule) DottedRuleInMemory(child, *cellLabel, prevDottedRule);
+      DottedRuleCompact *rule = m_dottedRulePool.malloc();
+      new (rule) DottedRuleCompact(child, *cellLabel, prevDottedRule);
 #else
-      DottedRuleInMemory *rule = new DottedRuleInMemory(child, *cellLabel,
-                                                        prevDottedRule);
+      DottedRuleCompact *rule = new DottedRuleCompact(child, *cellLabel,
+                                                      prevDottedRule);
 #endif
       dottedRuleColl.Add(stackInd, rule);
     }
@@ -28,9 +28,8 @@
 #endif
 
 #include "ChartRuleLookupManagerCYKPlus.h"
-#include "DotChartInMemory.h"
+#include "DotChartCompact.h"
 #include "NonTerminal.h"
-#include "RuleTable/PhraseDictionaryNodeSCFG.h"
 #include "RuleTable/PhraseDictionarySCFG.h"
 #include "StackVec.h"
 
@@ -38,10 +37,10 @@ namespace Moses
 {
 
 class ChartParserCallback;
-class DottedRuleColl;
+class DottedRuleCompactColl;
 class WordsRange;
 
-//! Implementation of ChartRuleLookupManager for in-memory rule tables.
+//! Implementation of ChartRuleLookupManager for in-memory rule tables, walking their CompactRuleTrie.
 class ChartRuleLookupManagerMemory : public ChartRuleLookupManagerCYKPlus
 {
  public:
@@ -57,19 +56,21 @@ class ChartRuleLookupManagerMemory : public ChartRuleLookupManagerCYKPlus
 
  private:
   void ExtendPartialRuleApplication(
-    const DottedRuleInMemory &prevDottedRule,
+    const DottedRuleCompact &prevDottedRule,
     size_t startPos,
     size_t endPos,
     size_t stackInd,
-    DottedRuleColl &dottedRuleColl);
+    DottedRuleCompactColl &dottedRuleColl);
 
-  std::vector<DottedRuleColl*> m_dottedRuleColls;
+  std::vector<DottedRuleCompactColl*> m_dottedRuleColls;
   const PhraseDictionarySCFG &m_ruleTable;
+  const CompactRuleTrie &m_trie;
+  std::vector<UINT32> m_sourceTermIds; //! terminal id of each source word in the trie
 #ifdef USE_BOOST_POOL
   // Use an object pool to allocate the dotted rules for this sentence.  We
   // allocate a lot of them and this has been seen to significantly improve
   // performance, especially for multithreaded decoding.
-  boost::object_pool<DottedRuleInMemory> m_dottedRulePool;
+  boost::object_pool<DottedRuleCompact> m_dottedRulePool;
 #endif
 };
 
@@ -0,0 +1,40 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2013 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "DotChartCompact.h"
+
+#include "Util.h"
+
+#include <algorithm>
+
+namespace Moses
+{
+
+DottedRuleCompactColl::~DottedRuleCompactColl()
+{
+#ifdef USE_BOOST_POOL
+  // Do nothing.  DottedRule objects are stored in object pools owned by
+  // the sentence-specific ChartRuleLookupManagers.
+#else
+  std::for_each(m_coll.begin(), m_coll.end(),
+                RemoveAllInColl<CollType::value_type>);
+#endif
+}
+
+}
@@ -0,0 +1,98 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2013 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include "DotChart.h"
+#include "RuleTable/CompactRuleTrie.h"
+
+#include "util/check.hh"
+#include <vector>
+
+namespace Moses
+{
+
+/** A partial rule application, ending at a node of a CompactRuleTrie.
+ */
+class DottedRuleCompact : public DottedRule
+{
+ public:
+  // used only to init dot stack.
+  explicit DottedRuleCompact(const CompactRuleTrie::Node &node)
+      : DottedRule()
+      , m_node(node) {}
+
+  DottedRuleCompact(const CompactRuleTrie::Node &node,
+                    const ChartCellLabel &cellLabel,
+                    const DottedRuleCompact &prev)
+      : DottedRule(cellLabel, prev)
+      , m_node(node) {}
+
+  const CompactRuleTrie::Node &GetLastNode() const { return m_node; }
+
+ private:
+  const CompactRuleTrie::Node &m_node;
+};
+
+typedef std::vector<const DottedRuleCompact*> DottedRuleCompactList;
+
+// Collection of all DottedRuleCompacts that share a common start point,
+// grouped by end point, as DottedRuleColl is for DottedRuleInMemory.
+class DottedRuleCompactColl
+{
+protected:
+  typedef std::vector<DottedRuleCompactList> CollType;
+  CollType m_coll;
+  DottedRuleCompactList m_expandableDottedRuleList;
+
+public:
+  DottedRuleCompactColl(size_t size)
+    : m_coll(size)
+  {}
+
+  ~DottedRuleCompactColl();
+
+  const DottedRuleCompactList &Get(size_t pos) const {
+    return m_coll[pos];
+  }
+  DottedRuleCompactList &Get(size_t pos) {
+    return m_coll[pos];
+  }
+
+  void Add(size_t pos, const DottedRuleCompact *dottedRule) {
+    CHECK(dottedRule);
+    m_coll[pos].push_back(dottedRule);
+    if (!dottedRule->GetLastNode().IsLeaf()) {
+      m_expandableDottedRuleList.push_back(dottedRule);
+    }
+  }
+
+  void Clear(size_t pos) {
+#ifdef USE_BOOST_POOL
+    m_coll[pos].clear();
+#endif
+  }
+
+  const DottedRuleCompactList &GetExpandableDottedRuleList() const {
+    return m_expandableDottedRuleList;
+  }
+
+};
+
+}
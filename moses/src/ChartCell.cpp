@@ -151,6 +151,15 @@ void ChartCell::CleanupArcList()
   }
 }
 
+void ChartCell::RenumberHypotheses(unsigned localBase, unsigned first)
+{
+  MapType::iterator iter;
+  for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
+    ChartHypothesisCollection &coll = iter->second;
+    coll.RenumberHypotheses(localBase, first);
+  }
+}
+
 //! debug info - size of each hypo collection in this cell
 void ChartCell::OutputSizes(std::ostream &out) const
 {
@@ -106,6 +106,9 @@ public:
 
   void CleanupArcList();
 
+  //! see ChartHypothesisCollection::RenumberHypotheses()
+  void RenumberHypotheses(unsigned localBase, unsigned first);
+
   void OutputSizes(std::ostream &out) const;
   size_t GetSize() const;
 
@@ -98,6 +98,9 @@ public:
 
   unsigned GetId() const { return m_id; }
 
+  //! renumber, when the hypotheses of a cell were created in parallel with other cells
+  void SetId(unsigned id) { m_id = id; }
+
   //! Get the rule that created this hypothesis
   const TargetPhrase &GetCurrTargetPhrase()const {
     return m_targetPhrase;
@@ -266,6 +266,26 @@ void ChartHypothesisCollection::SortHypotheses()
   }
 }
 
+void ChartHypothesisCollection::RenumberHypotheses(unsigned localBase, unsigned first)
+{
+  HCType::iterator iter;
+  for (iter = m_hypos.begin() ; iter != m_hypos.end() ; ++iter) {
+    ChartHypothesis *mainHypo = *iter;
+    if (mainHypo->GetId() >= localBase) {
+      mainHypo->SetId(first + (mainHypo->GetId() - localBase));
+    }
+    const ChartArcList *arcList = mainHypo->GetArcList();
+    if (arcList == NULL) continue;
+    ChartArcList::const_iterator iterArc;
+    for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
+      ChartHypothesis *arc = *iterArc;
+      if (arc->GetId() >= localBase) {
+        arc->SetId(first + (arc->GetId() - localBase));
+      }
+    }
+  }
+}
+
 //! Call CleanupArcList() for each main hypo in collection
 void ChartHypothesisCollection::CleanupArcList()
 {
@@ -109,6 +109,10 @@ public:
   void SortHypotheses();
   void CleanupArcList();
 
+  /** give the hypotheses and arcs numbered from localBase on the ids from
+   *  first on, in the same order */
+  void RenumberHypotheses(unsigned localBase, unsigned first);
+
   //! return vector of hypothesis that has been sorted by score
   const HypoList &GetSortedHypotheses() const {
     return m_hyposOrdered;
@@ -40,6 +40,33 @@ namespace Moses
 {
 extern bool g_debug;
 
+#ifdef WITH_THREADS
+/** decodes cells of a width in a pool thread */
+class ChartManager::CellTask : public Task
+{
+public:
+  explicit CellTask(ChartManager &manager)
+    : m_manager(manager) {}
+
+  void Run() {
+    // feature functions keep some of the sentence specific data per thread
+    if (!m_manager.m_threadInitialized.get()) {
+      m_manager.m_system->InitializeSearchThread(m_manager.m_source);
+      m_manager.m_threadInitialized.reset(new bool(true));
+    }
+    m_manager.ProcessCells();
+
+    boost::mutex::scoped_lock lock(m_manager.m_cellMutex);
+    if (--m_manager.m_cellTasks == 0) {
+      m_manager.m_cellsDone.notify_all();
+    }
+  }
+
+private:
+  ChartManager &m_manager;
+};
+#endif
+
 /* constructor. Initialize everything prior to decoding a particular sentence.
  * \param source the sentence to be decoded
  * \param system which particular set of models to use.
@@ -52,11 +79,30 @@ ChartManager::ChartManager(InputType const& source, const TranslationSystem* sys
   ,m_hypothesisId(0)
   ,m_parser(source, *system, m_hypoStackColl)
   ,m_translationOptionList(StaticData::Instance().GetRuleLimit())
+  ,m_searchThreads(1)
+#ifdef WITH_THREADS
+  ,m_cellContext(&NoCleanup)
+  ,m_nextCell(0)
+  ,m_cellTasks(0)
+#endif
 {
+#ifdef WITH_THREADS
+  // hypothesis ids are printed while searching at higher verbosity, and only
+  // put in order once all the cells of a width are done
+  const StaticData &staticData = StaticData::Instance();
+  if (staticData.GetSearchThreadCount() > 1 && staticData.GetVerboseLevel() < 2) {
+    m_searchThreads = staticData.GetSearchThreadCount();
+  }
+#endif
 }
 
 ChartManager::~ChartManager()
 {
+#ifdef WITH_THREADS
+  m_threadPool.reset();
+  RemoveAllInColl(m_cellOptionLists);
+  RemoveAllInColl(m_cellContexts);
+#endif
   m_system->CleanUpAfterSentenceProcessing(m_source);
 
   clock_t end = clock();
@@ -81,24 +127,23 @@ void ChartManager::ProcessSentence()
   // MAIN LOOP
   size_t size = m_source.GetSize();
   for (size_t width = 1; width <= size; ++width) {
+#ifdef WITH_THREADS
+    // the cells of one width only depend on narrower cells
+    if (m_searchThreads > 1 && width < size) {
+      ProcessWidth(width);
+      continue;
+    }
+#endif
     for (size_t startPos = 0; startPos <= size-width; ++startPos) {
       size_t endPos = startPos + width - 1;
       WordsRange range(startPos, endPos);
 
       // create trans opt
       m_translationOptionList.Clear();
-      m_parser.Create(range, m_translationOptionList);
-      m_translationOptionList.ApplyThreshold();
-      PreCalculateScores();
+      CreateTranslationOptions(range, m_translationOptionList);
 
       // decode
-      ChartCell &cell = m_hypoStackColl.Get(range);
-
-      cell.ProcessSentence(m_translationOptionList, m_hypoStackColl);
-      m_translationOptionList.Clear();
-      cell.PruneToSize();
-      cell.CleanupArcList();
-      cell.SortHypotheses();
+      ProcessCell(range, m_translationOptionList);
     }
   }
 
@@ -123,6 +168,93 @@ void ChartManager::ProcessSentence()
   }
 }
 
+void ChartManager::CreateTranslationOptions(const WordsRange &range, ChartTranslationOptionList &transOptList)
+{
+  m_parser.Create(range, transOptList);
+  transOptList.ApplyThreshold();
+  PreCalculateScores(transOptList);
+}
+
+void ChartManager::ProcessCell(const WordsRange &range, ChartTranslationOptionList &transOptList)
+{
+  ChartCell &cell = m_hypoStackColl.Get(range);
+
+  cell.ProcessSentence(transOptList, m_hypoStackColl);
+  transOptList.Clear();
+  cell.PruneToSize();
+  cell.CleanupArcList();
+  cell.SortHypotheses();
+}
+
+#ifdef WITH_THREADS
+void ChartManager::ProcessWidth(size_t width)
+{
+  const size_t numCells = m_source.GetSize() - width + 1;
+
+  if (!m_threadPool) {
+    m_threadPool.reset(new ThreadPool(m_searchThreads - 1));
+    for (size_t startPos = 0; startPos < numCells; ++startPos) {
+      m_cellOptionLists.push_back(new ChartTranslationOptionList(StaticData::Instance().GetRuleLimit()));
+      m_cellContexts.push_back(new CellContext(m_source));
+    }
+  }
+
+  m_cellRanges.clear();
+  for (size_t startPos = 0; startPos < numCells; ++startPos) {
+    m_cellRanges.push_back(WordsRange(startPos, startPos + width - 1));
+  }
+
+  // the rule lookup managers and the cache of precalculated scores aren't
+  // thread safe, so the rules of all the cells are looked up first
+  for (size_t startPos = 0; startPos < numCells; ++startPos) {
+    CreateTranslationOptions(m_cellRanges[startPos], *m_cellOptionLists[startPos]);
+  }
+
+  {
+    boost::mutex::scoped_lock lock(m_cellMutex);
+    m_nextCell = 0;
+    m_cellTasks = m_searchThreads - 1;
+  }
+  for (size_t i = 1; i < m_searchThreads; ++i) {
+    m_threadPool->Submit(new CellTask(*this));
+  }
+  ProcessCells();
+  {
+    boost::mutex::scoped_lock lock(m_cellMutex);
+    while (m_cellTasks > 0) {
+      m_cellsDone.wait(lock);
+    }
+  }
+
+  // number the hypotheses and count them as if the cells had been decoded
+  // one after the other
+  for (size_t startPos = 0; startPos < numCells; ++startPos) {
+    CellContext &context = *m_cellContexts[startPos];
+    m_hypoStackColl.Get(m_cellRanges[startPos]).RenumberHypotheses(LOCAL_HYPO_ID_BASE, m_hypothesisId);
+    m_hypothesisId += context.m_numHypos;
+    m_sentenceStats->AddCounts(context.m_stats);
+    context.m_stats.Initialize(m_source);
+    context.m_numHypos = 0;
+  }
+}
+
+void ChartManager::ProcessCells()
+{
+  const size_t numCells = m_cellRanges.size();
+  for (;;) {
+    size_t startPos;
+    {
+      boost::mutex::scoped_lock lock(m_cellMutex);
+      if (m_nextCell == numCells) return;
+      startPos = m_nextCell++;
+    }
+    m_cellContext.reset(m_cellContexts[startPos]);
+    ProcessCell(m_cellRanges[startPos], *m_cellOptionLists[startPos]);
+    m_cellContext.reset();
+  }
+}
+#endif
+
 /** add specific translation options and hypotheses according to the XML override translation scheme.
  *  Doesn't seem to do anything about walls and zones.
  *  @todo check walls & zones. Check that the implementation doesn't leak, xml options sometimes does if you're not careful
@@ -343,10 +475,10 @@ void ChartManager::CreateDeviantPaths(
 }
 
   
-void ChartManager::PreCalculateScores() 
+void ChartManager::PreCalculateScores(const ChartTranslationOptionList &transOptList)
 {
-  for (size_t i = 0; i < m_translationOptionList.GetSize(); ++i) {
-    const ChartTranslationOptions& cto = m_translationOptionList.Get(i);
+  for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+    const ChartTranslationOptions& cto = transOptList.Get(i);
     for (TargetPhraseCollection::const_iterator j  = cto.GetTargetPhraseCollection().begin();
      j != cto.GetTargetPhraseCollection().end(); ++j) {
       const TargetPhrase* targetPhrase = *j;
@@ -34,6 +34,14 @@
 
 #include <boost/shared_ptr.hpp>
 
+#ifdef WITH_THREADS
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include "ThreadPool.h"
+#endif
+
 namespace Moses
 {
 
@@ -70,7 +78,48 @@ private:
   boost::unordered_map<TargetPhrase,ScoreComponentCollection, TargetPhraseHasher, TargetPhraseComparator> m_precalculatedScores;
 
   //! Pre-calculate most stateless feature values
-  void PreCalculateScores();
+  void PreCalculateScores(const ChartTranslationOptionList &transOptList);
+
+  //! look up the rules which apply to a span
+  void CreateTranslationOptions(const WordsRange &range, ChartTranslationOptionList &transOptList);
+
+  //! fill the cell of a span with hypotheses
+  void ProcessCell(const WordsRange &range, ChartTranslationOptionList &transOptList);
+
+  size_t m_searchThreads; //! cells of the same width are decoded concurrently if > 1
+
+#ifdef WITH_THREADS
+  class CellTask;
+
+  /** what a thread decoding a cell of a parallel width uses instead of the
+   *  counters of the manager, to be merged once the width is done */
+  struct CellContext {
+    explicit CellContext(const InputType &source) : m_stats(source), m_numHypos(0) {}
+    SentenceStats m_stats;
+    unsigned m_numHypos;
+  };
+
+  //! ids of hypotheses created in a parallel width, until the width is done
+  static const unsigned LOCAL_HYPO_ID_BASE = 0x80000000u;
+
+  static void NoCleanup(CellContext *) {}
+
+  boost::scoped_ptr<ThreadPool> m_threadPool;
+  std::vector<WordsRange> m_cellRanges; //! of the width, which the translation options point to
+  std::vector<ChartTranslationOptionList*> m_cellOptionLists; //! by start position
+  std::vector<CellContext*> m_cellContexts; //! by start position
+  boost::thread_specific_ptr<CellContext> m_cellContext; //! of the cell the thread is decoding
+  boost::thread_specific_ptr<bool> m_threadInitialized;
+  boost::mutex m_cellMutex;
+  boost::condition_variable m_cellsDone;
+  size_t m_nextCell, m_cellTasks;
+
+  //! decode all the cells of one width, in several threads
+  void ProcessWidth(size_t width);
+
+  //! decode cells of the width until there are none left. Run in each thread
+  void ProcessCells();
+#endif
 
 public:
   ChartManager(InputType const& source, const TranslationSystem* system);
@@ -95,6 +144,9 @@ public:
 
   //! debug data collected when decoding sentence
   SentenceStats& GetSentenceStats() const {
+#ifdef WITH_THREADS
+    if (m_cellContext.get()) return m_cellContext->m_stats;
+#endif
     return *m_sentenceStats;
   }
   
@@ -110,7 +162,12 @@ public:
   }
 
   //! contigious hypo id for each input sentence. For debugging purposes
-  unsigned GetNextHypoId() { return m_hypothesisId++; }
+  unsigned GetNextHypoId() {
+#ifdef WITH_THREADS
+    if (m_cellContext.get()) return LOCAL_HYPO_ID_BASE + m_cellContext->m_numHypos++;
+#endif
+    return m_hypothesisId++;
+  }
 
   //! Access the pre-calculated values
   void InsertPreCalculatedScores(const TargetPhrase& targetPhrase,
@@ -0,0 +1,255 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ClockCache_h
+#define moses_ClockCache_h
+
+#include <iostream>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Hit/miss/eviction counters of a ClockCache, summed over all shards.
+ */
+struct ClockCacheStats {
+  size_t hits, misses, inserts, evictions;
+  size_t entries, cost;
+
+  ClockCacheStats()
+    : hits(0), misses(0), inserts(0), evictions(0), entries(0), cost(0) {}
+
+  float HitRate() const {
+    return (hits + misses) ? (float) hits / (hits + misses) : 0.0f;
+  }
+};
+
+inline std::ostream& operator<<(std::ostream &out, const ClockCacheStats &stats)
+{
+  out << "hits=" << stats.hits << " misses=" << stats.misses
+      << " hit-rate=" << stats.HitRate()
+      << " inserts=" << stats.inserts << " evictions=" << stats.evictions
+      << " entries=" << stats.entries << " cost=" << stats.cost;
+  return out;
+}
+
+/** Thread-safe cache which is split into independently locked shards.
+  * Each shard evicts with the CLOCK algorithm (second chance approximation
+  * of LRU): a hit only sets a reference bit, and the clock hand sweeps over
+  * the slots clearing bits until it finds an unreferenced entry to evict.
+  * Neither lookups nor evictions need to sort or timestamp the entries.
+  *
+  * Each entry carries a cost (1 by default, but it can be e.g. a size in
+  * bytes), and each shard keeps the sum of its costs below capacity/shards.
+  * Values are handed out by copy, so ValuePtr should be a cheap, shared
+  * handle such as a boost::shared_ptr; an evicted value stays alive for as
+  * long as a caller holds on to it.
+  */
+template <class Key, class ValuePtr, class Hash = boost::hash<Key> >
+class ClockCache
+{
+public:
+  ClockCache(size_t capacity, size_t shards)
+    : m_hash() {
+    // no point in having shards which can't hold a single entry
+    if (shards > capacity) shards = capacity;
+    if (shards == 0) shards = 1;
+    const size_t shardCapacity = (capacity + shards - 1) / shards;
+    m_shards.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+      m_shards.push_back(new Shard(shardCapacity));
+    }
+  }
+
+  ~ClockCache() {
+    for (size_t i = 0; i < m_shards.size(); ++i) {
+      delete m_shards[i];
+    }
+  }
+
+  /** look up key. Returns true and sets value if found */
+  bool Find(const Key &key, ValuePtr &value) const {
+    const size_t hash = m_hash(key);
+    Shard &shard = GetShard(hash);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.m_mutex);
+#endif
+    typename Index::const_iterator iter = shard.m_index.find(key);
+    if (iter == shard.m_index.end()) {
+      ++shard.m_stats.misses;
+      return false;
+    }
+    Slot &slot = shard.m_slots[iter->second];
+    slot.m_referenced = true;
+    value = slot.m_value;
+    ++shard.m_stats.hits;
+    return true;
+  }
+
+  /** insert or replace the value of key, evicting entries as necessary */
+  void Add(const Key &key, const ValuePtr &value, size_t cost = 1) {
+    const size_t hash = m_hash(key);
+    Shard &shard = GetShard(hash);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.m_mutex);
+#endif
+    typename Index::iterator iter = shard.m_index.find(key);
+    if (iter != shard.m_index.end()) {
+      Slot &slot = shard.m_slots[iter->second];
+      shard.m_stats.cost -= slot.m_cost;
+      slot.m_value = value;
+      slot.m_cost = cost;
+      slot.m_referenced = true;
+      shard.m_stats.cost += cost;
+      shard.Reduce(0);
+      return;
+    }
+
+    if (cost > shard.m_capacity) return; // would never fit
+    shard.Reduce(cost);
+
+    size_t ind;
+    if (shard.m_free.empty()) {
+      ind = shard.m_slots.size();
+      shard.m_slots.push_back(Slot());
+    } else {
+      ind = shard.m_free.back();
+      shard.m_free.pop_back();
+    }
+    std::pair<typename Index::iterator, bool> inserted
+      = shard.m_index.insert(std::make_pair(key, ind));
+    Slot &slot = shard.m_slots[ind];
+    // element addresses of an unordered_map are stable across rehashing
+    slot.m_key = &inserted.first->first;
+    slot.m_value = value;
+    slot.m_cost = cost;
+    slot.m_referenced = false;
+    ++shard.m_stats.inserts;
+    ++shard.m_stats.entries;
+    shard.m_stats.cost += cost;
+  }
+
+  void Clear() {
+    for (size_t i = 0; i < m_shards.size(); ++i) {
+      Shard &shard = *m_shards[i];
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(shard.m_mutex);
+#endif
+      shard.m_index.clear();
+      shard.m_slots.clear();
+      shard.m_free.clear();
+      shard.m_hand = 0;
+      shard.m_stats.entries = 0;
+      shard.m_stats.cost = 0;
+    }
+  }
+
+  ClockCacheStats GetStats() const {
+    ClockCacheStats ret;
+    for (size_t i = 0; i < m_shards.size(); ++i) {
+      const Shard &shard = *m_shards[i];
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(shard.m_mutex);
+#endif
+      ret.hits += shard.m_stats.hits;
+      ret.misses += shard.m_stats.misses;
+      ret.inserts += shard.m_stats.inserts;
+      ret.evictions += shard.m_stats.evictions;
+      ret.entries += shard.m_stats.entries;
+      ret.cost += shard.m_stats.cost;
+    }
+    return ret;
+  }
+
+  size_t GetNumShards() const {
+    return m_shards.size();
+  }
+
+private:
+  typedef boost::unordered_map<Key, size_t, Hash> Index;
+
+  struct Slot {
+    const Key *m_key; // points into the index. NULL if the slot is free
+    ValuePtr m_value;
+    size_t m_cost;
+    bool m_referenced;
+
+    Slot() : m_key(NULL), m_cost(0), m_referenced(false) {}
+  };
+
+  struct Shard {
+    Index m_index;
+    std::vector<Slot> m_slots;
+    std::vector<size_t> m_free;
+    size_t m_hand;
+    size_t m_capacity;
+    ClockCacheStats m_stats;
+#ifdef WITH_THREADS
+    mutable boost::mutex m_mutex;
+#endif
+
+    explicit Shard(size_t capacity) : m_hand(0), m_capacity(capacity) {}
+
+    //! sweep the clock hand until there is room for extra. Lock must be held
+    void Reduce(size_t extra) {
+      while (m_stats.cost + extra > m_capacity && m_stats.entries > 0) {
+        if (m_hand >= m_slots.size()) m_hand = 0;
+        Slot &slot = m_slots[m_hand];
+        if (slot.m_key == NULL) {
+          // free slot
+        } else if (slot.m_referenced) {
+          slot.m_referenced = false;
+        } else {
+          m_index.erase(m_index.find(*slot.m_key));
+          m_stats.cost -= slot.m_cost;
+          --m_stats.entries;
+          ++m_stats.evictions;
+          slot = Slot();
+          m_free.push_back(m_hand);
+        }
+        ++m_hand;
+      }
+    }
+  };
+
+  Shard &GetShard(size_t hash) const {
+    // the index consumes the low bits, so mix in the high ones
+    return *m_shards[(hash ^ (hash >> 17)) % m_shards.size()];
+  }
+
+  Hash m_hash;
+  std::vector<Shard*> m_shards;
+
+  // no copying
+  ClockCache(const ClockCache&);
+  ClockCache &operator=(const ClockCache&);
+};
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "ClockCache.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(clock_cache)
+
+typedef boost::shared_ptr<int> IntPtr;
+typedef ClockCache<size_t, IntPtr> IntCache;
+
+BOOST_AUTO_TEST_CASE(find_and_count)
+{
+  IntCache cache(10, 2);
+  IntPtr value;
+  BOOST_CHECK(!cache.Find(3, value));
+  cache.Add(3, IntPtr(new int(30)));
+  BOOST_CHECK(cache.Find(3, value));
+  BOOST_CHECK_EQUAL(*value, 30);
+
+  ClockCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.hits, 1);
+  BOOST_CHECK_EQUAL(stats.misses, 1);
+  BOOST_CHECK_EQUAL(stats.inserts, 1);
+  BOOST_CHECK_EQUAL(stats.entries, 1);
+}
+
+BOOST_AUTO_TEST_CASE(replace)
+{
+  IntCache cache(10, 1);
+  cache.Add(1, IntPtr(new int(1)));
+  cache.Add(1, IntPtr(new int(2)));
+  IntPtr value;
+  BOOST_CHECK(cache.Find(1, value));
+  BOOST_CHECK_EQUAL(*value, 2);
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 1);
+}
+
+BOOST_AUTO_TEST_CASE(second_chance)
+{
+  IntCache cache(3, 1);
+  cache.Add(1, IntPtr(new int(1)));
+  cache.Add(2, IntPtr(new int(2)));
+  cache.Add(3, IntPtr(new int(3)));
+  IntPtr kept;
+  BOOST_CHECK(cache.Find(1, kept));
+
+  // 1 was referenced, so 2 is the first victim
+  cache.Add(4, IntPtr(new int(4)));
+  IntPtr value;
+  BOOST_CHECK(cache.Find(1, value));
+  BOOST_CHECK(!cache.Find(2, value));
+  BOOST_CHECK(cache.Find(3, value));
+  BOOST_CHECK(cache.Find(4, value));
+  BOOST_CHECK_EQUAL(cache.GetStats().evictions, 1);
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 3);
+}
+
+BOOST_AUTO_TEST_CASE(evicted_value_stays_alive)
+{
+  IntCache cache(1, 1);
+  cache.Add(1, IntPtr(new int(1)));
+  IntPtr value;
+  BOOST_CHECK(cache.Find(1, value));
+  cache.Add(2, IntPtr(new int(2)));
+  cache.Add(3, IntPtr(new int(3)));
+  BOOST_CHECK_EQUAL(*value, 1);
+}
+
+BOOST_AUTO_TEST_CASE(cost_budget)
+{
+  IntCache cache(10, 1);
+  cache.Add(1, IntPtr(new int(1)), 4);
+  cache.Add(2, IntPtr(new int(2)), 4);
+  cache.Add(3, IntPtr(new int(3)), 4);
+  ClockCacheStats stats = cache.GetStats();
+  BOOST_CHECK(stats.cost <= 10);
+  BOOST_CHECK_EQUAL(stats.entries, 2);
+
+  // never fits
+  cache.Add(4, IntPtr(new int(4)), 11);
+  IntPtr value;
+  BOOST_CHECK(!cache.Find(4, value));
+}
+
+BOOST_AUTO_TEST_CASE(capacity_over_shards)
+{
+  IntCache cache(64, 8);
+  for (size_t i = 0; i < 1000; ++i) {
+    cache.Add(i, IntPtr(new int(i)));
+  }
+  ClockCacheStats stats = cache.GetStats();
+  BOOST_CHECK(stats.entries <= 64);
+  BOOST_CHECK_EQUAL(stats.inserts, 1000);
+  BOOST_CHECK_EQUAL(stats.evictions, stats.inserts - stats.entries);
+
+  cache.Clear();
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -40,6 +40,8 @@ PhraseDecoder::PhraseDecoder(
   m_containsAlignmentInfo(true), m_maxRank(0),
   m_symbolTree(0), m_multipleScoreTrees(false),
   m_scoreTrees(1), m_alignTree(0),
+  m_decodingCache(StaticData::Instance().GetMinphrCacheSize(),
+                  4 * StaticData::Instance().ThreadCount()),
   m_phraseDictionary(phraseDictionary), m_input(input), m_output(output),
   m_feature(feature), m_weight(weight),
   m_weightWP(weightWP), m_languageModels(languageModels),
@@ -483,9 +485,4 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
   return tpv;
 }
 
-void PhraseDecoder::PruneCache()
-{
-  m_decodingCache.Prune();
-}
-
 }
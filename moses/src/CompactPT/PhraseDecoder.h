@@ -144,8 +144,6 @@ class PhraseDecoder
                                            BitWrapper<> &encodedBitStream,
                                            const Phrase &sourcePhrase,
                                            bool topLevel);
-    
-    void PruneCache();
 };
 
 }
@@ -156,14 +156,21 @@ PhraseDictionaryCompact::~PhraseDictionaryCompact() {
 
 //TO_STRING_BODY(PhraseDictionaryCompact)
 
-void PhraseDictionaryCompact::CacheForCleanup(TargetPhraseCollection* tpc) {
+PhraseDictionaryCompact::PhraseCache &PhraseDictionaryCompact::GetSentenceCache() {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_sentenceMutex);
-  PhraseCache &ref = m_sentenceCache[boost::this_thread::get_id()]; 
+  PhraseCache *ref = m_sentenceCache.get();
+  if(!ref) {
+    ref = new PhraseCache();
+    m_sentenceCache.reset(ref);
+  }
+  return *ref;
 #else
-  PhraseCache &ref = m_sentenceCache; 
+  return m_sentenceCache;
 #endif
-  ref.push_back(tpc);
+}
+
+void PhraseDictionaryCompact::CacheForCleanup(TargetPhraseCollection* tpc) {
+  GetSentenceCache().push_back(tpc);
 }
 
 void PhraseDictionaryCompact::InitializeForInput(const Moses::InputType&) {}
@@ -174,16 +181,8 @@ void PhraseDictionaryCompact::AddEquivPhrase(const Phrase &source,
 void PhraseDictionaryCompact::CleanUp(const InputType &source) {
   if(!m_inMemory)
     m_hash.KeepNLastRanges(0.01, 0.2);
-    
-  m_phraseDecoder->PruneCache();
-  
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_sentenceMutex);
-  PhraseCache &ref = m_sentenceCache[boost::this_thread::get_id()]; 
-#else
-  PhraseCache &ref = m_sentenceCache; 
-#endif
-  
+
+  PhraseCache &ref = GetSentenceCache();
   for(PhraseCache::iterator it = ref.begin(); it != ref.end(); it++) 
       delete *it;
       
@@ -25,9 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/unordered_map.hpp>
 
 #ifdef WITH_THREADS
-#ifdef BOOST_HAS_PTHREADS
-#include <boost/thread/mutex.hpp>
-#endif
+#include <boost/thread/tss.hpp>
 #endif
 
 #include "PhraseDictionary.h"
@@ -52,14 +50,15 @@ protected:
   bool m_inMemory;
   bool m_useAlignmentInfo;
   
+  // Collections handed out during the current sentence of each thread
   typedef std::vector<TargetPhraseCollection*> PhraseCache;
 #ifdef WITH_THREADS
-  boost::mutex m_sentenceMutex;
-  typedef std::map<boost::thread::id, PhraseCache> SentenceCache;
+  boost::thread_specific_ptr<PhraseCache> m_sentenceCache;
 #else
-  typedef PhraseCache SentenceCache;
+  PhraseCache m_sentenceCache;
 #endif
-  SentenceCache m_sentenceCache;
+
+  PhraseCache &GetSentenceCache();
   
   BlockHashIndex m_hash;
   PhraseDecoder* m_phraseDecoder;
@@ -566,12 +566,12 @@ void PhraseTableCreator::EncodeTargetPhraseREnc(std::vector<std::string>& s,
         {
           bestRank = r;
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
+          bestDiff = abs(int(*it)-int(i));
         }
-        else if(r == bestRank && unsigned(abs(*it-i)) < bestDiff)
+        else if(r == bestRank && unsigned(abs(int(*it)-int(i))) < bestDiff)
         {
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
+          bestDiff = abs(int(*it)-int(i));
         }
       }
     }
@@ -22,18 +22,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_TargetPhraseCollectionCache_h
 #define moses_TargetPhraseCollectionCache_h
 
-#include <map>
-#include <set>
 #include <vector>
 
 #ifdef WITH_THREADS
-#ifdef BOOST_HAS_PTHREADS
-#include <boost/thread/mutex.hpp>
-#endif
+#include <boost/thread/tss.hpp>
 #endif
 
 #include <boost/shared_ptr.hpp>
 
+#include "ClockCache.h"
 #include "Phrase.h"
 #include "TargetPhraseCollection.h"
 
@@ -44,137 +41,133 @@ namespace Moses
 typedef std::vector<TargetPhrase> TargetPhraseVector;
 typedef boost::shared_ptr<TargetPhraseVector> TargetPhraseVectorPtr;
 
+/** Decoded target phrase collections by source phrase.
+ *
+ * The collections are kept in a sharded ClockCache which stays within a
+ * budget in bytes, so a few huge collections can't push out thousands of
+ * small ones. In front of it, each thread has a small direct-mapped table of
+ * the entries it used last, which is read without taking any lock. Entries
+ * are immutable and shared, so an entry evicted from the cache stays valid
+ * in the thread tables (and for callers) until it is replaced there.
+ */
 class TargetPhraseCollectionCache
 {
   private:
-    size_t m_max;
-    float m_tolerance;
-    
-    struct LastUsed {
-      clock_t m_clock;
+    struct Entry {
+      Phrase m_source;
       TargetPhraseVectorPtr m_tpv;
       size_t m_bitsLeft;
-      
-      LastUsed() : m_clock(0), m_bitsLeft(0) {}
-      
-      LastUsed(clock_t clock, TargetPhraseVectorPtr tpv, size_t bitsLeft = 0)
-      : m_clock(clock), m_tpv(tpv), m_bitsLeft(bitsLeft) {}
+
+      Entry(const Phrase &source, TargetPhraseVectorPtr tpv, size_t bitsLeft)
+      : m_source(source), m_tpv(tpv), m_bitsLeft(bitsLeft) {}
+    };
+    typedef boost::shared_ptr<const Entry> EntryPtr;
+
+    struct Slot {
+      size_t m_hash;
+      EntryPtr m_entry;
+
+      Slot() : m_hash(0) {}
     };
-    
-    typedef std::map<Phrase, LastUsed> CacheMap;
-    
-    CacheMap m_phraseCache;
-    
+    typedef std::vector<Slot> ThreadCache;
+
+    static const size_t THREAD_CACHE_SIZE = 256;
+
+    ClockCache<Phrase, EntryPtr> m_cache;
+
 #ifdef WITH_THREADS
-    boost::mutex m_mutex;
+    boost::thread_specific_ptr<ThreadCache> m_threadCache;
+#else
+    ThreadCache m_threadCache;
 #endif
 
-  public:
-    
-    typedef CacheMap::iterator iterator;
-    typedef CacheMap::const_iterator const_iterator;
-        
-    TargetPhraseCollectionCache(size_t max = 5000, float tolerance = 0.2)
-    : m_max(max), m_tolerance(tolerance)
-    {}
-    
-    iterator Begin()
+    ThreadCache &GetThreadCache()
     {
-      return m_phraseCache.begin();
-    }
-    
-    const_iterator Begin() const
-    {
-      return m_phraseCache.begin();
-    }
-    
-    iterator End()
-    {
-      return m_phraseCache.end();
+#ifdef WITH_THREADS
+      ThreadCache *threadCache = m_threadCache.get();
+      if(!threadCache)
+      {
+        threadCache = new ThreadCache(THREAD_CACHE_SIZE);
+        m_threadCache.reset(threadCache);
+      }
+      return *threadCache;
+#else
+      if(m_threadCache.empty())
+        m_threadCache.resize(THREAD_CACHE_SIZE);
+      return m_threadCache;
+#endif
     }
-    
-    const_iterator End() const
+
+    // Approximate memory taken by an entry
+    static size_t GetBytes(const Entry &entry)
     {
-      return m_phraseCache.end();
+      size_t bytes = sizeof(Entry) + sizeof(TargetPhraseVector)
+                     + entry.m_source.GetSize() * sizeof(Word);
+      for(TargetPhraseVector::const_iterator it = entry.m_tpv->begin();
+          it != entry.m_tpv->end(); it++)
+        bytes += sizeof(TargetPhrase) + it->GetSize() * sizeof(Word);
+      return bytes;
     }
-    
+
+  public:
+
+    TargetPhraseCollectionCache(size_t maxBytes = 64 << 20, size_t shards = 16)
+    : m_cache(maxBytes, shards)
+    {}
+
     void Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
                size_t bitsLeft = 0, size_t maxRank = 0)
     {
-#ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
-#endif
+      // The first decoding of a phrase stays cached
+      EntryPtr entry;
+      if(m_cache.Find(sourcePhrase, entry))
+        return;
 
-      iterator it = m_phraseCache.find(sourcePhrase);
-      if(it != m_phraseCache.end())
-        it->second.m_clock = clock();
-      else
+      if(maxRank && tpv->size() > maxRank)
       {
-        if(maxRank && tpv->size() > maxRank)
-        {
-          TargetPhraseVectorPtr tpv_temp(new TargetPhraseVector());
-          tpv_temp->resize(maxRank);
-          std::copy(tpv->begin(), tpv->begin() + maxRank, tpv_temp->begin());
-          m_phraseCache[sourcePhrase] = LastUsed(clock(), tpv_temp, bitsLeft);
-        }
-        else
-          m_phraseCache[sourcePhrase] = LastUsed(clock(), tpv, bitsLeft);
+        TargetPhraseVectorPtr tpv_temp(new TargetPhraseVector());
+        tpv_temp->resize(maxRank);
+        std::copy(tpv->begin(), tpv->begin() + maxRank, tpv_temp->begin());
+        tpv = tpv_temp;
       }
+      entry.reset(new Entry(sourcePhrase, tpv, bitsLeft));
+      m_cache.Add(sourcePhrase, entry, GetBytes(*entry));
+
+      const size_t hash = hash_value(sourcePhrase);
+      Slot &slot = GetThreadCache()[hash % THREAD_CACHE_SIZE];
+      slot.m_hash = hash;
+      slot.m_entry = entry;
     }
 
     std::pair<TargetPhraseVectorPtr, size_t> Retrieve(const Phrase &sourcePhrase)
     {
-#ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
-#endif
-
-      iterator it = m_phraseCache.find(sourcePhrase);
-      if(it != m_phraseCache.end())
+      const size_t hash = hash_value(sourcePhrase);
+      Slot &slot = GetThreadCache()[hash % THREAD_CACHE_SIZE];
+      if(!slot.m_entry || slot.m_hash != hash
+         || !(slot.m_entry->m_source == sourcePhrase))
       {
-        LastUsed &lu = it->second;
-        lu.m_clock = clock();
-        return std::make_pair(lu.m_tpv, lu.m_bitsLeft);
+        EntryPtr entry;
+        if(!m_cache.Find(sourcePhrase, entry))
+          return std::make_pair(TargetPhraseVectorPtr(), 0);
+        slot.m_hash = hash;
+        slot.m_entry = entry;
       }
-      else
-        return std::make_pair(TargetPhraseVectorPtr(), 0);
+      return std::make_pair(slot.m_entry->m_tpv, slot.m_entry->m_bitsLeft);
     }
 
-    void Prune()
+    //! Empties the cache and the table of this thread
+    void CleanUp()
     {
-#ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
-#endif
-
-      if(m_phraseCache.size() > m_max * (1 + m_tolerance))
-      {
-        typedef std::set<std::pair<clock_t, Phrase> > Cands;
-        Cands cands; 
-        for(CacheMap::iterator it = m_phraseCache.begin();
-            it != m_phraseCache.end(); it++)
-        {
-          LastUsed &lu = it->second;
-          cands.insert(std::make_pair(lu.m_clock, it->first));
-        }
-         
-        for(Cands::iterator it = cands.begin(); it != cands.end(); it++)
-        {
-          const Phrase& p = it->second;
-          m_phraseCache.erase(p);
-          
-          if(m_phraseCache.size() < (m_max * (1 - m_tolerance)))
-            break;
-        }
-      }
+      m_cache.Clear();
+      ThreadCache &threadCache = GetThreadCache();
+      for(size_t i = 0; i < threadCache.size(); i++)
+        threadCache[i] = Slot();
     }
 
-    void CleanUp()
+    ClockCacheStats GetStats() const
     {
-#ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
-#endif
-      m_phraseCache.clear();
+      return m_cache.GetStats();
     }
-    
 };
 
 }
@@ -0,0 +1,233 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "RuleTable/CompactRuleTrie.h"
+#include "RuleTable/PhraseDictionaryNodeSCFG.h"
+#include "TargetPhrase.h"
+#include "TargetPhraseCollection.h"
+#include "Word.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(compact_rule_trie)
+
+namespace
+{
+
+// source with its left hand side, target, and alignment of the non-terminals
+const char *kRules[][3] = {
+  {"a [X]", "A [X]", ""},
+  {"a [X]", "AA [X]", ""},
+  {"a b [X]", "A B [X]", ""},
+  {"a c [X]", "A C [X]", ""},
+  {"a [X][X] [X]", "A [X][X] [X]", "1-1"},
+  {"a [X][NP] c [X]", "[X][NP] C [X]", "1-0"},
+  {"a [Y][Y] [X]", "A [Y][Y] [X]", "1-1"},
+  {"[X][X] b [X]", "[X][X] B [X]", "0-0"},
+  {"[X][X] [X][X] [X]", "[X][X] [X][X] [X]", "0-1 1-0"},
+  {"b [X]", "B [X]", ""},
+};
+const size_t kNumRules = sizeof(kRules) / sizeof(kRules[0]);
+
+//! the root of the trie of nodes that CompactRuleTrie replaces
+class SCFGRoot : public PhraseDictionaryNodeSCFG
+{
+public:
+  SCFGRoot() {}
+};
+
+struct RuleFixture {
+  RuleFixture() : factorOrder(1, 0) {
+    const char *terminals[] = {"a", "b", "c", "d"};
+    for (size_t i = 0; i < sizeof(terminals) / sizeof(terminals[0]); ++i) {
+      vocab.push_back(MakeWord(Input, terminals[i], false));
+    }
+  }
+
+  void Load(size_t tableLimit) {
+    for (size_t i = 0; i < kNumRules; ++i) {
+      Word sourceLHS, targetLHS;
+      Phrase source(0);
+      source.CreateFromStringNewFormat(Input, factorOrder, kRules[i][0], "|", sourceLHS);
+      TargetPhrase target;
+      target.CreateFromStringNewFormat(Output, factorOrder, kRules[i][1], "|", targetLHS);
+      if (*kRules[i][2]) {
+        target.SetAlignmentInfo(kRules[i][2], source);
+      }
+
+      compact.GetOrCreateTargetPhraseCollection(source, target).Add(new TargetPhrase(target));
+      GetOrCreateNode(source, target).GetOrCreateTargetPhraseCollection().Add(new TargetPhrase(target));
+    }
+    compact.Build(tableLimit);
+    if (tableLimit) {
+      scfg.Sort(tableLimit);
+    }
+  }
+
+  //! as the text rule table loaders walk the node trie
+  PhraseDictionaryNodeSCFG &GetOrCreateNode(const Phrase &source, const TargetPhrase &target) {
+    AlignmentInfo::const_iterator iterAlign = target.GetAlignmentInfo().begin();
+    PhraseDictionaryNodeSCFG *node = &scfg;
+    for (size_t pos = 0; pos < source.GetSize(); ++pos) {
+      const Word &word = source.GetWord(pos);
+      if (word.IsNonTerminal()) {
+        node = node->GetOrCreateChild(word, target.GetWord(iterAlign->second));
+        ++iterAlign;
+      } else {
+        node = node->GetOrCreateChild(word);
+      }
+    }
+    return *node;
+  }
+
+  Word MakeWord(FactorDirection direction, const string &str, bool isNonTerminal) const {
+    Word word;
+    word.CreateFromString(direction, factorOrder, str, isNonTerminal);
+    return word;
+  }
+
+  const CompactRuleTrie::Node *GetChild(const CompactRuleTrie::Node &node, const Word &sourceTerm) const {
+    const UINT32 termId = compact.GetTerminalId(sourceTerm);
+    return termId == CompactRuleTrie::NO_ID ? NULL : compact.GetChild(node, termId);
+  }
+
+  const CompactRuleTrie::Node *GetChild(const CompactRuleTrie::Node &node, const Word &sourceNonTerm, const Word &targetNonTerm) const {
+    const UINT32 sourceId = compact.GetLabelId(sourceNonTerm), targetId = compact.GetLabelId(targetNonTerm);
+    if (sourceId == CompactRuleTrie::NO_ID || targetId == CompactRuleTrie::NO_ID) {
+      return NULL;
+    }
+    return compact.GetChild(node, sourceId, targetId);
+  }
+
+  //! the target phrases of a node, empty if it has no collection
+  string TargetStrings(const TargetPhraseCollection *coll) const {
+    string ret;
+    if (coll) {
+      for (TargetPhraseCollection::const_iterator iter = coll->begin(); iter != coll->end(); ++iter) {
+        ret += (*iter)->GetStringRep(factorOrder) + "|";
+      }
+    }
+    return ret;
+  }
+
+  //! same rules, terminal edges and non-terminal edges below node and expected
+  void CheckSame(const CompactRuleTrie::Node &node, const PhraseDictionaryNodeSCFG &expected) const {
+    BOOST_CHECK_EQUAL(compact.GetTargetPhraseCollection(node) == NULL, expected.GetTargetPhraseCollection() == NULL);
+    BOOST_CHECK_EQUAL(TargetStrings(compact.GetTargetPhraseCollection(node)),
+                      TargetStrings(expected.GetTargetPhraseCollection()));
+    BOOST_CHECK_EQUAL(node.IsLeaf(), expected.IsLeaf());
+
+    for (size_t i = 0; i < vocab.size(); ++i) {
+      const CompactRuleTrie::Node *child = GetChild(node, vocab[i]);
+      const PhraseDictionaryNodeSCFG *expectedChild = expected.GetChild(vocab[i]);
+      BOOST_REQUIRE_EQUAL(child == NULL, expectedChild == NULL);
+      if (child) {
+        CheckSame(*child, *expectedChild);
+      }
+    }
+
+    BOOST_REQUIRE_EQUAL(node.GetNumNonTerminalChildren(), expected.GetNonTerminalMap().size());
+    for (size_t ind = 0; ind < node.GetNumNonTerminalChildren(); ++ind) {
+      const Word *sourceLabel, *targetLabel;
+      const CompactRuleTrie::Node &child = compact.GetNonTerminalChild(node, ind, sourceLabel, targetLabel);
+      BOOST_CHECK_EQUAL(GetChild(node, *sourceLabel, *targetLabel), &child);
+      const PhraseDictionaryNodeSCFG *expectedChild = expected.GetChild(*sourceLabel, *targetLabel);
+      BOOST_REQUIRE(expectedChild != NULL);
+      CheckSame(child, *expectedChild);
+    }
+  }
+
+  vector<FactorType> factorOrder;
+  vector<Word> vocab; //! source terminals, one of them in no rule
+  CompactRuleTrie compact;
+  SCFGRoot scfg;
+};
+
+}
+
+BOOST_FIXTURE_TEST_CASE(same_as_node_trie, RuleFixture)
+{
+  Load(0);
+  CheckSame(compact.GetRootNode(), scfg);
+}
+
+BOOST_FIXTURE_TEST_CASE(same_as_node_trie_pruned, RuleFixture)
+{
+  Load(1);
+  CheckSame(compact.GetRootNode(), scfg);
+}
+
+BOOST_FIXTURE_TEST_CASE(get_child, RuleFixture)
+{
+  Load(0);
+  const Word a = MakeWord(Input, "a", false), b = MakeWord(Input, "b", false), c = MakeWord(Input, "c", false);
+  const Word sourceX = MakeWord(Input, "X", true), targetX = MakeWord(Output, "X", true);
+  const Word targetNP = MakeWord(Output, "NP", true), targetZ = MakeWord(Output, "Z", true);
+  const CompactRuleTrie::Node &root = compact.GetRootNode();
+
+  BOOST_CHECK(compact.GetTargetPhraseCollection(root) == NULL);
+  BOOST_CHECK(compact.GetTerminalId(MakeWord(Input, "d", false)) == CompactRuleTrie::NO_ID);
+  BOOST_CHECK(compact.GetLabelId(targetZ) == CompactRuleTrie::NO_ID);
+
+  // a rule and longer rules with both kinds of edges below it
+  const CompactRuleTrie::Node *nodeA = GetChild(root, a);
+  BOOST_REQUIRE(nodeA != NULL);
+  BOOST_REQUIRE(compact.GetTargetPhraseCollection(*nodeA) != NULL);
+  BOOST_CHECK_EQUAL(compact.GetTargetPhraseCollection(*nodeA)->GetSize(), 2);
+  BOOST_CHECK(GetChild(*nodeA, b) != NULL);
+  BOOST_CHECK(GetChild(*nodeA, c) != NULL);
+  BOOST_CHECK(GetChild(*nodeA, a) == NULL);
+  BOOST_CHECK_EQUAL(nodeA->GetNumNonTerminalChildren(), 3);
+
+  // the same source label with two target labels
+  const CompactRuleTrie::Node *nodeAXX = GetChild(*nodeA, sourceX, targetX);
+  const CompactRuleTrie::Node *nodeAXNP = GetChild(*nodeA, sourceX, targetNP);
+  BOOST_REQUIRE(nodeAXX != NULL);
+  BOOST_REQUIRE(nodeAXNP != NULL);
+  BOOST_CHECK(nodeAXX != nodeAXNP);
+  BOOST_CHECK(nodeAXX->IsLeaf());
+  BOOST_CHECK(compact.GetTargetPhraseCollection(*nodeAXNP) == NULL);
+  const CompactRuleTrie::Node *nodeAXNPC = GetChild(*nodeAXNP, c);
+  BOOST_REQUIRE(nodeAXNPC != NULL);
+  BOOST_CHECK_EQUAL(compact.GetTargetPhraseCollection(*nodeAXNPC)->GetSize(), 1);
+
+  // paths that no rule takes
+  BOOST_CHECK(GetChild(root, c) == NULL);
+  BOOST_CHECK(GetChild(*GetChild(root, b), b) == NULL);
+  BOOST_CHECK(GetChild(root, sourceX, targetNP) == NULL);
+  BOOST_CHECK(GetChild(*nodeA, sourceX, targetZ) == NULL);
+  BOOST_CHECK(GetChild(*GetChild(root, sourceX, targetX), sourceX, targetX) != NULL);
+
+  vector<const Word*> rootWords;
+  compact.GetRootWords(rootWords);
+  BOOST_CHECK_EQUAL(rootWords.size(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -3,6 +3,7 @@
 
 #include "util/check.hh"
 #include <vector>
+#include "SentenceArena.h"
 
 
 namespace Moses
@@ -15,6 +16,22 @@ class FFState
 public:
   virtual ~FFState();
   virtual int Compare(const FFState& other) const = 0;
+
+  //! states created during search live in the sentence's arena
+  static void *operator new(size_t size) {
+    return SentenceArena::AllocateCurrent(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    SentenceArena::Free(ptr, size);
+  }
+
+  /** hash of the state, used to find recombination candidates before
+   *  calling Compare(). States which compare equal must have equal hashes.
+   *  The default is correct but makes every state collide.
+   */
+  virtual size_t Hash() const {
+    return 0;
+  }
 };
 
 class DummyState : public FFState {
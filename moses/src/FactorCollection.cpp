@@ -34,8 +34,42 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+#ifdef WITH_THREADS
+const std::size_t FactorCollection::ThreadCache::SIZE;
+
+FactorCollection::ThreadCache::ThreadCache()
+{
+  for (std::size_t i = 0; i < SIZE; ++i) {
+    entries[i].hash = 0;
+    entries[i].factor = NULL;
+  }
+}
+#endif
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString)
 {
+#ifdef WITH_THREADS
+  ThreadCache *cache = m_threadCache.get();
+  if (cache == NULL) {
+    cache = new ThreadCache();
+    m_threadCache.reset(cache);
+  }
+  const std::size_t hash = HashFactor()(factorString);
+  ThreadCache::Entry &entry = cache->entries[hash & (ThreadCache::SIZE - 1)];
+  if (entry.factor != NULL && entry.hash == hash && entry.factor->GetString() == factorString) {
+    return entry.factor;
+  }
+  const Factor *factor = FindOrInsert(factorString);
+  entry.hash = hash;
+  entry.factor = factor;
+  return factor;
+#else
+  return FindOrInsert(factorString);
+#endif
+}
+
+const Factor *FactorCollection::FindOrInsert(const StringPiece &factorString)
+{
 // Sorry this is so complicated.  Can't we just require everybody to use Boost >= 1.42?  The issue is that I can't check BOOST_VERSION unless we have Boost.  
 #ifdef WITH_THREADS
 
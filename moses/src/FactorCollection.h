@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
 #include "util/murmur_hash.hh"
@@ -87,6 +88,22 @@ class FactorCollection
 #ifdef WITH_THREADS
   //reader-writer lock
   mutable boost::shared_mutex m_accessLock;
+
+  /** Direct-mapped cache of the factors a thread has looked up, so that
+   *  lookups of known factors don't touch the lock, which is shared by all
+   *  threads. Factors are never removed from m_set, so entries never go stale.
+   */
+  struct ThreadCache {
+    static const std::size_t SIZE = 1 << 14;
+    struct Entry {
+      std::size_t hash;
+      const Factor *factor; //! NULL if empty
+    };
+    Entry entries[SIZE];
+
+    ThreadCache();
+  };
+  boost::thread_specific_ptr<ThreadCache> m_threadCache;
 #endif
 
   size_t m_factorId; /**< unique, contiguous ids, starting from 0, for each factor */
@@ -96,6 +113,9 @@ class FactorCollection
     :m_factorId(0)
   {}
 
+  //! find or insert factorString in m_set, taking the lock if threaded
+  const Factor *FindOrInsert(const StringPiece &factorString);
+
 public:
   static FactorCollection& Instance() {
     return s_instance;
@@ -58,6 +58,7 @@ namespace Moses {
 #endif
       //Need to check again if the id is in the map, as someone may have added
       //it while we were waiting on the writer lock.
+      i = name2id.find(name);
       if (i != name2id.end()) {
         m_id = i->second;
       } else {
@@ -146,15 +147,59 @@ namespace Moses {
     return ! (*this == rhs);
   }
   
+  const size_t FCoreVector::INLINE_SIZE;
+
+  FCoreVector::FCoreVector(size_t size)
+    : m_data(Allocate(size)), m_size(size) {
+    fill(m_data, m_data + m_size, FValue(0));
+  }
+
+  FCoreVector::FCoreVector(const FCoreVector& rhs)
+    : m_data(Allocate(rhs.m_size)), m_size(rhs.m_size) {
+    copy(rhs.m_data, rhs.m_data + m_size, m_data);
+  }
+
+  FCoreVector::~FCoreVector() {
+    if (m_data != m_inline) delete [] m_data;
+  }
+
+  FCoreVector& FCoreVector::operator=(const FCoreVector& rhs) {
+    if (this == &rhs) return *this;
+    if (rhs.m_size != m_size) {
+      // reuse a heap buffer only if it has exactly the right size
+      if (m_data != m_inline) delete [] m_data;
+      m_data = Allocate(rhs.m_size);
+      m_size = rhs.m_size;
+    }
+    copy(rhs.m_data, rhs.m_data + m_size, m_data);
+    return *this;
+  }
+
+  void FCoreVector::resize(size_t newsize) {
+    if (newsize == m_size) return;
+    FValue* newData = (newsize <= INLINE_SIZE && m_data != m_inline) ? m_inline : Allocate(newsize);
+    if (newData != m_data) {
+      copy(m_data, m_data + min(m_size, newsize), newData);
+      if (m_data != m_inline) delete [] m_data;
+      m_data = newData;
+    }
+    if (newsize > m_size) fill(m_data + m_size, m_data + newsize, FValue(0));
+    m_size = newsize;
+  }
+
+  FValue FCoreVector::sum() const {
+    FValue sum = 0;
+    for (size_t i = 0; i < m_size; ++i) {
+      sum += m_data[i];
+    }
+    return sum;
+  }
+
   FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
 
   void FVector::resize(size_t newsize) {
-      valarray<FValue> oldValues(m_coreFeatures);
-      m_coreFeatures.resize(newsize);
-      for (size_t i = 0; i < min(m_coreFeatures.size(), oldValues.size()); ++i) {
-        m_coreFeatures[i] = oldValues[i];
-      }
-    }
+    m_coreFeatures.resize(newsize);
+  }
 	
   void FVector::clear() {
     m_coreFeatures.resize(0);
@@ -333,9 +378,11 @@ namespace Moses {
     if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
       resize(rhs.m_coreFeatures.size());
     for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-        set(i->first, get(i->first) + i->second);
+        m_features[i->first] += i->second;
+    FValue* lhsCore = m_coreFeatures.data();
+    const FValue* rhsCore = rhs.m_coreFeatures.data();
     for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-      m_coreFeatures[i] += rhs.m_coreFeatures[i];
+      lhsCore[i] += rhsCore[i];
     return *this;
   }
   
@@ -544,7 +591,9 @@ namespace Moses {
     for (iterator i = begin(); i != end(); ++i) {
       i->second *= rhs;
     }
-    m_coreFeatures *= rhs;
+    for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+      m_coreFeatures[i] *= rhs;
+    }
     return *this;
   }
   
@@ -552,7 +601,9 @@ namespace Moses {
     for (iterator i = begin(); i != end(); ++i) {
       i->second /= rhs;
     }
-    m_coreFeatures /= rhs;
+    for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+      m_coreFeatures[i] /= rhs;
+    }
     return *this;
   }
 
@@ -730,11 +781,15 @@ namespace Moses {
   FValue FVector::inner_product(const FVector& rhs) const {
     CHECK(m_coreFeatures.size() == rhs.m_coreFeatures.size());
     FValue product = 0.0;
-    for (const_iterator i = cbegin(); i != cend(); ++i) {
+    if (!m_features.empty() && !rhs.m_features.empty()) {
+      for (const_iterator i = cbegin(); i != cend(); ++i) {
         product += ((i->second)*(rhs.get(i->first)));
+      }
     }
+    const FValue* lhsCore = m_coreFeatures.data();
+    const FValue* rhsCore = rhs.m_coreFeatures.data();
     for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-      product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
+      product += lhsCore[i]*rhsCore[i];
     }
     return product;
   }
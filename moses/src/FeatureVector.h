@@ -22,11 +22,11 @@
 #ifndef FEATUREVECTOR_H
 #define FEATUREVECTOR_H
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <string>
-#include <valarray>
 #include <vector>
 
 #include <boost/functional/hash.hpp>
@@ -37,7 +37,6 @@
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
-#include <boost/serialization/valarray.hpp>
 #endif
 
 #ifdef WITH_THREADS
@@ -114,6 +113,54 @@ namespace Moses {
 		}
 	};
 	
+	/**
+	 * Dense storage for the core features of an FVector. Up to INLINE_SIZE
+	 * values are kept inside the object itself, so that the score breakdowns
+	 * which are created and copied for every hypothesis don't touch the heap
+	 * for typical models. The values are contiguous, for tight loops.
+	 **/
+	class FCoreVector
+	{
+  public:
+    static const size_t INLINE_SIZE = 32;
+
+    //! size values, all 0
+    explicit FCoreVector(size_t size = 0);
+    FCoreVector(const FCoreVector& rhs);
+    ~FCoreVector();
+    FCoreVector& operator=(const FCoreVector& rhs);
+
+    size_t size() const {
+      return m_size;
+    }
+    //! keeps the first min(size(), newsize) values, new ones are 0
+    void resize(size_t newsize);
+
+    FValue& operator[](size_t index) {
+      return m_data[index];
+    }
+    FValue operator[](size_t index) const {
+      return m_data[index];
+    }
+    FValue* data() {
+      return m_data;
+    }
+    const FValue* data() const {
+      return m_data;
+    }
+
+    FValue sum() const;
+
+  private:
+    FValue* m_data; //! either m_inline or on the heap
+    size_t m_size;
+    FValue m_inline[INLINE_SIZE];
+
+    FValue* Allocate(size_t size) {
+      return size <= INLINE_SIZE ? m_inline : new FValue[size];
+    }
+	};
+
 	class ProxyFVector;
 	
 	/**
@@ -250,7 +297,7 @@ namespace Moses {
     void set(const FName& name, const FValue& value);
 	       
     FNVmap m_features;
-    std::valarray<FValue> m_coreFeatures;
+    FCoreVector m_coreFeatures;
 		
 #ifdef MPI_ENABLE
     //serialization
@@ -266,7 +313,8 @@ namespace Moses {
 			}
 			ar << names;
 			ar << values;
-      ar << m_coreFeatures;
+      std::vector<FValue> coreValues(m_coreFeatures.data(), m_coreFeatures.data() + m_coreFeatures.size());
+      ar << coreValues;
     }
 		
     template<class Archive>
@@ -276,7 +324,10 @@ namespace Moses {
 			std::vector<FValue> values;
 			ar >> names;
 			ar >> values;
-      ar >> m_coreFeatures;
+      std::vector<FValue> coreValues;
+      ar >> coreValues;
+      m_coreFeatures.resize(coreValues.size());
+      std::copy(coreValues.begin(), coreValues.end(), m_coreFeatures.data());
 			CHECK(names.size() == values.size());
 			for (size_t i = 0; i < names.size(); ++i) {
 				set(FName(names[i]), values[i]);
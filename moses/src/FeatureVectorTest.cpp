@@ -269,5 +269,29 @@ BOOST_AUTO_TEST_CASE(ip)
 }
 
 
+BOOST_AUTO_TEST_CASE(core_resize)
+{
+  // grow from the inline storage onto the heap and back, keeping the values
+  FVector f1(3);
+  f1[0] = 1; f1[1] = 2; f1[2] = 3;
+  f1.resize(FCoreVector::INLINE_SIZE + 10);
+  BOOST_CHECK_EQUAL(f1.coreSize(), FCoreVector::INLINE_SIZE + 10);
+  BOOST_CHECK_EQUAL(f1[2], 3);
+  BOOST_CHECK_EQUAL(f1[FCoreVector::INLINE_SIZE + 9], 0);
+  f1[FCoreVector::INLINE_SIZE + 9] = 4;
+
+  FVector f2 = f1;
+  BOOST_CHECK_EQUAL(f2[FCoreVector::INLINE_SIZE + 9], 4);
+  f2.resize(2);
+  BOOST_CHECK_EQUAL(f2.coreSize(), 2);
+  BOOST_CHECK_EQUAL(f2[1], 2);
+  f2.resize(4);
+  BOOST_CHECK_EQUAL(f2[2], 0);
+
+  f1 = f2;
+  BOOST_CHECK_EQUAL(f1.coreSize(), 4);
+  BOOST_CHECK_EQUAL(f1[0], 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
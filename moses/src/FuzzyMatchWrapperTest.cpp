@@ -0,0 +1,167 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "fuzzy-match/FuzzyMatchWrapper.h"
+#include "fuzzy-match/SentenceAlignment.h"
+
+using namespace std;
+using namespace tmmt;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(fuzzy_match_wrapper)
+
+namespace
+{
+
+string TempFile(const string &text)
+{
+  char name[] = "FuzzyMatchXXXXXX";
+  int fd = mkstemp(name);
+  BOOST_CHECK(fd != -1);
+  BOOST_CHECK(!close(fd));
+  ofstream out(name);
+  out << text;
+  return name;
+}
+
+//! a translation memory of one sentence pair
+class OneSentenceWrapper : public FuzzyMatchWrapper
+{
+public:
+  OneSentenceWrapper(const string &source, const string &target, const string &alignment)
+    : FuzzyMatchWrapper(source, target, alignment) {}
+
+  bool CreateRule(const string &path, size_t inputLength, ExtractedRule &rule) const {
+    return create_rule(source[0], targetAndAlignment[0][0], path, inputLength, rule);
+  }
+
+  //! the target words of a rule, with X for the non-terminals
+  string TargetString(const ExtractedRule &rule) const {
+    string ret;
+    for (size_t i = 0; i < rule.target.size(); ++i) {
+      if (i) ret += " ";
+      ret += (rule.target[i] == ExtractedRule::NON_TERMINAL) ? "X" : GetWord(rule.target[i]);
+    }
+    return ret;
+  }
+};
+
+struct WrapperFixture {
+  WrapperFixture(const string &source, const string &target, const string &alignment)
+    : sourceFile(TempFile(source)), targetFile(TempFile(target)), alignmentFile(TempFile(alignment)) {}
+
+  ~WrapperFixture() {
+    BOOST_CHECK(!remove(sourceFile.c_str()));
+    BOOST_CHECK(!remove(targetFile.c_str()));
+    BOOST_CHECK(!remove(alignmentFile.c_str()));
+  }
+
+  string sourceFile, targetFile, alignmentFile;
+};
+
+//! the input positions of a rule, with X for the non-terminals
+string SourceString(const ExtractedRule &rule)
+{
+  string ret;
+  for (size_t i = 0; i < rule.source.size(); ++i) {
+    if (i) ret += " ";
+    ret += (rule.source[i] == ExtractedRule::NON_TERMINAL) ? string("X") : string(1, '0' + rule.source[i]);
+  }
+  return ret;
+}
+
+string AlignmentString(const ExtractedRule &rule)
+{
+  string ret;
+  for (size_t i = 0; i < rule.alignment.size(); ++i) {
+    if (i) ret += " ";
+    ret += string(1, '0' + rule.alignment[i].first) + "-" + string(1, '0' + rule.alignment[i].second);
+  }
+  return ret;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(substitution_becomes_non_terminal)
+{
+  // the input is "the small house is red"
+  WrapperFixture files("the big house is red\n", "3 das grosse haus ist rot\n", "0-0 1-1 2-2 3-3 4-4\n");
+  OneSentenceWrapper wrapper(files.sourceFile, files.targetFile, files.alignmentFile);
+
+  ExtractedRule rule;
+  BOOST_REQUIRE(wrapper.CreateRule("MSMMM", 5, rule));
+  BOOST_CHECK_EQUAL(SourceString(rule), "0 X 2 3 4");
+  BOOST_CHECK_EQUAL(wrapper.TargetString(rule), "das X haus ist rot");
+  // the words, then the non-terminals
+  BOOST_CHECK_EQUAL(AlignmentString(rule), "0-0 2-2 3-3 4-4 1-1");
+  BOOST_CHECK_EQUAL(rule.count, 3);
+}
+
+BOOST_AUTO_TEST_CASE(deletion_and_insertion_at_the_end)
+{
+  // the input is "a c d e": b is not in it, and e is not in the corpus. The
+  // target word aligned to b is dropped, e goes after the last target word,
+  // and the crossing alignment of c is remapped to the rule positions
+  WrapperFixture files("a b c d\n", "1 w x y z\n", "0-0 1-2 2-1 3-3\n");
+  OneSentenceWrapper wrapper(files.sourceFile, files.targetFile, files.alignmentFile);
+
+  ExtractedRule rule;
+  BOOST_REQUIRE(wrapper.CreateRule("MDMMI", 4, rule));
+  BOOST_CHECK_EQUAL(SourceString(rule), "0 1 2 X");
+  BOOST_CHECK_EQUAL(wrapper.TargetString(rule), "w x z X");
+  BOOST_CHECK_EQUAL(AlignmentString(rule), "0-0 1-1 2-2 3-3");
+}
+
+BOOST_AUTO_TEST_CASE(unaligned_mismatch_follows_previous_word)
+{
+  // the input is "p s q", with s in place of the unaligned r: the gap goes
+  // after the target word of the last aligned corpus word before it
+  WrapperFixture files("p r q\n", "1 P Q\n", "0-0 2-1\n");
+  OneSentenceWrapper wrapper(files.sourceFile, files.targetFile, files.alignmentFile);
+
+  ExtractedRule rule;
+  BOOST_REQUIRE(wrapper.CreateRule("MSM", 3, rule));
+  BOOST_CHECK_EQUAL(SourceString(rule), "0 X 2");
+  BOOST_CHECK_EQUAL(wrapper.TargetString(rule), "P X Q");
+  BOOST_CHECK_EQUAL(AlignmentString(rule), "0-0 2-2 1-1");
+}
+
+BOOST_AUTO_TEST_CASE(empty_path_no_rule)
+{
+  // what the extraction through files used when nothing matched
+  WrapperFixture files("a b\n", "1 A B\n", "0-0 1-1\n");
+  OneSentenceWrapper wrapper(files.sourceFile, files.targetFile, files.alignmentFile);
+
+  ExtractedRule rule;
+  BOOST_CHECK(!wrapper.CreateRule("", 2, rule));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <vector>
 #include <algorithm>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "TranslationOption.h"
@@ -43,10 +44,6 @@ using namespace std;
 namespace Moses
 {
 
-#ifdef USE_HYPO_POOL
-ObjectPool<Hypothesis> Hypothesis::s_objectPool("Hypothesis", 300000);
-#endif
-
 Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget)
   : m_prevHypo(NULL)
   , m_targetPhrase(emptyTarget)
@@ -58,7 +55,9 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
     m_sourceCompleted.GetFirstGapPos()>0 ? m_sourceCompleted.GetFirstGapPos()-1 : NOT_FOUND)
   , m_currTargetWordsRange(0, emptyTarget.GetSize()-1)
   , m_wordDeleted(false)
-  , m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size())
+  , m_scoreBreakdown(NULL)
+  , m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size(), NULL
+               , SentenceArenaAllocator<const FFState*>(&manager.GetArena()))
   , m_arcList(NULL)
   , m_transOpt(NULL)
   , m_manager(manager)
@@ -91,7 +90,8 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   , m_wordDeleted(false)
   ,	m_totalScore(0.0f)
   ,	m_futureScore(0.0f)
-  , m_ffStates(prevHypo.m_ffStates.size())
+  , m_scoreBreakdown(NULL)
+  , m_ffStates(prevHypo.m_ffStates.size(), NULL, prevHypo.m_ffStates.get_allocator())
   , m_arcList(NULL)
   , m_transOpt(&transOpt)
   , m_manager(prevHypo.GetManager())
@@ -112,6 +112,8 @@ Hypothesis::~Hypothesis()
   for (unsigned i = 0; i < m_ffStates.size(); ++i)
     delete m_ffStates[i];
 
+  SentenceArena::Destroy(m_scoreBreakdown);
+
   if (m_arcList) {
     ArcList::iterator iter;
     for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
@@ -119,11 +121,16 @@ Hypothesis::~Hypothesis()
     }
     m_arcList->clear();
 
-    delete m_arcList;
+    SentenceArena::Destroy(m_arcList);
     m_arcList = NULL;
   }
 }
 
+SentenceArena &Hypothesis::GetArena() const
+{
+  return m_manager.GetArena();
+}
+
 void Hypothesis::AddArc(Hypothesis *loserHypo)
 {
   if (!m_arcList) {
@@ -131,7 +138,8 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       this->m_arcList = loserHypo->m_arcList;  // take ownership, we'll delete
       loserHypo->m_arcList = 0;                // prevent a double deletion
     } else {
-      this->m_arcList = new ArcList();
+      SentenceArena &arena = GetArena();
+      this->m_arcList = new (arena.Allocate(sizeof(ArcList))) ArcList(SentenceArenaAllocator<Hypothesis*>(&arena));
     }
   } else {
     if (loserHypo->m_arcList) {  // both have an arc list: merge. delete loser
@@ -139,7 +147,7 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       size_t add_size = loserHypo->m_arcList->size();
       this->m_arcList->resize(my_size + add_size, 0);
       std::memcpy(&(*m_arcList)[0] + my_size, &(*loserHypo->m_arcList)[0], add_size * sizeof(Hypothesis *));
-      delete loserHypo->m_arcList;
+      SentenceArena::Destroy(loserHypo->m_arcList);
       loserHypo->m_arcList = 0;
     } else { // loserHypo doesn't have any arcs
       // DO NOTHING
@@ -195,12 +203,8 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
   if (createHypothesis) {
 
-#ifdef USE_HYPO_POOL
-    Hypothesis *ptr = s_objectPool.getPtr();
+    void *ptr = prevHypo.GetArena().Allocate(sizeof(Hypothesis));
     return new(ptr) Hypothesis(prevHypo, transOpt);
-#else
-    return new Hypothesis(prevHypo, transOpt);
-#endif
 
   } else {
     // If the previous hypothesis plus the proposed translation option
@@ -216,12 +220,8 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
 Hypothesis* Hypothesis::Create(Manager& manager, InputType const& m_source, const TargetPhrase &emptyTarget)
 {
-#ifdef USE_HYPO_POOL
-  Hypothesis *ptr = s_objectPool.getPtr();
+  void *ptr = manager.GetArena().Allocate(sizeof(Hypothesis));
   return new(ptr) Hypothesis(manager, m_source, emptyTarget);
-#else
-  return new Hypothesis(manager, m_source, emptyTarget);
-#endif
 }
 
 /** check, if two hypothesis can be recombined.
@@ -250,10 +250,20 @@ int Hypothesis::RecombineCompare(const Hypothesis &compare) const
   return 0;
 }
 
+size_t Hypothesis::GetRecombinationHash() const
+{
+  size_t seed = m_sourceCompleted.hash();
+  for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+    boost::hash_combine(seed, m_ffStates[i] == NULL ? 0 : m_ffStates[i]->Hash());
+  }
+  return seed;
+}
+
 void Hypothesis::ResetScore()
 {
   m_currScoreBreakdown.ZeroAll();
-  m_scoreBreakdown.reset(0);
+  SentenceArena::Destroy(m_scoreBreakdown);
+  m_scoreBreakdown = NULL;
   m_futureScore = m_totalScore = 0.0f;
 }
 
@@ -274,6 +284,22 @@ void Hypothesis::EvaluateWith(const StatelessFeatureFunction* slff) {
   slff->Evaluate(PhraseBasedFeatureContext(this), &m_currScoreBreakdown);
 }
 
+void Hypothesis::EvaluateWith(const LanguageModel* lm, int state_idx,
+                              const std::vector<Hypothesis*> &hypos) {
+  std::vector<const Hypothesis*> batch(hypos.begin(), hypos.end());
+  std::vector<const FFState*> prevStates(hypos.size());
+  std::vector<ScoreComponentCollection*> accumulators(hypos.size());
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    prevStates[i] = hypos[i]->m_prevHypo ? hypos[i]->m_prevHypo->m_ffStates[state_idx] : NULL;
+    accumulators[i] = &hypos[i]->m_currScoreBreakdown;
+  }
+  std::vector<FFState*> states;
+  lm->EvaluateBatch(batch, prevStates, states, accumulators);
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    hypos[i]->m_ffStates[state_idx] = states[i];
+  }
+}
+
 void Hypothesis::CalculateFutureScore(const SquareMatrix& futureScore) {
   m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
 }
@@ -299,7 +325,6 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   m_manager.getSntTranslationOptions()->InsertPreCalculatedScores
     (*m_transOpt, &m_currScoreBreakdown);
 
-  const StaticData &staticData = StaticData::Instance();
   clock_t t=0; // used to track time
 
   // compute values of stateless feature functions that were not
@@ -328,16 +353,8 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   // FUTURE COST
   m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
 
-  // Apply sparse producer weights
-  ScoreComponentCollection tempScoreBreakdown = m_currScoreBreakdown;
-  const vector<const FeatureFunction*>& sparseProducers = m_manager.GetTranslationSystem()->GetSparseProducers();
-  for (unsigned i = 0; i < sparseProducers.size(); ++i) {
-    float weight = sparseProducers[i]->GetSparseProducerWeight();
-    tempScoreBreakdown.MultiplyEquals(sparseProducers[i], weight);
-  }
-
-  // TOTAL
-  m_totalScore = tempScoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
+  // TOTAL. The search weights include the sparse producer weights
+  m_totalScore = m_currScoreBreakdown.InnerProduct(m_manager.GetSearchWeights()) + m_futureScore;
   if (m_prevHypo) {
     m_totalScore += m_prevHypo->m_totalScore - m_prevHypo->m_futureScore;
   }
@@ -462,7 +479,7 @@ void Hypothesis::CleanupArcList()
    */
   const StaticData &staticData = StaticData::Instance();
   size_t nBestSize = staticData.GetNBestSize();
-  bool distinctNBest = staticData.GetDistinctNBest() || staticData.UseMBR() || staticData.GetOutputSearchGraph() || staticData.UseLatticeMBR() ;
+  bool distinctNBest = staticData.GetDistinctNBest() || staticData.UseMBR() || m_manager.GetOutputSearchGraph() || staticData.UseLatticeMBR() ;
 
   if (!distinctNBest && m_arcList->size() > nBestSize * 5) {
     // prune arc list only if there too many arcs
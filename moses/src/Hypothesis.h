@@ -35,7 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GenerationDictionary.h"
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
-#include "ObjectPool.h"
+#include "SentenceArena.h"
 
 namespace Moses
 {
@@ -48,8 +48,9 @@ class Hypothesis;
 class FFState;
 class Manager;
 class LexicalReordering;
+class LanguageModel;
 
-typedef std::vector<Hypothesis*> ArcList;
+typedef std::vector<Hypothesis*, SentenceArenaAllocator<Hypothesis*> > ArcList;
 
 /** Used to store a state in the beam search
     for the best translation. With its link back to the previous hypothesis
@@ -64,8 +65,6 @@ class Hypothesis
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 
 protected:
-  static ObjectPool<Hypothesis> s_objectPool;
-
   const Hypothesis* m_prevHypo; /*! backpointer to previous hypothesis (from which this one was created) */
 //	const Phrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
   const TargetPhrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
@@ -79,9 +78,9 @@ protected:
   bool							m_wordDeleted;
   float							m_totalScore;  /*! score so far */
   float							m_futureScore; /*! estimated future cost to translate rest of sentence */
-  mutable std::auto_ptr<ScoreComponentCollection> m_scoreBreakdown; /*! detailed score break-down by components (for instance language model, word penalty, etc) */
+  mutable ScoreComponentCollection *m_scoreBreakdown; /*! detailed score break-down by components (for instance language model, word penalty, etc). Lazily created in the arena */
   ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis */
-  std::vector<const FFState*> m_ffStates;
+  std::vector<const FFState*, SentenceArenaAllocator<const FFState*> > m_ffStates;
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption *m_transOpt;
@@ -94,11 +93,10 @@ protected:
   /*! used when creating a new hypothesis using a translation option (phrase translation) */
   Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt);
 
-public:
-  static ObjectPool<Hypothesis> &GetObjectPool() {
-    return s_objectPool;
-  }
+  //! the manager's arena, which holds this hypothesis and what it owns
+  SentenceArena &GetArena() const;
 
+public:
   ~Hypothesis();
 
   /** return the subclass of Hypothesis most appropriate to the given translation option */
@@ -205,6 +203,8 @@ public:
   }
 
   int RecombineCompare(const Hypothesis &compare) const;
+  //! hypotheses which RecombineCompare() equal have the same hash
+  size_t GetRecombinationHash() const;
 
   void ToStream(std::ostream& out) const {
     if (m_prevHypo != NULL) {
@@ -243,8 +243,9 @@ public:
     return m_arcList;
   }
   const ScoreComponentCollection& GetScoreBreakdown() const {
-    if (!m_scoreBreakdown.get()) {
-      m_scoreBreakdown.reset(new ScoreComponentCollection(m_currScoreBreakdown));
+    if (!m_scoreBreakdown) {
+      void *mem = GetArena().Allocate(sizeof(ScoreComponentCollection));
+      m_scoreBreakdown = new (mem) ScoreComponentCollection(m_currScoreBreakdown);
       if (m_prevHypo) {
         m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
       }
@@ -268,6 +269,8 @@ public:
   void IncorporateTransOptScores();
   void EvaluateWith(StatefulFeatureFunction* sfff, int state_idx);
   void EvaluateWith(const StatelessFeatureFunction* slff);
+  //! EvaluateWith() for each of hypos, so that the LM can share lookups between them
+  static void EvaluateWith(const LanguageModel* lm, int state_idx, const std::vector<Hypothesis*> &hypos);
   void CalculateFutureScore(const SquareMatrix& futureScore);
   void CalculateFinalScore();
 
@@ -292,17 +295,8 @@ struct CompareHypothesisTotalScore {
   }
 };
 
-#ifdef USE_HYPO_POOL
-
-#define FREEHYPO(hypo) \
-{ \
-	ObjectPool<Hypothesis> &pool = Hypothesis::GetObjectPool(); \
-	pool.freeObject(hypo); \
-} \
- 
-#else
-#define FREEHYPO(hypo) delete hypo
-#endif
+//! hypotheses are created in their manager's SentenceArena
+#define FREEHYPO(hypo) SentenceArena::Destroy(hypo)
 
 /** defines less-than relation on hypotheses.
 * The particular order is not important for us, we need just to figure out
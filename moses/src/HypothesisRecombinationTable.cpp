@@ -0,0 +1,147 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "util/check.hh"
+#include "HypothesisRecombinationTable.h"
+#include "Hypothesis.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+const size_t HypothesisRecombinationTable::EMPTY;
+const size_t HypothesisRecombinationTable::DELETED;
+
+size_t HypothesisRecombinationTable::Probe(const Hypothesis *hypo, size_t hash, size_t &firstDeleted) const
+{
+  const size_t mask = m_buckets.size() - 1;
+  firstDeleted = EMPTY;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Bucket &bucket = m_buckets[i];
+    if (bucket.m_index == EMPTY) {
+      return i;
+    } else if (bucket.m_index == DELETED) {
+      if (firstDeleted == EMPTY) firstDeleted = i;
+    } else if (bucket.m_hash == hash
+               && m_coll[bucket.m_index]->RecombineCompare(*hypo) == 0) {
+      return i;
+    }
+  }
+}
+
+pair<HypothesisRecombinationTable::iterator, bool> HypothesisRecombinationTable::insert(Hypothesis *hypo)
+{
+  // keep the load factor, including deleted buckets, below 1/2
+  if (2 * (m_occupied + 1) > m_buckets.size()) {
+    size_t numBuckets = 16;
+    while (numBuckets < 4 * (m_size + 1)) numBuckets *= 2;
+    Rehash(numBuckets);
+  }
+
+  const size_t hash = hypo->GetRecombinationHash();
+  size_t firstDeleted;
+  size_t ind = Probe(hypo, hash, firstDeleted);
+  Bucket *bucket = &m_buckets[ind];
+  if (bucket->m_index != EMPTY) {
+    // equivalent hypothesis exists
+    return make_pair(iterator(&m_coll, bucket->m_index), false);
+  }
+
+  if (firstDeleted != EMPTY) {
+    bucket = &m_buckets[firstDeleted];
+  } else {
+    ++m_occupied;
+  }
+  bucket->m_hash = hash;
+  bucket->m_index = m_coll.size();
+  m_coll.push_back(hypo);
+  m_hashes.push_back(hash);
+  ++m_size;
+  return make_pair(iterator(&m_coll, bucket->m_index), true);
+}
+
+HypothesisRecombinationTable::iterator HypothesisRecombinationTable::find(const Hypothesis *hypo)
+{
+  if (m_buckets.empty()) return end();
+  size_t firstDeleted;
+  const Bucket &bucket = m_buckets[Probe(hypo, hypo->GetRecombinationHash(), firstDeleted)];
+  if (bucket.m_index == EMPTY) return end();
+  return iterator(&m_coll, bucket.m_index);
+}
+
+void HypothesisRecombinationTable::erase(const iterator &iter)
+{
+  const size_t index = iter.m_index;
+  CHECK(index < m_coll.size() && m_coll[index] != NULL);
+
+  const size_t mask = m_buckets.size() - 1;
+  size_t i = m_hashes[index] & mask;
+  while (m_buckets[i].m_index != index) {
+    CHECK(m_buckets[i].m_index != EMPTY);
+    i = (i + 1) & mask;
+  }
+  m_buckets[i].m_index = DELETED;
+  m_coll[index] = NULL;
+  --m_size;
+}
+
+void HypothesisRecombinationTable::clear()
+{
+  m_coll.clear();
+  m_hashes.clear();
+  m_buckets.clear();
+  m_size = m_occupied = 0;
+}
+
+void HypothesisRecombinationTable::Compact()
+{
+  if (m_size == m_coll.size()) return;
+
+  size_t out = 0;
+  for (size_t in = 0; in < m_coll.size(); ++in) {
+    if (m_coll[in] != NULL) {
+      m_coll[out] = m_coll[in];
+      m_hashes[out] = m_hashes[in];
+      ++out;
+    }
+  }
+  m_coll.resize(out);
+  m_hashes.resize(out);
+  Rehash(m_buckets.size());
+}
+
+void HypothesisRecombinationTable::Rehash(size_t numBuckets)
+{
+  m_buckets.assign(numBuckets, Bucket());
+  const size_t mask = numBuckets - 1;
+  m_occupied = 0;
+  for (size_t index = 0; index < m_coll.size(); ++index) {
+    if (m_coll[index] == NULL) continue;
+    size_t i = m_hashes[index] & mask;
+    while (m_buckets[i].m_index != EMPTY) i = (i + 1) & mask;
+    m_buckets[i].m_hash = m_hashes[index];
+    m_buckets[i].m_index = index;
+    ++m_occupied;
+  }
+}
+
+}
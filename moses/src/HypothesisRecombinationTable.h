@@ -0,0 +1,150 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_HypothesisRecombinationTable_h
+#define moses_HypothesisRecombinationTable_h
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace Moses
+{
+
+class Hypothesis;
+
+/** Unique set of hypotheses, where hypotheses are equal if they can be
+ *  recombined. Hypotheses are kept in a flat vector in insertion order (so
+ *  iteration is deterministic), indexed by an open-addressing hash table on
+ *  Hypothesis::GetRecombinationHash(). Hypothesis::RecombineCompare() is only
+ *  called when the hashes are equal.
+ *
+ *  Iterators stay valid across insert() and erase(); erased entries leave a
+ *  hole which is reclaimed by Compact(), which invalidates all iterators.
+ */
+class HypothesisRecombinationTable
+{
+public:
+  /** iterates over the hypotheses in insertion order. Like the iterators of
+   *  std::set, it can't be used to modify the table */
+  class const_iterator
+  {
+    friend class HypothesisRecombinationTable;
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Hypothesis* value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Hypothesis* const *pointer;
+    typedef Hypothesis* const &reference;
+
+    const_iterator() : m_coll(NULL), m_index(0) {}
+
+    reference operator*() const {
+      return (*m_coll)[m_index];
+    }
+    const_iterator &operator++() {
+      ++m_index;
+      Skip();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator ret(*this);
+      ++*this;
+      return ret;
+    }
+    bool operator==(const const_iterator &other) const {
+      return m_index == other.m_index;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return m_index != other.m_index;
+    }
+
+  private:
+    const_iterator(const std::vector<Hypothesis*> *coll, size_t index)
+      : m_coll(coll), m_index(index) {
+      Skip();
+    }
+    void Skip() {
+      while (m_index < m_coll->size() && (*m_coll)[m_index] == NULL) ++m_index;
+    }
+
+    const std::vector<Hypothesis*> *m_coll;
+    size_t m_index;
+  };
+  typedef const_iterator iterator;
+
+  HypothesisRecombinationTable() : m_size(0), m_occupied(0) {}
+
+  const_iterator begin() const {
+    return const_iterator(&m_coll, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(&m_coll, m_coll.size());
+  }
+  size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  /** add hypo unless a recombinable hypothesis already exists.
+   *  Returns the position of the hypothesis stored and whether it is hypo */
+  std::pair<iterator, bool> insert(Hypothesis *hypo);
+
+  //! position of a hypothesis which can be recombined with hypo, or end()
+  iterator find(const Hypothesis *hypo);
+
+  //! remove hypothesis from the table, but don't delete it
+  void erase(const iterator &iter);
+
+  //! remove all hypotheses, but don't delete them
+  void clear();
+
+  //! squeeze out the holes left by erase(). Invalidates all iterators
+  void Compact();
+
+private:
+  static const size_t EMPTY = (size_t) -1;
+  static const size_t DELETED = (size_t) -2;
+
+  struct Bucket {
+    size_t m_hash;
+    size_t m_index; //! into m_coll, or EMPTY/DELETED
+
+    Bucket() : m_hash(0), m_index(EMPTY) {}
+  };
+
+  std::vector<Hypothesis*> m_coll; //! in insertion order, NULL if erased
+  std::vector<size_t> m_hashes; //! parallel to m_coll
+  std::vector<Bucket> m_buckets; //! size is a power of 2
+  size_t m_size; //! number of hypotheses
+  size_t m_occupied; //! number of buckets which are not EMPTY
+
+  //! bucket of an equivalent hypothesis, or the EMPTY bucket ending the probe
+  size_t Probe(const Hypothesis *hypo, size_t hash, size_t &firstDeleted) const;
+  void Rehash(size_t numBuckets);
+};
+
+}
+
+#endif
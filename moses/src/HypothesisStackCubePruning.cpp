@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
+#include <functional>
 #include <set>
 #include <queue>
 #include "HypothesisStackCubePruning.h"
@@ -35,7 +36,7 @@ namespace Moses
 HypothesisStackCubePruning::HypothesisStackCubePruning(Manager& manager) :
   HypothesisStack(manager)
 {
-  m_nBestIsEnabled = StaticData::Instance().IsNBestEnabled();
+  m_nBestIsEnabled = manager.IsNBestEnabled();
   m_bestScore = -std::numeric_limits<float>::infinity();
   m_worstScore = -std::numeric_limits<float>::infinity();
 }
@@ -146,29 +147,31 @@ void HypothesisStackCubePruning::AddInitial(Hypothesis *hypo)
 void HypothesisStackCubePruning::PruneToSize(size_t newSize)
 {
   if (m_hypos.size() > newSize) { // ok, if not over the limit
-    priority_queue<float> bestScores;
+    vector<float> bestScores;
+    bestScores.reserve(m_hypos.size());
 
-    // push all scores to a heap
-    // (but never push scores below m_bestScore+m_beamWidth)
+    // collect all scores
+    // (but never collect scores below m_bestScore+m_beamWidth)
     iterator iter = m_hypos.begin();
     float score = 0;
     while (iter != m_hypos.end()) {
       Hypothesis *hypo = *iter;
       score = hypo->GetTotalScore();
       if (score > m_bestScore+m_beamWidth) {
-        bestScores.push(score);
+        bestScores.push_back(score);
       }
       ++iter;
     }
 
-    // pop the top newSize scores (and ignore them, these are the scores of hyps that will remain)
-    //  ensure to never pop beyond heap size
+    // the threshold is the newSize-th best score
+    //  ensure to never go beyond the number of scores
     size_t minNewSizeHeapSize = newSize > bestScores.size() ? bestScores.size() : newSize;
-    for (size_t i = 1 ; i < minNewSizeHeapSize ; i++)
-      bestScores.pop();
-
-    // and remember the threshold
-    float scoreThreshold = bestScores.top();
+    float scoreThreshold = m_bestScore+m_beamWidth;
+    if (minNewSizeHeapSize > 0) {
+      vector<float>::iterator nth = bestScores.begin() + minNewSizeHeapSize - 1;
+      nth_element(bestScores.begin(), nth, bestScores.end(), greater<float>());
+      scoreThreshold = *nth;
+    }
 
     // delete all hypos under score threshold
     iter = m_hypos.begin();
@@ -183,6 +186,7 @@ void HypothesisStackCubePruning::PruneToSize(size_t newSize)
         ++iter;
       }
     }
+    m_hypos.Compact();
     VERBOSE(3,", pruned to size " << size() << endl);
 
     IFVERBOSE(3) {
@@ -35,7 +35,7 @@ namespace Moses
 HypothesisStackNormal::HypothesisStackNormal(Manager& manager) :
   HypothesisStack(manager)
 {
-  m_nBestIsEnabled = StaticData::Instance().IsNBestEnabled();
+  m_nBestIsEnabled = manager.IsNBestEnabled();
   m_bestScore = -std::numeric_limits<float>::infinity();
   m_worstScore = -std::numeric_limits<float>::infinity();
 }
@@ -43,9 +43,11 @@ HypothesisStackNormal::HypothesisStackNormal(Manager& manager) :
 /** remove all hypotheses from the collection */
 void HypothesisStackNormal::RemoveAll()
 {
-  while (m_hypos.begin() != m_hypos.end()) {
-    Remove(m_hypos.begin());
+  for (iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    Hypothesis *h = *iter;
+    FREEHYPO(h);
   }
+  m_hypos.clear();
 }
 
 pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesis *hypo)
@@ -144,64 +146,88 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
   }
 }
 
+namespace
+{
+struct CompareIteratorTotalScore {
+  bool operator()(const HypothesisStack::iterator &a, const HypothesisStack::iterator &b) const {
+    return (*a)->GetTotalScore() > (*b)->GetTotalScore();
+  }
+};
+}
+
 void HypothesisStackNormal::PruneToSize(size_t newSize)
 {
   if ( size() <= newSize ) return; // ok, if not over the limit
 
-  // we need to store a temporary list of hypotheses
-  vector< Hypothesis* > hypos = GetSortedListNOTCONST();
-  bool* included = (bool*) malloc(sizeof(bool) * hypos.size());
-  for(size_t i=0; i<hypos.size(); i++) included[i] = false;
-
-  // clear out original set
-  for( iterator iter = m_hypos.begin(); iter != m_hypos.end(); ) {
-    iterator removeHyp = iter++;
-    Detach(removeHyp);
+  // flat list of positions, so that unwanted hypotheses can be erased directly
+  vector< iterator > hypos;
+  hypos.reserve(size());
+  for (iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    hypos.push_back(iter);
   }
+  vector< bool > included(hypos.size(), false);
+  size_t numIncluded = 0;
 
-  // add best hyps for each coverage according to minStackDiversity
   if ( m_minHypoStackDiversity > 0 ) {
+    // diversity needs the best hyps for each coverage, so sort everything
+    sort(hypos.begin(), hypos.end(), CompareIteratorTotalScore());
+
+    // add best hyps for each coverage according to minStackDiversity
     map< WordsBitmapID, size_t > diversityCount;
     for(size_t i=0; i<hypos.size(); i++) {
-      Hypothesis *hyp = hypos[i];
+      Hypothesis *hyp = *hypos[i];
       WordsBitmapID coverage = hyp->GetWordsBitmap().GetID();;
       if (diversityCount.find( coverage ) == diversityCount.end())
         diversityCount[ coverage ] = 0;
 
       if (diversityCount[ coverage ] < m_minHypoStackDiversity) {
-        m_hypos.insert( hyp );
         included[i] = true;
+        numIncluded++;
         diversityCount[ coverage ]++;
         if (diversityCount[ coverage ] == m_minHypoStackDiversity)
           SetWorstScoreForBitmap( coverage, hyp->GetTotalScore());
       }
     }
-  }
-
-  // only add more if stack not full after satisfying minStackDiversity
-  if ( size() < newSize ) {
 
-    // add best remaining hypotheses
-    for(size_t i=0; i<hypos.size()
-        && size() < newSize
-        && hypos[i]->GetTotalScore() > m_bestScore+m_beamWidth; i++) {
-      if (! included[i]) {
-        m_hypos.insert( hypos[i] );
+    // only add more if stack not full after satisfying minStackDiversity
+    if ( numIncluded < newSize ) {
+
+      // add best remaining hypotheses
+      for(size_t i=0; i<hypos.size()
+          && numIncluded < newSize
+          && (*hypos[i])->GetTotalScore() > m_bestScore+m_beamWidth; i++) {
+        if (! included[i]) {
+          included[i] = true;
+          numIncluded++;
+          if (numIncluded == newSize)
+            m_worstScore = (*hypos[i])->GetTotalScore();
+        }
+      }
+    }
+  } else if (newSize > 0) {
+    // only the best newSize matter, and they needn't be in order
+    nth_element(hypos.begin(), hypos.begin() + newSize - 1, hypos.end(), CompareIteratorTotalScore());
+    for(size_t i=0; i<newSize; i++) {
+      if ((*hypos[i])->GetTotalScore() > m_bestScore+m_beamWidth) {
         included[i] = true;
-        if (size() == newSize)
-          m_worstScore = hypos[i]->GetTotalScore();
+        numIncluded++;
       }
     }
+    // hypos[newSize-1] is the worst of the best newSize
+    if (numIncluded == newSize)
+      m_worstScore = (*hypos[newSize-1])->GetTotalScore();
   }
 
   // delete hypotheses that have not been included
   for(size_t i=0; i<hypos.size(); i++) {
     if (! included[i]) {
-      FREEHYPO( hypos[i] );
+      Hypothesis *hyp = *hypos[i];
+      Detach(hypos[i]);
+      FREEHYPO( hyp );
       m_manager.GetSentenceStats().AddPruning();
     }
   }
-  free(included);
+  m_hypos.Compact();
 
   // some reporting....
   VERBOSE(3,", pruned to size " << size() << endl);
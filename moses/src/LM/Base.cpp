@@ -55,6 +55,16 @@ float LanguageModel::GetOOVWeight() const {
   }
 }
 
+void LanguageModel::EvaluateBatch(const std::vector<const Hypothesis*> &hypos,
+                                  const std::vector<const FFState*> &prevStates,
+                                  std::vector<FFState*> &states,
+                                  const std::vector<ScoreComponentCollection*> &accumulators) const {
+  states.resize(hypos.size());
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    states[i] = Evaluate(*hypos[i], prevStates[i], accumulators[i]);
+  }
+}
+
 void LanguageModel::IncrementalCallback(Incremental::Manager &manager) const {
   UTIL_THROW(util::Exception, "Incremental search is only supported by KenLM.");
 }
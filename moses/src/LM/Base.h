@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <cstddef>
+#include <vector>
 
 #include "../FeatureFunction.h"
 
@@ -85,6 +86,16 @@ public:
   virtual void CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, std::size_t &oovCount) const {
   }
 
+  /* Evaluate() a batch of hypotheses. prevStates, states and accumulators are
+   * parallel to hypos. Implementations can look up a request shared by several
+   * hypotheses only once, and order the lookups for locality.
+   * The default calls Evaluate() on each hypothesis
+   */
+  virtual void EvaluateBatch(const std::vector<const Hypothesis*> &hypos,
+                             const std::vector<const FFState*> &prevStates,
+                             std::vector<FFState*> &states,
+                             const std::vector<ScoreComponentCollection*> &accumulators) const;
+
   virtual void IssueRequestsFor(Hypothesis& hypo,
                                 const FFState* input_state) {
   }
@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <memory>
@@ -27,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "lm/enumerate_vocab.hh"
 #include "lm/left.hh"
 #include "lm/model.hh"
+#include "util/murmur_hash.hh"
 
 #include "LM/Ken.h"
 #include "LM/Base.h"
@@ -41,6 +43,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Incremental/Manager.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 using namespace std;
 
@@ -55,6 +58,39 @@ struct KenLMState : public FFState {
     if (state.length > other.state.length) return 1;
     return std::memcmp(state.words, other.state.words, sizeof(lm::WordIndex) * state.length);
   }
+  size_t Hash() const {
+    return util::MurmurHashNative(state.words, sizeof(lm::WordIndex) * state.length, state.length);
+  }
+};
+
+// One lookup of a batch: p(word | state)
+struct KenLMRequest {
+  lm::ngram::State state;
+  lm::WordIndex word;
+
+  bool operator==(const KenLMRequest &other) const {
+    return word == other.word && state == other.state;
+  }
+};
+
+inline size_t hash_value(const KenLMRequest &request) {
+  return lm::ngram::hash_value(request.state, request.word);
+}
+
+// Order of the lookups: by word, so that the unigram entries and the
+// n-grams extending them are visited in address order
+class KenLMRequestOrder {
+  public:
+    explicit KenLMRequestOrder(const std::vector<KenLMRequest> &requests) : m_requests(requests) {}
+
+    bool operator()(size_t a, size_t b) const {
+      const KenLMRequest &first = m_requests[a], &second = m_requests[b];
+      if (first.word != second.word) return first.word < second.word;
+      return first.state < second.state;
+    }
+
+  private:
+    const std::vector<KenLMRequest> &m_requests;
 };
 
 /*
@@ -86,6 +122,11 @@ template <class Model> class LanguageModelKen : public LanguageModel {
 
     FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
+    void EvaluateBatch(const std::vector<const Hypothesis*> &hypos,
+                       const std::vector<const FFState*> &prevStates,
+                       std::vector<FFState*> &states,
+                       const std::vector<ScoreComponentCollection*> &accumulators) const;
+
     FFState *EvaluateChart(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
     void IncrementalCallback(Incremental::Manager &manager) const {
@@ -115,6 +156,9 @@ template <class Model> class LanguageModelKen : public LanguageModel {
       }
     }
 
+    // Score the end of sentence or get the state after a long phrase, and add the score to out
+    void FinishEvaluate(const Hypothesis &hypo, float score, lm::ngram::State &state, ScoreComponentCollection *out) const;
+
     boost::shared_ptr<Model> m_ngram;
     
     std::vector<lm::WordIndex> m_lmIdLookup;
@@ -247,21 +291,30 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
     score += m_ngram->Score(*state0, TranslateID(hypo.GetWord(position)), *state1);
     std::swap(state0, state1);
   }
+  if (state0 != &ret->state) {
+    ret->state = *state0;
+  }
+
+  FinishEvaluate(hypo, score, ret->state, out);
+  return ret.release();
+}
+
+template <class Model> void LanguageModelKen<Model>::FinishEvaluate(const Hypothesis &hypo, float score, lm::ngram::State &state, ScoreComponentCollection *out) const {
+  const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
+  const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
 
   if (hypo.IsSourceCompleted()) {
     // Score end of sentence.  
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
     const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), ret->state).prob;
-  } else if (adjust_end < end) {
+    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), state).prob;
+  } else if (begin + m_ngram->Order() - 1 < end) {
     // Get state after adding a long phrase.  
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
     const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    m_ngram->GetState(&indices.front(), last, ret->state);
-  } else if (state0 != &ret->state) {
-    // Short enough phrase that we can just reuse the state.  
-    ret->state = *state0;
+    m_ngram->GetState(&indices.front(), last, state);
   }
+  // otherwise the phrase was short enough that the state is already right
 
   score = TransformLMScore(score);
 
@@ -273,8 +326,90 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
   } else {
     out->PlusEquals(this, score);
   }
+}
 
-  return ret.release();
+template <class Model> void LanguageModelKen<Model>::EvaluateBatch(
+    const std::vector<const Hypothesis*> &hypos,
+    const std::vector<const FFState*> &prevStates,
+    std::vector<FFState*> &states,
+    const std::vector<ScoreComponentCollection*> &accumulators) const {
+  const std::size_t count = hypos.size();
+  std::vector<KenLMState*> rets(count);
+  std::vector<float> scores(count, 0.0);
+  // number of words of each phrase scored word by word
+  std::vector<std::size_t> lengths(count);
+  std::size_t maxLength = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    rets[i] = new KenLMState();
+    rets[i]->state = static_cast<const KenLMState&>(*prevStates[i]).state;
+    lengths[i] = std::min<std::size_t>(hypos[i]->GetCurrTargetLength(), m_ngram->Order() - 1);
+    maxLength = std::max(maxLength, lengths[i]);
+  }
+
+  // Score the phrases one word position at a time. Many hypotheses extend
+  // the same state with the same word (e.g. the expansions of one hypothesis
+  // with translations starting alike), so each distinct request is looked
+  // up once. The distinct requests go to the model as one batch, in an
+  // order which keeps the lookups close in memory, and the model prefetches
+  // the entries of the next requests while it scores one.
+  std::vector<KenLMRequest> requests;
+  std::vector<std::size_t> requestOf(count);
+  std::vector<std::size_t> order;
+  std::vector<const lm::ngram::State*> batchStates;
+  std::vector<lm::WordIndex> batchWords;
+  std::vector<lm::ngram::State> batchOutStates;
+  std::vector<lm::FullScoreReturn> batchScores;
+  // position of each request in the batch
+  std::vector<std::size_t> batchOf;
+  boost::unordered_map<KenLMRequest, std::size_t> index;
+  for (std::size_t position = 0; position < maxLength; ++position) {
+    requests.clear();
+    index.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+      if (position >= lengths[i]) continue;
+      KenLMRequest request;
+      request.state = rets[i]->state;
+      request.word = TranslateID(hypos[i]->GetCurrWord(position));
+      std::pair<boost::unordered_map<KenLMRequest, std::size_t>::iterator, bool> inserted
+        = index.insert(std::make_pair(request, requests.size()));
+      if (inserted.second) requests.push_back(request);
+      requestOf[i] = inserted.first->second;
+    }
+
+    order.resize(requests.size());
+    for (std::size_t r = 0; r < requests.size(); ++r) order[r] = r;
+    std::sort(order.begin(), order.end(), KenLMRequestOrder(requests));
+    batchStates.resize(requests.size());
+    batchWords.resize(requests.size());
+    batchOf.resize(requests.size());
+    for (std::size_t o = 0; o < order.size(); ++o) {
+      const std::size_t r = order[o];
+      batchStates[o] = &requests[r].state;
+      batchWords[o] = requests[r].word;
+      batchOf[r] = o;
+    }
+    batchOutStates.resize(requests.size());
+    batchScores.resize(requests.size());
+    if (!requests.empty()) {
+      m_ngram->FullScoreBatch(&batchStates.front(), &batchWords.front(), requests.size(), &batchOutStates.front(), &batchScores.front());
+    }
+
+    // same order of additions as Evaluate(), so that the scores are identical
+    for (std::size_t i = 0; i < count; ++i) {
+      if (position >= lengths[i]) continue;
+      const std::size_t b = batchOf[requestOf[i]];
+      scores[i] += batchScores[b].prob;
+      rets[i]->state = batchOutStates[b];
+    }
+  }
+
+  states.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (lengths[i]) {
+      FinishEvaluate(*hypos[i], scores[i], rets[i]->state, accumulators[i]);
+    }
+    states[i] = rets[i];
+  }
 }
 
 class LanguageModelChartStateKenLM : public FFState {
@@ -50,6 +50,9 @@ struct PointerState : public FFState {
     else if (other.lmstate < lmstate) return -1;
     return 0;
   }
+  size_t Hash() const {
+    return (size_t) lmstate;
+  }
 };
 
 LanguageModelPointerState::LanguageModelPointerState()
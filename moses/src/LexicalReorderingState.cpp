@@ -1,6 +1,7 @@
 
 #include <vector>
 #include <string>
+#include <boost/functional/hash.hpp>
 #include "util/check.hh"
 
 #include "FFState.h"
@@ -203,6 +204,12 @@ int PhraseBasedReorderingState::Compare(const FFState& o) const
   return 1;
 }
 
+size_t PhraseBasedReorderingState::Hash() const
+{
+  // the previous scores of forward states are left to Compare()
+  return hash_value(m_prevRange);
+}
+
 LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
 {
   ReorderingType reoType;
@@ -301,6 +308,13 @@ int BidirectionalReorderingState::Compare(const FFState& o) const
     return m_forward->Compare(*other.m_forward);
 }
 
+size_t BidirectionalReorderingState::Hash() const
+{
+  size_t seed = m_backward->Hash();
+  boost::hash_combine(seed, m_forward->Hash());
+  return seed;
+}
+
 LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
 {
   LexicalReorderingState *newbwd = m_backward->Expand(topt, scores);
@@ -325,6 +339,11 @@ int HierarchicalReorderingBackwardState::Compare(const FFState& o) const
   return m_reoStack.Compare(other.m_reoStack);
 }
 
+size_t HierarchicalReorderingBackwardState::Hash() const
+{
+  return m_reoStack.Hash();
+}
+
 LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, Scores& scores) const
 {
 
@@ -428,6 +447,11 @@ int HierarchicalReorderingForwardState::Compare(const FFState& o) const
 //  dright: if the next phrase follows the conditioning phrase and other stuff comes in between
 //  dleft:  if the next phrase precedes the conditioning phrase and other stuff comes in between
 
+size_t HierarchicalReorderingForwardState::Hash() const
+{
+  return hash_value(m_prevRange);
+}
+
 LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const TranslationOption& topt, Scores& scores) const
 {
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
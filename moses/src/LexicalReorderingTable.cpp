@@ -7,6 +7,7 @@
 #include "GenerationDictionary.h"
 #include "TargetPhrase.h"
 #include "TargetPhraseCollection.h"
+#include "LexicalReorderingTableHashed.h"
 
 #ifndef WIN32
 #include "CompactPT/LexicalReorderingTableCompact.h"  
@@ -59,6 +60,11 @@ LexicalReorderingTable* LexicalReorderingTable::LoadAvailable(const std::string&
     return new LexicalReorderingTableCompact(filePath+".minlexr", f_factors, e_factors, c_factors);                                              
   }
 #endif
+  if(FileExists(filePath+".hashlexr")) {
+    //there exists a hashed binary version, which is mapped into memory
+    VERBOSE(2,"Using hashed lexical reordering table" << std::endl);
+    return new LexicalReorderingTableHashed(filePath+".hashlexr", f_factors, e_factors, c_factors);
+  }
   if(FileExists(filePath+".binlexr.idx")) {
     //there exists a binary version use that
     return new LexicalReorderingTableTree(filePath, f_factors, e_factors, c_factors);
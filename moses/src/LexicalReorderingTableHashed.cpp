@@ -0,0 +1,334 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/unordered_map.hpp>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+
+#include "LexicalReorderingTableHashed.h"
+#include "FactorCollection.h"
+#include "Phrase.h"
+#include "StaticData.h"
+#include "Util.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+const char kMagic[8] = {'m', 'o', 's', 'e', 's', 'L', 'R', 'H'};
+const uint64_t kVersion = 1;
+
+size_t Align8(size_t offset)
+{
+  return (offset + 7) & ~(size_t) 7;
+}
+
+void WritePadding(FILE *file, size_t written)
+{
+  const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  if (Align8(written) != written) {
+    util::WriteOrThrow(file, zeros, Align8(written) - written);
+  }
+}
+}
+
+const uint32_t LexicalReorderingTableHashed::SEPARATOR;
+const size_t LexicalReorderingTableHashed::MAX_KEY;
+
+LexicalReorderingTableHashed::LexicalReorderingTableHashed(
+  const std::string& filePath,
+  const std::vector<FactorType>& f_factors,
+  const std::vector<FactorType>& e_factors,
+  const std::vector<FactorType>& c_factors)
+  : LexicalReorderingTable(f_factors, e_factors, c_factors)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+  const uint64_t size = util::SizeFile(file.get());
+  UTIL_THROW_IF(size == util::kBadSize || size < sizeof(Header), util::Exception,
+                "Reordering table " << filePath << " is too small");
+  // shared and read-only: the pages are shared with other processes
+  util::MapRead(util::LAZY, file.get(), 0, size, m_memory);
+
+  const char *base = static_cast<const char*>(m_memory.get());
+  m_header = reinterpret_cast<const Header*>(base);
+  UTIL_THROW_IF(memcmp(m_header->m_magic, kMagic, sizeof(kMagic)) || m_header->m_version != kVersion,
+                util::Exception, filePath << " is not a binary reordering table of version " << kVersion);
+  const uint64_t numSides = !m_FactorsF.empty() + !m_FactorsE.empty() + !m_FactorsC.empty();
+  UTIL_THROW_IF(m_header->m_numSides != numSides, util::Exception,
+                "Reordering table " << filePath << " has " << m_header->m_numSides
+                << " phrases per entry, but the model is conditioned on " << numSides);
+
+  size_t offset = Align8(sizeof(Header));
+  m_buckets = reinterpret_cast<const Bucket*>(base + offset);
+  offset += m_header->m_numBuckets * sizeof(Bucket);
+  const size_t numValues = m_header->m_numRows * m_header->m_numScores;
+  if (m_header->m_quantized) {
+    m_scores = NULL;
+    m_bases = reinterpret_cast<const float*>(base + offset);
+    m_steps = m_bases + m_header->m_numScores;
+    offset += 2 * m_header->m_numScores * sizeof(float);
+    m_codes = reinterpret_cast<const uint8_t*>(base + offset);
+    offset = Align8(offset + numValues);
+  } else {
+    m_scores = reinterpret_cast<const float*>(base + offset);
+    m_bases = m_steps = NULL;
+    m_codes = NULL;
+    offset = Align8(offset + numValues * sizeof(float));
+  }
+  UTIL_THROW_IF(offset + m_header->m_vocabBytes > size, util::Exception,
+                "Reordering table " << filePath << " is truncated");
+
+  // map the factors of the decoder to the ids of the table
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_ids.clear();
+  const char *word = base + offset;
+  for (uint32_t id = 0; id < m_header->m_vocabSize; ++id) {
+    const size_t length = strlen(word);
+    const size_t factorId = factorCollection.AddFactor(StringPiece(word, length))->GetId();
+    if (factorId >= m_ids.size()) {
+      m_ids.resize(factorId + 1, SEPARATOR);
+    }
+    m_ids[factorId] = id;
+    word += length + 1;
+  }
+  VERBOSE(2, "Mapped reordering table " << filePath << " with " << m_header->m_numRows
+          << " entries and " << m_header->m_vocabSize << " words" << std::endl);
+}
+
+uint64_t LexicalReorderingTableHashed::Hash(const uint32_t *key, size_t size)
+{
+  const uint64_t hash = util::MurmurHash64A(key, size * sizeof(uint32_t));
+  return hash ? hash : 1; // 0 marks an empty bucket
+}
+
+bool LexicalReorderingTableHashed::AppendIds(const Phrase& phrase, size_t start,
+    const FactorList& factors, uint32_t *key, size_t &size) const
+{
+  if (size + (phrase.GetSize() - start) * factors.size() + 1 > MAX_KEY) return false;
+  for (size_t pos = start; pos < phrase.GetSize(); ++pos) {
+    const Word &word = phrase.GetWord(pos);
+    for (size_t i = 0; i < factors.size(); ++i) {
+      const Factor *factor = word.GetFactor(factors[i]);
+      if (factor == NULL) return false;
+      const size_t factorId = factor->GetId();
+      if (factorId >= m_ids.size() || m_ids[factorId] == SEPARATOR) return false;
+      key[size++] = m_ids[factorId];
+    }
+  }
+  key[size++] = SEPARATOR;
+  return true;
+}
+
+bool LexicalReorderingTableHashed::Find(const uint32_t *key, size_t size, Scores &scores) const
+{
+  const uint64_t hash = Hash(key, size);
+  const uint64_t mask = m_header->m_numBuckets - 1;
+  for (uint64_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Bucket &bucket = m_buckets[i];
+    if (bucket.m_key == 0) return false;
+    if (bucket.m_key != hash) continue;
+
+    const size_t numScores = m_header->m_numScores;
+    scores.resize(numScores);
+    if (m_scores) {
+      const float *row = m_scores + bucket.m_row * numScores;
+      std::copy(row, row + numScores, scores.begin());
+    } else {
+      const uint8_t *row = m_codes + bucket.m_row * numScores;
+      for (size_t s = 0; s < numScores; ++s) {
+        scores[s] = m_bases[s] + row[s] * m_steps[s];
+      }
+    }
+    return true;
+  }
+}
+
+Scores LexicalReorderingTableHashed::GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
+{
+  Scores scores;
+  uint32_t key[MAX_KEY];
+  size_t size = 0;
+  if (!m_FactorsF.empty() && !AppendIds(f, 0, m_FactorsF, key, size)) return scores;
+  if (!m_FactorsE.empty() && !AppendIds(e, 0, m_FactorsE, key, size)) return scores;
+  if (m_FactorsC.empty()) {
+    Find(key, size, scores);
+    return scores;
+  }
+
+  // as LexicalReorderingTableMemory, try from the longest to the empty context
+  const size_t prefix = size;
+  for (size_t i = 0; i <= c.GetSize(); ++i) {
+    size = prefix;
+    if (AppendIds(c, i, m_FactorsC, key, size) && Find(key, size, scores)) {
+      return scores;
+    }
+  }
+  return scores;
+}
+
+bool LexicalReorderingTableHashed::Create(std::istream& inFile, const std::string& outFileName, bool quantize)
+{
+  boost::unordered_map<std::string, uint32_t> vocab;
+  std::vector<std::string> words;
+  boost::unordered_map<uint64_t, size_t> rowOfKey;
+  std::vector<uint64_t> keys;
+  std::vector<float> values;
+  size_t numScores = 0, numSides = 0;
+
+  std::string line;
+  std::vector<uint32_t> key;
+  size_t lineNum = 0;
+  while (getline(inFile, line)) {
+    ++lineNum;
+    std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
+    if (tokens.size() < 2) {
+      TRACE_ERR("Line " << lineNum << " has no scores" << std::endl);
+      return false;
+    }
+    if (numSides == 0) {
+      numSides = tokens.size() - 1;
+    } else if (tokens.size() - 1 != numSides) {
+      TRACE_ERR("Line " << lineNum << " has " << tokens.size() - 1 << " phrases, expected " << numSides << std::endl);
+      return false;
+    }
+
+    // ids of the factors of each word, and a separator after each phrase
+    key.clear();
+    for (size_t side = 0; side < numSides; ++side) {
+      std::vector<std::string> phrase = Tokenize(tokens[side]);
+      for (size_t w = 0; w < phrase.size(); ++w) {
+        std::vector<std::string> factors = Tokenize(phrase[w], "|");
+        for (size_t i = 0; i < factors.size(); ++i) {
+          std::pair<boost::unordered_map<std::string, uint32_t>::iterator, bool> inserted
+            = vocab.insert(std::make_pair(factors[i], (uint32_t) words.size()));
+          if (inserted.second) words.push_back(factors[i]);
+          key.push_back(inserted.first->second);
+        }
+      }
+      key.push_back(SEPARATOR);
+    }
+    if (key.size() > MAX_KEY) {
+      TRACE_ERR("Skipping line " << lineNum << ", its phrases are too long" << std::endl);
+      continue;
+    }
+
+    std::vector<float> p = Scan<float>(Tokenize(tokens.back()));
+    if (numScores == 0) {
+      numScores = p.size();
+    } else if (p.size() != numScores) {
+      TRACE_ERR("Line " << lineNum << " has " << p.size() << " scores, expected " << numScores << std::endl);
+      return false;
+    }
+    std::transform(p.begin(), p.end(), p.begin(), TransformScore);
+    std::transform(p.begin(), p.end(), p.begin(), FloorScore);
+
+    // a repeated entry replaces the earlier one, as in the text table
+    const uint64_t hash = Hash(&key.front(), key.size());
+    std::pair<boost::unordered_map<uint64_t, size_t>::iterator, bool> inserted
+      = rowOfKey.insert(std::make_pair(hash, keys.size()));
+    if (inserted.second) {
+      keys.push_back(hash);
+      values.insert(values.end(), p.begin(), p.end());
+    } else {
+      std::copy(p.begin(), p.end(), values.begin() + inserted.first->second * numScores);
+    }
+  }
+  rowOfKey.clear();
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.m_magic, kMagic, sizeof(kMagic));
+  header.m_version = kVersion;
+  header.m_numScores = numScores;
+  header.m_numSides = numSides;
+  header.m_numRows = keys.size();
+  header.m_numBuckets = 2;
+  while (header.m_numBuckets < 2 * keys.size()) header.m_numBuckets *= 2;
+  header.m_quantized = quantize;
+  header.m_vocabSize = words.size();
+  for (size_t i = 0; i < words.size(); ++i) {
+    header.m_vocabBytes += words[i].size() + 1;
+  }
+
+  std::vector<Bucket> buckets(header.m_numBuckets);
+  const uint64_t mask = header.m_numBuckets - 1;
+  for (size_t row = 0; row < keys.size(); ++row) {
+    uint64_t i = keys[row] & mask;
+    while (buckets[i].m_key) i = (i + 1) & mask;
+    buckets[i].m_key = keys[row];
+    buckets[i].m_row = row;
+  }
+
+  FILE *file = util::FOpenOrThrow(outFileName.c_str(), "wb");
+  util::WriteOrThrow(file, &header, sizeof(header));
+  WritePadding(file, sizeof(header));
+  util::WriteOrThrow(file, &buckets.front(), buckets.size() * sizeof(Bucket));
+
+  if (quantize) {
+    // 256 evenly spaced levels between the lowest and highest value of each score
+    std::vector<float> bases(numScores, 0.0), steps(numScores, 0.0);
+    for (size_t s = 0; s < numScores; ++s) {
+      float lowest = 0.0, highest = 0.0;
+      for (size_t row = 0; row < keys.size(); ++row) {
+        const float value = values[row * numScores + s];
+        if (row == 0 || value < lowest) lowest = value;
+        if (row == 0 || value > highest) highest = value;
+      }
+      bases[s] = lowest;
+      steps[s] = (highest - lowest) / 255;
+    }
+    std::vector<uint8_t> codes(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      const size_t s = i % numScores;
+      codes[i] = steps[s] > 0 ? (uint8_t) floor((values[i] - bases[s]) / steps[s] + 0.5) : 0;
+    }
+    if (numScores) {
+      util::WriteOrThrow(file, &bases.front(), numScores * sizeof(float));
+      util::WriteOrThrow(file, &steps.front(), numScores * sizeof(float));
+    }
+    if (!codes.empty()) util::WriteOrThrow(file, &codes.front(), codes.size());
+    WritePadding(file, 2 * numScores * sizeof(float) + codes.size());
+  } else {
+    if (!values.empty()) util::WriteOrThrow(file, &values.front(), values.size() * sizeof(float));
+    WritePadding(file, values.size() * sizeof(float));
+  }
+
+  for (size_t i = 0; i < words.size(); ++i) {
+    util::WriteOrThrow(file, words[i].c_str(), words[i].size() + 1);
+  }
+  if (fclose(file)) {
+    TRACE_ERR("Error writing " << outFileName << std::endl);
+    return false;
+  }
+  return true;
+}
+
+}
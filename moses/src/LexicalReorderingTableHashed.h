@@ -0,0 +1,107 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_LexicalReorderingTableHashed_h
+#define moses_LexicalReorderingTableHashed_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "util/mmap.hh"
+#include "LexicalReorderingTable.h"
+
+namespace Moses
+{
+
+/** Binary lexicalized reordering table (.hashlexr) which is mapped into
+ *  memory read-only, so its pages are shared by all processes using it and
+ *  only the parts touched are read from disk.
+ *
+ *  Words are stored as integer ids, which are mapped from the factor ids of
+ *  the decoder once at load time. A lookup hashes the ids of f, e and c and
+ *  probes an open-addressing table of 64 bit fingerprints (as KenLM's
+ *  probing model does), so it builds no strings and allocates nothing.
+ *  Scores are stored as floats, or optionally quantized to 8 bits per score.
+ *
+ *  Create the table with misc/processLexicalTableHashed.
+ */
+class LexicalReorderingTableHashed : public LexicalReorderingTable
+{
+public:
+  LexicalReorderingTableHashed(const std::string& filePath,
+                               const std::vector<FactorType>& f_factors,
+                               const std::vector<FactorType>& e_factors,
+                               const std::vector<FactorType>& c_factors);
+
+  virtual Scores GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
+
+  /** write the binary version of the text table read from inFile.
+   *  quantize stores each score in 8 bits instead of 32 */
+  static bool Create(std::istream& inFile, const std::string& outFileName, bool quantize);
+
+  static const uint32_t SEPARATOR = (uint32_t) -1;
+
+private:
+  struct Header {
+    char m_magic[8];
+    uint64_t m_version;
+    uint64_t m_numScores;
+    uint64_t m_numSides; //! number of phrases in a key: f, e and/or c
+    uint64_t m_numRows;
+    uint64_t m_numBuckets; //! a power of 2
+    uint64_t m_quantized;
+    uint64_t m_vocabSize;
+    uint64_t m_vocabBytes;
+  };
+
+  struct Bucket {
+    uint64_t m_key; //! 0 if empty
+    uint64_t m_row;
+  };
+
+  util::scoped_memory m_memory;
+  const Header *m_header;
+  const Bucket *m_buckets;
+  const float *m_scores; //! if not quantized
+  const float *m_bases, *m_steps; //! of each score, if quantized
+  const uint8_t *m_codes; //! if quantized
+
+  //! table id of each factor id, or SEPARATOR if not in the table
+  std::vector<uint32_t> m_ids;
+
+  //! longest key looked up, in ids. Longer keys can't be in the table
+  static const size_t MAX_KEY = 512;
+
+  static uint64_t Hash(const uint32_t *key, size_t size);
+
+  /** append the ids of the words of phrase from start on and a SEPARATOR to
+   *  key. false if a word is not in the table or the key gets too long */
+  bool AppendIds(const Phrase& phrase, size_t start, const FactorList& factors, uint32_t *key, size_t &size) const;
+
+  bool Find(const uint32_t *key, size_t size, Scores &scores) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,129 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "LexicalReorderingTableHashed.h"
+#include "Phrase.h"
+#include "Util.h"
+
+using namespace std;
+using namespace Moses;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(lexical_reordering_table_hashed)
+
+struct TableFixture {
+  TableFixture() {
+    char name[] = "HashedLexrXXXXXX";
+    int fd = mkstemp(name);
+    BOOST_CHECK(fd != -1);
+    BOOST_CHECK(!close(fd));
+    filename = name;
+  }
+
+  ~TableFixture() {
+    BOOST_CHECK(!remove(filename.c_str()));
+  }
+
+  void Create(const string &text, bool quantize) {
+    istringstream in(text);
+    BOOST_CHECK(LexicalReorderingTableHashed::Create(in, filename, quantize));
+  }
+
+  string filename;
+};
+
+static Phrase MakePhrase(const string &text) {
+  vector<FactorType> factors(1, 0);
+  Phrase phrase(0);
+  phrase.CreateFromString(factors, text, "|");
+  return phrase;
+}
+
+BOOST_FIXTURE_TEST_CASE(find_f_e, TableFixture)
+{
+  Create("das haus ||| the house ||| 0.5 0.25 0.125\n"
+         "das ||| the ||| 0.1 0.2 0.3\n", false);
+  FactorList factors(1, 0), none;
+  LexicalReorderingTableHashed table(filename, factors, factors, none);
+
+  Scores scores = table.GetScore(MakePhrase("das haus"), MakePhrase("the house"), MakePhrase(""));
+  BOOST_REQUIRE_EQUAL(scores.size(), 3);
+  BOOST_CHECK_CLOSE(scores[0], FloorScore(TransformScore(0.5)), 0.001);
+  BOOST_CHECK_CLOSE(scores[2], FloorScore(TransformScore(0.125)), 0.001);
+
+  BOOST_CHECK(table.GetScore(MakePhrase("das"), MakePhrase("the house"), MakePhrase("")).empty());
+  BOOST_CHECK(table.GetScore(MakePhrase("das haus"), MakePhrase("unknown"), MakePhrase("")).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(longest_context, TableFixture)
+{
+  Create("a ||| x ||| y z ||| 0.5 0.5\n"
+         "a ||| x ||| z ||| 0.25 0.25\n"
+         "a ||| x ||| ||| 0.125 0.125\n", false);
+  FactorList factors(1, 0);
+  LexicalReorderingTableHashed table(filename, factors, factors, factors);
+
+  Scores scores = table.GetScore(MakePhrase("a"), MakePhrase("x"), MakePhrase("y z"));
+  BOOST_REQUIRE_EQUAL(scores.size(), 2);
+  BOOST_CHECK_CLOSE(scores[0], FloorScore(TransformScore(0.5)), 0.001);
+  scores = table.GetScore(MakePhrase("a"), MakePhrase("x"), MakePhrase("w z"));
+  BOOST_REQUIRE_EQUAL(scores.size(), 2);
+  BOOST_CHECK_CLOSE(scores[0], FloorScore(TransformScore(0.25)), 0.001);
+  scores = table.GetScore(MakePhrase("a"), MakePhrase("x"), MakePhrase("unseen"));
+  BOOST_REQUIRE_EQUAL(scores.size(), 2);
+  BOOST_CHECK_CLOSE(scores[0], FloorScore(TransformScore(0.125)), 0.001);
+}
+
+BOOST_FIXTURE_TEST_CASE(quantized, TableFixture)
+{
+  ostringstream text;
+  for (size_t i = 1; i <= 100; ++i) {
+    text << "f" << i << " ||| e" << i << " ||| " << i / 100.0 << " 0.5\n";
+  }
+  Create(text.str(), true);
+  FactorList factors(1, 0), none;
+  LexicalReorderingTableHashed table(filename, factors, factors, none);
+
+  // within half a step of 256 levels over the range of the score
+  const float step = (TransformScore(1.0) - TransformScore(0.01)) / 255;
+  for (size_t i = 1; i <= 100; ++i) {
+    ostringstream f, e;
+    f << "f" << i;
+    e << "e" << i;
+    Scores scores = table.GetScore(MakePhrase(f.str()), MakePhrase(e.str()), MakePhrase(""));
+    BOOST_REQUIRE_EQUAL(scores.size(), 2);
+    BOOST_CHECK(fabs(scores[0] - TransformScore(i / 100.0)) <= step / 2 + 1e-5);
+    BOOST_CHECK_CLOSE(scores[1], TransformScore(0.5), 0.001);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -28,12 +28,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
-#include "TrellisPathCollection.h"
+#include "NBestExtractor.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "LMList.h"
@@ -50,15 +52,23 @@ using namespace std;
 
 namespace Moses
 {
-Manager::Manager(size_t lineNumber, InputType const& source, SearchAlgorithm searchAlgorithm, const TranslationSystem* system)
+Manager::Manager(size_t lineNumber, InputType const& source, SearchAlgorithm searchAlgorithm, const TranslationSystem* system, bool outputSearchGraph)
   :m_lineNumber(lineNumber)
   ,m_system(system)
+  ,m_outputSearchGraph(outputSearchGraph)
+  ,m_searchWeights(StaticData::Instance().GetAllWeights())
   ,m_transOptColl(source.CreateTranslationOptionCollection(system))
   ,m_search(Search::CreateSearch(*this, source, searchAlgorithm, *m_transOptColl))
   ,interrupted_flag(0)
   ,m_hypoId(0)
   ,m_source(source)
 {
+  // done here once, rather than on a copy of the scores of every hypothesis
+  const vector<const FeatureFunction*>& sparseProducers = m_system->GetSparseProducers();
+  for (size_t i = 0; i < sparseProducers.size(); ++i) {
+    m_searchWeights.MultiplyEquals(sparseProducers[i], sparseProducers[i]->GetSparseProducerWeight());
+  }
+
   m_system->InitializeBeforeSentenceProcessing(source);
 }
 
@@ -76,6 +86,9 @@ Manager::~Manager()
  */
 void Manager::ProcessSentence()
 {
+  // states created by the feature functions during search go into the arena
+  SentenceArena::Scope arenaScope(m_arena);
+
   // reset statistics
   ResetSentenceStats(m_source);
 
@@ -98,6 +111,7 @@ void Manager::ProcessSentence()
   searchTime.start();
   m_search->ProcessSentence();
   VERBOSE(1, "Line " << m_lineNumber << ": Search took " << searchTime << " seconds" << endl);
+  VERBOSE(2, "Line " << m_lineNumber << ": Sentence arena holds " << m_arena.GetBytesReserved() << " bytes" << endl);
 }
 
 /**
@@ -187,11 +201,35 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 
 
 
+namespace
+{
+
+/** the output factors of the words of a path. Factors are unique per string,
+ *  so two paths have the same surface string if and only if these are equal */
+void GetSurfaceFactors(const vector<const Hypothesis*> &edges, const vector<FactorType> &outputFactorOrder
+                       , vector<const Factor*> &surface)
+{
+  surface.clear();
+  vector<const Hypothesis*>::const_iterator iter;
+  for (iter = edges.begin(); iter != edges.end(); ++iter) {
+    const TargetPhrase &phrase = (*iter)->GetCurrTargetPhrase();
+    for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+      const Word &word = phrase.GetWord(pos);
+      for (size_t i = 0; i < outputFactorOrder.size(); ++i) {
+        surface.push_back(word.GetFactor(outputFactorOrder[i]));
+      }
+    }
+  }
+}
+
+}
+
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
- * this function controls this for one sentence.
+ * Paths are enumerated best first by NBestExtractor, which shares the
+ * common parts of paths, and only the paths output are made TrellisPaths.
+ * This function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
  * \param ret holds the n-best list that was calculated
@@ -208,49 +246,30 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
-
-  set<Phrase> distinctHyps;
+  NBestExtractor extractor(sortedPureHypo);
 
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  const vector<FactorType> &outputFactorOrder = StaticData::Instance().GetOutputFactorOrder();
+  boost::unordered_set<vector<const Factor*> > distinctHyps;
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
-    // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    CHECK(path);
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
-      }
-    } else {
-      ret.Add(path);
-    }
-
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
+  vector<const Hypothesis*> edges;
+  vector<const Factor*> surface;
+  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && (iteration < count * nBestFactor) ; iteration++) {
+    // get next best derivation
+    const NBestExtractor::Derivation *derivation = extractor.Next();
+    if (derivation == NULL)
+      break;
+    NBestExtractor::GetEdges(*derivation, edges);
+    if (onlyDistinct) {
+      GetSurfaceFactors(edges, outputFactorOrder, surface);
+      if (!distinctHyps.insert(surface).second)
+        continue;
     }
+    ret.Add(new TrellisPath(edges));
   }
 }
 
@@ -26,10 +26,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <list>
 #include "InputType.h"
 #include "Hypothesis.h"
+#include "SentenceArena.h"
 #include "StaticData.h"
 #include "TranslationOption.h"
 #include "TranslationOptionCollection.h"
 #include "TrellisPathList.h"
+#include "ThreadPool.h"
 #include "SquareMatrix.h"
 #include "WordsBitmap.h"
 #include "Search.h"
@@ -96,6 +98,9 @@ class Manager
 protected:
   // data
 //	InputType const& m_source; /**< source sentence to be translated */
+  SentenceArena m_arena; /**< memory for the hypotheses of this sentence. Declared before the stacks and search objects which point into it, so that it is destroyed after them */
+  bool m_outputSearchGraph; /**< keep the search graph of this sentence, whatever the configuration says */
+  ScoreComponentCollection m_searchWeights; /**< weights used to score hypotheses, with the sparse producer weights folded in */
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
 
@@ -103,6 +108,7 @@ protected:
   size_t interrupted_flag;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
+  CancellationTokenPtr m_cancellation; /**< polled by the search, may be NULL */
 
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
@@ -115,7 +121,9 @@ protected:
 public:
   size_t m_lineNumber;
   InputType const& m_source; /**< source sentence to be translated */
-  Manager(size_t lineNumber, InputType const& source, SearchAlgorithm searchAlgorithm, const TranslationSystem* system);
+  /** outputSearchGraph keeps the search graph for GetSearchGraph(), as the
+   *  output-search-graph option does, but for this sentence only */
+  Manager(size_t lineNumber, InputType const& source, SearchAlgorithm searchAlgorithm, const TranslationSystem* system, bool outputSearchGraph = false);
   ~Manager();
   const  TranslationOptionCollection* getSntTranslationOptions();
   const TranslationSystem* GetTranslationSystem() {
@@ -132,6 +140,28 @@ public:
   void printThisHypothesis(long translationId, const Hypothesis* hypo, const std::vector <const TargetPhrase* > & remainingPhrases, float remainingScore , std::ostream& outputStream) const;
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
+  SentenceArena &GetArena() {
+    return m_arena;
+  }
+  /** all weights, with the weights of the sparse features of each sparse
+   *  producer already multiplied by the weight of the producer */
+  const ScoreComponentCollection &GetSearchWeights() const {
+    return m_searchWeights;
+  }
+  //! the search stops early, like on a time-out, once token is cancelled
+  void SetCancellationToken(const CancellationTokenPtr &token) {
+    m_cancellation = token;
+  }
+  bool IsCancelled() const {
+    return m_cancellation && m_cancellation->IsCancelled();
+  }
+  //! whether the search keeps the arcs of the hypotheses, for n-best lists or the search graph
+  bool IsNBestEnabled() const {
+    return m_outputSearchGraph || StaticData::Instance().IsNBestEnabled();
+  }
+  bool GetOutputSearchGraph() const {
+    return m_outputSearchGraph || StaticData::Instance().GetOutputSearchGraph();
+  }
 #ifdef HAVE_PROTOBUF
   void SerializeSearchGraphPB(long translationId, std::ostream& outputStream) const;
 #endif
@@ -0,0 +1,138 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "DummyScoreProducers.h"
+#include "Hypothesis.h"
+#include "HypothesisStackNormal.h"
+#include "Manager.h"
+#include "Sentence.h"
+#include "StaticData.h"
+#include "TranslationOption.h"
+#include "TranslationSystem.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(manager)
+
+namespace
+{
+
+/** Two hypotheses over the same source word, which recombine, in the search
+ *  stack of a sentence. The configuration has neither n-best lists nor the
+ *  search graph */
+class RecombinationFixture
+{
+  // before the manager, which is constructed from them
+  TargetPhrase m_emptyTarget;
+  Sentence m_sentence;
+  WordPenaltyProducer m_wp;
+  UnknownWordPenaltyProducer m_uwp;
+  DistortionScoreProducer m_dist;
+  TranslationSystem m_system;
+
+public:
+  explicit RecombinationFixture(bool outputSearchGraph)
+    : m_system("mock", &m_wp, &m_uwp, &m_dist)
+    , m_manager(0, MakeSentence(m_sentence), Normal, &m_system, outputSearchGraph)
+    , m_stack(NULL) {
+    BOOST_REQUIRE(!StaticData::Instance().GetOutputSearchGraph());
+    BOOST_REQUIRE(!StaticData::Instance().IsNBestEnabled());
+    m_manager.ResetSentenceStats(m_sentence);
+    m_initial = Hypothesis::Create(m_manager, m_sentence, m_emptyTarget);
+
+    m_stack = new HypothesisStackNormal(m_manager);
+    m_stack->SetMaxHypoStackSize(10, 0);
+    m_stack->SetBeamWidth(-numeric_limits<float>::infinity());
+    m_winner = Extend("x");
+    m_loser = Extend("y");
+    BOOST_CHECK(m_stack->AddPrune(m_winner));
+    BOOST_CHECK(!m_stack->AddPrune(m_loser));
+    BOOST_CHECK_EQUAL(m_stack->size(), 1);
+  }
+
+  ~RecombinationFixture() {
+    delete m_stack;
+    FREEHYPO(m_initial);
+    RemoveAllInColl(m_transOpts);
+  }
+
+  Manager m_manager;
+  HypothesisStackNormal *m_stack;
+  Hypothesis *m_winner, *m_loser;
+
+private:
+  static Sentence &MakeSentence(Sentence &sentence) {
+    stringstream in("a b\n");
+    sentence.Read(in, vector<FactorType>(1, 0));
+    return sentence;
+  }
+
+  Hypothesis *Extend(const string &target) {
+    TargetPhrase targetPhrase;
+    targetPhrase.CreateFromString(vector<FactorType>(1, 0), target, "|");
+    m_transOpts.push_back(new TranslationOption(WordsRange(0, 0), targetPhrase, m_sentence));
+    return Hypothesis::Create(*m_initial, *m_transOpts.back(), NULL);
+  }
+
+  Hypothesis *m_initial;
+  vector<TranslationOption*> m_transOpts;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(search_graph_for_one_sentence)
+{
+  RecombinationFixture fixture(true);
+  BOOST_CHECK(fixture.m_manager.GetOutputSearchGraph());
+  BOOST_CHECK(fixture.m_manager.IsNBestEnabled());
+
+  // the loser is kept as an arc, and the arcs survive their clean up
+  const ArcList *arcs = fixture.m_winner->GetArcList();
+  BOOST_REQUIRE(arcs != NULL);
+  BOOST_REQUIRE_EQUAL(arcs->size(), 1);
+  BOOST_CHECK((*arcs)[0] == fixture.m_loser);
+  fixture.m_winner->CleanupArcList();
+  BOOST_REQUIRE_EQUAL(arcs->size(), 1);
+  BOOST_CHECK(fixture.m_loser->GetWinningHypo() == fixture.m_winner);
+}
+
+BOOST_AUTO_TEST_CASE(no_search_graph_by_default)
+{
+  RecombinationFixture fixture(false);
+  BOOST_CHECK(!fixture.m_manager.GetOutputSearchGraph());
+  BOOST_CHECK(!fixture.m_manager.IsNBestEnabled());
+
+  // the loser is deleted
+  BOOST_CHECK(fixture.m_winner->GetArcList() == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -75,7 +75,7 @@ MockHypothesisGuard::~MockHypothesisGuard()
   RemoveAllInColl(m_toptions);
   while (m_hypothesis) {
     Hypothesis* prevHypo = const_cast<Hypothesis*>(m_hypothesis->GetPrevHypo());
-    delete m_hypothesis;
+    FREEHYPO(m_hypothesis);
     m_hypothesis = prevHypo;
   }
 }
@@ -0,0 +1,150 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+
+#include "util/check.hh"
+#include "NBestExtractor.h"
+#include "Hypothesis.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+bool NBestExtractor::CandidateOrder::operator()(const Candidate &a, const Candidate &b) const
+{
+  // true if a comes out of the heap after b. Ties are broken by hypothesis id
+  // and rank, so that the order doesn't depend on the heap
+  if (a.m_score != b.m_score) return a.m_score < b.m_score;
+  if (a.m_edge->GetId() != b.m_edge->GetId()) return a.m_edge->GetId() > b.m_edge->GetId();
+  return a.m_prevRank > b.m_prevRank;
+}
+
+NBestExtractor::NBestExtractor(const vector<const Hypothesis*> &finalHypos)
+{
+  vector<const Hypothesis*>::const_iterator iter;
+  for (iter = finalHypos.begin(); iter != finalHypos.end(); ++iter) {
+    const Hypothesis *hypo = *iter;
+    Candidate candidate = { hypo, 0, hypo->GetTotalScore() };
+    m_goal.m_candidates.push(candidate);
+  }
+}
+
+NBestExtractor::~NBestExtractor()
+{
+  NodeMap::iterator iter;
+  for (iter = m_nodes.begin(); iter != m_nodes.end(); ++iter) {
+    delete iter->second;
+  }
+}
+
+float NBestExtractor::EdgeDelta(const Hypothesis *edge)
+{
+  return edge->GetTotalScore() - edge->GetWinningHypo()->GetTotalScore();
+}
+
+NBestExtractor::Node &NBestExtractor::GetNode(const Hypothesis *hypo)
+{
+  pair<NodeMap::iterator, bool> ret = m_nodes.insert(make_pair(hypo, (Node*) NULL));
+  if (!ret.second) return *ret.first->second;
+
+  Node *node = new Node;
+  ret.first->second = node;
+
+  // the best derivation of every node is the hypothesis itself with delta 0,
+  // so the first derivation through each edge scores just the edge
+  Candidate candidate = { hypo, 0, 0.0f };
+  node->m_candidates.push(candidate);
+  const ArcList *arcList = hypo->GetArcList();
+  if (arcList) {
+    ArcList::const_iterator iter;
+    for (iter = arcList->begin(); iter != arcList->end(); ++iter) {
+      const Hypothesis *arc = *iter;
+      Candidate arcCandidate = { arc, 0, EdgeDelta(arc) };
+      node->m_candidates.push(arcCandidate);
+    }
+  }
+  return *node;
+}
+
+const NBestExtractor::Derivation *NBestExtractor::GetDerivation(const Hypothesis *hypo, size_t k)
+{
+  Node &node = GetNode(hypo);
+  while (node.m_best.size() <= k) {
+    if (!PopCandidate(node, false)) return NULL;
+  }
+  return node.m_best[k];
+}
+
+bool NBestExtractor::PopCandidate(Node &node, bool goal)
+{
+  if (node.m_candidates.empty()) return false;
+  const Candidate candidate = node.m_candidates.top();
+  node.m_candidates.pop();
+
+  if (goal) {
+    // a derivation of the goal is a derivation of a final hypothesis
+    const Derivation *derivation = GetDerivation(candidate.m_edge, candidate.m_prevRank);
+    CHECK(derivation);
+    node.m_best.push_back(derivation);
+  } else {
+    const Hypothesis *prevHypo = candidate.m_edge->GetPrevHypo();
+    Derivation derivation;
+    derivation.m_edge = candidate.m_edge;
+    derivation.m_prev = prevHypo ? GetDerivation(prevHypo, candidate.m_prevRank) : NULL;
+    derivation.m_prevRank = candidate.m_prevRank;
+    derivation.m_delta = candidate.m_score;
+    CHECK(prevHypo == NULL || derivation.m_prev != NULL);
+    m_derivations.push_back(derivation);
+    node.m_best.push_back(&m_derivations.back());
+  }
+
+  // only the edge just used can have a new candidate: the same edge over the
+  // next derivation of its predecessor
+  const Hypothesis *prevHypo = goal ? candidate.m_edge : candidate.m_edge->GetPrevHypo();
+  if (prevHypo) {
+    const Derivation *next = GetDerivation(prevHypo, candidate.m_prevRank + 1);
+    if (next) {
+      const float edgeScore = goal ? candidate.m_edge->GetTotalScore() : EdgeDelta(candidate.m_edge);
+      Candidate successor = { candidate.m_edge, candidate.m_prevRank + 1, edgeScore + next->m_delta };
+      node.m_candidates.push(successor);
+    }
+  }
+  return true;
+}
+
+const NBestExtractor::Derivation *NBestExtractor::Next()
+{
+  if (!PopCandidate(m_goal, true)) return NULL;
+  return m_goal.m_best.back();
+}
+
+void NBestExtractor::GetEdges(const Derivation &derivation, vector<const Hypothesis*> &edges)
+{
+  edges.clear();
+  for (const Derivation *curr = &derivation; curr != NULL; curr = curr->m_prev) {
+    edges.push_back(curr->m_edge);
+  }
+  reverse(edges.begin(), edges.end());
+}
+
+}
@@ -0,0 +1,114 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_NBestExtractor_h
+#define moses_NBestExtractor_h
+
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+namespace Moses
+{
+
+class Hypothesis;
+
+/** Enumerates the derivations of a phrase-based search in order of score,
+ *  lazily, as Algorithm 3 of Huang and Chiang (2005), "Better k-best
+ *  parsing".
+ *
+ *  The recombination graph has a node for each hypothesis which survived
+ *  recombination. The incoming edges of a node are the hypothesis itself
+ *  and its arcs (the hypotheses recombined into it), each with the single
+ *  predecessor node GetPrevHypo(). A derivation is an edge and the rank of
+ *  the derivation of its predecessor which it extends, so derivations share
+ *  their suffixes and are never copied. The k-th best derivation of a node
+ *  is only worked out when a derivation which needs it is asked for.
+ */
+class NBestExtractor
+{
+public:
+  /** one derivation of a node, as a path back to the initial hypothesis.
+   *  Scores are relative to the best derivation of the node */
+  struct Derivation {
+    const Hypothesis *m_edge; //! hypothesis or arc
+    const Derivation *m_prev; //! derivation of m_edge->GetPrevHypo(), NULL for the initial hypothesis
+    size_t m_prevRank;
+    float m_delta; //! <= 0
+  };
+
+  //! finalHypos: surviving hypotheses of the last stack, best first
+  explicit NBestExtractor(const std::vector<const Hypothesis*> &finalHypos);
+  ~NBestExtractor();
+
+  /** next best derivation of a complete translation, or NULL if there are no more.
+   *  Its total score is GetTotalScore() of the final hypothesis plus m_delta */
+  const Derivation *Next();
+
+  //! edges of a derivation, from the initial to the final hypothesis as TrellisPath takes them
+  static void GetEdges(const Derivation &derivation, std::vector<const Hypothesis*> &edges);
+
+private:
+  struct Candidate {
+    const Hypothesis *m_edge;
+    size_t m_prevRank;
+    float m_score;
+  };
+
+  struct CandidateOrder {
+    bool operator()(const Candidate &a, const Candidate &b) const;
+  };
+
+  typedef std::priority_queue<Candidate, std::vector<Candidate>, CandidateOrder> CandidateHeap;
+
+  struct Node {
+    std::vector<const Derivation*> m_best; //! k-best derivations found so far
+    CandidateHeap m_candidates;
+  };
+
+  typedef boost::unordered_map<const Hypothesis*, Node*> NodeMap;
+
+  NodeMap m_nodes;
+  std::deque<Derivation> m_derivations; //! storage, addresses are stable
+  Node m_goal; //! whose edges are the final hypotheses
+
+  Node &GetNode(const Hypothesis *hypo);
+
+  //! k-th best derivation of the node of hypo (counting from 0), or NULL
+  const Derivation *GetDerivation(const Hypothesis *hypo, size_t k);
+
+  /** move the best candidate of node to its k-best list and queue its
+   *  successor. false if there are no candidates left */
+  bool PopCandidate(Node &node, bool goal);
+
+  //! score of an edge of node, relative to the best derivation of the node
+  static float EdgeDelta(const Hypothesis *edge);
+
+  // no copying
+  NBestExtractor(const NBestExtractor&);
+  NBestExtractor &operator=(const NBestExtractor&);
+};
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "DummyScoreProducers.h"
+#include "Hypothesis.h"
+#include "Manager.h"
+#include "NBestExtractor.h"
+#include "Sentence.h"
+#include "StaticData.h"
+#include "TranslationOption.h"
+#include "TranslationSystem.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(nbest_extractor)
+
+namespace
+{
+
+typedef vector<const Hypothesis*> Edges;
+
+/** A recombination graph over "a b c", with the score of each edge carried
+ *  by the unknown word penalty, as the search would leave it:
+ *
+ *  word 0: x (-1), y (-1.5) and x again (-1), recombined
+ *  words 0-1: z (-0.5) and z (-1) after the best of word 0, and "x z" (-2)
+ *    from the start, recombined
+ *  word 2: c (-1) and e (-1.5), recombined, and d (-1) on its own
+ *
+ *  so there are ties between edges, between derivations, and between the two
+ *  final hypotheses, and derivations with the same output
+ */
+class GraphFixture
+{
+public:
+  GraphFixture()
+    : m_system("mock", &m_wp, &m_uwp, &m_dist)
+    , m_manager(0, MakeSentence(m_sentence), Normal, &m_system) {
+    StaticData::InstanceNonConst().SetWeight(&m_uwp, 1.0f);
+    m_manager.ResetSentenceStats(m_sentence);
+    m_initial = Hypothesis::Create(m_manager, m_sentence, m_emptyTarget);
+    m_initial->SetWinningHypo(m_initial);
+
+    Hypothesis *x = Extend(m_initial, 0, 0, "x", -1.0f);
+    Hypothesis *y = Extend(m_initial, 0, 0, "y", -1.5f);
+    Hypothesis *x2 = Extend(m_initial, 0, 0, "x", -1.0f);
+    Recombine(x, y);
+    Recombine(x, x2);
+
+    Hypothesis *z = Extend(x, 1, 1, "z", -0.5f);
+    Hypothesis *z2 = Extend(x, 1, 1, "z", -1.0f);
+    Hypothesis *xz = Extend(m_initial, 0, 1, "x z", -2.0f);
+    Recombine(z, z2);
+    Recombine(z, xz);
+
+    Hypothesis *c = Extend(z, 2, 2, "c", -1.0f);
+    Hypothesis *e = Extend(z, 2, 2, "e", -1.5f);
+    Hypothesis *d = Extend(z, 2, 2, "d", -1.0f);
+    Recombine(c, e);
+
+    m_finalHypos.push_back(c);
+    m_finalHypos.push_back(d);
+  }
+
+  ~GraphFixture() {
+    // the winners, which delete their arcs
+    for (vector<Hypothesis*>::reverse_iterator iter = m_winners.rbegin(); iter != m_winners.rend(); ++iter) {
+      FREEHYPO(*iter);
+    }
+    FREEHYPO(m_initial);
+    RemoveAllInColl(m_transOpts);
+    StaticData::InstanceNonConst().SetWeight(&m_uwp, 0.0f);
+  }
+
+  //! every derivation of the final hypotheses, by brute force
+  void GetAllDerivations(map<Edges, float> &derivations) const {
+    for (size_t i = 0; i < m_finalHypos.size(); ++i) {
+      AddDerivations(m_finalHypos[i], derivations);
+    }
+  }
+
+  vector<const Hypothesis*> m_finalHypos;
+
+private:
+  static Sentence &MakeSentence(Sentence &sentence) {
+    stringstream in("a b c\n");
+    sentence.Read(in, vector<FactorType>(1, 0));
+    return sentence;
+  }
+
+  Hypothesis *Extend(Hypothesis *prevHypo, size_t startPos, size_t endPos, const string &target, float score) {
+    TargetPhrase targetPhrase;
+    targetPhrase.CreateFromString(vector<FactorType>(1, 0), target, "|");
+    targetPhrase.SetScore(&m_uwp, Scores(1, score));
+    m_transOpts.push_back(new TranslationOption(WordsRange(startPos, endPos), targetPhrase, m_sentence));
+
+    Hypothesis *hypo = Hypothesis::Create(*prevHypo, *m_transOpts.back(), NULL);
+    hypo->IncorporateTransOptScores();
+    hypo->CalculateFinalScore();
+    hypo->SetWinningHypo(hypo);
+    m_winners.push_back(hypo);
+    return hypo;
+  }
+
+  //! the loser becomes an arc of the winner
+  void Recombine(Hypothesis *winner, Hypothesis *loser) {
+    m_winners.erase(find(m_winners.begin(), m_winners.end(), loser));
+    winner->AddArc(loser);
+    loser->SetWinningHypo(winner);
+  }
+
+  //! the derivations of the node of hypo, each scored by the sum of its edges
+  static void AddDerivations(const Hypothesis *hypo, map<Edges, float> &derivations) {
+    Edges edges(1, hypo);
+    if (hypo->GetArcList()) {
+      edges.insert(edges.end(), hypo->GetArcList()->begin(), hypo->GetArcList()->end());
+    }
+    for (size_t i = 0; i < edges.size(); ++i) {
+      const Hypothesis *prevHypo = edges[i]->GetPrevHypo();
+      if (prevHypo == NULL) {
+        derivations[Edges(1, edges[i])] = 0.0f;
+        continue;
+      }
+      const float edgeScore = edges[i]->GetTotalScore() - prevHypo->GetTotalScore();
+      map<Edges, float> prevDerivations;
+      AddDerivations(prevHypo, prevDerivations);
+      for (map<Edges, float>::const_iterator iter = prevDerivations.begin(); iter != prevDerivations.end(); ++iter) {
+        Edges path(iter->first);
+        path.push_back(edges[i]);
+        derivations[path] = iter->second + edgeScore;
+      }
+    }
+  }
+
+  TargetPhrase m_emptyTarget;
+  Sentence m_sentence;
+  WordPenaltyProducer m_wp;
+  UnknownWordPenaltyProducer m_uwp;
+  DistortionScoreProducer m_dist;
+  TranslationSystem m_system;
+  Manager m_manager;
+  Hypothesis *m_initial;
+  vector<Hypothesis*> m_winners; //! hypotheses which are not arcs
+  vector<TranslationOption*> m_transOpts;
+};
+
+//! total score of a derivation of one of the final hypotheses
+float GetScore(const NBestExtractor::Derivation &derivation)
+{
+  return derivation.m_edge->GetWinningHypo()->GetTotalScore() + derivation.m_delta;
+}
+
+}
+
+BOOST_FIXTURE_TEST_CASE(same_as_exhaustive, GraphFixture)
+{
+  map<Edges, float> all;
+  GetAllDerivations(all);
+  // 3 derivations of word 0, 3 * 2 + 1 of words 0-1, and 7 * 2 + 7 in all
+  BOOST_REQUIRE_EQUAL(all.size(), 21);
+  vector<float> expectedScores;
+  for (map<Edges, float>::const_iterator iter = all.begin(); iter != all.end(); ++iter) {
+    expectedScores.push_back(iter->second);
+  }
+  sort(expectedScores.begin(), expectedScores.end(), greater<float>());
+
+  NBestExtractor extractor(m_finalHypos);
+  set<Edges> seen;
+  for (size_t k = 0; k < all.size(); ++k) {
+    const NBestExtractor::Derivation *derivation = extractor.Next();
+    BOOST_REQUIRE(derivation != NULL);
+    BOOST_CHECK_EQUAL(GetScore(*derivation), expectedScores[k]);
+
+    Edges edges;
+    NBestExtractor::GetEdges(*derivation, edges);
+    BOOST_CHECK(seen.insert(edges).second);
+    map<Edges, float>::const_iterator iter = all.find(edges);
+    BOOST_REQUIRE(iter != all.end());
+    BOOST_CHECK_EQUAL(iter->second, GetScore(*derivation));
+  }
+  BOOST_CHECK(extractor.Next() == NULL);
+}
+
+BOOST_FIXTURE_TEST_CASE(same_order_with_ties, GraphFixture)
+{
+  // ties come out in the same order whatever is asked for in between
+  NBestExtractor first(m_finalHypos), second(m_finalHypos);
+  vector<Edges> firstEdges;
+  for (const NBestExtractor::Derivation *derivation = first.Next(); derivation; derivation = first.Next()) {
+    firstEdges.push_back(Edges());
+    NBestExtractor::GetEdges(*derivation, firstEdges.back());
+  }
+  for (size_t k = 0; k < 5; ++k) {
+    Edges edges;
+    NBestExtractor::GetEdges(*second.Next(), edges);
+    BOOST_CHECK(edges == firstEdges[k]);
+  }
+  BOOST_REQUIRE_EQUAL(firstEdges.size(), 21);
+
+  // the best is the best edge all the way
+  BOOST_REQUIRE_EQUAL(firstEdges[0].size(), 4);
+  BOOST_CHECK_EQUAL(firstEdges[0][3]->GetTotalScore(), -2.5f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -80,6 +80,9 @@ Parameter::Parameter()
   AddParam("stack", "s", "maximum stack size for histogram pruning");
   AddParam("stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
   AddParam("threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam("search-threads", "number of threads which decode one sentence, scoring the hypotheses of a stack or filling the chart cells of a span width concurrently (default 1). The output doesn't change");
+  AddParam("loading-threads", "number of threads which parse a text phrase or rule table while it is loaded (defaults to the number of decoding threads)");
+  AddParam("task-order", "order in which queued sentences are translated by the threads: input (default) or shortest (shortest first)");
 	AddParam("translation-details", "T", "for each best hypothesis, report translation details to the given file");
 	AddParam("ttable-file", "location and properties of the translation tables");
 	AddParam("ttable-limit", "ttl", "maximum number of translation table entries per input phrase");
@@ -127,6 +130,7 @@ Parameter::Parameter()
   AddParam("clean-lm-cache", "clean language model caches after N translations (default N=1)");
   AddParam("use-persistent-cache", "cache translation options across sentences (default true)");
   AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
+  AddParam("persistent-cache-shards", "number of independently locked parts of the translation option cache (default 4 per thread)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
   AddParam("output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
   AddParam("time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
@@ -188,6 +192,7 @@ Parameter::Parameter()
   // Compact phrase table and reordering table.                                                                                  
   AddParam("minlexr-memory", "Load lexical reordering table in minlexr format into memory");                                          
   AddParam("minphr-memory", "Load phrase table in minphr format into memory");
+  AddParam("minphr-cache-size", "memory for decoded target phrases of minphr tables, in MB (default 64)");
 }
 
 Parameter::~Parameter()
@@ -0,0 +1,111 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "RuleTable/PhraseDictionaryFuzzyMatch.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace MosesTest
+{
+
+BOOST_AUTO_TEST_SUITE(phrase_dictionary_fuzzy_match)
+
+namespace
+{
+
+const unsigned int X = tmmt::ExtractedRule::NON_TERMINAL;
+
+class ScoringDictionary : public PhraseDictionaryFuzzyMatch
+{
+public:
+  static void Score(const vector<tmmt::ExtractedRule> &rules
+                    , vector<const tmmt::ExtractedRule*> &unique
+                    , vector<vector<float> > &scores) {
+    ScoreRules(rules, unique, scores);
+  }
+};
+
+tmmt::ExtractedRule MakeRule(unsigned int source0, unsigned int source1
+                             , tmmt::WORD_ID target0, tmmt::WORD_ID target1, int count)
+{
+  tmmt::ExtractedRule rule;
+  rule.source.push_back(source0);
+  rule.source.push_back(source1);
+  rule.target.push_back(target0);
+  rule.target.push_back(target1);
+  rule.count = count;
+  return rule;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(score_by_relative_frequency)
+{
+  vector<tmmt::ExtractedRule> rules;
+  rules.push_back(MakeRule(0, X, 7, X, 1));    // r0
+  rules.push_back(MakeRule(0, X, 8, X, 1));    // r1, same source
+  rules.push_back(MakeRule(0, X, 7, X, 2));    // r0 again, more frequent
+  rules.push_back(MakeRule(1, X, 7, X, 1));    // r2, same target as r0
+  rules.push_back(MakeRule(1, X, 8, X, 0));    // no count, ignored
+  rules[0].alignment.push_back(make_pair(1, 1));
+  rules[2].alignment.push_back(make_pair(0, 0));
+  rules[2].alignment.push_back(make_pair(1, 1));
+
+  vector<const tmmt::ExtractedRule*> unique;
+  vector<vector<float> > scores;
+  ScoringDictionary::Score(rules, unique, scores);
+
+  BOOST_REQUIRE_EQUAL(unique.size(), 3);
+  BOOST_REQUIRE_EQUAL(scores.size(), 3);
+  BOOST_CHECK(unique[0] == &rules[2]);
+  BOOST_CHECK(unique[1] == &rules[1]);
+  BOOST_CHECK(unique[2] == &rules[3]);
+
+  // count 3 of 4 for source 0 and of 4 for target 7
+  BOOST_CHECK_CLOSE(scores[0][0], 3.0f / 4, 1e-4);
+  BOOST_CHECK_CLOSE(scores[0][1], 3.0f / 4, 1e-4);
+  BOOST_CHECK_CLOSE(scores[1][0], 1.0f, 1e-4);
+  BOOST_CHECK_CLOSE(scores[1][1], 1.0f / 4, 1e-4);
+  BOOST_CHECK_CLOSE(scores[2][0], 1.0f / 4, 1e-4);
+  BOOST_CHECK_CLOSE(scores[2][1], 1.0f, 1e-4);
+  for (size_t i = 0; i < scores.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(scores[i].size(), 3);
+    BOOST_CHECK_CLOSE(scores[i][2], 2.718f, 1e-4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(no_rules)
+{
+  vector<tmmt::ExtractedRule> rules(1, MakeRule(0, 1, 7, 8, 0));
+  vector<const tmmt::ExtractedRule*> unique(1, &rules[0]);
+  vector<vector<float> > scores(1);
+  ScoringDictionary::Score(rules, unique, scores);
+  BOOST_CHECK(unique.empty());
+  BOOST_CHECK(scores.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -27,7 +27,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <memory>
 #include <sys/stat.h>
 #include <stdlib.h>
-#include "util/file_piece.hh"
 #include "util/tokenize_piece.hh"
 
 #include "PhraseDictionaryMemory.h"
@@ -39,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "WordsRange.h"
 #include "UserMessage.h"
 #include "SparsePhraseDictionaryFeature.h"
+#include "TableLoadPipeline.h"
 
 using namespace std;
 
@@ -58,43 +58,91 @@ template <class It> StringPiece GrabOrDie(It &it, const std::string &file, size_
 }
 } // namespace
 
-bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
-                                  , const std::vector<FactorType> &output
-                                  , const string &filePath
-                                  , const vector<float> &weight
-                                  , size_t tableLimit
-                                  , const LMList &languageModels
-                                  , float weightWP)
+/** Parses the lines of the table in blocks on several threads, and adds
+ * them to the trie in file order.
+ */
+class PhraseDictionaryMemory::Loader : public TableLoadPipeline
 {
-  const_cast<LMList&>(languageModels).InitializeBeforeSentenceProcessing();
-
-  const StaticData &staticData = StaticData::Instance();
+public:
+  Loader(PhraseDictionaryMemory &dictionary
+         , const std::vector<FactorType> &input
+         , const std::vector<FactorType> &output
+         , const std::string &filePath
+         , const std::vector<float> &weight
+         , const LMList &languageModels
+         , float weightWP)
+    : TableLoadPipeline(filePath, StaticData::Instance().GetLoadingThreadCount())
+    , m_dictionary(dictionary)
+    , m_input(input)
+    , m_output(output)
+    , m_weight(weight)
+    , m_languageModels(languageModels)
+    , m_weightWP(weightWP)
+    , m_numElement(NOT_FOUND)
+    , m_preSourceNode(NULL) {
+  }
 
-  m_tableLimit = tableLimit;
+protected:
+  struct Entry {
+    size_t lineNum;
+    size_t consumed; // fields of the line
+    StringPiece sourcePhraseString;
+    TargetPhrase *targetPhrase;
+  };
+
+  class Block : public TableLoadPipeline::Block
+  {
+  public:
+    std::vector<Entry> entries;
+    // of the entries, from the first with each source phrase string
+    std::vector<boost::shared_ptr<const Phrase> > sourcePhrases;
+
+    ~Block() {
+      for (size_t i = 0; i < entries.size(); ++i) {
+        delete entries[i].targetPhrase;
+      }
+    }
+  };
 
-  util::FilePiece inFile(filePath.c_str(), staticData.GetVerboseLevel() >= 1 ? &std::cerr : NULL);
+  TableLoadPipeline::Block *NewBlock() const {
+    return new Block();
+  }
 
-  size_t line_num = 0;
-  size_t numElement = NOT_FOUND; // 3=old format, 5=async format which include word alignment info
+  void Parse(TableLoadPipeline::Block &base) const;
+  void Merge(TableLoadPipeline::Block &base);
+
+private:
+  PhraseDictionaryMemory &m_dictionary;
+  const std::vector<FactorType> &m_input;
+  const std::vector<FactorType> &m_output;
+  const std::vector<float> &m_weight;
+  const LMList &m_languageModels;
+  float m_weightWP;
+
+  // only touched by Merge()
+  size_t m_numElement; // 3=old format, 5=async format which include word alignment info
+  TargetPhraseCollection *m_preSourceNode;
+  boost::shared_ptr<const Phrase> m_preSourcePhrase;
+  std::string m_preSourceString;
+};
+
+void PhraseDictionaryMemory::Loader::Parse(TableLoadPipeline::Block &base) const
+{
+  Block &block = static_cast<Block&>(base);
+  const StaticData &staticData = StaticData::Instance();
   const std::string& factorDelimiter = staticData.GetFactorDelimiter();
+  const std::string &filePath = GetFilePath();
+  const size_t numScoreComponent = m_dictionary.m_numScoreComponent;
 
-  Phrase sourcePhrase(0);
   std::vector<float> scv;
-  scv.reserve(m_numScoreComponent);
-
-  TargetPhraseCollection *preSourceNode = NULL;
-  std::string preSourceString;
-
-  while(true) {
-    ++line_num;
-    StringPiece line;
-    try {
-      line = inFile.ReadLine();
-    } catch (util::EndOfFileException &e) {
-      break;
-    }
+  scv.reserve(numScoreComponent);
+
+  const std::vector<StringPiece> &lines = block.GetLines();
+  block.entries.reserve(lines.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const size_t line_num = block.GetFirstLineNum() + i;
 
-    util::TokenIter<util::MultiCharacter> pipes(line, util::MultiCharacter("|||"));
+    util::TokenIter<util::MultiCharacter> pipes(lines[i], util::MultiCharacter("|||"));
     StringPiece sourcePhraseString(GrabOrDie(pipes, filePath, line_num));
     StringPiece targetPhraseString(GrabOrDie(pipes, filePath, line_num));
     StringPiece scoreString(GrabOrDie(pipes, filePath, line_num));
@@ -107,7 +155,7 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
  
     //target
     std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(Output));
-    targetPhrase->CreateFromString(output, targetPhraseString, factorDelimiter);
+    targetPhrase->CreateFromString(m_output, targetPhraseString, factorDelimiter);
 
     scv.clear();
     for (util::TokenIter<util::AnyCharacter, true> token(scoreString, util::AnyCharacter(" \t")); token; ++token) {
@@ -121,9 +169,9 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
         abort();
       }
     }
-    if (scv.size() != m_numScoreComponent) {
+    if (scv.size() != numScoreComponent) {
       stringstream strme;
-      strme << "Size of scoreVector != number (" <<scv.size() << "!=" <<m_numScoreComponent<<") of score components on line " << line_num;
+      strme << "Size of scoreVector != number (" <<scv.size() << "!=" <<numScoreComponent<<") of score components on line " << line_num;
       UserMessage::Add(strme.str());
       abort();
     }
@@ -141,7 +189,7 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
     if (pipes) {
       //sparse features
       SparsePhraseDictionaryFeature* spdf = 
-        GetFeature()->GetSparsePhraseDictionaryFeature();
+        m_dictionary.GetFeature()->GetSparsePhraseDictionaryFeature();
       if (spdf) {
         sparse.Assign(spdf,(pipes++)->as_string());
       }
@@ -149,35 +197,75 @@ bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
 
 
     // scv good to go sir!
-    targetPhrase->SetScore(m_feature, scv, sparse, weight, weightWP, languageModels);
+    targetPhrase->SetScore(m_dictionary.GetFeature(), scv, sparse, m_weight, m_weightWP, m_languageModels);
 
-    // Check number of entries delimited by ||| agrees across all lines.  
     for (; pipes; ++pipes, ++consumed) {}
-    if (numElement != consumed) {
-      if (numElement == NOT_FOUND) {
-        numElement = consumed;
+
+    // the translations of a source phrase are on consecutive lines, and
+    // share one copy of it
+    if (block.entries.empty() || block.entries.back().sourcePhraseString != sourcePhraseString) {
+      Phrase *sourcePhrase = new Phrase(0);
+      block.sourcePhrases.push_back(boost::shared_ptr<const Phrase>(sourcePhrase));
+      sourcePhrase->CreateFromString(m_input, sourcePhraseString, factorDelimiter);
+    }
+    targetPhrase->SetSourcePhrase(block.sourcePhrases.back());
+
+    Entry entry;
+    entry.lineNum = line_num;
+    entry.consumed = consumed;
+    entry.sourcePhraseString = sourcePhraseString;
+    entry.targetPhrase = targetPhrase.release();
+    block.entries.push_back(entry);
+  }
+}
+
+void PhraseDictionaryMemory::Loader::Merge(TableLoadPipeline::Block &base)
+{
+  Block &block = static_cast<Block&>(base);
+  for (size_t i = 0; i < block.entries.size(); ++i) {
+    Entry &entry = block.entries[i];
+
+    // Check number of entries delimited by ||| agrees across all lines.  
+    if (m_numElement != entry.consumed) {
+      if (m_numElement == NOT_FOUND) {
+        m_numElement = entry.consumed;
       } else {
         stringstream strme;
-        strme << "Syntax error at " << filePath << ":" << line_num;
+        strme << "Syntax error at " << GetFilePath() << ":" << entry.lineNum;
         UserMessage::Add(strme.str());
         abort();
       }
     }
 
-    //TODO: Would be better to reuse source phrases, but ownership has to be 
-    //consistent across phrase table implementations
-    sourcePhrase.Clear();
-    sourcePhrase.CreateFromString(input, sourcePhraseString, factorDelimiter);
-    //Now that the source phrase is ready, we give the target phrase a copy
-    targetPhrase->SetSourcePhrase(sourcePhrase);
-    if (preSourceString == sourcePhraseString && preSourceNode) {
-      preSourceNode->Add(targetPhrase.release());
+    TargetPhrase *targetPhrase = entry.targetPhrase;
+    entry.targetPhrase = NULL;
+    if (m_preSourceString == entry.sourcePhraseString && m_preSourceNode) {
+      // the source phrase may have started in an earlier block
+      targetPhrase->SetSourcePhrase(m_preSourcePhrase);
+      m_preSourceNode->Add(targetPhrase);
     } else {
-      preSourceNode = CreateTargetPhraseCollection(sourcePhrase);
-      preSourceNode->Add(targetPhrase.release());
-      preSourceString.assign(sourcePhraseString.data(), sourcePhraseString.size());
+      m_preSourceNode = m_dictionary.CreateTargetPhraseCollection(targetPhrase->GetSourcePhrase());
+      m_preSourceNode->Add(targetPhrase);
+      m_preSourcePhrase = targetPhrase->GetSourcePhrasePtr();
+      m_preSourceString.assign(entry.sourcePhraseString.data(), entry.sourcePhraseString.size());
     }
   }
+}
+
+bool PhraseDictionaryMemory::Load(const std::vector<FactorType> &input
+                                  , const std::vector<FactorType> &output
+                                  , const string &filePath
+                                  , const vector<float> &weight
+                                  , size_t tableLimit
+                                  , const LMList &languageModels
+                                  , float weightWP)
+{
+  const_cast<LMList&>(languageModels).InitializeBeforeSentenceProcessing();
+
+  m_tableLimit = tableLimit;
+
+  Loader loader(*this, input, output, filePath, weight, languageModels, weightWP);
+  loader.Run();
 
   // sort each target phrase collection
   m_collection.Sort(m_tableLimit);
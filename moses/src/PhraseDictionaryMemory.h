@@ -38,6 +38,8 @@ class PhraseDictionaryMemory : public PhraseDictionary
   friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryMemory&);
 
 protected:
+  class Loader;
+
   PhraseDictionaryNode m_collection;
 
   TargetPhraseCollection *CreateTargetPhraseCollection(const Phrase &source);
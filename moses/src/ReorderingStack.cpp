@@ -6,6 +6,7 @@
 
 #include "ReorderingStack.h"
 #include <vector>
+#include <boost/functional/hash.hpp>
 
 namespace Moses
 {
@@ -20,6 +21,11 @@ int ReorderingStack::Compare(const ReorderingStack& o)  const
   return 0;
 }
 
+size_t ReorderingStack::Hash() const
+{
+  return boost::hash_range(m_stack.begin(), m_stack.end());
+}
+
 // Method to push (shift element into the stack and reduce if reqd)
 int ReorderingStack::ShiftReduce(WordsRange input_span)
 {
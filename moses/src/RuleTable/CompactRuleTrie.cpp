@@ -0,0 +1,243 @@
+// $Id$
+
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2013 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+
+#include "util/check.hh"
+#include "RuleTable/CompactRuleTrie.h"
+#include "AlignmentInfo.h"
+#include "Phrase.h"
+#include "TargetPhrase.h"
+
+namespace Moses
+{
+
+namespace
+{
+
+struct RuleOrder {
+  template <class Rule> bool operator()(const Rule *a, const Rule *b) const {
+    return a->first < b->first;
+  }
+};
+
+}
+
+CompactRuleTrie::CompactRuleTrie()
+{
+  Clear();
+}
+
+void CompactRuleTrie::Clear()
+{
+  Node root = { 0, 0, 0, 0, NO_ID };
+  m_nodes.assign(1, root);
+  m_termKeys.clear();
+  m_termChildren.clear();
+  m_nonTermKeys.clear();
+  m_nonTermChildren.clear();
+  m_targetPhraseColls.clear();
+  m_terminalIds.clear();
+  m_terminals.clear();
+  m_labelIds.clear();
+  m_labels.clear();
+  m_rules.clear();
+}
+
+UINT32 CompactRuleTrie::GetOrCreateTerminalId(const Word &sourceTerm)
+{
+  std::pair<TerminalIdMap::iterator, bool> ret =
+    m_terminalIds.insert(std::make_pair(sourceTerm, (UINT32) m_terminals.size()));
+  if (ret.second) {
+    m_terminals.push_back(sourceTerm);
+  }
+  return ret.first->second;
+}
+
+UINT32 CompactRuleTrie::GetOrCreateLabelId(const Word &nonTerm)
+{
+  // as the old trie did, only the first factor of a label is relevant
+  std::pair<LabelIdMap::iterator, bool> ret =
+    m_labelIds.insert(std::make_pair(nonTerm[0], (UINT32) m_labels.size()));
+  if (ret.second) {
+    m_labels.push_back(nonTerm);
+  }
+  return ret.first->second;
+}
+
+UINT32 CompactRuleTrie::GetTerminalId(const Word &sourceTerm) const
+{
+  TerminalIdMap::const_iterator iter = m_terminalIds.find(sourceTerm);
+  return iter == m_terminalIds.end() ? NO_ID : iter->second;
+}
+
+UINT32 CompactRuleTrie::GetLabelId(const Word &nonTerm) const
+{
+  LabelIdMap::const_iterator iter = m_labelIds.find(nonTerm[0]);
+  return iter == m_labelIds.end() ? NO_ID : iter->second;
+}
+
+TargetPhraseCollection &CompactRuleTrie::GetOrCreateTargetPhraseCollection(const Phrase &source, const TargetPhrase &target)
+{
+  CHECK(m_nodes.size() == 1);
+
+  const size_t size = source.GetSize();
+  const AlignmentInfo &alignmentInfo = target.GetAlignmentInfo();
+  AlignmentInfo::const_iterator iterAlign = alignmentInfo.begin();
+
+  EdgeSeq edges(size);
+  for (size_t pos = 0 ; pos < size ; ++pos) {
+    const Word& word = source.GetWord(pos);
+
+    if (word.IsNonTerminal()) {
+      // indexed by source label 1st
+      CHECK(iterAlign != alignmentInfo.end());
+      CHECK(iterAlign->first == pos);
+      const Word &targetNonTerm = target.GetWord(iterAlign->second);
+      ++iterAlign;
+
+      edges[pos] = NON_TERMINAL | ((UINT64) GetOrCreateLabelId(word) << 32) | GetOrCreateLabelId(targetNonTerm);
+    } else {
+      edges[pos] = GetOrCreateTerminalId(word);
+    }
+  }
+
+  std::pair<RuleMap::iterator, bool> ret =
+    m_rules.insert(std::make_pair(edges, (UINT32) m_targetPhraseColls.size()));
+  if (ret.second) {
+    m_targetPhraseColls.push_back(TargetPhraseCollection());
+  }
+  return m_targetPhraseColls[ret.first->second];
+}
+
+void CompactRuleTrie::Build(size_t tableLimit)
+{
+  if (tableLimit) {
+    std::deque<TargetPhraseCollection>::iterator iter;
+    for (iter = m_targetPhraseColls.begin(); iter != m_targetPhraseColls.end(); ++iter) {
+      iter->Sort(true, tableLimit);
+    }
+  }
+
+  std::vector<const RuleMap::value_type*> rules;
+  rules.reserve(m_rules.size());
+  for (RuleMap::const_iterator iter = m_rules.begin(); iter != m_rules.end(); ++iter) {
+    rules.push_back(&*iter);
+  }
+  std::sort(rules.begin(), rules.end(), RuleOrder());
+
+  BuildNode(0, rules.begin(), rules.end(), 0);
+
+  RuleMap().swap(m_rules);
+}
+
+void CompactRuleTrie::BuildNode(UINT32 node, RuleIter begin, RuleIter end, size_t depth)
+{
+  // the rule ending here, if any, sorts first
+  if (begin != end && (*begin)->first.size() == depth) {
+    m_nodes[node].m_targetPhrases = (*begin)->second;
+    ++begin;
+  }
+
+  // one edge and child for each distinct next symbol. Terminals sort first
+  std::vector<RuleIter> groups;
+  for (RuleIter iter = begin; iter != end; ++iter) {
+    if (iter == begin || (*iter)->first[depth] != (*(iter - 1))->first[depth]) {
+      groups.push_back(iter);
+    }
+  }
+  groups.push_back(end);
+
+  const UINT32 firstChild = m_nodes.size();
+  m_nodes[node].m_termBegin = m_termKeys.size();
+  m_nodes[node].m_nonTermBegin = m_nonTermKeys.size();
+  for (size_t ind = 0; ind + 1 < groups.size(); ++ind) {
+    const UINT64 edge = (*groups[ind])->first[depth];
+    const UINT32 child = m_nodes.size();
+    Node childNode = { 0, 0, 0, 0, NO_ID };
+    m_nodes.push_back(childNode);
+    if (edge & NON_TERMINAL) {
+      m_nonTermKeys.push_back(edge & ~NON_TERMINAL);
+      m_nonTermChildren.push_back(child);
+    } else {
+      m_termKeys.push_back(edge);
+      m_termChildren.push_back(child);
+    }
+  }
+  m_nodes[node].m_termEnd = m_termKeys.size();
+  m_nodes[node].m_nonTermEnd = m_nonTermKeys.size();
+
+  for (size_t ind = 0; ind + 1 < groups.size(); ++ind) {
+    BuildNode(firstChild + ind, groups[ind], groups[ind + 1], depth + 1);
+  }
+}
+
+const CompactRuleTrie::Node *CompactRuleTrie::GetChild(const Node &node, UINT32 termId) const
+{
+  if (node.m_termBegin == node.m_termEnd) {
+    return NULL;
+  }
+  const UINT32 *begin = &m_termKeys[0] + node.m_termBegin;
+  const UINT32 *end = &m_termKeys[0] + node.m_termEnd;
+  const UINT32 *found = std::lower_bound(begin, end, termId);
+  if (found == end || *found != termId) {
+    return NULL;
+  }
+  return &m_nodes[m_termChildren[found - &m_termKeys[0]]];
+}
+
+const CompactRuleTrie::Node *CompactRuleTrie::GetChild(const Node &node, UINT32 sourceLabelId, UINT32 targetLabelId) const
+{
+  if (node.m_nonTermBegin == node.m_nonTermEnd) {
+    return NULL;
+  }
+  const UINT64 key = ((UINT64) sourceLabelId << 32) | targetLabelId;
+  const UINT64 *begin = &m_nonTermKeys[0] + node.m_nonTermBegin;
+  const UINT64 *end = &m_nonTermKeys[0] + node.m_nonTermEnd;
+  const UINT64 *found = std::lower_bound(begin, end, key);
+  if (found == end || *found != key) {
+    return NULL;
+  }
+  return &m_nodes[m_nonTermChildren[found - &m_nonTermKeys[0]]];
+}
+
+const CompactRuleTrie::Node &CompactRuleTrie::GetNonTerminalChild(const Node &node, size_t ind, const Word *&sourceLabel, const Word *&targetLabel) const
+{
+  const size_t edge = node.m_nonTermBegin + ind;
+  CHECK(edge < node.m_nonTermEnd);
+  const UINT64 key = m_nonTermKeys[edge];
+  sourceLabel = &m_labels[key >> 32];
+  targetLabel = &m_labels[key & 0xffffffff];
+  return m_nodes[m_nonTermChildren[edge]];
+}
+
+void CompactRuleTrie::GetRootWords(std::vector<const Word*> &words) const
+{
+  const Node &root = GetRootNode();
+  for (size_t ind = root.m_nonTermBegin; ind < root.m_nonTermEnd; ++ind) {
+    words.push_back(&m_labels[m_nonTermKeys[ind] >> 32]);
+  }
+  for (size_t ind = root.m_termBegin; ind < root.m_termEnd; ++ind) {
+    words.push_back(&m_terminals[m_termKeys[ind]]);
+  }
+}
+
+}
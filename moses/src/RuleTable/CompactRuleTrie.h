@@ -0,0 +1,145 @@
+// $Id$
+
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2013 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "TargetPhraseCollection.h"
+#include "Terminal.h"
+#include "TypeDef.h"
+#include "Word.h"
+
+namespace Moses
+{
+
+class Factor;
+class Phrase;
+class TargetPhrase;
+
+/** Source side prefix tree of a SCFG rule table, which is built in one go
+ * once all the rules have been added and can't be changed afterwards.
+ *
+ * Terminals are interned to integer ids, and non-terminal labels to label
+ * ids, so an edge is a single number. Each node has a range of terminal
+ * edges and a range of non-terminal edges (source label, target label),
+ * kept in a few flat arrays for the whole trie and sorted so that a child is
+ * found by binary search. The nodes themselves are in one array, with the
+ * children of a node next to each other. Target phrase collections are kept
+ * in one container and referred to by index.
+ *
+ * While loading, rules are collected by their sequence of edges in a hash
+ * table, which is freed when the trie is built.
+ */
+class CompactRuleTrie
+{
+public:
+  static const UINT32 NO_ID = (UINT32) -1;
+
+  struct Node {
+    UINT32 m_termBegin, m_termEnd; //! terminal edges
+    UINT32 m_nonTermBegin, m_nonTermEnd; //! non-terminal edges
+    UINT32 m_targetPhrases; //! index of the target phrase collection, or NO_ID
+
+    bool IsLeaf() const {
+      return m_termBegin == m_termEnd && m_nonTermBegin == m_nonTermEnd;
+    }
+    size_t GetNumNonTerminalChildren() const {
+      return m_nonTermEnd - m_nonTermBegin;
+    }
+  };
+
+  CompactRuleTrie();
+
+  /** collection for the rule with source side source, while loading.
+   *  Non-terminals are paired up with their target labels by the alignment of target */
+  TargetPhraseCollection &GetOrCreateTargetPhraseCollection(const Phrase &source, const TargetPhrase &target);
+
+  //! sort and prune the collections, and lay the trie out
+  void Build(size_t tableLimit);
+
+  //! remove all rules
+  void Clear();
+
+  const Node &GetRootNode() const {
+    return m_nodes[0];
+  }
+
+  //! id of a source terminal, NO_ID if it isn't in any rule
+  UINT32 GetTerminalId(const Word &sourceTerm) const;
+
+  //! id of a non-terminal label (source or target), NO_ID if it isn't in any rule
+  UINT32 GetLabelId(const Word &nonTerm) const;
+
+  //! child over a terminal id, or NULL
+  const Node *GetChild(const Node &node, UINT32 termId) const;
+
+  //! child over a non-terminal pair of label ids, or NULL
+  const Node *GetChild(const Node &node, UINT32 sourceLabelId, UINT32 targetLabelId) const;
+
+  //! ind-th non-terminal child of node, with its labels
+  const Node &GetNonTerminalChild(const Node &node, size_t ind, const Word *&sourceLabel, const Word *&targetLabel) const;
+
+  const TargetPhraseCollection *GetTargetPhraseCollection(const Node &node) const {
+    return node.m_targetPhrases == NO_ID ? NULL : &m_targetPhraseColls[node.m_targetPhrases];
+  }
+
+  //! terminals and source labels of the edges from the root, for printing
+  void GetRootWords(std::vector<const Word*> &words) const;
+
+private:
+  typedef boost::unordered_map<Word, UINT32, TerminalHasher, TerminalEqualityPred> TerminalIdMap;
+  typedef boost::unordered_map<const Factor*, UINT32> LabelIdMap;
+  typedef std::vector<UINT64> EdgeSeq;
+  typedef boost::unordered_map<EdgeSeq, UINT32> RuleMap;
+
+  // an edge is a terminal id, or NON_TERMINAL and the label ids in the two halves
+  static const UINT64 NON_TERMINAL = (UINT64) 1 << 63;
+
+  std::vector<Node> m_nodes;
+  std::vector<UINT32> m_termKeys, m_termChildren;
+  std::vector<UINT64> m_nonTermKeys;
+  std::vector<UINT32> m_nonTermChildren;
+  std::deque<TargetPhraseCollection> m_targetPhraseColls;
+
+  TerminalIdMap m_terminalIds;
+  std::vector<Word> m_terminals;
+  LabelIdMap m_labelIds;
+  std::vector<Word> m_labels;
+
+  RuleMap m_rules; //! while loading
+
+  UINT32 GetOrCreateTerminalId(const Word &sourceTerm);
+  UINT32 GetOrCreateLabelId(const Word &nonTerm);
+
+  //! fill in node, whose rules are [begin, end) of the sorted rules, all sharing depth edges
+  typedef std::vector<const RuleMap::value_type*>::const_iterator RuleIter;
+  void BuildNode(UINT32 node, RuleIter begin, RuleIter end, size_t depth);
+
+  // no copying
+  CompactRuleTrie(const CompactRuleTrie&);
+  CompactRuleTrie &operator=(const CompactRuleTrie&);
+};
+
+}
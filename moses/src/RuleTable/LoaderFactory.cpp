@@ -37,7 +37,7 @@ namespace Moses
 // Determines the rule table type by peeking inside the file then creates
 // a suitable RuleTableLoader object.
 std::auto_ptr<RuleTableLoader> RuleTableLoaderFactory::Create(
-    const std::string &path)
+    const std::string &path, size_t threads)
 {
   InputFileStream input(path);
   std::string line;
@@ -57,15 +57,15 @@ std::auto_ptr<RuleTableLoader> RuleTableLoaderFactory::Create(
     }
     else if (tokens[0] == "[X]" && tokens[1] == "|||") {
       return std::auto_ptr<RuleTableLoader>(new 
-          RuleTableLoaderHiero());
+          RuleTableLoaderHiero(threads));
       
     }
     
-    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderStandard());
+    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderStandard(threads));
   }
   else
   { // empty phrase table
-    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderStandard());
+    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderStandard(threads));
   }
 }
 
@@ -31,7 +31,9 @@ class RuleTableLoader;
 class RuleTableLoaderFactory
 {
  public:
-  static std::auto_ptr<RuleTableLoader> Create(const std::string &);
+  /** threads is the number of threads parsing a text rule table. Tables
+   *  loaded for each sentence are small, and are loaded on one */
+  static std::auto_ptr<RuleTableLoader> Create(const std::string &, size_t threads = 1);
 };
 
 }
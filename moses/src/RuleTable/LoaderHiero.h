@@ -17,6 +17,9 @@ namespace Moses {
 class RuleTableLoaderHiero : public RuleTableLoaderStandard
 {
 public:
+  explicit RuleTableLoaderHiero(size_t threads = 1)
+    : RuleTableLoaderStandard(threads) {}
+
   bool Load(const std::vector<FactorType> &input,
             const std::vector<FactorType> &output,
             const std::string &inFile,
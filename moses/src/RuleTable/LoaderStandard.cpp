@@ -36,7 +36,7 @@
 #include "UserMessage.h"
 #include "ChartTranslationOptionList.h"
 #include "FactorCollection.h"
-#include "util/file_piece.hh"
+#include "TableLoadPipeline.h"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
 
@@ -146,39 +146,87 @@ void ReformatHieroRule(const string &lineOrig, string &out)
   out = ret.str();
 }
   
-bool RuleTableLoaderStandard::Load(FormatType format
-                                , const std::vector<FactorType> &input
-                                , const std::vector<FactorType> &output
-                                , const std::string &inFile
-                                , const std::vector<float> &weight
-                                , size_t /* tableLimit */
-                                , const LMList &languageModels
-                                , const WordPenaltyProducer* wpProducer
-                                , RuleTableTrie &ruleTable)
+/** Parses the rules in blocks on several threads, and adds them to the
+ * rule table in file order.
+ */
+class RuleTableLoaderStandard::Pipeline : public TableLoadPipeline
 {
-  PrintUserTime(string("Start loading text SCFG phrase table. ") + (format==MosesFormat?"Moses ":"Hiero ") + " format");
+public:
+  Pipeline(RuleTableLoaderStandard &loader
+           , FormatType format
+           , const std::vector<FactorType> &input
+           , const std::vector<FactorType> &output
+           , const std::string &inFile
+           , const std::vector<float> &weight
+           , const LMList &languageModels
+           , const WordPenaltyProducer* wpProducer
+           , RuleTableTrie &ruleTable)
+    : TableLoadPipeline(inFile, loader.m_threads)
+    , m_loader(loader)
+    , m_format(format)
+    , m_input(input)
+    , m_output(output)
+    , m_weight(weight)
+    , m_languageModels(languageModels)
+    , m_wpProducer(wpProducer)
+    , m_ruleTable(ruleTable) {
+  }
 
-  const StaticData &staticData = StaticData::Instance();
-  const std::string& factorDelimiter = staticData.GetFactorDelimiter();
+protected:
+  struct Entry {
+    boost::shared_ptr<const Phrase> sourcePhrase;
+    Word sourceLHS;
+    TargetPhrase *targetPhrase;
+  };
+
+  class Block : public TableLoadPipeline::Block
+  {
+  public:
+    std::vector<Entry> entries;
 
-  string lineOrig;
-  size_t count = 0;
+    ~Block() {
+      for (size_t i = 0; i < entries.size(); ++i) {
+        delete entries[i].targetPhrase;
+      }
+    }
+  };
 
-  std::ostream *progress = NULL;
-  IFVERBOSE(1) progress = &std::cerr;
-  util::FilePiece in(inFile.c_str(), progress);
+  TableLoadPipeline::Block *NewBlock() const {
+    return new Block();
+  }
+
+  void Parse(TableLoadPipeline::Block &base) const;
+  void Merge(TableLoadPipeline::Block &base);
+
+private:
+  RuleTableLoaderStandard &m_loader;
+  FormatType m_format;
+  const std::vector<FactorType> &m_input;
+  const std::vector<FactorType> &m_output;
+  const std::vector<float> &m_weight;
+  const LMList &m_languageModels;
+  const WordPenaltyProducer* m_wpProducer;
+  RuleTableTrie &m_ruleTable;
+};
+
+void RuleTableLoaderStandard::Pipeline::Parse(TableLoadPipeline::Block &base) const
+{
+  Block &block = static_cast<Block&>(base);
+  const StaticData &staticData = StaticData::Instance();
+  const std::string& factorDelimiter = staticData.GetFactorDelimiter();
 
   // reused variables
   vector<float> scoreVector;
-  StringPiece line;
   std::string hiero_before, hiero_after;
+  std::string preSourceString;
 
-  while(true) {
-    try {
-      line = in.ReadLine();
-    } catch (const util::EndOfFileException &e) { break; }
+  const std::vector<StringPiece> &lines = block.GetLines();
+  block.entries.reserve(lines.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const size_t count = block.GetFirstLineNum() + i;
+    StringPiece line = lines[i];
 
-    if (format == HieroFormat) { // inefficiently reformat line
+    if (m_format == HieroFormat) { // inefficiently reformat line
       hiero_before.assign(line.data(), line.size());
       ReformatHieroRule(hiero_before, hiero_after);
       line = hiero_after;
@@ -194,14 +242,14 @@ bool RuleTableLoaderStandard::Load(FormatType format
     
     if (++pipes) {
       stringstream strme;
-      strme << "Syntax error at " << ruleTable.GetFilePath() << ":" << count;
+      strme << "Syntax error at " << m_ruleTable.GetFilePath() << ":" << count;
       UserMessage::Add(strme.str());
       abort();
     }
 
     bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
     if (isLHSEmpty && !staticData.IsWordDeletionEnabled()) {
-      TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
+      TRACE_ERR( m_ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
       continue;
     }
 
@@ -211,7 +259,7 @@ bool RuleTableLoaderStandard::Load(FormatType format
       scoreVector.push_back(strtod(s->data(), &err_ind));
       UTIL_THROW_IF(err_ind == s->data(), util::Exception, "Bad score " << *s << " on line " << count);
     }
-    const size_t numScoreComponents = ruleTable.GetFeature()->GetNumScoreComponents();
+    const size_t numScoreComponents = m_ruleTable.GetFeature()->GetNumScoreComponents();
     if (scoreVector.size() != numScoreComponents) {
       stringstream strme;
       strme << "Size of scoreVector != number (" << scoreVector.size() << "!="
@@ -223,16 +271,26 @@ bool RuleTableLoaderStandard::Load(FormatType format
     // parse source & find pt node
 
     // constituent labels
-    Word sourceLHS, targetLHS;
-
-    // source
-    Phrase sourcePhrase( 0);
-    sourcePhrase.CreateFromStringNewFormat(Input, input, sourcePhraseString, factorDelimiter, sourceLHS);
+    Word targetLHS;
+
+    // source. The rules of a source phrase are on consecutive lines, and
+    // share one copy of it
+    Entry entry;
+    if (block.entries.empty() || preSourceString != sourcePhraseString) {
+      Phrase *sourcePhrase = new Phrase(0);
+      entry.sourcePhrase.reset(sourcePhrase);
+      sourcePhrase->CreateFromStringNewFormat(Input, m_input, sourcePhraseString, factorDelimiter, entry.sourceLHS);
+      preSourceString.assign(sourcePhraseString.data(), sourcePhraseString.size());
+    } else {
+      entry.sourcePhrase = block.entries.back().sourcePhrase;
+      entry.sourceLHS = block.entries.back().sourceLHS;
+    }
+    const Phrase &sourcePhrase = *entry.sourcePhrase;
 
     // create target phrase obj
-    TargetPhrase *targetPhrase = new TargetPhrase(Output);
-    targetPhrase->CreateFromStringNewFormat(Output, output, targetPhraseString, factorDelimiter, targetLHS);
-    targetPhrase->SetSourcePhrase(sourcePhrase);
+    std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(Output));
+    targetPhrase->CreateFromStringNewFormat(Output, m_output, targetPhraseString, factorDelimiter, targetLHS);
+    targetPhrase->SetSourcePhrase(entry.sourcePhrase);
 
     // rest of target phrase
     targetPhrase->SetAlignmentInfo(alignString, sourcePhrase);
@@ -245,13 +303,40 @@ bool RuleTableLoaderStandard::Load(FormatType format
     std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),TransformScore);
     std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),FloorScore);
 
-    targetPhrase->SetScoreChart(ruleTable.GetFeature(), scoreVector, weight, languageModels,wpProducer);
+    targetPhrase->SetScoreChart(m_ruleTable.GetFeature(), scoreVector, m_weight, m_languageModels, m_wpProducer);
 
-    TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase, *targetPhrase, sourceLHS);
-    phraseColl.Add(targetPhrase);
+    entry.targetPhrase = targetPhrase.release();
+    block.entries.push_back(entry);
+  }
+}
 
-    count++;
+void RuleTableLoaderStandard::Pipeline::Merge(TableLoadPipeline::Block &base)
+{
+  Block &block = static_cast<Block&>(base);
+  for (size_t i = 0; i < block.entries.size(); ++i) {
+    Entry &entry = block.entries[i];
+    TargetPhrase *targetPhrase = entry.targetPhrase;
+    entry.targetPhrase = NULL;
+
+    TargetPhraseCollection &phraseColl = m_loader.GetOrCreateTargetPhraseCollection(m_ruleTable, *entry.sourcePhrase, *targetPhrase, entry.sourceLHS);
+    phraseColl.Add(targetPhrase);
   }
+}
+
+bool RuleTableLoaderStandard::Load(FormatType format
+                                , const std::vector<FactorType> &input
+                                , const std::vector<FactorType> &output
+                                , const std::string &inFile
+                                , const std::vector<float> &weight
+                                , size_t /* tableLimit */
+                                , const LMList &languageModels
+                                , const WordPenaltyProducer* wpProducer
+                                , RuleTableTrie &ruleTable)
+{
+  PrintUserTime(string("Start loading text SCFG phrase table. ") + (format==MosesFormat?"Moses ":"Hiero ") + " format");
+
+  Pipeline pipeline(*this, format, input, output, inFile, weight, languageModels, wpProducer, ruleTable);
+  pipeline.Run();
 
   // sort and prune each target phrase collection
   SortAndPrune(ruleTable);
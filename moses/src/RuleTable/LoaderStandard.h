@@ -28,6 +28,9 @@ namespace Moses
 class RuleTableLoaderStandard : public RuleTableLoader
 {
 protected:
+  class Pipeline;
+
+  size_t m_threads; //! parsing the table
 
   bool Load(FormatType format,
             const std::vector<FactorType> &input,
@@ -39,6 +42,9 @@ protected:
             const WordPenaltyProducer* wpProducer,
             RuleTableTrie &);
  public:
+  explicit RuleTableLoaderStandard(size_t threads = 1)
+    : m_threads(threads) {}
+
   bool Load(const std::vector<FactorType> &input,
             const std::vector<FactorType> &output,
             const std::string &inFile,
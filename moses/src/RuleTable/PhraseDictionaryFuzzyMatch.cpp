@@ -23,11 +23,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
-#include <sys/types.h>
-#include <unistd.h>
-#include <dirent.h>
 
 #include <fstream>
+#include <map>
+#include <set>
 #include <string>
 #include <iterator>
 #include <algorithm>
@@ -77,7 +76,14 @@ namespace Moses
     m_config = Tokenize(initStr, ";");
     assert(m_config.size() == 3);
 
-    m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2]);
+    if (GetFeature()->GetNumScoreComponents() != 3) {
+      UserMessage::Add("A fuzzy-match rule table has 3 scores: p(s|t), p(t|s) and the phrase penalty");
+      return false;
+    }
+
+    // the candidate matches of a sentence are evaluated by the search threads
+    m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2]
+                                                      , StaticData::Instance().GetSearchThreadCount());
     
     return true;
   }
@@ -90,185 +96,135 @@ namespace Moses
   }
     
   
-  int removedirectoryrecursively(const char *dirname)
+  void PhraseDictionaryFuzzyMatch::InitializeForInput(InputType const& inputSentence)
   {
-    DIR *dir;
-    struct dirent *entry;
-    char path[PATH_MAX];
-    
-    if (path == NULL) {
-      fprintf(stderr, "Out of memory error\n");
-      return 0;
+    // input words, without <s> and </s>
+    vector<string> input;
+    for (size_t i = 1; i + 1 < inputSentence.GetSize(); ++i) {
+      input.push_back(inputSentence.GetWord(i).GetString(*m_input, false));
     }
-    dir = opendir(dirname);
-    if (dir == NULL) {
-      perror("Error opendir()");
-      return 0;
+
+    vector<tmmt::ExtractedRule> rules;
+    m_FuzzyMatchWrapper->Extract(input, rules);
+
+    // populate with rules for this sentence. Other sentences only insert
+    // their own nodes, which leaves this one in place
+    PhraseDictionaryNodeSCFG *rootNode;
+    {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+      rootNode = &m_collection[inputSentence.GetTranslationId()];
     }
-    
-    while ((entry = readdir(dir)) != NULL) {
-      if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
-        snprintf(path, (size_t) PATH_MAX, "%s/%s", dirname, entry->d_name);
-        if (entry->d_type == DT_DIR) {
-          removedirectoryrecursively(path);
+    AddRules(*rootNode, inputSentence, rules);
+
+    // sort and prune each target phrase collection
+    SortAndPrune(*rootNode);
+  }
+
+  void PhraseDictionaryFuzzyMatch::ScoreRules(const vector<tmmt::ExtractedRule> &rules
+                                              , vector<const tmmt::ExtractedRule*> &unique
+                                              , vector<vector<float> > &scores)
+  {
+    typedef vector<unsigned int> SourceKey;
+    typedef vector<tmmt::WORD_ID> TargetKey;
+
+    // merge identical rules and count, as the extract file was scored
+    vector<float> counts, bestCounts;
+    map<pair<SourceKey, TargetKey>, size_t> ruleIndex;
+    map<SourceKey, float> sourceCounts;
+    map<TargetKey, float> targetCounts;
+    unique.clear();
+    for (size_t i = 0; i < rules.size(); ++i) {
+      const tmmt::ExtractedRule &rule = rules[i];
+      if (rule.count <= 0) {
+        continue;
+      }
+      pair<map<pair<SourceKey, TargetKey>, size_t>::iterator, bool> ret =
+        ruleIndex.insert(make_pair(make_pair(rule.source, rule.target), unique.size()));
+      if (ret.second) {
+        unique.push_back(&rule);
+        counts.push_back(rule.count);
+        bestCounts.push_back(rule.count);
+      } else {
+        // keep the alignment of the most frequent copy
+        size_t ind = ret.first->second;
+        counts[ind] += rule.count;
+        if (rule.count > bestCounts[ind]) {
+          unique[ind] = &rule;
+          bestCounts[ind] = rule.count;
         }
-        
-        remove(path);
-        /*
-         * Here, the actual deletion must be done.  Beacuse this is
-         * quite a dangerous thing to do, and this program is not very
-         * well tested, we are just printing as if we are deleting.
-         */
-        //printf("(not really) Deleting: %s\n", path);
-        /*
-         * When you are finished testing this and feel you are ready to do the real
-         * deleting, use this: remove*STUB*(path);
-         * (see "man 3 remove")
-         * Please note that I DONT TAKE RESPONSIBILITY for data you delete with this!
-         */
       }
-      
+      sourceCounts[rule.source] += rule.count;
+      targetCounts[rule.target] += rule.count;
+    }
+
+    // p(s|t), p(t|s) and the phrase penalty, as train-model.perl --NoLex scored them
+    scores.assign(unique.size(), vector<float>(3));
+    for (size_t i = 0; i < unique.size(); ++i) {
+      scores[i][0] = counts[i] / targetCounts[unique[i]->target];
+      scores[i][1] = counts[i] / sourceCounts[unique[i]->source];
+      scores[i][2] = 2.718;
     }
-    closedir(dir);
-    
-    rmdir(dirname);
-    /*
-     * Now the directory is emtpy, finally delete the directory itself. (Just
-     * printing here, see above) 
-     */
-    //printf("(not really) Deleting: %s\n", dirname);
-    
-    return 1;
   }
 
-  void PhraseDictionaryFuzzyMatch::InitializeForInput(InputType const& inputSentence)
+  void PhraseDictionaryFuzzyMatch::AddRules(PhraseDictionaryNodeSCFG &rootNode
+                                            , const InputType &inputSentence
+                                            , const vector<tmmt::ExtractedRule> &rules)
   {
-    char dirName[] = "/tmp/moses.XXXXXX";
-    char *temp = mkdtemp(dirName);
-    CHECK(temp);
-    string dirNameStr(dirName);
-    
-    string inFileName(dirNameStr + "/in");
-    
-    ofstream inFile(inFileName.c_str());
-    
-    for (size_t i = 1; i < inputSentence.GetSize() - 1; ++i)
-    {
-      inFile << inputSentence.GetWord(i);
-    }
-    inFile << endl;
-    inFile.close();
-        
-    string ptFileName = m_FuzzyMatchWrapper->Extract(dirNameStr);
+    vector<const tmmt::ExtractedRule*> unique;
+    vector<vector<float> > scores;
+    ScoreRules(rules, unique, scores);
 
-    // populate with rules for this sentence
-    long translationId = inputSentence.GetTranslationId();
+    Word sourceNonTerm, targetNonTerm;
+    sourceNonTerm.CreateFromString(Input, *m_input, "X", true);
+    targetNonTerm.CreateFromString(Output, *m_output, "X", true);
 
-    PhraseDictionaryNodeSCFG &rootNode = m_collection[translationId];
-    FormatType format = MosesFormat;
-        
-    // data from file
-    InputFileStream inStream(ptFileName);
-    
-    // copied from class LoaderStandard
-    PrintUserTime("Start loading fuzzy-match phrase model");
-    
-    const StaticData &staticData = StaticData::Instance();
-    const std::string& factorDelimiter = staticData.GetFactorDelimiter();
-    
-    
-    string lineOrig;
-    size_t count = 0;
-    
-    while(getline(inStream, lineOrig)) {
-      const string *line;
-      if (format == HieroFormat) { // reformat line
-        assert(false);
-        //line = ReformatHieroRule(lineOrig);
-      }
-      else
-      { // do nothing to format of line
-        line = &lineOrig;
+    for (size_t i = 0; i < unique.size(); ++i) {
+      const tmmt::ExtractedRule &rule = *unique[i];
+
+      // source, from the input words
+      Phrase sourcePhrase(rule.source.size());
+      for (size_t pos = 0; pos < rule.source.size(); ++pos) {
+        if (rule.source[pos] == tmmt::ExtractedRule::NON_TERMINAL) {
+          sourcePhrase.AddWord(sourceNonTerm);
+        } else {
+          sourcePhrase.AddWord(inputSentence.GetWord(rule.source[pos] + 1));
+        }
       }
-      
-      vector<string> tokens;
-      vector<float> scoreVector;
-      
-      TokenizeMultiCharSeparator(tokens, *line , "|||" );
-      
-      if (tokens.size() != 4 && tokens.size() != 5) {
-        stringstream strme;
-        strme << "Syntax error at " << ptFileName << ":" << count;
-        UserMessage::Add(strme.str());
-        abort();
+
+      TargetPhrase *targetPhrase = new TargetPhrase(Output);
+      for (size_t pos = 0; pos < rule.target.size(); ++pos) {
+        if (rule.target[pos] == tmmt::ExtractedRule::NON_TERMINAL) {
+          targetPhrase->AddWord(targetNonTerm);
+        } else {
+          targetPhrase->AddWord().CreateFromString(Output, *m_output, m_FuzzyMatchWrapper->GetWord(rule.target[pos]), false);
+        }
       }
-      
-      const string &sourcePhraseString = tokens[0]
-      , &targetPhraseString = tokens[1]
-      , &scoreString        = tokens[2]
-      , &alignString        = tokens[3];
-      
-      bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
-      if (isLHSEmpty && !staticData.IsWordDeletionEnabled()) {
-        TRACE_ERR( ptFileName << ":" << count << ": pt entry contains empty target, skipping\n");
-        continue;
+
+      set<pair<size_t, size_t> > alignment(rule.alignment.begin(), rule.alignment.end());
+      vector<int> indicator;
+      for (set<pair<size_t, size_t> >::const_iterator iter = alignment.begin(); iter != alignment.end(); ++iter) {
+        indicator.push_back(sourcePhrase.GetWord(iter->first).IsNonTerminal() ? 1 : 0);
       }
-      
-      Tokenize<float>(scoreVector, scoreString);
-      const size_t numScoreComponents = GetFeature()->GetNumScoreComponents();
-      if (scoreVector.size() != numScoreComponents) {
-        stringstream strme;
-        strme << "Size of scoreVector != number (" << scoreVector.size() << "!="
-        << numScoreComponents << ") of score components on line " << count;
-        UserMessage::Add(strme.str());
-        abort();
+      if (indicator.empty()) {
+        targetPhrase->SetAlignmentInfo(alignment);
+      } else {
+        targetPhrase->SetAlignmentInfo(alignment, &indicator[0]);
       }
-      CHECK(scoreVector.size() == numScoreComponents);
-      
-      // parse source & find pt node
-      
-      // constituent labels
-      Word sourceLHS, targetLHS;
-      
-      // source
-      Phrase sourcePhrase( 0);
-      sourcePhrase.CreateFromStringNewFormat(Input, *m_input, sourcePhraseString, factorDelimiter, sourceLHS);
-      
-      // create target phrase obj
-      TargetPhrase *targetPhrase = new TargetPhrase(Output);
-      targetPhrase->CreateFromStringNewFormat(Output, *m_output, targetPhraseString, factorDelimiter, targetLHS);
-      
-      // rest of target phrase
-      targetPhrase->SetAlignmentInfo(alignString);
-      targetPhrase->SetTargetLHS(targetLHS);
-      //targetPhrase->SetDebugOutput(string("New Format pt ") + line);
-      
-      // component score, for n-best output
+      targetPhrase->SetTargetLHS(targetNonTerm);
+
+      vector<float> &scoreVector = scores[i];
       std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),TransformScore);
       std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),FloorScore);
-      
+
       targetPhrase->SetScoreChart(GetFeature(), scoreVector, *m_weight, *m_languageModels, m_wpProducer);
-      
-      TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(rootNode, sourcePhrase, *targetPhrase, sourceLHS);
+
+      TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(rootNode, sourcePhrase, *targetPhrase, sourceNonTerm);
       phraseColl.Add(targetPhrase);
-      
-      count++;
-      
-      if (format == HieroFormat) { // reformat line
-        delete line;
-      }
-      else
-      { // do nothing
-      }
-      
     }
-    
-    // sort and prune each target phrase collection
-    SortAndPrune(rootNode);
-   
-    removedirectoryrecursively(dirName);
   }
-  
+
   TargetPhraseCollection &PhraseDictionaryFuzzyMatch::GetOrCreateTargetPhraseCollection(PhraseDictionaryNodeSCFG &rootNode
                                                                                   , const Phrase &source
                                                                                   , const TargetPhrase &target
@@ -283,7 +239,6 @@ namespace Moses
                                                                   , const TargetPhrase &target
                                                                   , const Word &sourceLHS)
   {
-    cerr << source << endl << target << endl;
     const size_t size = source.GetSize();
     
     const AlignmentInfo &alignmentInfo = target.GetAlignmentInfo();
@@ -329,11 +284,17 @@ namespace Moses
   
   void PhraseDictionaryFuzzyMatch::CleanUp(const InputType &source)
   {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
     m_collection.erase(source.GetTranslationId());
   }
 
   const PhraseDictionaryNodeSCFG &PhraseDictionaryFuzzyMatch::GetRootNode(const InputType &source) const 
   {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
     long transId = source.GetTranslationId();
     std::map<long, PhraseDictionaryNodeSCFG>::const_iterator iter = m_collection.find(transId);
     CHECK(iter != m_collection.end());
@@ -341,6 +302,9 @@ namespace Moses
   }
   PhraseDictionaryNodeSCFG &PhraseDictionaryFuzzyMatch::GetRootNode(const InputType &source) 
   {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
     long transId = source.GetTranslationId();
     std::map<long, PhraseDictionaryNodeSCFG>::iterator iter = m_collection.find(transId);
     CHECK(iter != m_collection.end());
@@ -19,6 +19,10 @@
 
 #pragma once
 
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 #include "PhraseDictionary.h"
 #include "PhraseDictionaryNodeSCFG.h"
 #include "PhraseDictionarySCFG.h"
@@ -84,7 +88,22 @@ namespace Moses
     void SortAndPrune(PhraseDictionaryNodeSCFG &rootNode);
     PhraseDictionaryNodeSCFG &GetRootNode(const InputType &source);
 
+    /** merge the identical rules extracted for a sentence, keeping the
+     *  alignment of the most frequent copy, and score each by relative
+     *  frequency: p(s|t), p(t|s) and the phrase penalty, as
+     *  train-model.perl --NoLex scores an extract file */
+    static void ScoreRules(const std::vector<tmmt::ExtractedRule> &rules
+                           , std::vector<const tmmt::ExtractedRule*> &unique
+                           , std::vector<std::vector<float> > &scores);
+
+    //! add the rules extracted for the sentence, scored by ScoreRules()
+    void AddRules(PhraseDictionaryNodeSCFG &rootNode, const InputType &inputSentence, const std::vector<tmmt::ExtractedRule> &rules);
+
     std::map<long, PhraseDictionaryNodeSCFG> m_collection;
+#ifdef WITH_THREADS
+    //! sentences are translated at the same time, so guard m_collection
+    mutable boost::shared_mutex m_accessLock;
+#endif
     std::vector<std::string> m_config;
     
     const std::vector<FactorType> *m_input, *m_output;
@@ -43,49 +43,9 @@ namespace Moses
 TargetPhraseCollection &PhraseDictionarySCFG::GetOrCreateTargetPhraseCollection(
                                                                                 const Phrase &source
                                                                                 , const TargetPhrase &target
-                                                                                , const Word &sourceLHS)
+                                                                                , const Word & /* sourceLHS */)
 {
-  PhraseDictionaryNodeSCFG &currNode = GetOrCreateNode(source, target, sourceLHS);
-  return currNode.GetOrCreateTargetPhraseCollection();
-}
-
-PhraseDictionaryNodeSCFG &PhraseDictionarySCFG::GetOrCreateNode(const Phrase &source
-                                                                , const TargetPhrase &target
-                                                                , const Word &sourceLHS)
-{
-  const size_t size = source.GetSize();
-
-  const AlignmentInfo &alignmentInfo = target.GetAlignmentInfo();
-  AlignmentInfo::const_iterator iterAlign = alignmentInfo.begin();
-
-  PhraseDictionaryNodeSCFG *currNode = &m_collection;
-  for (size_t pos = 0 ; pos < size ; ++pos) {
-    const Word& word = source.GetWord(pos);
-
-    if (word.IsNonTerminal()) {
-      // indexed by source label 1st
-      const Word &sourceNonTerm = word;
-
-      CHECK(iterAlign != target.GetAlignmentInfo().end());
-      CHECK(iterAlign->first == pos);
-      size_t targetNonTermInd = iterAlign->second;
-      ++iterAlign;
-      const Word &targetNonTerm = target.GetWord(targetNonTermInd);
-
-      currNode = currNode->GetOrCreateChild(sourceNonTerm, targetNonTerm);
-    } else {
-      currNode = currNode->GetOrCreateChild(word);
-    }
-
-    CHECK(currNode != NULL);
-  }
-  
-  // finally, the source LHS
-  //currNode = currNode->GetOrCreateChild(sourceLHS);
-  //CHECK(currNode != NULL);
-
-  
-  return *currNode;
+  return m_collection.GetOrCreateTargetPhraseCollection(source, target);
 }
 
 ChartRuleLookupManager *PhraseDictionarySCFG::CreateRuleLookupManager(
@@ -97,10 +57,7 @@ ChartRuleLookupManager *PhraseDictionarySCFG::CreateRuleLookupManager(
 
 void PhraseDictionarySCFG::SortAndPrune()
 {
-  if (GetTableLimit())
-  {
-    m_collection.Sort(GetTableLimit());
-  }
+  m_collection.Build(GetTableLimit());
 }
 
 TO_STRING_BODY(PhraseDictionarySCFG);
@@ -108,17 +65,10 @@ TO_STRING_BODY(PhraseDictionarySCFG);
 // friend
 ostream& operator<<(ostream& out, const PhraseDictionarySCFG& phraseDict)
 {
-  typedef PhraseDictionaryNodeSCFG::TerminalMap TermMap;
-  typedef PhraseDictionaryNodeSCFG::NonTerminalMap NonTermMap;
-
-  const PhraseDictionaryNodeSCFG &coll = phraseDict.m_collection;
-  for (NonTermMap::const_iterator p = coll.m_nonTermMap.begin(); p != coll.m_nonTermMap.end(); ++p) {
-    const Word &sourceNonTerm = p->first.first;
-    out << sourceNonTerm;
-  }
-  for (TermMap::const_iterator p = coll.m_sourceTermMap.begin(); p != coll.m_sourceTermMap.end(); ++p) {
-    const Word &sourceTerm = p->first;
-    out << sourceTerm;
+  std::vector<const Word*> words;
+  phraseDict.m_collection.GetRootWords(words);
+  for (std::vector<const Word*>::const_iterator p = words.begin(); p != words.end(); ++p) {
+    out << **p;
   }
   return out;
 }
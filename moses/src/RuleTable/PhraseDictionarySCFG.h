@@ -20,7 +20,7 @@
 #pragma once
 
 #include "PhraseDictionary.h"
-#include "PhraseDictionaryNodeSCFG.h"
+#include "RuleTable/CompactRuleTrie.h"
 #include "InputType.h"
 #include "NonTerminal.h"
 #include "RuleTable/Trie.h"
@@ -30,6 +30,7 @@ namespace Moses
 
 /** Implementation of a SCFG rule table in a trie.  Looking up a rule of
  * length n symbols requires n look-ups to find the TargetPhraseCollection.
+ * The trie is a CompactRuleTrie, which is laid out once the table is loaded.
  */
 class PhraseDictionarySCFG : public RuleTableTrie
 {
@@ -41,7 +42,7 @@ class PhraseDictionarySCFG : public RuleTableTrie
                        PhraseDictionaryFeature* feature)
       : RuleTableTrie(numScoreComponents, feature) {}
 
-  const PhraseDictionaryNodeSCFG &GetRootNode() const { return m_collection; }
+  const CompactRuleTrie &GetTrie() const { return m_collection; }
 
   ChartRuleLookupManager *CreateRuleLookupManager(
     const InputType &,
@@ -53,13 +54,9 @@ class PhraseDictionarySCFG : public RuleTableTrie
   TargetPhraseCollection &GetOrCreateTargetPhraseCollection(
       const Phrase &source, const TargetPhrase &target, const Word &sourceLHS);
 
-  PhraseDictionaryNodeSCFG &GetOrCreateNode(const Phrase &source
-                                            , const TargetPhrase &target
-                                            , const Word &sourceLHS);
-
   void SortAndPrune();
 
-  PhraseDictionaryNodeSCFG m_collection;
+  CompactRuleTrie m_collection;
 };
 
 }  // namespace Moses
@@ -22,6 +22,7 @@
 #include "InputFileStream.h"
 #include "RuleTable/Loader.h"
 #include "RuleTable/LoaderFactory.h"
+#include "StaticData.h"
 #include "Util.h"
 
 namespace Moses
@@ -44,7 +45,7 @@ bool RuleTableTrie::Load(const std::vector<FactorType> &input,
   m_tableLimit = tableLimit;
 
   std::auto_ptr<Moses::RuleTableLoader> loader =
-      Moses::RuleTableLoaderFactory::Create(filePath);
+      Moses::RuleTableLoaderFactory::Create(filePath, StaticData::Instance().GetLoadingThreadCount());
   if (!loader.get())
   {
     return false;
@@ -100,6 +100,10 @@ void SearchCubePruning::ProcessSentence()
       VERBOSE(1,"Decoding is out of time (" << _elapsed_time << "," << staticData.GetTimeoutThreshold() << ")" << std::endl);
       return;
     }
+    if (m_manager.IsCancelled()) {
+      VERBOSE(1,"Decoding was cancelled" << std::endl);
+      return;
+    }
     HypothesisStackCubePruning &sourceHypoColl = *static_cast<HypothesisStackCubePruning*>(*iterStack);
 
     // priority queue which has a single entry for each bitmap container, sorted by score of top hyp
@@ -1,11 +1,41 @@
 #include "Manager.h"
 #include "Timer.h"
 #include "SearchNormal.h"
+#include "SentenceArena.h"
 
 using namespace std;
 
 namespace Moses
 {
+
+#ifdef WITH_THREADS
+/** scores one slice of the pending hypotheses in a pool thread */
+class SearchNormal::ScoreTask : public Task
+{
+public:
+  ScoreTask(SearchNormal &search, size_t slice, size_t numSlices)
+    : m_search(search), m_slice(slice), m_numSlices(numSlices) {}
+
+  void Run() {
+    // feature functions keep some of the sentence specific data per thread
+    if (!m_search.m_threadInitialized.get()) {
+      m_search.m_manager.GetTranslationSystem()->InitializeSearchThread(m_search.m_source);
+      m_search.m_threadInitialized.reset(new bool(true));
+    }
+    m_search.ScoreSlice(m_slice, m_numSlices);
+
+    boost::mutex::scoped_lock lock(m_search.m_scoreMutex);
+    if (--m_search.m_scoreTasks == 0) {
+      m_search.m_scoreDone.notify_all();
+    }
+  }
+
+private:
+  SearchNormal &m_search;
+  size_t m_slice, m_numSlices;
+};
+#endif
+
 /**
  * Organizing main function
  *
@@ -20,6 +50,10 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
   ,m_start(clock())
   ,interrupted_flag(0)
   ,m_transOptColl(transOptColl)
+  ,m_searchThreads(1)
+#ifdef WITH_THREADS
+  ,m_scoreTasks(0)
+#endif
 {
   VERBOSE(1, "Translating: " << m_source << endl);
   const StaticData &staticData = StaticData::Instance();
@@ -44,11 +78,28 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
 
     m_hypoStackColl[ind] = sourceHypoColl;
   }
+
+#ifdef WITH_THREADS
+  // hypotheses can only be scored out of order if their creation doesn't
+  // depend on the stacks, as it does with early discarding. The detailed
+  // timing statistics aren't collected from several threads
+  if (staticData.GetSearchThreadCount() > 1 && !staticData.UseEarlyDiscarding()
+      && staticData.GetVerboseLevel() < 2) {
+    m_searchThreads = staticData.GetSearchThreadCount();
+  }
+#endif
 }
 
 SearchNormal::~SearchNormal()
 {
+#ifdef WITH_THREADS
+  m_threadPool.reset();
+#endif
   RemoveAllInColl(m_hypoStackColl);
+#ifdef WITH_THREADS
+  // after the hypotheses, which have feature function states from these
+  RemoveAllInColl(m_threadArenas);
+#endif
 }
 
 /**
@@ -75,6 +126,11 @@ void SearchNormal::ProcessSentence()
       interrupted_flag = 1;
       return;
     }
+    if (m_manager.IsCancelled()) {
+      VERBOSE(1,"Decoding was cancelled" << std::endl);
+      interrupted_flag = 1;
+      return;
+    }
     HypothesisStackNormal &sourceHypoColl = *static_cast<HypothesisStackNormal*>(*iterStack);
 
     // the stack is pruned before processing (lazy pruning):
@@ -94,7 +150,11 @@ void SearchNormal::ProcessSentence()
     for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
       Hypothesis &hypothesis = **iterHypo;
       ProcessOneHypothesis(hypothesis); // expand the hypothesis
+      if (m_pending.size() >= 256 * m_searchThreads) {
+        ScorePending();
+      }
     }
+    ScorePending();
     // some logging
     IFVERBOSE(2) {
       OutputHypoStackSize();
@@ -302,6 +362,11 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
       stats.AddTimeBuildHyp( clock()-t );
     }
     if (newHypo==NULL) return;
+    if (m_searchThreads > 1) {
+      // scored and added to the stack by ScorePending()
+      m_pending.push_back(newHypo);
+      return;
+    }
     newHypo->CalcScore(m_transOptColl.GetFutureScore());
   } else
     // early discarding: check if hypothesis is too bad to build
@@ -354,6 +419,14 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
 
   }
 
+  AddToStack(newHypo);
+}
+
+void SearchNormal::AddToStack(Hypothesis *newHypo)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  clock_t t=0; // used to track time for steps
+
   // logging for the curious
   IFVERBOSE(3) {
     newHypo->PrintHypothesis();
@@ -370,6 +443,51 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
   }
 }
 
+void SearchNormal::ScorePending()
+{
+  if (m_pending.empty()) return;
+
+#ifdef WITH_THREADS
+  if (!m_threadPool) {
+    m_threadPool.reset(new ThreadPool(m_searchThreads - 1));
+    for (size_t i = 0; i < m_searchThreads; ++i) {
+      m_threadArenas.push_back(new SentenceArena());
+    }
+  }
+  {
+    boost::mutex::scoped_lock lock(m_scoreMutex);
+    m_scoreTasks = m_searchThreads - 1;
+  }
+  for (size_t slice = 1; slice < m_searchThreads; ++slice) {
+    m_threadPool->Submit(new ScoreTask(*this, slice, m_searchThreads));
+  }
+  ScoreSlice(0, m_searchThreads);
+  {
+    boost::mutex::scoped_lock lock(m_scoreMutex);
+    while (m_scoreTasks > 0) {
+      m_scoreDone.wait(lock);
+    }
+  }
+#endif
+
+  // in the order they were created, as the single threaded search would
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    AddToStack(m_pending[i]);
+  }
+  m_pending.clear();
+}
+
+void SearchNormal::ScoreSlice(size_t slice, size_t numSlices)
+{
+#ifdef WITH_THREADS
+  SentenceArena::Scope arenaScope(*m_threadArenas[slice]);
+#endif
+  // interleaved, as the hypotheses of one source span tend to cost the same
+  for (size_t i = slice; i < m_pending.size(); i += numSlices) {
+    m_pending[i]->CalcScore(m_transOptColl.GetFutureScore());
+  }
+}
+
 const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() const
 {
   return m_hypoStackColl;
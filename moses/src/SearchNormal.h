@@ -7,12 +7,19 @@
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
 
+#ifdef WITH_THREADS
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include "ThreadPool.h"
+#endif
+
 namespace Moses
 {
 
 class Manager;
 class InputType;
 class TranslationOptionCollection;
+class SentenceArena;
 
 /** Functions and variables you need to decoder an input using the phrase-based decoder (NO cube-pruning)
  *  Instantiated by the Manager class
@@ -29,10 +36,31 @@ protected:
   HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  /** With several search threads, new hypotheses are created in order but
+   *  not scored. Batches of them are then scored in parallel, and added to
+   *  the stacks in the order they were created, so the result is the same
+   *  as with one thread */
+  size_t m_searchThreads;
+  std::vector<Hypothesis*> m_pending; /**< created, but not yet scored */
+#ifdef WITH_THREADS
+  class ScoreTask;
+  friend class ScoreTask;
+  std::vector<SentenceArena*> m_threadArenas; /**< one per slice of a batch, for the states of the feature functions */
+  boost::thread_specific_ptr<bool> m_threadInitialized; /**< whether a pool thread has been initialized for the sentence */
+  boost::scoped_ptr<ThreadPool> m_threadPool;
+  boost::mutex m_scoreMutex;
+  boost::condition_variable m_scoreDone;
+  size_t m_scoreTasks; /**< number of ScoreTasks still running */
+#endif
+
   // functions for creating hypotheses
   void ProcessOneHypothesis(const Hypothesis &hypothesis);
   void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
   virtual void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore);
+  void AddToStack(Hypothesis *hypo);
+  //! score the pending hypotheses in parallel, and add them to the stacks
+  void ScorePending();
+  void ScoreSlice(size_t slice, size_t numSlices);
 
 public:
   SearchNormal(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl);
@@ -15,7 +15,7 @@ SearchNormalBatch::SearchNormalBatch(Manager& manager, const InputType &source,
   m_max_stack_size = StaticData::Instance().GetMaxHypoStackSize();
 
   // Split the feature functions into sets of stateless, stateful
-  // distributed lm, and stateful non-distributed.
+  // distributed lm, other lms, and other stateful.
   const vector<const StatefulFeatureFunction*>& ffs =
          m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
@@ -23,11 +23,21 @@ SearchNormalBatch::SearchNormalBatch(Manager& manager, const InputType &source,
           m_dlm_ffs[i] = const_cast<LanguageModel*>(static_cast<const LanguageModel* const>(ffs[i]));
           m_dlm_ffs[i]->SetFFStateIdx(i);
       }
+      else if (const LanguageModel *lm = dynamic_cast<const LanguageModel*>(ffs[i])) {
+          m_batch_lm_ffs[i] = lm;
+      }
       else {
           m_stateful_ffs[i] = const_cast<StatefulFeatureFunction*>(ffs[i]);
       }
   }
-  m_stateless_ffs = const_cast< vector<const StatelessFeatureFunction*>& >(m_manager.GetTranslationSystem()->GetStatelessFeatureFunctions());
+  // as in Hypothesis::CalcScore, the features cached in the translation
+  // options (the phrase tables among them) are not evaluated again
+  const vector<const StatelessFeatureFunction*> &sfs = m_manager.GetTranslationSystem()->GetStatelessFeatureFunctions();
+  for (size_t i = 0; i < sfs.size(); ++i) {
+    if (!sfs[i]->ComputeValueInTranslationOption()) {
+      m_stateless_ffs.push_back(sfs[i]);
+    }
+  }
  
 }
 
@@ -58,6 +68,11 @@ void SearchNormalBatch::ProcessSentence()
       interrupted_flag = 1;
       return;
     }
+    if (m_manager.IsCancelled()) {
+      VERBOSE(1,"Decoding was cancelled" << std::endl);
+      interrupted_flag = 1;
+      return;
+    }
     HypothesisStackNormal &sourceHypoColl = *static_cast<HypothesisStackNormal*>(*iterStack);
 
     // the stack is pruned before processing (lazy pruning):
@@ -176,6 +191,14 @@ void SearchNormalBatch::EvalAndMergePartialHypos() {
         hypo->CalculateFutureScore(m_transOptColl.GetFutureScore());
     }
 
+    // Evaluate the non-distributed LMs over the whole batch.
+    std::map<int, const LanguageModel*>::iterator lm_iter;
+    for (lm_iter = m_batch_lm_ffs.begin();
+         lm_iter != m_batch_lm_ffs.end();
+         ++lm_iter) {
+        Hypothesis::EvaluateWith((*lm_iter).second, (*lm_iter).first, m_partial_hypos);
+    }
+
     // Wait for all requests from the distributed LM to come back.
     std::map<int, LanguageModel*>::iterator dlm_iter;
     for (dlm_iter = m_dlm_ffs.begin();
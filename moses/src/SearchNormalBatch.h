@@ -13,6 +13,8 @@ class TranslationOptionCollection;
 /** Implements the phrase-based stack decoding algorithm (no cube pruning) with a twist...
  *  Language model requests are batched together, duplicate requests are removed, and requests are sent together.
  *  Useful for distributed LM where network latency is an issue.
+ *  Other language models are evaluated over the whole batch at once, which
+ *  lets e.g. KenLM look up requests shared by several hypotheses only once.
  */  
 class SearchNormalBatch: public SearchNormal
 {
@@ -21,6 +23,7 @@ protected:
   // Added for asynclm decoding.
   std::vector<const StatelessFeatureFunction*> m_stateless_ffs;
   std::map<int, LanguageModel*> m_dlm_ffs;
+  std::map<int, const LanguageModel*> m_batch_lm_ffs;
   std::map<int, StatefulFeatureFunction*> m_stateful_ffs;  
   std::vector<Hypothesis*> m_partial_hypos;
   int m_batch_size;
@@ -0,0 +1,138 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "SentenceArena.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Moses
+{
+
+namespace
+{
+// each block starts with a pointer to the arena which owns it
+const std::size_t HEADER = sizeof(SentenceArena*);
+
+#ifdef WITH_THREADS
+// the arena isn't owned by the thread, so don't delete it at thread exit
+void NoCleanup(SentenceArena *) {}
+boost::thread_specific_ptr<SentenceArena> s_current(&NoCleanup);
+#else
+SentenceArena *s_current = NULL;
+#endif
+}
+
+const std::size_t SentenceArena::ALIGN;
+const std::size_t SentenceArena::MAX_POOLED;
+
+SentenceArena::SentenceArena()
+  : m_free(MAX_POOLED / ALIGN + 1, NULL)
+  , m_reserved(0)
+{}
+
+SentenceArena::~SentenceArena()
+{
+  // m_pool frees everything
+}
+
+void *SentenceArena::Allocate(std::size_t size)
+{
+  const std::size_t total = (size + HEADER + ALIGN - 1) / ALIGN * ALIGN;
+  void **block;
+  if (total > MAX_POOLED) {
+    block = static_cast<void**>(::operator new(total));
+    *block = NULL;
+    return block + 1;
+  }
+
+  void *&head = m_free[total / ALIGN];
+  if (head != NULL) {
+    block = static_cast<void**>(head);
+    head = *block;
+  } else {
+    block = static_cast<void**>(m_pool.Allocate(total));
+    m_reserved += total;
+  }
+  *block = this;
+  return block + 1;
+}
+
+void SentenceArena::Free(void *ptr, std::size_t size)
+{
+  if (ptr == NULL) return;
+  void **block = static_cast<void**>(ptr) - 1;
+  SentenceArena *owner = static_cast<SentenceArena*>(*block);
+  if (owner == NULL) {
+    ::operator delete(block);
+  } else {
+    owner->Release(block, (size + HEADER + ALIGN - 1) / ALIGN * ALIGN);
+  }
+}
+
+void SentenceArena::Release(void *block, std::size_t total)
+{
+  void *&head = m_free[total / ALIGN];
+  *static_cast<void**>(block) = head;
+  head = block;
+}
+
+void *SentenceArena::AllocateCurrent(std::size_t size)
+{
+  SentenceArena *arena = GetCurrent();
+  if (arena != NULL) return arena->Allocate(size);
+
+  void **block = static_cast<void**>(::operator new(size + HEADER));
+  *block = NULL;
+  return block + 1;
+}
+
+SentenceArena *SentenceArena::GetCurrent()
+{
+#ifdef WITH_THREADS
+  return s_current.get();
+#else
+  return s_current;
+#endif
+}
+
+void SentenceArena::SetCurrent(SentenceArena *arena)
+{
+#ifdef WITH_THREADS
+  s_current.reset(arena);
+#else
+  s_current = arena;
+#endif
+}
+
+SentenceArena::Scope::Scope(SentenceArena &arena)
+  : m_previous(GetCurrent())
+{
+  SetCurrent(&arena);
+}
+
+SentenceArena::Scope::~Scope()
+{
+  SetCurrent(m_previous);
+}
+
+}
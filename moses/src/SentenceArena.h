@@ -0,0 +1,170 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SentenceArena_h
+#define moses_SentenceArena_h
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "util/pool.hh"
+
+namespace Moses
+{
+
+/** Memory for the search-time objects of one sentence (hypotheses, feature
+ * function states, score breakdowns, arc lists).
+ *
+ * Blocks are carved out of a util::Pool, so that the arena never shares a
+ * lock with other threads, and are all given back to the system at once when
+ * the arena is destroyed. Freed blocks go to a free list per size class and
+ * are reused by later allocations of the same size, so the arena doesn't
+ * grow with the number of hypotheses created, only with the number alive.
+ *
+ * An arena must only be used by one thread at a time, and has to outlive
+ * every object allocated from it. Each block is preceded by a pointer to its
+ * arena, so that Free() works on any block, including those which fell back
+ * to the heap because they were too large or because no arena was current.
+ */
+class SentenceArena
+{
+public:
+  SentenceArena();
+  ~SentenceArena();
+
+  //! memory for size bytes, aligned like a pointer
+  void *Allocate(std::size_t size);
+
+  /** give back memory from Allocate() or AllocateCurrent().
+   *  size must be the size that was asked for */
+  static void Free(void *ptr, std::size_t size);
+
+  //! destroy and free an object constructed in memory from an arena
+  template <class T> static void Destroy(T *obj) {
+    if (obj == NULL) return;
+    obj->~T();
+    Free(obj, sizeof(T));
+  }
+
+  //! allocate from the arena current in this thread, or the heap if there is none
+  static void *AllocateCurrent(std::size_t size);
+
+  /** makes an arena current in this thread for the lifetime of the scope,
+   *  so that classes with an operator new based on AllocateCurrent() (such
+   *  as FFState) are allocated from it */
+  class Scope
+  {
+  public:
+    explicit Scope(SentenceArena &arena);
+    ~Scope();
+  private:
+    SentenceArena *m_previous;
+  };
+
+  //! number of bytes taken from the system
+  std::size_t GetBytesReserved() const {
+    return m_reserved;
+  }
+
+private:
+  static const std::size_t ALIGN = sizeof(void*);
+  //! larger blocks come from the heap
+  static const std::size_t MAX_POOLED = 1024;
+
+  util::Pool m_pool;
+  std::vector<void*> m_free; //! free list per size class, linked through the blocks
+  std::size_t m_reserved;
+
+  static SentenceArena *GetCurrent();
+  static void SetCurrent(SentenceArena *arena);
+
+  void Release(void *block, std::size_t total);
+
+  // no copying
+  SentenceArena(const SentenceArena&);
+  SentenceArena &operator=(const SentenceArena&);
+};
+
+/** STL allocator taking memory from a SentenceArena, e.g. for arc lists */
+template <class T> class SentenceArenaAllocator
+{
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <class U> struct rebind {
+    typedef SentenceArenaAllocator<U> other;
+  };
+
+  //! NULL arena allocates from the heap
+  explicit SentenceArenaAllocator(SentenceArena *arena = NULL) : m_arena(arena) {}
+  template <class U> SentenceArenaAllocator(const SentenceArenaAllocator<U> &other)
+    : m_arena(other.GetArena()) {}
+
+  pointer allocate(size_type n, const void * = 0) {
+    const std::size_t size = n * sizeof(T);
+    return static_cast<pointer>(m_arena ? m_arena->Allocate(size) : SentenceArena::AllocateCurrent(size));
+  }
+  void deallocate(pointer p, size_type n) {
+    SentenceArena::Free(p, n * sizeof(T));
+  }
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+  void construct(pointer p, const T &val) {
+    new (p) T(val);
+  }
+  void destroy(pointer p) {
+    p->~T();
+  }
+  pointer address(reference x) const {
+    return &x;
+  }
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  SentenceArena *GetArena() const {
+    return m_arena;
+  }
+
+  // any allocator can free memory from any other
+  template <class U> bool operator==(const SentenceArenaAllocator<U> &) const {
+    return true;
+  }
+  template <class U> bool operator!=(const SentenceArenaAllocator<U> &) const {
+    return false;
+  }
+
+private:
+  SentenceArena *m_arena;
+};
+
+}
+
+#endif
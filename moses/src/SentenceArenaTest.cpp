@@ -0,0 +1,80 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "SentenceArena.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(sentence_arena)
+
+BOOST_AUTO_TEST_CASE(reuse_freed_blocks)
+{
+  SentenceArena arena;
+  void *a = arena.Allocate(40);
+  void *b = arena.Allocate(40);
+  BOOST_CHECK(a != b);
+  const size_t reserved = arena.GetBytesReserved();
+
+  SentenceArena::Free(a, 40);
+  BOOST_CHECK_EQUAL(arena.Allocate(40), a);
+  BOOST_CHECK_EQUAL(arena.GetBytesReserved(), reserved);
+}
+
+BOOST_AUTO_TEST_CASE(large_blocks_from_heap)
+{
+  SentenceArena arena;
+  void *big = arena.Allocate(100000);
+  BOOST_CHECK_EQUAL(arena.GetBytesReserved(), 0);
+  SentenceArena::Free(big, 100000);
+}
+
+BOOST_AUTO_TEST_CASE(current_arena)
+{
+  // no arena is current, so this comes from the heap
+  void *heap = SentenceArena::AllocateCurrent(16);
+  SentenceArena::Free(heap, 16);
+
+  SentenceArena arena;
+  {
+    SentenceArena::Scope scope(arena);
+    void *ptr = SentenceArena::AllocateCurrent(16);
+    BOOST_CHECK(arena.GetBytesReserved() > 0);
+    SentenceArena::Free(ptr, 16);
+  }
+  const size_t reserved = arena.GetBytesReserved();
+  SentenceArena::Free(SentenceArena::AllocateCurrent(16), 16);
+  BOOST_CHECK_EQUAL(arena.GetBytesReserved(), reserved);
+}
+
+BOOST_AUTO_TEST_CASE(stl_allocator)
+{
+  SentenceArena arena;
+  vector<int, SentenceArenaAllocator<int> > coll((SentenceArenaAllocator<int>(&arena)));
+  for (int i = 0; i < 1000; ++i) coll.push_back(i);
+  BOOST_CHECK_EQUAL(coll[999], 999);
+  BOOST_CHECK(arena.GetBytesReserved() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
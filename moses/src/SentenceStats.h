@@ -156,6 +156,15 @@ public:
     m_numHyposDiscarded++;
   }
 
+  //! add the hypothesis counts of stats collected separately, e.g. in another thread
+  void AddCounts(const SentenceStats &other) {
+    m_numHyposCreated += other.m_numHyposCreated;
+    m_numHyposPruned += other.m_numHyposPruned;
+    m_numHyposDiscarded += other.m_numHyposDiscarded;
+    m_numHyposEarlyDiscarded += other.m_numHyposEarlyDiscarded;
+    m_numHyposNotBuilt += other.m_numHyposNotBuilt;
+  }
+
   void AddTimeCollectOpts( clock_t t ) {
     m_timeCollectOpts += t;
   }
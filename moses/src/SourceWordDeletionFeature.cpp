@@ -58,7 +58,7 @@ void SourceWordDeletionFeature::ComputeFeatures(const TargetPhrase& targetPhrase
 	size_t targetLength = targetPhrase.GetSize();
 	size_t sourceLength = targetPhrase.GetSourcePhrase().GetSize();
 	if (targetLength == 1 && sourceLength == 1) {
-		const Factor* f1 = targetPhrase.GetWord(0).GetFactor(1);
+		const Factor* f1 = (MAX_NUM_FACTORS > 1) ? targetPhrase.GetWord(0).GetFactor(1) : NULL;
 		if (f1 && f1->GetString().compare(UNKNOWN_FACTOR) == 0) {
 			return;
 		}
@@ -83,6 +83,21 @@ static size_t CalcMax(size_t x, const vector<size_t>& y, const vector<size_t>& z
   return max;
 }
 
+// words only have room for the factors the decoder was built with
+static bool CheckFactorOrder(const vector<FactorType>& factorOrder, const string& paramName)
+{
+  for (vector<FactorType>::const_iterator i=factorOrder.begin(); i != factorOrder.end(); ++i) {
+    if (*i >= MAX_NUM_FACTORS) {
+      stringstream strme;
+      strme << paramName << " uses factor " << *i << ", but this build only has "
+            << MAX_NUM_FACTORS << " factors. Build with --max-factors=" << (*i + 1);
+      UserMessage::Add(strme.str());
+      return false;
+    }
+  }
+  return true;
+}
+
 StaticData StaticData::s_instance;
 
 StaticData::StaticData()
@@ -293,6 +308,7 @@ bool StaticData::LoadData(Parameter *parameter)
                              ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
   } else {
     m_useTransOptCache = false;
+    m_transOptCacheMaxSize = 0;
   }
 
   std::cerr << "transOptCache: " << m_useTransOptCache << std::endl;
@@ -317,6 +333,10 @@ bool StaticData::LoadData(Parameter *parameter)
     // default. output factor 0
     m_outputFactorOrder.push_back(0);
   }
+  if (!CheckFactorOrder(m_inputFactorOrder, "input-factors")
+      || !CheckFactorOrder(m_outputFactorOrder, "output-factors")) {
+    return false;
+  }
 
   //source word deletion
   SetBooleanParameter( &m_wordDeletionEnabled, "phrase-drop-allowed", false );
@@ -447,6 +467,8 @@ bool StaticData::LoadData(Parameter *parameter)
   
   // Compact phrase table and reordering model
   SetBooleanParameter( &m_minphrMemory, "minphr-memory", false );
+  m_minphrCacheSize = (m_parameter->GetParam("minphr-cache-size").size() > 0)
+                      ? Scan<size_t>(m_parameter->GetParam("minphr-cache-size")[0]) << 20 : 64 << 20;
   SetBooleanParameter( &m_minlexrMemory, "minlexr-memory", false );
 
   m_timeout_threshold = (m_parameter->GetParam("time-out").size() > 0) ?
@@ -486,6 +508,51 @@ bool StaticData::LoadData(Parameter *parameter)
     }
   }
 
+  m_searchThreadCount = (m_parameter->GetParam("search-threads").size() > 0)
+                         ? Scan<size_t>(m_parameter->GetParam("search-threads")[0]) : 1;
+  if (m_searchThreadCount < 1) {
+    UserMessage::Add("Specify at least one search thread.");
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_searchThreadCount > 1) {
+    UserMessage::Add("Error: search-threads > 1 but moses not built with thread support");
+    return false;
+  }
+#endif
+
+  m_loadingThreadCount = (m_parameter->GetParam("loading-threads").size() > 0)
+                         ? Scan<size_t>(m_parameter->GetParam("loading-threads")[0]) : m_threadCount;
+  if (m_loadingThreadCount < 1) {
+    UserMessage::Add("Specify at least one loading thread.");
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_loadingThreadCount > 1) {
+    UserMessage::Add("Error: loading-threads > 1 but moses not built with thread support");
+    return false;
+  }
+#endif
+
+  m_shortestFirst = false;
+  if (m_parameter->GetParam("task-order").size() > 0) {
+    const string &order = m_parameter->GetParam("task-order")[0];
+    if (order == "shortest") {
+      m_shortestFirst = true;
+    } else if (order != "input") {
+      UserMessage::Add("Unknown task order: " + order);
+      return false;
+    }
+  }
+
+  // the persistent cache is sharded so that threads rarely wait on the same lock
+  if (m_useTransOptCache && m_transOptCacheMaxSize > 0) {
+    size_t shards = (m_parameter->GetParam("persistent-cache-shards").size() > 0)
+                    ? Scan<size_t>(m_parameter->GetParam("persistent-cache-shards")[0]) : 4 * m_threadCount;
+    m_transOptCache.reset(new TransOptCache(m_transOptCacheMaxSize, shards));
+    VERBOSE(2,"transOptCache shards: " << m_transOptCache->GetNumShards() << std::endl);
+  }
+
   m_startTranslationId = (m_parameter->GetParam("start-translation-id").size() > 0) ?
           Scan<long>(m_parameter->GetParam("start-translation-id")[0]) : 0;
 
@@ -1125,6 +1192,9 @@ bool StaticData::LoadLanguageModels()
 
         // factorType = 0 = Surface, 1 = POS, 2 = Stem, 3 = Morphology, etc
         vector<FactorType> 	factorTypes		= Tokenize<FactorType>(token[1], ",");
+        if (!CheckFactorOrder(factorTypes, "lmodel-file")) {
+          return false;
+        }
 
         // nGramOrder = 2 = bigram, 3 = trigram, etc
         size_t nGramOrder = Scan<int>(token[2]);
@@ -1192,6 +1262,9 @@ bool StaticData::LoadGenerationTables()
       vector<string>			token		= Tokenize(generationVector[currDict]);
       vector<FactorType> 	input		= Tokenize<FactorType>(token[0], ",")
                                     ,output	= Tokenize<FactorType>(token[1], ",");
+      if (!CheckFactorOrder(input, "generation-file") || !CheckFactorOrder(output, "generation-file")) {
+        return false;
+      }
       m_maxFactorIdx[1] = CalcMax(m_maxFactorIdx[1], input, output);
       string							filePath;
       size_t							numFeatures;
@@ -1284,6 +1357,9 @@ bool StaticData::LoadPhraseTables()
 
       vector<FactorType>  input		= Tokenize<FactorType>(token[1], ",")
                                     ,output = Tokenize<FactorType>(token[2], ",");
+      if (!CheckFactorOrder(input, "ttable-file") || !CheckFactorOrder(output, "ttable-file")) {
+        return false;
+      }
       m_maxFactorIdx[0] = CalcMax(m_maxFactorIdx[0], input);
       m_maxFactorIdx[1] = CalcMax(m_maxFactorIdx[1], output);
       m_maxNumFactors = std::max(m_maxFactorIdx[0], m_maxFactorIdx[1]) + 1;
@@ -1946,66 +2022,32 @@ bool StaticData::LoadWordTranslationFeature()
   return true;
 }
 
-const TranslationOptionList* StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
+TranslationOptionListPtr StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
 {
+  TranslationOptionListPtr ret;
+  if (m_transOptCache.get() == NULL) return ret;
   std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter
-    = m_transOptCache.find(key);
-  if (iter == m_transOptCache.end())
-    return NULL;
-  iter->second.second = clock(); // update last used time
-  return iter->second.first;
-}
-
-void StaticData::ReduceTransOptCache() const
-{
-  if (m_transOptCache.size() <= m_transOptCacheMaxSize) return; // not full
-  clock_t t = clock();
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter;
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
-  }
-  for( size_t i=0; i < lastUsedTimes.size()-m_transOptCacheMaxSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iterRemove = iter++;
-      delete iterRemove->second.first;
-      m_transOptCache.erase(iterRemove);
-    } else iter++;
-  }
-  VERBOSE(2,"Reduced persistent translation option cache in " << ((clock()-t)/(float)CLOCKS_PER_SEC) << " seconds." << std::endl);
+  m_transOptCache->Find(key, ret);
+  return ret;
 }
 
 void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
 {
-  if (m_transOptCacheMaxSize == 0) return;
+  if (m_transOptCache.get() == NULL) return;
   std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-  TranslationOptionList* storedTransOptList = new TranslationOptionList(transOptList);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  m_transOptCache[key] = make_pair( storedTransOptList, clock() );
-  ReduceTransOptCache();
+  TranslationOptionListPtr storedTransOptList(new TranslationOptionList(transOptList));
+  m_transOptCache->Add(key, storedTransOptList);
 }
+
 void StaticData::ClearTransOptionCache() const {
-  map<std::pair<size_t, Phrase>, std::pair< TranslationOptionList*, clock_t > >::iterator iterCache;
-  for (iterCache = m_transOptCache.begin() ; iterCache != m_transOptCache.end() ; ++iterCache) {
-    TranslationOptionList *transOptList = iterCache->second.first;
-    delete transOptList;
-  }
+  if (m_transOptCache.get() == NULL) return;
+  m_transOptCache->Clear();
+}
+
+ClockCacheStats StaticData::GetTransOptCacheStats() const
+{
+  if (m_transOptCache.get() == NULL) return ClockCacheStats();
+  return m_transOptCache->GetStats();
 }
 
 void StaticData::ReLoadParameter()
@@ -32,6 +32,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fstream>
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 #ifdef WITH_THREADS
 #include <boost/thread/mutex.hpp>
 #endif
@@ -46,6 +48,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOptionList.h"
 #include "TranslationSystem.h"
 #include "ScoreComponentCollection.h"
+#include "ClockCache.h"
 
 namespace Moses
 {
@@ -75,6 +78,9 @@ class SyntacticLanguageModel;
 #endif
 class TranslationSystem;
 
+typedef boost::shared_ptr<const TranslationOptionList> TranslationOptionListPtr;
+typedef ClockCache<std::pair<size_t, Phrase>, TranslationOptionListPtr> TransOptCache;
+
 typedef std::pair<std::string, float> UnknownLHSEntry;
 typedef std::vector<UnknownLHSEntry>  UnknownLHSList;
 
@@ -204,13 +210,8 @@ protected:
   size_t m_timeout_threshold; //! seconds after which time out is activated
 
   bool m_useTransOptCache; //! flag indicating, if the persistent translation option cache should be used
-  mutable std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> > m_transOptCache; //! persistent translation option cache
+  std::auto_ptr<TransOptCache> m_transOptCache; //! persistent translation option cache, sharded with CLOCK eviction
   size_t m_transOptCacheMaxSize; //! maximum size for persistent translation option cache
-  //FIXME: Single lock for cache not most efficient. However using a
-  //reader-writer for LRU cache is tricky - how to record last used time?
-#ifdef WITH_THREADS
-  mutable boost::mutex m_transOptCacheMutex;
-#endif
   bool m_isAlwaysCreateDirectTranslationOption;
   //! constructor. only the 1 static variable can be created
 
@@ -231,6 +232,7 @@ protected:
 
   // Whether to load compact phrase table and reordering table into memory
   bool m_minphrMemory;
+  size_t m_minphrCacheSize; //! in bytes
   bool m_minlexrMemory;
 
   // Initial = 0 = can be used when creating poss trans
@@ -241,6 +243,9 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  bool m_shortestFirst; //! translate the queued sentences in order of length
+  size_t m_searchThreadCount; //! threads used within the search of one sentence
+  size_t m_loadingThreadCount; //! threads parsing a text table while it is loaded
   long m_startTranslationId;
   
   StaticData();
@@ -278,7 +283,6 @@ protected:
   bool LoadSourceWordDeletionFeature();
   bool LoadWordTranslationFeature();
 
-  void ReduceTransOptCache() const;
   bool m_continuePartialTranslation;
 
   std::string m_binPath;
@@ -448,6 +452,10 @@ public:
      return m_minphrMemory;
   }
 
+  size_t GetMinphrCacheSize() const {
+    return m_minphrCacheSize;
+  }
+
   bool UseMinlexrInMemory() const {
      return m_minlexrMemory;
   }
@@ -686,8 +694,11 @@ public:
 
   void ClearTransOptionCache() const;
 
+  //! returned list stays valid even if it is evicted from the cache meanwhile
+  TranslationOptionListPtr FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
 
-  const TranslationOptionList* FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+  //! hit/miss/eviction counters of the persistent cache
+  ClockCacheStats GetTransOptCacheStats() const;
 
   bool PrintAllDerivations() const {
     return m_printAllDerivations;
@@ -736,6 +747,15 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+  bool TranslateShortestFirst() const {
+    return m_shortestFirst;
+  }
+  size_t GetSearchThreadCount() const {
+    return m_searchThreadCount;
+  }
+  size_t GetLoadingThreadCount() const {
+    return m_loadingThreadCount;
+  }
   
   long GetStartTranslationId() const
   { return m_startTranslationId; }
@@ -0,0 +1,240 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <exception>
+#include <iostream>
+#include <memory>
+
+#include "util/exception.hh"
+#include "util/file_piece.hh"
+
+#include "StaticData.h"
+#include "TableLoadPipeline.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "Util.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+// a block ends after this many lines, or the line which makes it this long
+const size_t BLOCK_LINES = 10000;
+const size_t BLOCK_BYTES = 4 << 20;
+// blocks read but not yet merged, for each parsing thread
+const size_t BLOCKS_PER_THREAD = 4;
+}
+
+#ifdef WITH_THREADS
+class TableLoadPipeline::ParseTask : public Task
+{
+public:
+  ParseTask(TableLoadPipeline &pipeline, Block &block)
+    : m_pipeline(pipeline), m_block(block) {}
+
+  void Run() {
+    m_pipeline.ParseBlock(m_block);
+    boost::mutex::scoped_lock lock(m_pipeline.m_mutex);
+    m_block.m_parsed = true;
+    m_pipeline.m_blockParsed.notify_all();
+  }
+
+private:
+  TableLoadPipeline &m_pipeline;
+  Block &m_block;
+};
+#endif
+
+TableLoadPipeline::TableLoadPipeline(const std::string &filePath, size_t threads)
+  : m_filePath(filePath)
+  , m_threads(threads)
+  , m_lineNum(0)
+#ifdef WITH_THREADS
+  , m_readDone(false)
+  , m_stopping(false)
+#endif
+{
+}
+
+TableLoadPipeline::~TableLoadPipeline()
+{
+}
+
+void TableLoadPipeline::Run()
+{
+  std::ostream *progress = NULL;
+  IFVERBOSE(1) progress = &std::cerr;
+  util::FilePiece in(m_filePath.c_str(), progress);
+
+  Timer timer;
+  timer.start();
+
+#ifdef WITH_THREADS
+  if (m_threads > 1) {
+    RunThreaded(in);
+  } else
+#endif
+  {
+    while (Block *block = ReadBlock(in)) {
+      ParseBlock(*block);
+      MergeBlock(*block);
+    }
+  }
+
+  const double seconds = timer.get_elapsed_time();
+  const double megabytes = in.Offset() / 1048576.0;
+  VERBOSE(2, "Loaded " << m_filePath << ": " << m_lineNum << " lines, " << megabytes << " MB in "
+          << seconds << " s (" << (seconds > 0 ? m_lineNum / seconds : 0) << " lines/s, "
+          << (seconds > 0 ? megabytes / seconds : 0) << " MB/s) with "
+          << m_threads << " parsing thread(s)" << endl);
+}
+
+TableLoadPipeline::Block *TableLoadPipeline::ReadBlock(util::FilePiece &in)
+{
+  // owned here until it is returned, as reading may throw
+  std::auto_ptr<Block> block(NewBlock());
+  block->m_firstLineNum = m_lineNum + 1;
+
+  // the lines go into one string, and are only cut out of it once it is
+  // complete, as it may move while it grows
+  std::vector<size_t> ends;
+  try {
+    while (ends.size() < BLOCK_LINES && block->m_text.size() < BLOCK_BYTES) {
+      const StringPiece line = in.ReadLine();
+      block->m_text.append(line.data(), line.size());
+      ends.push_back(block->m_text.size());
+    }
+  } catch (const util::EndOfFileException &e) {
+    if (ends.empty()) {
+      return NULL;
+    }
+  }
+
+  block->m_lines.reserve(ends.size());
+  size_t begin = 0;
+  for (size_t i = 0; i < ends.size(); ++i) {
+    block->m_lines.push_back(StringPiece(block->m_text.data() + begin, ends[i] - begin));
+    begin = ends[i];
+  }
+  m_lineNum += ends.size();
+  return block.release();
+}
+
+void TableLoadPipeline::ParseBlock(Block &block) const
+{
+  try {
+    Parse(block);
+  } catch (const std::exception &e) {
+    block.m_error = e.what();
+  }
+}
+
+void TableLoadPipeline::MergeBlock(Block &block)
+{
+  // deleted however this ends, as Merge() may throw too
+  std::auto_ptr<Block> owned(&block);
+  if (!block.m_error.empty()) {
+    UTIL_THROW(util::Exception, block.m_error);
+  }
+  Merge(block);
+}
+
+#ifdef WITH_THREADS
+void TableLoadPipeline::Read(util::FilePiece &in, ThreadPool &pool)
+{
+  const size_t maxBlocks = BLOCKS_PER_THREAD * m_threads;
+  try {
+    while (Block *block = ReadBlock(in)) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (m_blocks.size() >= maxBlocks && !m_stopping) {
+        m_blockMerged.wait(lock);
+      }
+      if (m_stopping) {
+        delete block;
+        break;
+      }
+      m_blocks.push_back(block);
+      pool.Submit(new ParseTask(*this, *block));
+    }
+  } catch (const std::exception &e) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_readError = e.what();
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_readDone = true;
+  m_blockParsed.notify_all();
+}
+
+void TableLoadPipeline::RunThreaded(util::FilePiece &in)
+{
+  ThreadPool pool(m_threads);
+  boost::thread reader(boost::bind(&TableLoadPipeline::Read, this, boost::ref(in), boost::ref(pool)));
+
+  std::string error;
+  for (;;) {
+    Block *block = NULL;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (!(!m_blocks.empty() && m_blocks.front()->m_parsed) && !(m_readDone && m_blocks.empty())) {
+        m_blockParsed.wait(lock);
+      }
+      if (m_blocks.empty()) {
+        error = m_readError;
+        break;
+      }
+      block = m_blocks.front();
+      m_blocks.pop_front();
+      m_blockMerged.notify_all();
+    }
+
+    try {
+      MergeBlock(*block);
+    } catch (const std::exception &e) {
+      error = e.what();
+      break;
+    }
+  }
+
+  if (!error.empty()) {
+    // stop reading, and drop the blocks which are still being parsed once
+    // the pool has finished them
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_stopping = true;
+      m_blockMerged.notify_all();
+    }
+    reader.join();
+    pool.Stop(true);
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+      delete m_blocks[i];
+    }
+    m_blocks.clear();
+    UTIL_THROW(util::Exception, error);
+  }
+
+  reader.join();
+  pool.Stop(true);
+}
+#endif
+
+}
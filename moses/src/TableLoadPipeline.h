@@ -0,0 +1,127 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TableLoadPipeline_h
+#define moses_TableLoadPipeline_h
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "util/string_piece.hh"
+
+namespace util
+{
+class FilePiece;
+}
+
+namespace Moses
+{
+
+class ThreadPool;
+
+/** Loads a text table, such as a phrase or rule table, on several threads.
+ *  A reader thread decompresses the file and cuts it into blocks of whole
+ *  lines, a pool of threads parses the blocks, and the thread which called
+ *  Run() merges the parsed blocks into the table in file order, while the
+ *  blocks behind them are still being read and parsed. The number of blocks
+ *  in flight is bounded. With one thread, each block is read, parsed and
+ *  merged in turn.
+ */
+class TableLoadPipeline
+{
+public:
+  //! lines of the file, and what a subclass parsed them into
+  class Block
+  {
+  public:
+    Block() : m_firstLineNum(0), m_parsed(false) {}
+    virtual ~Block() {}
+
+    //! line number of the first line in the file, from 1
+    size_t GetFirstLineNum() const {
+      return m_firstLineNum;
+    }
+    //! the lines, without their newlines. Valid for the lifetime of the block
+    const std::vector<StringPiece> &GetLines() const {
+      return m_lines;
+    }
+
+  private:
+    friend class TableLoadPipeline;
+    size_t m_firstLineNum;
+    std::string m_text;
+    std::vector<StringPiece> m_lines;
+    bool m_parsed;
+    std::string m_error; //! what Parse() threw, if anything
+  };
+
+  TableLoadPipeline(const std::string &filePath, size_t threads);
+  virtual ~TableLoadPipeline();
+
+  /** reads, parses and merges the whole file. An exception thrown by Parse()
+   *  is thrown again from here, as a util::Exception */
+  void Run();
+
+protected:
+  virtual Block *NewBlock() const = 0;
+
+  //! parse the lines of block. Called on several blocks at once
+  virtual void Parse(Block &block) const = 0;
+
+  //! add a parsed block to the table. Called on one block at a time, in file order
+  virtual void Merge(Block &block) = 0;
+
+  const std::string &GetFilePath() const {
+    return m_filePath;
+  }
+
+private:
+  class ParseTask;
+
+  std::string m_filePath;
+  size_t m_threads;
+  size_t m_lineNum; //! lines read, only touched by the reader
+
+  //! the next block of the file, or NULL at its end
+  Block *ReadBlock(util::FilePiece &in);
+  void ParseBlock(Block &block) const;
+  void MergeBlock(Block &block);
+
+#ifdef WITH_THREADS
+  void Read(util::FilePiece &in, ThreadPool &pool);
+  void RunThreaded(util::FilePiece &in);
+
+  boost::mutex m_mutex; //! guards the members below
+  boost::condition_variable m_blockParsed; //! or the reader is done
+  boost::condition_variable m_blockMerged; //! or the pipeline is stopping
+  std::deque<Block*> m_blocks; //! read and not yet merged, in file order
+  bool m_readDone;
+  bool m_stopping;
+  std::string m_readError;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "util/exception.hh"
+
+#include "TableLoadPipeline.h"
+#include "Util.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+#ifdef WITH_THREADS
+boost::mutex s_liveMutex;
+#endif
+int s_liveBlocks = 0; //! blocks created and not yet deleted
+
+//! the numbers on the lines of a block
+class NumberBlock : public TableLoadPipeline::Block
+{
+public:
+  NumberBlock() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s_liveMutex);
+#endif
+    ++s_liveBlocks;
+  }
+  ~NumberBlock() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s_liveMutex);
+#endif
+    --s_liveBlocks;
+  }
+
+  vector<int> m_numbers;
+};
+
+//! reads a file of one number a line, failing on the line failParse or failMerge
+class NumberPipeline : public TableLoadPipeline
+{
+public:
+  NumberPipeline(const string &filePath, size_t threads, int failParse = -1, int failMerge = -1)
+    : TableLoadPipeline(filePath, threads), m_failParse(failParse), m_failMerge(failMerge) {}
+
+  vector<int> m_merged;
+  vector<size_t> m_firstLineNums;
+  vector<size_t> m_mergedBefore; //! numbers merged before each block
+
+protected:
+  Block *NewBlock() const {
+    return new NumberBlock();
+  }
+
+  void Parse(Block &block) const {
+    NumberBlock &numbers = static_cast<NumberBlock&>(block);
+    const vector<StringPiece> &lines = block.GetLines();
+    for (size_t i = 0; i < lines.size(); ++i) {
+      const int number = Scan<int>(lines[i].as_string());
+      if (number == m_failParse) {
+        throw runtime_error("bad line " + lines[i].as_string());
+      }
+      numbers.m_numbers.push_back(number);
+    }
+  }
+
+  void Merge(Block &block) {
+    NumberBlock &numbers = static_cast<NumberBlock&>(block);
+    m_firstLineNums.push_back(block.GetFirstLineNum());
+    m_mergedBefore.push_back(m_merged.size());
+    for (size_t i = 0; i < numbers.m_numbers.size(); ++i) {
+      if (numbers.m_numbers[i] == m_failMerge) {
+        throw runtime_error("cannot merge");
+      }
+      m_merged.push_back(numbers.m_numbers[i]);
+    }
+  }
+
+private:
+  int m_failParse, m_failMerge;
+};
+
+struct NumberFileFixture {
+  NumberFileFixture() {
+    char name[] = "TableLoadPipelineXXXXXX";
+    int fd = mkstemp(name);
+    BOOST_CHECK(fd != -1);
+    BOOST_CHECK(!close(fd));
+    filename = name;
+  }
+
+  ~NumberFileFixture() {
+    BOOST_CHECK(!remove(filename.c_str()));
+  }
+
+  void Write(int count) {
+    ofstream out(filename.c_str());
+    for (int i = 0; i < count; ++i) {
+      out << i << "\n";
+    }
+  }
+
+  string filename;
+};
+
+// more lines than in several blocks, and more blocks than are kept in flight
+const int kLines = 205000;
+
+}
+
+BOOST_AUTO_TEST_SUITE(table_load_pipeline)
+
+BOOST_FIXTURE_TEST_CASE(merge_in_file_order, NumberFileFixture)
+{
+  Write(kLines);
+  const size_t threads[] = {1, 2, 4};
+  for (size_t t = 0; t < 3; ++t) {
+    NumberPipeline pipeline(filename, threads[t]);
+    pipeline.Run();
+    BOOST_REQUIRE_EQUAL(pipeline.m_merged.size(), (size_t) kLines);
+    for (int i = 0; i < kLines; ++i) {
+      BOOST_REQUIRE_EQUAL(pipeline.m_merged[i], i);
+    }
+    // blocks of whole lines, numbered from 1
+    BOOST_REQUIRE(pipeline.m_firstLineNums.size() > 1);
+    BOOST_CHECK_EQUAL(pipeline.m_firstLineNums[0], 1);
+    for (size_t b = 0; b < pipeline.m_firstLineNums.size(); ++b) {
+      BOOST_CHECK_EQUAL(pipeline.m_firstLineNums[b], pipeline.m_mergedBefore[b] + 1);
+    }
+    BOOST_CHECK_EQUAL(s_liveBlocks, 0);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(empty_file, NumberFileFixture)
+{
+  Write(0);
+  NumberPipeline pipeline(filename, 2);
+  pipeline.Run();
+  BOOST_CHECK(pipeline.m_merged.empty());
+  BOOST_CHECK_EQUAL(s_liveBlocks, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(parse_error, NumberFileFixture)
+{
+  Write(kLines);
+  // early, so that the reader is still ahead and has to be stopped, and late
+  const int failures[] = {5, kLines - 5};
+  const size_t threads[] = {1, 2, 4};
+  for (size_t f = 0; f < 2; ++f) {
+    for (size_t t = 0; t < 3; ++t) {
+      NumberPipeline pipeline(filename, threads[t], failures[f]);
+      bool thrown = false;
+      try {
+        pipeline.Run();
+      } catch (const util::Exception &e) {
+        thrown = true;
+        BOOST_CHECK(string(e.what()).find("bad line " + SPrint(failures[f])) != string::npos);
+      }
+      BOOST_CHECK(thrown);
+      // the blocks before the failing one are merged, and none after it
+      BOOST_CHECK(pipeline.m_merged.size() < (size_t) failures[f]);
+      for (size_t i = 0; i < pipeline.m_merged.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(pipeline.m_merged[i], (int) i);
+      }
+      BOOST_CHECK_EQUAL(s_liveBlocks, 0);
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(merge_error, NumberFileFixture)
+{
+  Write(kLines);
+  const size_t threads[] = {1, 4};
+  for (size_t t = 0; t < 2; ++t) {
+    NumberPipeline pipeline(filename, threads[t], -1, 15000);
+    BOOST_CHECK_THROW(pipeline.Run(), std::exception);
+    BOOST_CHECK_EQUAL(pipeline.m_merged.size(), 15000);
+    BOOST_CHECK_EQUAL(s_liveBlocks, 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(missing_file)
+{
+  NumberPipeline pipeline("TableLoadPipelineTest.no.such.file", 2);
+  BOOST_CHECK_THROW(pipeline.Run(), util::Exception);
+  BOOST_CHECK_EQUAL(s_liveBlocks, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -40,8 +40,10 @@ using namespace std;
 
 namespace Moses
 {
+const Phrase TargetPhrase::s_emptySourcePhrase(0);
+
 TargetPhrase::TargetPhrase( std::string out_string)
-  :Phrase(0), m_fullScore(0.0), m_sourcePhrase(0)
+  :Phrase(0), m_fullScore(0.0)
   , m_alignmentInfo(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
 {
 
@@ -54,7 +56,6 @@ TargetPhrase::TargetPhrase( std::string out_string)
 TargetPhrase::TargetPhrase()
   :Phrase(ARRAY_SIZE_INCR)
   , m_fullScore(0.0)
-  ,m_sourcePhrase(0)
   , m_alignmentInfo(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
 {
 }
@@ -62,7 +63,6 @@ TargetPhrase::TargetPhrase()
 TargetPhrase::TargetPhrase(const Phrase &phrase)
   : Phrase(phrase)
   , m_fullScore(0.0)
-  , m_sourcePhrase(0)
   , m_alignmentInfo(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
 {
 }
@@ -307,7 +307,7 @@ void TargetPhrase::SetAlignmentInfo(const StringPiece &alignString)
 
 
 
-void TargetPhrase::SetAlignmentInfo(const StringPiece &alignString, Phrase &sourcePhrase)
+void TargetPhrase::SetAlignmentInfo(const StringPiece &alignString, const Phrase &sourcePhrase)
 {
   std::vector<int> indicator;
 	
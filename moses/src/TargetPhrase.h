@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_TargetPhrase_h
 
 #include <vector>
+#include <boost/shared_ptr.hpp>
 #include "TypeDef.h"
 #include "Phrase.h"
 #include "ScoreComponentCollection.h"
@@ -51,12 +52,14 @@ protected:
   float m_fullScore;
   ScoreComponentCollection m_scoreBreakdown;
 
-	// in case of confusion net, ptr to source phrase
-	Phrase m_sourcePhrase; 
+	// shared by all the translations of a source phrase. NULL if not set
+	boost::shared_ptr<const Phrase> m_sourcePhrase;
 	const AlignmentInfo* m_alignmentInfo;
 	Word m_lhsTarget;
 	size_t m_ruleCount;
 
+	static const Phrase s_emptySourcePhrase;
+
 public:
   TargetPhrase();
   TargetPhrase(std::string out_string);
@@ -129,12 +132,21 @@ public:
 		return m_scoreBreakdown;
 	}
 
-  //TODO: Probably shouldn't copy this, but otherwise ownership is unclear
+	//! takes a copy of the source phrase
 	void SetSourcePhrase(const Phrase&  p) 
 	{
-		m_sourcePhrase=p;
+		m_sourcePhrase.reset(new Phrase(p));
+	}
+	//! shares the source phrase, so that all the translations of a phrase keep one copy
+	void SetSourcePhrase(const boost::shared_ptr<const Phrase> &p)
+	{
+		m_sourcePhrase = p;
 	}
 	const Phrase& GetSourcePhrase() const 
+	{
+		return m_sourcePhrase ? *m_sourcePhrase : s_emptySourcePhrase;
+	}
+	const boost::shared_ptr<const Phrase> &GetSourcePhrasePtr() const
 	{
 		return m_sourcePhrase;
 	}
@@ -149,7 +161,7 @@ public:
   }
 
   void SetAlignmentInfo(const StringPiece &alignString);
-  void SetAlignmentInfo(const StringPiece &alignString, Phrase &sourcePhrase);
+  void SetAlignmentInfo(const StringPiece &alignString, const Phrase &sourcePhrase);
   void SetAlignmentInfo(const std::set<std::pair<size_t,size_t> > &alignmentInfo);
   void SetAlignmentInfo(const std::set<std::pair<size_t,size_t> > &alignmentInfo, int* indicator);
   void SetAlignmentInfo(const AlignmentInfo *alignmentInfo) {
@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "ThreadPool.h"
 
 #ifdef WITH_THREADS
@@ -30,38 +33,121 @@ using namespace Moses;
 namespace Moses
 {
 
+namespace
+{
+double Seconds(const boost::posix_time::time_duration &duration)
+{
+  return duration.total_microseconds() / 1000000.0;
+}
+
+boost::posix_time::ptime Now()
+{
+  return boost::posix_time::microsec_clock::universal_time();
+}
+}
+
+std::ostream& operator<<(std::ostream &out, const ThreadPoolStats &stats)
+{
+  out << "threads=" << stats.threads
+      << " submitted=" << stats.submitted << " executed=" << stats.executed
+      << " stolen=" << stats.stolen << " cancelled=" << stats.cancelled
+      << " queued=" << stats.queued << " max-queued=" << stats.maxQueued
+      << " utilization=" << stats.Utilization();
+  return out;
+}
+
 ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false), m_queueLimit(0)
+  : m_stopped(false), m_stopping(false), m_queueLimit(0), m_queued(0)
+  , m_nextWorker(0), m_seq(0), m_submitted(0), m_cancelled(0), m_maxQueued(0)
+  , m_startTime(Now())
 {
+  if (numThreads == 0) numThreads = 1;
+  for (size_t i = 0; i < numThreads; ++i) {
+    m_workers.push_back(new Worker());
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
   }
 }
 
-void ThreadPool::Execute()
+ThreadPool::~ThreadPool()
 {
-  do {
-    Task* task = NULL;
-    {
-      // Find a job to perform
-      boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
-        m_threadNeeded.wait(lock);
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+bool ThreadPool::PopFrom(Worker &worker, Entry &entry)
+{
+  boost::mutex::scoped_lock lock(worker.m_mutex);
+  if (worker.m_queue.empty()) return false;
+  pop_heap(worker.m_queue.begin(), worker.m_queue.end(), EntryOrderer());
+  entry = worker.m_queue.back();
+  worker.m_queue.pop_back();
+  return true;
+}
+
+bool ThreadPool::Take(size_t id, Entry &entry)
+{
+  bool found = PopFrom(*m_workers[id], entry);
+  for (size_t i = 1; !found && i < m_workers.size(); ++i) {
+    found = PopFrom(*m_workers[(id + i) % m_workers.size()], entry);
+    if (found) {
+      boost::mutex::scoped_lock lock(m_workers[id]->m_mutex);
+      ++m_workers[id]->m_stolen;
+    }
+  }
+  if (found) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    --m_queued;
+    m_threadAvailable.notify_all();
+  }
+  return found;
+}
+
+void ThreadPool::Execute(size_t id)
+{
+  m_workerId.reset(new size_t(id));
+  Worker &worker = *m_workers[id];
+  for (;;) {
+    Entry entry;
+    if (Take(id, entry)) {
+      //Execute job
+      {
+        boost::mutex::scoped_lock lock(worker.m_mutex);
+        worker.m_current = entry.task;
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
+      // a task the pool doesn't delete may be deleted by its owner as soon
+      // as Run() has told it it's done, so it isn't touched after Run()
+      const bool deleteTask = entry.task->DeleteAfterExecution();
+      const boost::posix_time::ptime start = Now();
+      entry.task->Run();
+      const double busy = Seconds(Now() - start);
+      {
+        boost::mutex::scoped_lock lock(worker.m_mutex);
+        worker.m_current = NULL;
+        worker.m_busySeconds += busy;
+        ++worker.m_executed;
       }
-    }
-    //Execute job
-    if (task) {
-      task->Run();
-      if (task->DeleteAfterExecution()) {
-        delete task;
+      if (deleteTask) {
+        delete entry.task;
       }
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_threadAvailable.notify_all();
+      continue;
     }
-    m_threadAvailable.notify_all();
-  } while (!m_stopped);
+
+    // Find a job to perform, or wait for one
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_stopped) break;
+    // m_queued is only decremented after a task has been taken, so if it
+    // isn't 0, a task is in a queue or about to leave one
+    if (m_queued == 0) {
+      m_threadNeeded.wait(lock);
+    }
+    if (m_stopped) break;
+  }
 }
 
 void ThreadPool::Submit( Task* task )
@@ -70,11 +156,33 @@ void ThreadPool::Submit( Task* task )
   if (m_stopping) {
     throw runtime_error("ThreadPool stopping - unable to accept new jobs");
   }
-  while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
+  const size_t *workerId = m_workerId.get();
+  // a task submitted from inside the pool mustn't wait for the pool
+  while (workerId == NULL && m_queueLimit > 0 && m_queued >= m_queueLimit) {
     m_threadAvailable.wait(lock);
   }
-  m_tasks.push(task);
-  m_threadNeeded.notify_all();
+
+  Entry entry;
+  entry.task = task;
+  entry.priority = task->GetPriority();
+  entry.seq = m_seq++;
+  size_t id;
+  if (workerId) {
+    id = *workerId;
+  } else {
+    id = m_nextWorker;
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+  }
+  {
+    Worker &worker = *m_workers[id];
+    boost::mutex::scoped_lock workerLock(worker.m_mutex);
+    worker.m_queue.push_back(entry);
+    push_heap(worker.m_queue.begin(), worker.m_queue.end(), EntryOrderer());
+  }
+  ++m_queued;
+  ++m_submitted;
+  m_maxQueued = max(m_maxQueued, m_queued);
+  m_threadNeeded.notify_one();
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -88,9 +196,31 @@ void ThreadPool::Stop(bool processRemainingJobs)
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
     //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    while (m_queued > 0 && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
+  } else {
+    //drop the queued jobs, and ask the running ones to finish early
+    size_t dropped = 0, cancelled = 0;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+      Worker &worker = *m_workers[i];
+      boost::mutex::scoped_lock workerLock(worker.m_mutex);
+      for (size_t j = 0; j < worker.m_queue.size(); ++j) {
+        Task *task = worker.m_queue[j].task;
+        task->GetCancellationToken()->Cancel();
+        if (task->DeleteAfterExecution()) delete task;
+      }
+      dropped += worker.m_queue.size();
+      worker.m_queue.clear();
+      if (worker.m_current) {
+        worker.m_current->GetCancellationToken()->Cancel();
+        ++cancelled;
+      }
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    // tasks taken meanwhile decrement m_queued themselves
+    m_queued -= dropped;
+    m_cancelled += dropped + cancelled;
   }
   //tell all threads to stop
   {
@@ -100,8 +230,30 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threadNeeded.notify_all();
 
   m_threads.join_all();
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_stopTime = Now();
 }
 
+ThreadPoolStats ThreadPool::GetStats() const
+{
+  ThreadPoolStats stats;
+  stats.threads = m_workers.size();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    const Worker &worker = *m_workers[i];
+    boost::mutex::scoped_lock lock(worker.m_mutex);
+    stats.executed += worker.m_executed;
+    stats.stolen += worker.m_stolen;
+    stats.busySeconds += worker.m_busySeconds;
+  }
+  boost::mutex::scoped_lock lock(m_mutex);
+  stats.submitted = m_submitted;
+  stats.cancelled = m_cancelled;
+  stats.queued = m_queued;
+  stats.maxQueued = m_maxQueued;
+  stats.elapsedSeconds = Seconds((m_stopTime.is_not_a_date_time() ? Now() : m_stopTime) - m_startTime);
+  return stats;
 }
-#endif //WITH_THREADS
 
+}
+#endif //WITH_THREADS
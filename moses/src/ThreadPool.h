@@ -23,12 +23,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_ThreadPool_h
 
 #include <iostream>
-#include <queue>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #ifdef WITH_THREADS
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #endif
 
 #ifdef BOOST_HAS_PTHREADS
@@ -44,18 +46,92 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 **/
 namespace Moses {
 
+/** Flag which a long running task polls to find out whether it should stop
+ *  early. It is shared, so that it can outlive the task it was created for.
+ */
+class CancellationToken
+{
+public:
+  CancellationToken() : m_cancelled(false) {}
+
+  void Cancel() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_cancelled = true;
+  }
+
+  bool IsCancelled() const {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    return m_cancelled;
+  }
+
+private:
+  bool m_cancelled;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_mutex;
+#endif
+};
+
+typedef boost::shared_ptr<CancellationToken> CancellationTokenPtr;
+
 /** A task to be executed by the ThreadPool
  */
 class Task
 {
 public:
+  Task() : m_priority(0), m_cancellation(new CancellationToken()) {}
+
   virtual void Run() = 0;
+  //! asked before Run(). If false, the pool doesn't touch the task once Run() returns
   virtual bool DeleteAfterExecution() { return true; }
   virtual ~Task() {}
+
+  /** queued tasks with a lower priority value are started first, e.g. the
+   *  length of the input for shortest first, or a deadline. Tasks with the
+   *  same value are started in the order they were submitted */
+  double GetPriority() const { return m_priority; }
+  void SetPriority(double priority) { m_priority = priority; }
+
+  //! set by ThreadPool::Stop() or by the owner of the task. Run() should poll it
+  const CancellationTokenPtr &GetCancellationToken() const { return m_cancellation; }
+
+private:
+  double m_priority;
+  CancellationTokenPtr m_cancellation;
 };
 
 #ifdef WITH_THREADS
 
+/** Counters of a ThreadPool, since it was constructed
+ */
+struct ThreadPoolStats {
+  size_t threads;
+  size_t submitted, executed, stolen, cancelled;
+  size_t queued, maxQueued; //! queue depth, now and at its maximum
+  double busySeconds; //! time spent in Task::Run(), summed over all threads
+  double elapsedSeconds;
+
+  ThreadPoolStats()
+    : threads(0), submitted(0), executed(0), stolen(0), cancelled(0)
+    , queued(0), maxQueued(0), busySeconds(0), elapsedSeconds(0) {}
+
+  //! fraction of the time that the threads were busy
+  float Utilization() const {
+    return (threads && elapsedSeconds > 0) ? busySeconds / (threads * elapsedSeconds) : 0.0f;
+  }
+};
+
+std::ostream& operator<<(std::ostream &out, const ThreadPoolStats &stats);
+
+/** Pool of a fixed number of threads, each with its own priority queue of
+ *  tasks. A thread takes the most urgent task from its own queue, and steals
+ *  the most urgent task of another thread if its queue is empty, so a long
+ *  task doesn't hold up the tasks queued behind it. Tasks submitted from
+ *  inside the pool are queued on the submitting thread.
+ */
 class ThreadPool
 {
  public:
@@ -64,9 +140,7 @@ class ThreadPool
    **/
   explicit ThreadPool(size_t numThreads);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
    * Add a job to the threadpool.
@@ -74,8 +148,9 @@ class ThreadPool
   void Submit(Task* task);
 
   /**
-   * Wait until all queued jobs have completed, and shut down
-   * the ThreadPool.
+   * Shut down the ThreadPool. If processRemainingJobs, wait until all
+   * queued jobs have completed. Otherwise, the running jobs are cancelled
+   * and the queued jobs are dropped.
    **/
   void Stop(bool processRemainingJobs = false);
 
@@ -84,20 +159,58 @@ class ThreadPool
    **/
   void SetQueueLimit( size_t limit ) { m_queueLimit = limit; }
 
+  size_t GetNumThreads() const { return m_workers.size(); }
+
+  ThreadPoolStats GetStats() const;
+
 private:
+  struct Entry {
+    Task *task;
+    double priority;
+    size_t seq;
+  };
+  //! for a heap with the most urgent entry on top
+  struct EntryOrderer {
+    bool operator()(const Entry &a, const Entry &b) const {
+      if (a.priority != b.priority) return a.priority > b.priority;
+      return a.seq > b.seq;
+    }
+  };
+
+  struct Worker {
+    mutable boost::mutex m_mutex; //! guards all members
+    std::vector<Entry> m_queue; //! heap ordered by EntryOrderer
+    Task *m_current; //! running task, or NULL
+    size_t m_executed, m_stolen;
+    double m_busySeconds;
+
+    Worker() : m_current(NULL), m_executed(0), m_stolen(0), m_busySeconds(0) {}
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t id);
+
+  //! take the most urgent task of worker id, or else steal one
+  bool Take(size_t id, Entry &entry);
+  bool PopFrom(Worker &worker, Entry &entry);
 
-  std::queue<Task*> m_tasks;
+  std::vector<Worker*> m_workers;
+  boost::thread_specific_ptr<size_t> m_workerId; //! set in the pool's threads
   boost::thread_group m_threads;
-  boost::mutex m_mutex;
+  mutable boost::mutex m_mutex; //! guards the members below
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
   bool m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
+  size_t m_queued; //! in all worker queues
+  size_t m_nextWorker; //! for tasks submitted from outside
+  size_t m_seq;
+  size_t m_submitted, m_cancelled, m_maxQueued;
+  boost::posix_time::ptime m_startTime;
+  boost::posix_time::ptime m_stopTime;
 };
 
 class TestTask : public Task
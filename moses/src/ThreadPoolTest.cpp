@@ -0,0 +1,192 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ThreadPool.h"
+#include "Util.h"
+
+using namespace Moses;
+using namespace std;
+
+#ifdef WITH_THREADS
+
+namespace
+{
+
+//! records the order in which tasks run
+class OrderTask : public Task
+{
+public:
+  OrderTask(int id, vector<int> &order, boost::mutex &mutex)
+    : m_id(id), m_order(order), m_mutex(mutex) {}
+  void Run() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_order.push_back(m_id);
+  }
+private:
+  int m_id;
+  vector<int> &m_order;
+  boost::mutex &m_mutex;
+};
+
+//! runs until it is released or cancelled
+class BlockingTask : public Task
+{
+public:
+  BlockingTask() : m_started(false), m_released(false) {}
+  bool DeleteAfterExecution() { return false; }
+  void Run() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_started = true;
+    m_changed.notify_all();
+    while (!m_released && !GetCancellationToken()->IsCancelled()) {
+      m_changed.timed_wait(lock, boost::posix_time::milliseconds(1));
+    }
+  }
+  void WaitUntilStarted() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_started) m_changed.wait(lock);
+  }
+  void Release() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_released = true;
+    m_changed.notify_all();
+  }
+private:
+  bool m_started, m_released;
+  boost::mutex m_mutex;
+  boost::condition_variable m_changed;
+};
+
+//! owned by the test, and counts whether the pool asks about it after it ran
+class OwnedTask : public Task
+{
+public:
+  explicit OwnedTask(int &askedAfterRun) : m_ran(false), m_askedAfterRun(askedAfterRun) {}
+  bool DeleteAfterExecution() {
+    if (m_ran) ++m_askedAfterRun;
+    return false;
+  }
+  void Run() {
+    m_ran = true;
+  }
+private:
+  bool m_ran;
+  int &m_askedAfterRun;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(priority_order)
+{
+  ThreadPool pool(1);
+  BlockingTask blocker;
+  pool.Submit(&blocker);
+  blocker.WaitUntilStarted();
+
+  vector<int> order;
+  boost::mutex mutex;
+  const int priorities[] = {5, 1, 3, 1};
+  for (int i = 0; i < 4; ++i) {
+    OrderTask *task = new OrderTask(i, order, mutex);
+    task->SetPriority(priorities[i]);
+    pool.Submit(task);
+  }
+  blocker.Release();
+  pool.Stop(true);
+
+  BOOST_REQUIRE_EQUAL(order.size(), 4);
+  BOOST_CHECK_EQUAL(order[0], 1);
+  BOOST_CHECK_EQUAL(order[1], 3);
+  BOOST_CHECK_EQUAL(order[2], 2);
+  BOOST_CHECK_EQUAL(order[3], 0);
+
+  ThreadPoolStats stats = pool.GetStats();
+  BOOST_CHECK_EQUAL(stats.submitted, 5);
+  BOOST_CHECK_EQUAL(stats.executed, 5);
+  BOOST_CHECK_EQUAL(stats.queued, 0);
+  BOOST_CHECK(stats.maxQueued >= 4);
+}
+
+BOOST_AUTO_TEST_CASE(steal_from_busy_thread)
+{
+  ThreadPool pool(2);
+  BlockingTask blocker;
+  pool.Submit(&blocker);
+  blocker.WaitUntilStarted();
+
+  // half of these are queued on the blocked thread, and have to be stolen
+  vector<int> order;
+  boost::mutex mutex;
+  for (int i = 0; i < 10; ++i) {
+    pool.Submit(new OrderTask(i, order, mutex));
+  }
+  for (;;) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (order.size() == 10) break;
+    lock.unlock();
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+  blocker.Release();
+  pool.Stop(true);
+  BOOST_CHECK(pool.GetStats().stolen > 0);
+}
+
+BOOST_AUTO_TEST_CASE(stop_cancels)
+{
+  ThreadPool pool(1);
+  BlockingTask blocker;
+  pool.Submit(&blocker);
+  blocker.WaitUntilStarted();
+  vector<int> order;
+  boost::mutex mutex;
+  pool.Submit(new OrderTask(0, order, mutex));
+
+  pool.Stop(false);
+  BOOST_CHECK(blocker.GetCancellationToken()->IsCancelled());
+  BOOST_CHECK(order.empty());
+  BOOST_CHECK_EQUAL(pool.GetStats().cancelled, 2);
+}
+
+BOOST_AUTO_TEST_CASE(owned_task_not_touched_after_run)
+{
+  // the owner of such a task may delete it as soon as Run() returns
+  int askedAfterRun = 0;
+  vector<OwnedTask*> tasks;
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 20; ++i) {
+      tasks.push_back(new OwnedTask(askedAfterRun));
+      pool.Submit(tasks.back());
+    }
+    pool.Stop(true);
+  }
+  RemoveAllInColl(tasks);
+  BOOST_CHECK_EQUAL(askedAfterRun, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -117,6 +117,17 @@ namespace Moses {
       for(size_t i=0;i<m_reorderingTables.size();++i) {
         m_reorderingTables[i]->InitializeForInput(source);
       }
+      InitializeSearchThread(source);
+      
+      LMList::const_iterator iterLM;
+      for (iterLM = m_languageModels.begin() ; iterLM != m_languageModels.end() ; ++iterLM)
+      {
+        LanguageModel &languageModel = **iterLM;
+        languageModel.InitializeBeforeSentenceProcessing();
+      }
+    }
+    
+    void TranslationSystem::InitializeSearchThread(const InputType& source) const {
       for(size_t i=0;i<m_globalLexicalModels.size();++i) {
         m_globalLexicalModels[i]->InitializeForInput((Sentence const&)source);
       }
@@ -128,15 +139,8 @@ namespace Moses {
 	        ((GlobalLexicalModelUnlimited*)m_statelessFFs[i])->InitializeForInput((Sentence const&)source);
         }
       }
-      
-      LMList::const_iterator iterLM;
-      for (iterLM = m_languageModels.begin() ; iterLM != m_languageModels.end() ; ++iterLM)
-      {
-        LanguageModel &languageModel = **iterLM;
-        languageModel.InitializeBeforeSentenceProcessing();
-      }
     }
-    
+
      void TranslationSystem::CleanUpAfterSentenceProcessing(const InputType& source) const {
         
         for(size_t i=0;i<m_phraseDictionaries.size();++i)
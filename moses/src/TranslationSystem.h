@@ -98,6 +98,8 @@ class TranslationSystem {
       //sentence (and thread) specific initialisationn and cleanup
       void InitializeBeforeSentenceProcessing(const InputType& source) const;
       void CleanUpAfterSentenceProcessing(const InputType& source) const;
+      //! the thread specific part, for other threads which score hypotheses of the sentence
+      void InitializeSearchThread(const InputType& source) const;
       
       const std::vector<const ScoreProducer*>& GetFeatureFunctions() const { return m_producers; }
         
@@ -74,7 +74,11 @@ const size_t DEFAULT_VERBOSE_LEVEL = 1;
 // can only be 2 at the moment
 const int NUM_LANGUAGES = 2;
 
-const size_t MAX_NUM_FACTORS = 4;
+// factors a word has room for. Set with the --max-factors build option: a
+// build for single-factor models has words of 16 rather than 40 bytes
+#ifndef MAX_NUM_FACTORS
+#define MAX_NUM_FACTORS 4
+#endif
 
 enum FactorDirection {
   Input,			//! Source factors
@@ -28,37 +28,125 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "WordsRange.h"
+#include "util/murmur_hash.hh"
 
 namespace Moses
 {
 typedef unsigned long WordsBitmapID;
 
-/** vector of boolean used to represent whether a word has been translated or not
+/** vector of boolean used to represent whether a word has been translated or not.
+ *  Packed into 64 bit words, which are kept inline for sentences of up to
+ *  128 words, so that copying and comparing coverage, finding gaps and
+ *  counting covered words take a few word operations instead of a loop
+ *  over the sentence. Bits past the end of the sentence are always 0.
 */
 class WordsBitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap);
 protected:
+  typedef uint64_t Block;
+  static const size_t BLOCK_BITS = 64;
+  static const size_t INLINE_BLOCKS = 2;
+
   const size_t m_size; /**< number of words in sentence */
-  bool	*m_bitmap;	/**< ticks of words that have been done */
+  const size_t m_numBlocks;
+  Block *m_bitmap;	/**< ticks of words that have been done, points to m_inline or the heap */
+  Block m_inline[INLINE_BLOCKS];
 
   WordsBitmap(); // not implemented
 
+  static size_t NumBlocks(size_t size) {
+    return (size + BLOCK_BITS - 1) / BLOCK_BITS;
+  }
+
+  void Allocate() {
+    m_bitmap = (m_numBlocks <= INLINE_BLOCKS) ? m_inline : new Block[m_numBlocks];
+  }
+
+  //! bits from..to-1 of a block, to <= BLOCK_BITS
+  static Block Mask(size_t from, size_t to) {
+    const Block upto = (to == BLOCK_BITS) ? ~(Block) 0 : (((Block) 1 << to) - 1);
+    return upto & ~(((Block) 1 << from) - 1);
+  }
+
+  static size_t PopCount(Block block) {
+#ifdef __GNUC__
+    return __builtin_popcountll(block);
+#else
+    size_t count = 0;
+    for (; block; block &= block - 1) ++count;
+    return count;
+#endif
+  }
+
+  //! index of the lowest set bit. block must not be 0
+  static size_t LowestBit(Block block) {
+#ifdef __GNUC__
+    return __builtin_ctzll(block);
+#else
+    size_t bit = 0;
+    while (!(block & 1)) {
+      block >>= 1;
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  //! index of the highest set bit. block must not be 0
+  static size_t HighestBit(Block block) {
+#ifdef __GNUC__
+    return BLOCK_BITS - 1 - __builtin_clzll(block);
+#else
+    size_t bit = 0;
+    while (block >>= 1) ++bit;
+    return bit;
+#endif
+  }
+
+  //! covered positions from..to-1 of block, to <= BLOCK_BITS
+  Block GetBlock(size_t block, size_t from = 0, size_t to = BLOCK_BITS) const {
+    return m_bitmap[block] & Mask(from, to);
+  }
+
+  //! set bits from..to-1 of block, to <= BLOCK_BITS
+  void SetBlock(size_t block, size_t from, size_t to, bool value) {
+    if (value) m_bitmap[block] |= Mask(from, to);
+    else m_bitmap[block] &= ~Mask(from, to);
+  }
+
+  //! count bits at positions pos..pos+count-1, count <= BLOCK_BITS - 1, as a number
+  Block GetBits(size_t pos, size_t count) const {
+    if (count == 0) return 0;
+    const size_t block = pos / BLOCK_BITS, offset = pos % BLOCK_BITS;
+    Block bits = m_bitmap[block] >> offset;
+    if (offset + count > BLOCK_BITS) bits |= m_bitmap[block + 1] << (BLOCK_BITS - offset);
+    return bits & Mask(0, count);
+  }
+
+  //! mask of the valid positions in the last block
+  Block LastBlockMask() const {
+    const size_t rest = m_size % BLOCK_BITS;
+    return rest ? Mask(0, rest) : ~(Block) 0;
+  }
+
   //! set all elements to false
   void Initialize() {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      m_bitmap[pos] = false;
+    for (size_t block = 0 ; block < m_numBlocks ; block++) {
+      m_bitmap[block] = 0;
     }
   }
 
   //sets elements by vector
   void Initialize(std::vector<bool> vector) {
+    Initialize();
     size_t vector_size = vector.size();
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (pos < vector_size && vector[pos] == true) m_bitmap[pos] = true;
-      else m_bitmap[pos] = false;
+    for (size_t pos = 0 ; pos < m_size && pos < vector_size ; pos++) {
+      if (vector[pos]) SetValue(pos, true);
     }
   }
 
@@ -66,42 +154,41 @@ protected:
 public:
   //! create WordsBitmap of length size and initialise with vector
   WordsBitmap(size_t size, std::vector<bool> initialize_vector)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size), m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize(initialize_vector);
   }
   //! create WordsBitmap of length size and initialise
   WordsBitmap(size_t size)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size), m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize();
   }
   //! deep copy
   WordsBitmap(const WordsBitmap &copy)
-    :m_size	(copy.m_size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * m_size);
-    for (size_t pos = 0 ; pos < copy.m_size ; pos++) {
-      m_bitmap[pos] = copy.GetValue(pos);
-    }
+    :m_size	(copy.m_size), m_numBlocks(copy.m_numBlocks) {
+    Allocate();
+    std::memcpy(m_bitmap, copy.m_bitmap, m_numBlocks * sizeof(Block));
   }
   ~WordsBitmap() {
-    free(m_bitmap);
+    if (m_bitmap != m_inline) delete [] m_bitmap;
   }
   //! count of words translated
   size_t GetNumWordsCovered() const {
     size_t count = 0;
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (m_bitmap[pos])
-        count++;
+    for (size_t block = 0 ; block < m_numBlocks ; block++) {
+      count += PopCount(m_bitmap[block]);
     }
     return count;
   }
 
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t block = 0 ; block < m_numBlocks ; block++) {
+      Block gaps = ~m_bitmap[block];
+      if (block + 1 == m_numBlocks) gaps &= LastBlockMask();
+      if (gaps) {
+        return block * BLOCK_BITS + LowestBit(gaps);
       }
     }
     // no starting pos
@@ -111,9 +198,11 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t block = m_numBlocks ; block-- > 0 ; ) {
+      Block gaps = ~m_bitmap[block];
+      if (block + 1 == m_numBlocks) gaps &= LastBlockMask();
+      if (gaps) {
+        return block * BLOCK_BITS + HighestBit(gaps);
       }
     }
     // no starting pos
@@ -123,9 +212,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
+    for (size_t block = m_numBlocks ; block-- > 0 ; ) {
+      if (m_bitmap[block]) {
+        return block * BLOCK_BITS + HighestBit(m_bitmap[block]);
       }
     }
     // no starting pos
@@ -134,26 +223,35 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return m_bitmap[pos];
+    return (m_bitmap[pos / BLOCK_BITS] >> (pos % BLOCK_BITS)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    m_bitmap[pos] = value;
+    const Block bit = (Block) 1 << (pos % BLOCK_BITS);
+    if (value) m_bitmap[pos / BLOCK_BITS] |= bit;
+    else m_bitmap[pos / BLOCK_BITS] &= ~bit;
   }
   //! set value between 2 positions, inclusive
   void SetValue( size_t startPos, size_t endPos, bool value ) {
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = value;
+    if (endPos < startPos) return;
+    const size_t first = startPos / BLOCK_BITS, last = endPos / BLOCK_BITS;
+    for (size_t block = first ; block <= last ; block++) {
+      SetBlock(block, (block == first) ? startPos % BLOCK_BITS : 0,
+               (block == last) ? endPos % BLOCK_BITS + 1 : BLOCK_BITS, value);
     }
   }
   //! whether every word has been translated
   bool IsComplete() const {
-    return GetSize() == GetNumWordsCovered();
+    return GetFirstGapPos() == NOT_FOUND;
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const WordsRange &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    const size_t startPos = compare.GetStartPos(), endPos = compare.GetEndPos();
+    if (endPos < startPos) return false;
+    const size_t first = startPos / BLOCK_BITS, last = endPos / BLOCK_BITS;
+    for (size_t block = first ; block <= last ; block++) {
+      if (GetBlock(block, (block == first) ? startPos % BLOCK_BITS : 0,
+                   (block == last) ? endPos % BLOCK_BITS + 1 : BLOCK_BITS))
         return true;
     }
     return false;
@@ -175,27 +273,48 @@ public:
     if (thisSize != compareSize) {
       return (thisSize < compareSize) ? -1 : 1;
     }
-    return std::memcmp(m_bitmap, compare.m_bitmap, thisSize * sizeof(bool));
+    // ordered as the unpacked arrays of bool were: by the first position
+    // where the bitmaps differ, the one not covering it first
+    for (size_t block = 0 ; block < m_numBlocks ; block++) {
+      const Block diff = m_bitmap[block] ^ compare.m_bitmap[block];
+      if (diff) {
+        return (m_bitmap[block] >> LowestBit(diff)) & 1 ? 1 : -1;
+      }
+    }
+    return 0;
   }
 
   bool operator< (const WordsBitmap &compare) const {
     return Compare(compare) < 0;
   }
 
+  //! hash consistent with Compare()
+  inline size_t hash() const {
+    return util::MurmurHashNative(m_bitmap, m_numBlocks * sizeof(Block), m_size);
+  }
+
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
+    // one past the last covered position before l
+    for (size_t block = (l - 1) / BLOCK_BITS + 1 ; block-- > 0 ; ) {
+      const Block covered = GetBlock(block, 0, (block == (l - 1) / BLOCK_BITS) ? (l - 1) % BLOCK_BITS + 1 : BLOCK_BITS);
+      if (covered) {
+        return block * BLOCK_BITS + HighestBit(covered) + 1;
+      }
     }
-    return l;
+    return 0;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_size) return r;
-    while (r+1 < m_size && !m_bitmap[r+1]) {
-      ++r;
+    if (r+1 >= m_size) return r;
+    // one before the first covered position after r
+    for (size_t block = (r + 1) / BLOCK_BITS ; block < m_numBlocks ; block++) {
+      const Block covered = GetBlock(block, (block == (r + 1) / BLOCK_BITS) ? (r + 1) % BLOCK_BITS : 0);
+      if (covered) {
+        return block * BLOCK_BITS + LowestBit(covered) - 1;
+      }
     }
-    return r;
+    return m_size - 1;
   }
 
 
@@ -213,10 +332,8 @@ public:
     if (end == NOT_FOUND) end = 0; // nothing translated yet
 
     CHECK(end < start || end-start <= 16);
-    WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2 + (int) GetValue(pos);
-    }
+    // bits start+1..end, with end as the most significant
+    WordsBitmapID id = (end > start) ? GetBits(start + 1, end - start) : 0;
     return id + (1<<16) * start;
   }
 
@@ -235,10 +352,13 @@ public:
 
     CHECK(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2;
-      if (GetValue(pos) || (startPos<=pos && pos<=endPos))
-        id++;
+    if (end > start) {
+      id = GetBits(start + 1, end - start);
+      // and the span, clipped to start+1..end
+      const size_t from = std::max(startPos, start + 1);
+      if (from <= endPos) {
+        id |= Mask(from - start - 1, endPos - start);
+      }
     }
     return id + (1<<16) * start;
   }
@@ -249,7 +369,7 @@ public:
 // friend
 inline std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap)
 {
-  for (size_t i = 0 ; i < wordsBitmap.m_size ; i++) {
+  for (size_t i = 0 ; i < wordsBitmap.GetSize() ; i++) {
     out << (wordsBitmap.GetValue(i) ? 1 : 0);
   }
   return out;
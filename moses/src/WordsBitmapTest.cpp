@@ -0,0 +1,139 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdlib>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "WordsBitmap.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(words_bitmap)
+
+// the unpacked implementation, to check the packed one against
+static size_t FirstGap(const vector<bool> &bits)
+{
+  for (size_t pos = 0; pos < bits.size(); ++pos) {
+    if (!bits[pos]) return pos;
+  }
+  return NOT_FOUND;
+}
+
+static size_t LastGap(const vector<bool> &bits)
+{
+  for (size_t pos = bits.size(); pos-- > 0; ) {
+    if (!bits[pos]) return pos;
+  }
+  return NOT_FOUND;
+}
+
+static size_t LastPos(const vector<bool> &bits)
+{
+  for (size_t pos = bits.size(); pos-- > 0; ) {
+    if (bits[pos]) return pos;
+  }
+  return NOT_FOUND;
+}
+
+static void CheckSame(const WordsBitmap &bitmap, const vector<bool> &bits)
+{
+  size_t covered = 0;
+  for (size_t pos = 0; pos < bits.size(); ++pos) {
+    BOOST_REQUIRE_EQUAL(bitmap.GetValue(pos), bits[pos]);
+    covered += bits[pos];
+  }
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(), covered);
+  BOOST_CHECK_EQUAL(bitmap.IsComplete(), covered == bits.size());
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), FirstGap(bits));
+  BOOST_CHECK_EQUAL(bitmap.GetLastGapPos(), LastGap(bits));
+  BOOST_CHECK_EQUAL(bitmap.GetLastPos(), LastPos(bits));
+
+  for (size_t pos = 0; pos < bits.size(); ++pos) {
+    size_t left = pos;
+    while (left && !bits[left - 1]) --left;
+    BOOST_CHECK_EQUAL(bitmap.GetEdgeToTheLeftOf(pos), left);
+    size_t right = pos;
+    while (right + 1 < bits.size() && !bits[right + 1]) ++right;
+    BOOST_CHECK_EQUAL(bitmap.GetEdgeToTheRightOf(pos), right);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(random_against_unpacked)
+{
+  srand(1234);
+  const size_t sizes[] = {1, 7, 63, 64, 65, 127, 128, 129, 200};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    const size_t size = sizes[s];
+    WordsBitmap bitmap(size);
+    vector<bool> bits(size, false);
+    CheckSame(bitmap, bits);
+    for (size_t step = 0; step < 50; ++step) {
+      size_t start = rand() % size, end = rand() % size;
+      if (end < start) std::swap(start, end);
+      const bool value = rand() % 3 != 0;
+
+      bool overlap = false;
+      for (size_t pos = start; pos <= end; ++pos) overlap = overlap || bits[pos];
+      BOOST_CHECK_EQUAL(bitmap.Overlap(WordsRange(start, end)), overlap);
+
+      bitmap.SetValue(start, end, value);
+      for (size_t pos = start; pos <= end; ++pos) bits[pos] = value;
+      CheckSame(bitmap, bits);
+
+      WordsBitmap copy(bitmap);
+      CheckSame(copy, bits);
+      BOOST_CHECK_EQUAL(copy.Compare(bitmap), 0);
+      BOOST_CHECK_EQUAL(copy.hash(), bitmap.hash());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compare_by_first_difference)
+{
+  WordsBitmap a(100), b(100);
+  a.SetValue(70, true);
+  b.SetValue(3, true);
+  // as memcmp on arrays of bool: b covers the first differing position
+  BOOST_CHECK(a < b);
+  BOOST_CHECK_EQUAL(b.Compare(a), 1);
+  b.SetValue(3, false);
+  b.SetValue(70, true);
+  BOOST_CHECK_EQUAL(a.Compare(b), 0);
+  BOOST_CHECK(WordsBitmap(5) < WordsBitmap(6));
+}
+
+BOOST_AUTO_TEST_CASE(ids)
+{
+  // first gap at 2, covered 0,1,4,5
+  WordsBitmap bitmap(10);
+  bitmap.SetValue(0, 1, true);
+  bitmap.SetValue(4, 5, true);
+  // pattern of positions 5..3, most significant first: 110
+  BOOST_CHECK_EQUAL(bitmap.GetID(), (WordsBitmapID) (6 + (1<<16) * 2));
+  // plus 7..7: pattern of positions 7..3: 10110
+  BOOST_CHECK_EQUAL(bitmap.GetIDPlus(7, 7), (WordsBitmapID) (22 + (1<<16) * 2));
+  // plus 2..3 starting at the first gap moves it past the span, to 4:
+  // pattern of position 5 only
+  BOOST_CHECK_EQUAL(bitmap.GetIDPlus(2, 3), (WordsBitmapID) (1 + (1<<16) * 4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
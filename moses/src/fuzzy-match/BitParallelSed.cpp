@@ -0,0 +1,137 @@
+//
+//  BitParallelSed.cpp
+//  fuzzy-match
+//
+
+#include <cstdlib>
+#include "fuzzy-match/BitParallelSed.h"
+
+using namespace std;
+
+namespace tmmt
+{
+
+namespace
+{
+
+const size_t BLOCK_SIZE = 64;
+
+/* one column of a block: eq has the rows of the text word, hin is the
+ difference between this and the last column of the cell above the block.
+ Returns that difference for the cell in row last_row */
+inline int advance_block( uint64_t &pv, uint64_t &mv, uint64_t eq, int hin, uint64_t last_row )
+{
+  const uint64_t hin_neg = (hin < 0) ? 1 : 0;
+  const uint64_t hin_pos = (hin > 0) ? 1 : 0;
+
+  const uint64_t xv = eq | mv;
+  eq |= hin_neg;
+  const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+  uint64_t ph = mv | ~(xh | pv);
+  uint64_t mh = pv & xh;
+
+  int hout = 0;
+  if (ph & last_row)
+    hout = 1;
+  else if (mh & last_row)
+    hout = -1;
+
+  ph = (ph << 1) | hin_pos;
+  mh = (mh << 1) | hin_neg;
+  pv = mh | ~(xv | ph);
+  mv = ph & xv;
+  return hout;
+}
+
+}
+
+void BitParallelSed::Init( const vector< WORD_ID > &pattern )
+{
+  m_length = pattern.size();
+  m_blocks = (m_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  m_peq.clear();
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    vector< uint64_t > &eq = m_peq[ pattern[i] ];
+    if (eq.empty())
+      eq.resize( m_blocks, 0 );
+    eq[ i / BLOCK_SIZE ] |= (uint64_t) 1 << (i % BLOCK_SIZE);
+  }
+}
+
+unsigned int BitParallelSed::Distance( const vector< WORD_ID > &text, unsigned int max_cost ) const
+{
+  const int m = m_length;
+  const int n = text.size();
+  // no distance is more than m+n
+  const int k = (max_cost < (unsigned int) (m + n)) ? max_cost : m + n;
+
+  if (abs( m - n ) > k)
+    return max_cost + 1;
+  if (m == 0)
+    return n;
+
+  // rows of each block, and the bit of its last row
+  const int blocks = m_blocks;
+  const int last_height = m - (blocks - 1) * BLOCK_SIZE;
+  vector< int > height( blocks, BLOCK_SIZE );
+  height[ blocks - 1 ] = last_height;
+  vector< uint64_t > last_row( blocks, (uint64_t) 1 << (BLOCK_SIZE - 1) );
+  last_row[ blocks - 1 ] = (uint64_t) 1 << (last_height - 1);
+
+  // differences down each column, and the cost in the last row of each block.
+  // Blocks below y only have costs over k, and aren't computed
+  vector< uint64_t > pv( blocks, ~(uint64_t) 0 );
+  vector< uint64_t > mv( blocks, 0 );
+  vector< int > score( blocks );
+  int y = min( blocks - 1, k / (int) BLOCK_SIZE );
+  for (int b = 0; b <= y; ++b)
+    score[b] = b * BLOCK_SIZE + height[b];
+
+  for (int j = 0; j < n; ++j) {
+    map< WORD_ID, vector< uint64_t > >::const_iterator found = m_peq.find( text[j] );
+    const uint64_t *eq = (found == m_peq.end()) ? NULL : &found->second[0];
+
+    // the first row costs one more in each column
+    int hout = 1;
+    int prev_score = 0;
+    for (int b = 0; b <= y; ++b) {
+      prev_score = score[b];
+      hout = advance_block( pv[b], mv[b], eq ? eq[b] : 0, hout, last_row[b] );
+      score[b] += hout;
+    }
+
+    // the block below may now have costs within k. Its last column is taken
+    // to go up by one a row from the block above, which is no less than the
+    // real costs and over k, as the block wasn't computed
+    while (y + 1 < blocks && min( prev_score, score[y] ) <= k) {
+      ++y;
+      pv[y] = ~(uint64_t) 0;
+      mv[y] = 0;
+      score[y] = prev_score + height[y];
+      prev_score = score[y];
+      hout = advance_block( pv[y], mv[y], eq ? eq[y] : 0, hout, last_row[y] );
+      score[y] += hout;
+    }
+
+    // drop blocks whose costs are all over k. If none are left, and the
+    // first row is over k too, so is the distance
+    while (score[y] - height[y] + 1 > k) {
+      if (y == 0) {
+        if (j + 1 > k)
+          return max_cost + 1;
+        break;
+      }
+      --y;
+    }
+
+    // the cost can go down by at most one in each of the remaining columns
+    if (y == blocks - 1 && score[y] - (n - j - 1) > k)
+      return max_cost + 1;
+  }
+
+  if (y == blocks - 1 && score[y] <= k)
+    return score[y];
+  return max_cost + 1;
+}
+
+}
@@ -0,0 +1,44 @@
+//
+//  BitParallelSed.h
+//  fuzzy-match
+//
+
+#ifndef fuzzy_match_BitParallelSed_h
+#define fuzzy_match_BitParallelSed_h
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include "fuzzy-match/Vocabulary.h"
+
+namespace tmmt
+{
+
+/* word edit distance of many sentences to one fixed sentence (the pattern),
+ with bit vectors of the differences between neighbouring cells of the
+ dynamic programming matrix (Myers 1999, in blocks of 64 rows as in Hyyrö
+ 2003). Only the blocks that can still hold a cost within the maximum cost
+ are computed (Ukkonen's cut-off), and the computation stops as soon as the
+ distance is known to exceed it */
+
+class BitParallelSed
+{
+public:
+  BitParallelSed() : m_length(0), m_blocks(0) {}
+
+  void Init( const std::vector< WORD_ID > &pattern );
+
+  /* edit distance between pattern and text, or max_cost+1 if it is more
+   than max_cost. Can be called by several threads at once */
+  unsigned int Distance( const std::vector< WORD_ID > &text, unsigned int max_cost ) const;
+
+private:
+  size_t m_length; // of the pattern
+  size_t m_blocks;
+  // for each word of the pattern, the rows in which it is, m_blocks each
+  std::map< WORD_ID, std::vector< uint64_t > > m_peq;
+};
+
+}
+
+#endif
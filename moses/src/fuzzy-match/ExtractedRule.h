@@ -0,0 +1,30 @@
+//
+//  ExtractedRule.h
+//  fuzzy-match
+//
+
+#ifndef fuzzy_match_ExtractedRule_h
+#define fuzzy_match_ExtractedRule_h
+
+#include <vector>
+#include "fuzzy-match/Vocabulary.h"
+
+namespace tmmt
+{
+
+/* hierarchical rule made from a translation memory match for an input
+ sentence, as scripts/fuzzy-match/create_xml.perl makes them */
+
+struct ExtractedRule
+{
+  static const unsigned int NON_TERMINAL = (unsigned int) -1;
+
+  std::vector< unsigned int > source; // positions of input words, or NON_TERMINAL
+  std::vector< WORD_ID > target;      // target words, or NON_TERMINAL
+  std::vector< std::pair<int,int> > alignment; // of words and non-terminals
+  int count;
+};
+
+}
+
+#endif
@@ -6,13 +6,16 @@
 //  Copyright 2012 __MyCompanyName__. All rights reserved.
 //
 
+#include <climits>
 #include <iostream>
+#include <set>
+#include <boost/shared_ptr.hpp>
 #include "fuzzy-match/FuzzyMatchWrapper.h"
 #include "fuzzy-match/SentenceAlignment.h"
 #include "fuzzy-match/Vocabulary.h"
 #include "fuzzy-match/Match.h"
 #include "Util.h"
-#include "StaticData.h"
+#include "ThreadPool.h"
 #include "util/file.hh"
 
 using namespace std;
@@ -20,16 +23,21 @@ using namespace std;
 namespace tmmt 
 {
 
-  FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath)
+  const unsigned int ExtractedRule::NON_TERMINAL;
+
+  FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath, size_t threads)
   :basic_flag(false)
   ,lsed_flag(true)
   ,refined_flag(true)
   ,length_filter_flag(true)
   ,parse_flag(true)
+  ,plain_sed_flag(false)
   ,min_match(70)
   ,multiple_flag(false)
   ,multiple_slack(0)
   ,multiple_max(100)
+  ,threads(threads)
+  ,thread_pool(NULL)
   {
     // create suffix array
     //load_corpus(m_config[0], input);
@@ -41,39 +49,113 @@ namespace tmmt
     suffixArray = new tmmt::SuffixArray( sourcePath );
     cerr << "done creating suffix array" << endl;
 
+#ifdef WITH_THREADS
+    // the thread matching a sentence is one of the threads evaluating its candidates
+    if (threads > 1) {
+      thread_pool = new Moses::ThreadPool(threads - 1);
+    }
+#endif
   }
 
-  string FuzzyMatchWrapper::Extract(const string &dirNameStr)
+  FuzzyMatchWrapper::~FuzzyMatchWrapper()
   {
-    const Moses::StaticData &staticData = Moses::StaticData::Instance();
-    
-    string fuzzyMatchFile = ExtractTM(dirNameStr);
-    
-    string cmd("perl ");
-#ifdef IS_XCODE
-    cmd += "/Users/hieuhoang/unison/workspace/github/moses-smt/scripts/fuzzy-match/create_xml.perl " + fuzzyMatchFile;
-#elif IS_ECLIPSE
-    cmd += "/home/hieu/workspace/github/moses-smt/scripts/fuzzy-match/create_xml.perl " + fuzzyMatchFile;
-#else
-    cmd += staticData.GetBinDirectory() +  "/../scripts/fuzzy-match/create_xml.perl " + fuzzyMatchFile;
+#ifdef WITH_THREADS
+    delete thread_pool;
 #endif
-    cerr << cmd << endl;
-    system(cmd.c_str());
-        
-    return fuzzyMatchFile + ".pt.gz";
+    delete suffixArray;
   }
-  
-  string FuzzyMatchWrapper::ExtractTM(const string &dirNameStr)
+
+  /* the corpus sentences with matches of an input sentence. They are
+   evaluated in batches, and all the sentences of a batch are pruned with the
+   best cost of the batches before it. So the costs don't depend on the
+   number of threads, or on which thread evaluates which sentence */
+  struct FuzzyMatchWrapper::CandidateSearch
   {
-    string inputPath = dirNameStr + "/in";    
-    string fuzzyMatchFile = dirNameStr + "/fuzzyMatchFile";
-    ofstream fuzzyMatchStream(fuzzyMatchFile.c_str());
- 
-    vector< vector< WORD_ID > > input;
-    load_corpus(inputPath, input);
-    
-    assert(input.size() == 1);
-    size_t sentenceInd = 0;
+    static const size_t BATCH_SIZE = 64;
+
+    CandidateSearch( const MatchState &state, int best_cost )
+    :state(state)
+    ,best_cost(best_cost)
+    ,batch_best_cost(best_cost)
+    ,next(0)
+    ,batch_end(0)
+    ,running(0)
+    {}
+
+    const MatchState &state;
+    vector< pair< int, vector< Match > * > > candidates;
+    vector< int > costs;
+
+    // the following are shared by the threads
+    int best_cost; // of the finished batches
+    int batch_best_cost;
+    size_t next;
+    size_t batch_end;
+    size_t running; // candidates of the batch being evaluated
+    FilterCounts counts;
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+    boost::condition_variable batch_done;
+#endif
+  };
+
+  const size_t FuzzyMatchWrapper::CandidateSearch::BATCH_SIZE;
+
+#ifdef WITH_THREADS
+  class FuzzyMatchWrapper::CandidateTask : public Moses::Task
+  {
+  public:
+    CandidateTask( const FuzzyMatchWrapper &wrapper, const boost::shared_ptr< CandidateSearch > &search )
+    :m_wrapper(wrapper)
+    ,m_search(search)
+    {}
+
+    void Run() {
+      m_wrapper.evaluate_candidates( *m_search );
+    }
+
+  private:
+    const FuzzyMatchWrapper &m_wrapper;
+    // the task may only start when the sentence is done, and finds nothing left
+    boost::shared_ptr< CandidateSearch > m_search;
+  };
+#endif
+
+  int FuzzyMatchWrapper::Extract(const vector< string > &inputWords, vector< ExtractedRule > &rules) const
+  {
+    MatchState state;
+    const WORD_ID vocabSize = vocabulary.vocab.size();
+    for (size_t i = 0; i < inputWords.size(); ++i) {
+      map< WORD, WORD_ID >::const_iterator found = vocabulary.lookup.find( inputWords[i] );
+      if (found != vocabulary.lookup.end()) {
+        state.input.push_back( found->second );
+      } else {
+        state.input.push_back( vocabSize + state.unknown.size() );
+        state.unknown.push_back( inputWords[i] );
+      }
+    }
+
+    vector< pair< int, string > > best;
+    const int best_cost = find_best_matches( state, best );
+    // without a match there are no rules. The extraction through files fell
+    // back to corpus sentence 0 with an empty path, which matches no input
+    // word, so create_rule() would make no rule of it anyway
+
+    for (size_t i = 0; i < best.size(); ++i) {
+      const vector< SentenceAlignment > &targets = targetAndAlignment[best[i].first];
+      for (size_t targetInd = 0; targetInd < targets.size(); ++targetInd) {
+        ExtractedRule rule;
+        if (create_rule( source[best[i].first], targets[targetInd], best[i].second, state.input.size(), rule )) {
+          rules.push_back( rule );
+        }
+      }
+    }
+    return best_cost;
+  }
+
+  int FuzzyMatchWrapper::find_best_matches( MatchState &state, vector< pair< int, string > > &best ) const
+  {
+    const vector< WORD_ID > &input = state.input;
     
 		clock_t start_clock = clock();
 		// if (i % 10 == 0) cerr << ".";
@@ -81,7 +163,7 @@ namespace tmmt
 		// establish some basic statistics
     
 		// int input_length = compute_length( input[i] );
-		int input_length = input[sentenceInd].size();
+		int input_length = input.size();
 		int best_cost = input_length * (100-min_match) / 100 + 1;
     
 		int match_count = 0; // how many substring matches to be considered
@@ -89,7 +171,7 @@ namespace tmmt
     
 		// find match ranges in suffix array
 		vector< vector< pair< SuffixArray::INDEX, SuffixArray::INDEX > > > match_range;
-		for(size_t start=0;start<input[sentenceInd].size();start++) 
+		for(size_t start=0;start<input.size();start++) 
 		{
 			SuffixArray::INDEX prior_first_match = 0;
 			SuffixArray::INDEX prior_last_match = suffixArray->GetSize()-1;
@@ -97,9 +179,11 @@ namespace tmmt
 			bool stillMatched = true;
 			vector< pair< SuffixArray::INDEX, SuffixArray::INDEX > > matchedAtThisStart;
 			//cerr << "start: " << start;
-			for(int word=start; stillMatched && word<input[sentenceInd].size(); word++)
+			for(int word=start; stillMatched && word<input.size(); word++)
 			{
-				substring.push_back( vocabulary.GetWord( input[sentenceInd][word] ) );
+				// words that aren't in the vocabulary aren't in the corpus
+				if (input[word] >= vocabulary.vocab.size()) break;
+				substring.push_back( vocabulary.GetWord( input[word] ) );
         
 				// only look up, if needed (i.e. no unnecessary short gram lookups)
         //				if (! word-start+1 <= short_match_max_length( input_length ) )
@@ -127,7 +211,7 @@ namespace tmmt
 		map< int, int > sentence_match_word_count;
     
 		// go through all matches, longest first
-		for(int length = input[sentenceInd].size(); length >= 1; length--)
+		for(int length = input.size(); length >= 1; length--)
 		{
 			// do not create matches, if these are handled by the short match function
 			if (length <= short_match_max_length( input_length ) )
@@ -136,7 +220,7 @@ namespace tmmt
 			}
       
 			unsigned int count = 0;
-			for(int start = 0; start <= input[sentenceInd].size() - length; start++)
+			for(int start = 0; start <= input.size() - length; start++)
 			{
 				if (match_range[start].size() >= length)
 				{
@@ -224,82 +308,50 @@ namespace tmmt
     
 		// consider each sentence for which we have matches
 		int old_best_cost = best_cost;
-		int tm_count_word_match = 0;
-		int tm_count_word_match2 = 0;
-		int pruned_match_count = 0;
 		if (short_match_max_length( input_length ))
 		{
-			init_short_matches( input[sentenceInd] );
+			init_short_matches( state );
 		}
-		vector< int > best_tm;
+		state.input_sed.Init( input );
+
+		boost::shared_ptr< CandidateSearch > search( new CandidateSearch( state, best_cost ) );
 		typedef map< int, vector< Match > >::iterator I;
-    
-		clock_t clock_validation_sum = 0;
-    
 		for(I tm=sentence_match.begin(); tm!=sentence_match.end(); tm++)
 		{
-			int tmID = tm->first;
-			int tm_length = suffixArray->GetSentenceLength(tmID);
-			vector< Match > &match = tm->second;
-			add_short_matches( match, source[tmID], input_length, best_cost );
-      
-			//cerr << "match in sentence " << tmID << ": " << match.size() << " [" << tm_length << "]" << endl;
-      
-			// quick look: how many words are matched
-			int words_matched = 0;
-			for(int m=0;m<match.size();m++) {
-        
-				if (match[m].min_cost <= best_cost) // makes no difference
-					words_matched += match[m].input_end - match[m].input_start + 1;
-			}
-			if (max(input_length,tm_length) - words_matched > best_cost)
-			{
-				if (length_filter_flag) continue;
-			}
-			tm_count_word_match++;
-      
-			// prune, check again how many words are matched
-			vector< Match > pruned = prune_matches( match, best_cost );
-			words_matched = 0;
-			for(int p=0;p<pruned.size();p++) {
-				words_matched += pruned[p].input_end - pruned[p].input_start + 1;
-			}
-			if (max(input_length,tm_length) - words_matched > best_cost)
-			{
-				if (length_filter_flag) continue;
-			}
-			tm_count_word_match2++;
-      
-			pruned_match_count += pruned.size();
-			int prior_best_cost = best_cost;
-			int cost;
-      
-			clock_t clock_validation_start = clock();
-			if (! parse_flag ||
-			    pruned.size()>=10) // to prevent worst cases
-			{
-				string path;
-				cost = sed( input[sentenceInd], source[tmID], path, false );
-				if (cost <  best_cost) 
-				{
-					best_cost = cost;
-				}
-			}
-      
-			else
-			{
-				cost = parse_matches( pruned, input_length, tm_length, best_cost );
-				if (prior_best_cost != best_cost)
-				{
-					best_tm.clear();
-				}
+			search->candidates.push_back( make_pair( tm->first, &tm->second ) );
+		}
+		search->costs.resize( search->candidates.size() );
+
+#ifdef WITH_THREADS
+		if (thread_pool) {
+			size_t tasks = min( threads, search->candidates.size() );
+			for (size_t task = 1; task < tasks; ++task) {
+				thread_pool->Submit( new CandidateTask( *this, search ) );
 			}
-			clock_validation_sum += clock() - clock_validation_start;
-			if (cost == best_cost)
+		}
+#endif
+		evaluate_candidates( *search );
+
+		// all the sentences with the lowest cost
+		best_cost = search->best_cost;
+		vector< int > best_tm;
+		for(size_t i = 0; i < search->candidates.size(); i++)
+		{
+			if (search->costs[i] == best_cost)
 			{
-				best_tm.push_back( tmID );
+				best_tm.push_back( search->candidates[i].first );
 			}
 		}
+		FilterCounts counts;
+		{
+#ifdef WITH_THREADS
+			boost::mutex::scoped_lock lock( search->mutex );
+#endif
+			counts = search->counts;
+		}
+		int tm_count_word_match = counts.word_match;
+		int tm_count_word_match2 = counts.word_match2;
+		int pruned_match_count = counts.pruned_match;
 		cerr << "reduced best cost from " << old_best_cost << " to " << best_cost << endl;
 		cerr << "tm considered: " << sentence_match.size()
     << " word-matched: " << tm_count_word_match 
@@ -308,28 +360,18 @@ namespace tmmt
     
 		cerr << "pruned matches: " << ((float)pruned_match_count/(float)tm_count_word_match2) << endl;
     
-    // create xml and extract files
-    string inputStr, sourceStr;
-    for (size_t pos = 0; pos < input_length; ++pos) {
-      inputStr += vocabulary.GetWord(input[sentenceInd][pos]) + " ";
-    }
-    
 		// do not try to find the best ... report multiple matches
 		if (multiple_flag) {
-			int input_letter_length = compute_length( input[sentenceInd] );
 			for(int si=0; si<best_tm.size(); si++) {
 				int s = best_tm[si];
 				string path;
-				unsigned int letter_cost = sed( input[sentenceInd], source[s], path, true );
+				sed( input, source[s], path, true, state );
 				// do not report multiple identical sentences, but just their count
 				//cout << sentenceInd << " "; // sentence number
-				//cout << letter_cost << "/" << input_letter_length << " ";
 				//cout << "(" << best_cost <<"/" << input_length <<") ";
 				//cout << "||| " << s << " ||| " << path << endl;
         
-        vector<WORD_ID> &sourceSentence = source[s];
-        vector<SentenceAlignment> &targets = targetAndAlignment[s];
-        create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, path, fuzzyMatchStream);
+        best.push_back( make_pair( s, path ) );
         
 			}
 		} // if (multiple_flag)
@@ -340,12 +382,12 @@ namespace tmmt
       int best_match = -1;
       int best_letter_cost;
       if (lsed_flag) {
-        best_letter_cost = compute_length( input[sentenceInd] ) * min_match / 100 + 1;
+        best_letter_cost = compute_length( input, state ) * min_match / 100 + 1;
         for(int si=0; si<best_tm.size(); si++)
         {
           int s = best_tm[si];
           string path;
-          unsigned int letter_cost = sed( input[sentenceInd], source[s], path, true );
+          unsigned int letter_cost = sed( input, source[s], path, true, state );
           if (letter_cost < best_letter_cost)
           {
             best_letter_cost = letter_cost;
@@ -358,7 +400,7 @@ namespace tmmt
       else {
         if (best_tm.size() > 0) {
           string path;
-          sed( input[sentenceInd], source[best_tm[0]], path, false );
+          sed( input, source[best_tm[0]], path, false, state );
           best_path = path;
           best_match = best_tm[0];
         }
@@ -367,10 +409,9 @@ namespace tmmt
       << " ( range: " << (1000 * (clock_range-start_clock) / CLOCKS_PER_SEC)
       << " match: " << (1000 * (clock_matches-clock_range) / CLOCKS_PER_SEC)
       << " tm: " << (1000 * (clock()-clock_matches) / CLOCKS_PER_SEC)
-      << " (validation: " << (1000 * (clock_validation_sum) / CLOCKS_PER_SEC) << ")"
       << " )" << endl;
       if (lsed_flag) {
-        //cout << best_letter_cost << "/" << compute_length( input[sentenceInd] ) << " (";
+        //cout << best_letter_cost << "/" << compute_length( input, state ) << " (";
       }
       //cout << best_cost <<"/" << input_length;
       if (lsed_flag) {
@@ -378,21 +419,13 @@ namespace tmmt
       }
       //cout << " ||| " << best_match << " ||| " << best_path << endl;
       
-      if (best_match == -1) {
-        CHECK(source.size());
-        best_match = 0;
+      if (best_match != -1) {
+        best.push_back( make_pair( best_match, best_path ) );
       }
       
-      // creat xml & extracts
-      vector<WORD_ID> &sourceSentence = source[best_match];
-      vector<SentenceAlignment> &targets = targetAndAlignment[best_match];
-      create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, best_path, fuzzyMatchStream);
-      
     } // else if (multiple_flag)
     
-    fuzzyMatchStream.close();
-    
-    return fuzzyMatchFile;
+    return best_cost;
   }
 
   void FuzzyMatchWrapper::load_corpus( const std::string &fileName, vector< vector< WORD_ID > > &corpus )
@@ -527,61 +560,61 @@ namespace tmmt
   
 /* Letter string edit distance, e.g. sub 'their' to 'there' costs 2 */
 
-unsigned int FuzzyMatchWrapper::letter_sed( WORD_ID aIdx, WORD_ID bIdx )
+const string &FuzzyMatchWrapper::get_word( WORD_ID id, const MatchState &state ) const
+{
+	if (id < vocabulary.vocab.size())
+		return vocabulary.GetWord( id );
+	return state.unknown[ id - vocabulary.vocab.size() ];
+}
+
+unsigned int FuzzyMatchWrapper::letter_sed( WORD_ID aIdx, WORD_ID bIdx, MatchState &state ) const
 {
 	// check if already computed -> lookup in cache
 	pair< WORD_ID, WORD_ID > pIdx = make_pair( aIdx, bIdx );
-	map< pair< WORD_ID, WORD_ID >, unsigned int >::const_iterator lookup = lsed.find( pIdx );
-	if (lookup != lsed.end())
+	map< pair< WORD_ID, WORD_ID >, unsigned int >::const_iterator lookup = state.lsed.find( pIdx );
+	if (lookup != state.lsed.end())
 	{
 		return (lookup->second);
 	}
   
 	// get surface strings for word indices
-	const string &a = vocabulary.GetWord( aIdx );
-	const string &b = vocabulary.GetWord( bIdx );
+	const string &a = get_word( aIdx, state );
+	const string &b = get_word( bIdx, state );
   
-	// initialize cost matrix
-	unsigned int **cost  = (unsigned int**) calloc( sizeof( unsigned int*  ), a.size()+1 );
-	for( unsigned int i=0; i<=a.size(); i++ ) {
-		cost[i] = (unsigned int*) calloc( sizeof(unsigned int), b.size()+1 );
-		cost[i][0] = i;
-	}
+	// one row of the cost matrix at a time
+	vector< unsigned int > cost( b.size()+1 );
 	for( unsigned int j=0; j<=b.size(); j++ ) {
-		cost[0][j] = j;
+		cost[j] = j;
 	}
   
 	// core string edit distance loop
 	for( unsigned int i=1; i<=a.size(); i++ ) {
+		unsigned int diag = cost[0];
+		cost[0] = i;
 		for( unsigned int j=1; j<=b.size(); j++ ) {
       
-			unsigned int ins = cost[i-1][j] + 1;
-			unsigned int del = cost[i][j-1] + 1;
-			bool match = (a.substr(i-1,1).compare( b.substr(j-1,1) ) == 0);
-			unsigned int diag = cost[i-1][j-1] + (match ? 0 : 1);
+			unsigned int ins = cost[j] + 1;
+			unsigned int del = cost[j-1] + 1;
+			bool match = (a[i-1] == b[j-1]);
+			unsigned int sub = diag + (match ? 0 : 1);
+			diag = cost[j];
       
 			unsigned int min = (ins < del) ? ins : del;
-			min = (diag < min) ? diag : min;
+			min = (sub < min) ? sub : min;
       
-			cost[i][j] = min;
+			cost[j] = min;
 		}
 	}
-  
-	// clear out memory
-	unsigned int final = cost[a.size()][b.size()];
-	for( unsigned int i=0; i<=a.size(); i++ ) {
-		free( cost[i] );
-	}
-	free( cost );
+	unsigned int final = cost[b.size()];
   
 	// cache and return result
-	lsed[ pIdx ] = final;
+	state.lsed[ pIdx ] = final;
 	return final;
 }
 
 /* string edit distance implementation */
 
-unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< WORD_ID > &b, string &best_path, bool use_letter_sed ) {
+unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< WORD_ID > &b, string &best_path, bool use_letter_sed, MatchState &state ) const {
   
 	// initialize cost and path matrices
 	unsigned int **cost  = (unsigned int**) calloc( sizeof( unsigned int* ), a.size()+1 );
@@ -595,7 +628,7 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
 			cost[i][0] = cost[i-1][0];
 			if (use_letter_sed)
 			{
-				cost[i][0] += vocabulary.GetWord( a[i-1] ).size();
+				cost[i][0] += get_word( a[i-1], state ).size();
 			}
 			else
 			{
@@ -615,7 +648,7 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
 			cost[0][j] = cost[0][j-1];
 			if (use_letter_sed)
 			{
-				cost[0][j] +=	vocabulary.GetWord( b[j-1] ).size();
+				cost[0][j] +=	get_word( b[j-1], state ).size();
 			}
 			else
 			{
@@ -637,9 +670,9 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
 			unsigned int match;
 			if (use_letter_sed)
 			{
-				ins += vocabulary.GetWord( a[i-1] ).size();
-				del += vocabulary.GetWord( b[j-1] ).size();
-				match = letter_sed( a[i-1], b[j-1] );
+				ins += get_word( a[i-1], state ).size();
+				del += get_word( b[j-1], state ).size();
+				match = letter_sed( a[i-1], b[j-1], state );
 			}
 			else
 			{
@@ -702,11 +735,11 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
 /* utlility function: compute length of sentence in characters 
  (spaces do not count) */
 
-unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentence )
+unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentence, const MatchState &state ) const
 {
 	unsigned int length = 0; for( unsigned int i=0; i<sentence.size(); i++ )
 	{
-		length += vocabulary.GetWord( sentence[i] ).size();
+		length += get_word( sentence[i], state ).size();
 	}
 	return length;
 }
@@ -716,6 +749,8 @@ unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentenc
   int FuzzyMatchWrapper::basic_fuzzy_match( vector< vector< WORD_ID > > source, 
                       vector< vector< WORD_ID > > input ) 
 {
+	MatchState state;
+
 	// go through input set...
 	for(unsigned int i=0;i<input.size();i++)
 	{
@@ -725,7 +760,7 @@ unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentenc
 		unsigned int input_length;
 		if (use_letter_sed)
 		{
-			input_length = compute_length( input[i] );
+			input_length = compute_length( input[i], state );
 		}
 		else
 		{
@@ -741,7 +776,7 @@ unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentenc
 			int source_length;
 			if (use_letter_sed)
 			{
-				source_length = compute_length( source[s] );
+				source_length = compute_length( source[s], state );
 			}
 			else
 			{
@@ -755,7 +790,7 @@ unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentenc
       
 			// compute string edit distance
 			string path;
-			unsigned int cost = sed( input[i], source[s], path, use_letter_sed );
+			unsigned int cost = sed( input[i], source[s], path, use_letter_sed, state );
       
 			// update if new best
 			if (cost < best_cost) 
@@ -774,7 +809,7 @@ unsigned int FuzzyMatchWrapper::compute_length( const vector< WORD_ID > &sentenc
  the suffix array, since there are too many matches
  and for longer sentences, at least one 2-gram match must occur */
 
-int FuzzyMatchWrapper::short_match_max_length( int input_length )
+int FuzzyMatchWrapper::short_match_max_length( int input_length ) const
 {
   if ( ! refined_flag ) 
     return 0;
@@ -790,8 +825,10 @@ int FuzzyMatchWrapper::short_match_max_length( int input_length )
  (to be used by the next function) 
  (done here, because this has be done only once for an input sentence) */
 
-void FuzzyMatchWrapper::init_short_matches( const vector< WORD_ID > &input )
+void FuzzyMatchWrapper::init_short_matches( MatchState &state ) const
 {
+	const vector< WORD_ID > &input = state.input;
+	map< WORD_ID,vector< int > > &single_word_index = state.single_word_index;
 	int max_length = short_match_max_length( input.size() );
 	if (max_length == 0)
 		return;
@@ -812,23 +849,24 @@ void FuzzyMatchWrapper::init_short_matches( const vector< WORD_ID > &input )
 
 /* add all short matches to list of matches for a sentence */
 
-void FuzzyMatchWrapper::add_short_matches( vector< Match > &match, const vector< WORD_ID > &tm, int input_length, int best_cost )
+void FuzzyMatchWrapper::add_short_matches( vector< Match > &match, const vector< WORD_ID > &tm, int input_length, int best_cost, const MatchState &state ) const
 {	
 	int max_length = short_match_max_length( input_length );
 	if (max_length == 0)
 		return;
   
+	const map< WORD_ID,vector< int > > &single_word_index = state.single_word_index;
 	int tm_length = tm.size();
-	map< WORD_ID,vector< int > >::iterator input_word_hit;
+	map< WORD_ID,vector< int > >::const_iterator input_word_hit;
 	for(int t_pos=0; t_pos<tm.size(); t_pos++)
 	{
 		input_word_hit = single_word_index.find( tm[t_pos] );
 		if (input_word_hit != single_word_index.end())
 		{
-			vector< int > &position_vector = input_word_hit->second;
+			const vector< int > &position_vector = input_word_hit->second;
 			for(int j=0; j<position_vector.size(); j++)
 			{
-				int &i_pos = position_vector[j];
+				const int &i_pos = position_vector[j];
         
 				// before match
 				int max_cost = max( i_pos , t_pos );
@@ -854,7 +892,7 @@ void FuzzyMatchWrapper::add_short_matches( vector< Match > &match, const vector<
 
 /* remove matches that are subsumed by a larger match */
 
-vector< Match > FuzzyMatchWrapper::prune_matches( const vector< Match > &match, int best_cost )
+vector< Match > FuzzyMatchWrapper::prune_matches( const vector< Match > &match, int best_cost ) const
 {
 	//cerr << "\tpruning";
 	vector< Match > pruned;
@@ -893,7 +931,7 @@ vector< Match > FuzzyMatchWrapper::prune_matches( const vector< Match > &match,
 
 /* A* parsing method to compute string edit distance */
 
-int FuzzyMatchWrapper::parse_matches( vector< Match > &match, int input_length, int tm_length, int &best_cost )
+int FuzzyMatchWrapper::parse_matches( vector< Match > &match, int input_length, int tm_length, int &best_cost ) const
 {	
 	// cerr << "sentence has " << match.size() << " matches, best cost: " << best_cost << ", lengths input: " << input_length << " tm: " << tm_length << endl;
   
@@ -1047,30 +1085,269 @@ int FuzzyMatchWrapper::parse_matches( vector< Match > &match, int input_length,
 }
 
 
-void FuzzyMatchWrapper::create_extract(int sentenceInd, int cost, const vector< WORD_ID > &sourceSentence, const vector<SentenceAlignment> &targets, const string &inputStr, const string  &path, ofstream &outputFile)
+/* evaluate candidates of search, until there are none left. Called by each
+ thread working on search */
+
+void FuzzyMatchWrapper::evaluate_candidates( CandidateSearch &search ) const
 {
-  string sourceStr;
-  for (size_t pos = 0; pos < sourceSentence.size(); ++pos) {
-    WORD_ID wordId = sourceSentence[pos];
-    sourceStr += vocabulary.GetWord(wordId) + " ";
+	bool evaluated = false;
+	size_t ind = 0;
+	int cost = 0;
+	FilterCounts counts;
+	for(;;)
+	{
+		int best_cost;
+		{
+#ifdef WITH_THREADS
+			boost::mutex::scoped_lock lock( search.mutex );
+#endif
+			if (evaluated)
+			{
+				search.costs[ ind ] = cost;
+				search.batch_best_cost = min( search.batch_best_cost, cost );
+				search.counts.word_match += counts.word_match;
+				search.counts.word_match2 += counts.word_match2;
+				search.counts.pruned_match += counts.pruned_match;
+				search.running--;
+			}
+
+			// start the next batch when all of this one is evaluated
+			while (search.next == search.batch_end)
+			{
+#ifdef WITH_THREADS
+				if (search.running > 0)
+				{
+					search.batch_done.wait( lock );
+					continue;
+				}
+#endif
+				search.best_cost = search.batch_best_cost;
+				if (search.batch_end == search.candidates.size())
+				{
+#ifdef WITH_THREADS
+					search.batch_done.notify_all();
+#endif
+					return;
+				}
+				search.batch_end = min( search.candidates.size(), search.batch_end + CandidateSearch::BATCH_SIZE );
+#ifdef WITH_THREADS
+				search.batch_done.notify_all();
+#endif
+			}
+			ind = search.next++;
+			search.running++;
+			best_cost = search.best_cost;
+		}
+
+		counts = FilterCounts();
+		cost = evaluate_candidate( search.candidates[ ind ].first, *search.candidates[ ind ].second, best_cost, search.state, counts );
+		evaluated = true;
+	}
+}
+
+/* word edit cost of the corpus sentence tmID with the matches match, if it
+ isn't filtered out. Candidates with a cost over best_cost are pruned, and
+ their cost may be too high */
+
+int FuzzyMatchWrapper::evaluate_candidate( int tmID, vector< Match > &match, int best_cost, const MatchState &state, FilterCounts &counts ) const
+{
+	const int input_length = state.input.size();
+	int tm_length = suffixArray->GetSentenceLength(tmID);
+	add_short_matches( match, source[tmID], input_length, best_cost, state );
+
+	//cerr << "match in sentence " << tmID << ": " << match.size() << " [" << tm_length << "]" << endl;
+
+	// quick look: how many words are matched
+	int words_matched = 0;
+	for(int m=0;m<match.size();m++) {
+
+		if (match[m].min_cost <= best_cost) // makes no difference
+			words_matched += match[m].input_end - match[m].input_start + 1;
+	}
+	if (max(input_length,tm_length) - words_matched > best_cost)
+	{
+		if (length_filter_flag) return INT_MAX;
+	}
+	counts.word_match++;
+
+	// prune, check again how many words are matched
+	vector< Match > pruned = prune_matches( match, best_cost );
+	words_matched = 0;
+	for(int p=0;p<pruned.size();p++) {
+		words_matched += pruned[p].input_end - pruned[p].input_start + 1;
+	}
+	if (max(input_length,tm_length) - words_matched > best_cost)
+	{
+		if (length_filter_flag) return INT_MAX;
+	}
+	counts.word_match2++;
+
+	counts.pruned_match += pruned.size();
+
+	if (! parse_flag ||
+	    pruned.size()>=10) // to prevent worst cases
+	{
+		if (plain_sed_flag)
+		{
+			// without letter costs sed() only reads the state
+			string path;
+			return sed( state.input, source[tmID], path, false, const_cast< MatchState & >( state ) );
+		}
+		return state.input_sed.Distance( source[tmID], best_cost );
+	}
+	return parse_matches( pruned, input_length, tm_length, best_cost );
+}
+
+namespace
+{
+
+/* a mismatched part of the input, which becomes a non-terminal */
+struct Gap
+{
+  int start_i, start_t;
+  int rule_pos_s, rule_pos_t;
+};
+
+}
+
+/* rule from the match of the input with a corpus sentence and one of its
+ translations, as create_xml.perl makes them: the mismatched parts of the
+ input become non-terminals, and target words aligned to mismatched corpus
+ words are dropped. Returns false if the gaps can't be placed */
+
+bool FuzzyMatchWrapper::create_rule( const vector< WORD_ID > &sourceSentence, const SentenceAlignment &sentenceAlignment, const string &path, size_t input_length, ExtractedRule &rule ) const
+{
+  const vector< WORD_ID > &target = sentenceAlignment.target;
+  const int NONE = -2;
+
+  // target words aligned to each corpus word
+  vector< set< int > > alignedToS( sourceSentence.size() );
+  for (size_t i = 0; i < sentenceAlignment.alignment.size(); ++i) {
+    const pair<int,int> &point = sentenceAlignment.alignment[i];
+    if (point.first < (int) alignedToS.size() && point.second < (int) target.size()) {
+      alignedToS[point.first].insert(point.second);
+    }
   }
-    
-  for (size_t targetInd = 0; targetInd < targets.size(); ++targetInd) {
-    const SentenceAlignment &sentenceAlignment = targets[targetInd]; 
-    string targetStr = sentenceAlignment.getTargetString(vocabulary);
-    string alignStr = sentenceAlignment.getAlignmentString();
-    
-    outputFile
-    << sentenceInd << endl
-    << cost << endl
-    << sourceStr << endl 
-    << inputStr << endl
-    << targetStr << endl
-    << alignStr << endl
-    << path << endl
-    << sentenceAlignment.count << endl;
-    
+
+  // step 1: find mismatches
+  vector< bool > targetBitmap( target.size(), true );
+  vector< bool > inputBitmap;
+  vector< int > inputToSource;
+  vector< Gap > gaps;
+  int s = 0, i = 0;
+  int start_s = 0, start_i = 0;
+  bool currently_matching = false;
+  const string fullPath = path + "X"; // indicate end
+  for (size_t p = 0; p < fullPath.size(); ++p) {
+    char action = fullPath[p];
+
+    // beginning of a mismatch
+    if (currently_matching && action != 'M' && action != 'X') {
+      start_i = i;
+      start_s = s;
+      currently_matching = false;
+    }
+
+    // end of a mismatch
+    else if (!currently_matching && (action == 'M' || action == 'X')) {
+      // remove use of affected target words
+      for (int ss = start_s; ss < s; ++ss) {
+        for (set< int >::const_iterator tt = alignedToS[ss].begin(); tt != alignedToS[ss].end(); ++tt) {
+          targetBitmap[*tt] = false;
+        }
+      }
+
+      // input words need to be inserted: find the position in the target
+      if (start_i < i) {
+        // first removed target word
+        int start_t = NONE;
+        for (int ss = start_s; ss < s; ++ss) {
+          if (!alignedToS[ss].empty() && (start_t == NONE || *alignedToS[ss].begin() < start_t)) {
+            start_t = *alignedToS[ss].begin();
+          }
+        }
+        // end of sentence? add to end
+        if (start_t == NONE && i > (int) input_length - 1) {
+          start_t = (int) target.size() - 1;
+        }
+        // backtrack to previous words if unaligned
+        if (start_t == NONE) {
+          start_t = -1;
+          for (int ss = s - 1; start_t == -1 && ss >= 0; --ss) {
+            if (!alignedToS[ss].empty()) {
+              start_t = *alignedToS[ss].rbegin();
+            }
+          }
+        }
+        Gap gap = { start_i, start_t, NONE, NONE };
+        gaps.push_back(gap);
+      }
+      currently_matching = true;
+    }
+
+    if (action == 'M') {
+      inputBitmap.push_back(true);
+      inputToSource.push_back(s);
+    } else if (action == 'I' || action == 'S') {
+      inputBitmap.push_back(false);
+      inputToSource.push_back(NONE);
+    }
+    if (action != 'I') ++s;
+    if (action != 'D') ++i;
+  }
+
+  // step 2: build the rule
+  rule.source.clear();
+  rule.target.clear();
+  rule.alignment.clear();
+  rule.count = sentenceAlignment.count;
+
+  map< int, int > ruleAlignmentS;
+  int rule_pos_s = 0;
+  for (size_t pos = 0; pos < inputBitmap.size(); ++pos) {
+    if (inputBitmap[pos]) {
+      rule.source.push_back(pos);
+      ruleAlignmentS[inputToSource[pos]] = rule_pos_s++;
+    }
+    for (size_t g = 0; g < gaps.size(); ++g) {
+      if ((int) pos == gaps[g].start_i) {
+        rule.source.push_back(ExtractedRule::NON_TERMINAL);
+        gaps[g].rule_pos_s = rule_pos_s++;
+      }
+    }
+  }
+
+  map< int, int > ruleAlignmentT;
+  int rule_pos_t = 0;
+  for (int t = -1; t < (int) target.size(); ++t) {
+    if (t >= 0 && targetBitmap[t]) {
+      rule.target.push_back(target[t]);
+      ruleAlignmentT[t] = rule_pos_t++;
+    }
+    for (size_t g = 0; g < gaps.size(); ++g) {
+      if (t == gaps[g].start_t) {
+        rule.target.push_back(ExtractedRule::NON_TERMINAL);
+        gaps[g].rule_pos_t = rule_pos_t++;
+      }
+    }
+  }
+
+  for (map< int, int >::const_iterator iterS = ruleAlignmentS.begin(); iterS != ruleAlignmentS.end(); ++iterS) {
+    const set< int > &aligned = alignedToS[iterS->first];
+    for (set< int >::const_iterator t = aligned.begin(); t != aligned.end(); ++t) {
+      map< int, int >::const_iterator iterT = ruleAlignmentT.find(*t);
+      if (iterT != ruleAlignmentT.end()) {
+        rule.alignment.push_back(make_pair(iterS->second, iterT->second));
+      }
+    }
+  }
+  for (size_t g = 0; g < gaps.size(); ++g) {
+    if (gaps[g].rule_pos_s == NONE || gaps[g].rule_pos_t == NONE) {
+      return false;
+    }
+    rule.alignment.push_back(make_pair(gaps[g].rule_pos_s, gaps[g].rule_pos_t));
   }
+  return !rule.source.empty();
 }
 
 } // namespace
@@ -14,6 +14,13 @@
 #include "fuzzy-match/SuffixArray.h"
 #include "fuzzy-match/Vocabulary.h"
 #include "fuzzy-match/Match.h"
+#include "fuzzy-match/ExtractedRule.h"
+#include "fuzzy-match/BitParallelSed.h"
+
+namespace Moses
+{
+class ThreadPool;
+}
 
 namespace tmmt 
 {
@@ -23,30 +30,69 @@ class SentenceAlignment;
 class FuzzyMatchWrapper
 {
 public:
-  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment);
+  /** the candidate matches of a sentence are evaluated by threads threads.
+   Which matches are found doesn't depend on it */
+  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment, size_t threads = 1);
+  ~FuzzyMatchWrapper();
+
+  /** rules for the input sentence from its best matches, without going
+   through files. Sentences can be extracted by several threads at once.
+   Returns the word edit cost of the best matches */
+  int Extract(const std::vector< std::string > &input, std::vector< ExtractedRule > &rules) const;
 
-  std::string Extract(const std::string &dirNameStr);
+  /** compute the edit distance of the candidates with the dynamic
+   programming of sed() instead of BitParallelSed, to compare the two */
+  void SetPlainSed(bool plain) {
+    plain_sed_flag = plain;
+  }
+
+  const std::string &GetWord(WORD_ID id) const {
+    return vocabulary.GetWord(id);
+  }
   
 protected:
+  /** what matching one input sentence needs besides the translation memory */
+  struct MatchState {
+    std::vector< WORD_ID > input;
+    // input words not in the vocabulary, with ids from the vocabulary size on
+    std::vector< std::string > unknown;
+    std::map< WORD_ID,std::vector< int > > single_word_index;
+    // cache for word pairs
+    std::map< std::pair< WORD_ID, WORD_ID >, unsigned int > lsed;
+    // word edit distance to the input
+    BitParallelSed input_sed;
+  };
+
+  /** corpus sentences with matches of an input sentence, whose cost is
+   computed by one or more threads */
+  struct CandidateSearch;
+  class CandidateTask;
+
+  /** how many candidates got past each filter, for the statistics */
+  struct FilterCounts {
+    int word_match;
+    int word_match2;
+    int pruned_match;
+    FilterCounts() : word_match(0), word_match2(0), pruned_match(0) {}
+  };
+
   // tm-mt
   tmmt::Vocabulary vocabulary;
   std::vector< std::vector< tmmt::WORD_ID > > source;
   std::vector< std::vector< tmmt::SentenceAlignment > > targetAndAlignment;
   tmmt::SuffixArray *suffixArray;
-  std::map< WORD_ID,std::vector< int > > single_word_index;
   int basic_flag;
   int lsed_flag;
   int refined_flag;
   int length_filter_flag;
   int parse_flag;
+  int plain_sed_flag;
   int min_match;
   int multiple_flag;
   int multiple_slack;
   int multiple_max;
-
-  
-  // global cache for word pairs
-  std::map< std::pair< WORD_ID, WORD_ID >, unsigned int > lsed;
+  size_t threads;
+  Moses::ThreadPool *thread_pool;
 
   void load_corpus( const std::string &fileName, std::vector< std::vector< tmmt::WORD_ID > > &corpus );
   void load_target( const std::string &fileName, std::vector< std::vector< tmmt::SentenceAlignment > > &corpus);
@@ -55,21 +101,27 @@ protected:
   /** brute force method: compare input to all corpus sentences */
   int basic_fuzzy_match( std::vector< std::vector< tmmt::WORD_ID > > source, 
                         std::vector< std::vector< tmmt::WORD_ID > > input ) ;
+
+  /** best matches of the input in the corpus, as pairs of the corpus sentence
+   and the edit path. Returns the word edit cost of the best matches */
+  int find_best_matches( MatchState &state, std::vector< std::pair< int, std::string > > &best ) const;
+
+  const std::string &get_word( WORD_ID id, const MatchState &state ) const;
   
   /** utlility function: compute length of sentence in characters 
    (spaces do not count) */    
-  unsigned int compute_length( const std::vector< tmmt::WORD_ID > &sentence );
-  unsigned int letter_sed( WORD_ID aIdx, WORD_ID bIdx );
-  unsigned int sed( const std::vector< WORD_ID > &a, const std::vector< WORD_ID > &b, std::string &best_path, bool use_letter_sed );
-  void init_short_matches( const std::vector< WORD_ID > &input );
-  int short_match_max_length( int input_length );
-  void add_short_matches( std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost );
-  std::vector< Match > prune_matches( const std::vector< Match > &match, int best_cost );
-  int parse_matches( std::vector< Match > &match, int input_length, int tm_length, int &best_cost );
-
-  void create_extract(int sentenceInd, int cost, const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string &inputStr, const std::string  &path, std::ofstream &outputFile);
-
-  std::string ExtractTM(const std::string &inputPath);
+  unsigned int compute_length( const std::vector< tmmt::WORD_ID > &sentence, const MatchState &state ) const;
+  unsigned int letter_sed( WORD_ID aIdx, WORD_ID bIdx, MatchState &state ) const;
+  unsigned int sed( const std::vector< WORD_ID > &a, const std::vector< WORD_ID > &b, std::string &best_path, bool use_letter_sed, MatchState &state ) const;
+  void init_short_matches( MatchState &state ) const;
+  int short_match_max_length( int input_length ) const;
+  void add_short_matches( std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost, const MatchState &state ) const;
+  std::vector< Match > prune_matches( const std::vector< Match > &match, int best_cost ) const;
+  int parse_matches( std::vector< Match > &match, int input_length, int tm_length, int &best_cost ) const;
+  void evaluate_candidates( CandidateSearch &search ) const;
+  int evaluate_candidate( int tmID, std::vector< Match > &match, int best_cost, const MatchState &state, FilterCounts &counts ) const;
+
+  bool create_rule( const std::vector< WORD_ID > &sourceSentence, const SentenceAlignment &sentenceAlignment, const std::string &path, std::size_t input_length, ExtractedRule &rule ) const;
 
 };
 
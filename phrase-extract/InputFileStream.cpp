@@ -30,12 +30,16 @@ namespace Moses
 InputFileStream::InputFileStream(const std::string &filePath)
   : std::istream(NULL)
   , m_streambuf(NULL)
+  , m_buffer(NULL)
 {
   if (filePath.size() > 3 &&
       filePath.substr(filePath.size() - 3, 3) == ".gz") {
     m_streambuf = new gzfilebuf(filePath.c_str());
   } else {
     std::filebuf* fb = new std::filebuf();
+    // tables are read through in one go, so read them in large blocks
+    m_buffer = new char[BUFFER_SIZE];
+    fb->pubsetbuf(m_buffer, BUFFER_SIZE);
     fb = fb->open(filePath.c_str(), std::ios::in);
     if (! fb) {
       cerr << "Can't read " << filePath.c_str() << endl;
@@ -50,6 +54,8 @@ InputFileStream::~InputFileStream()
 {
   delete m_streambuf;
   m_streambuf = NULL;
+  delete[] m_buffer;
+  m_buffer = NULL;
 }
 
 void InputFileStream::Close()
@@ -35,6 +35,10 @@ class InputFileStream : public std::istream
 {
 protected:
   std::streambuf *m_streambuf;
+  char *m_buffer;
+
+  //! size of the read buffer of plain files
+  static const size_t BUFFER_SIZE = 1 << 20;
 public:
 
   InputFileStream(const std::string &filePath);
@@ -344,7 +344,7 @@ void processFiles( char* fileNameDirect, char* fileNameIndirect, char* fileNameC
       }
     }
 
-    fileConsolidated << endl;
+    fileConsolidated << '\n';
   }
   fileDirect.Close();
   fileIndirect.Close();
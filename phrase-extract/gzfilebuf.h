@@ -10,6 +10,10 @@ class gzfilebuf : public std::streambuf
 public:
   gzfilebuf(const char *filename) {
     _gzf = gzopen(filename, "rb");
+#if ZLIB_VERNUM >= 0x1240
+    // larger reads of the compressed file
+    gzbuffer(_gzf, _buffsize);
+#endif
     setg (_buff+sizeof(int),     // beginning of putback area
           _buff+sizeof(int),     // read position
           _buff+sizeof(int));    // end position
@@ -78,7 +82,7 @@ protected:
 
 private:
   gzFile _gzf;
-  static const unsigned int _buffsize = 1024;
+  static const unsigned int _buffsize = 1 << 16;
   char _buff[_buffsize];
 };
 
@@ -36,6 +36,11 @@
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 
+#ifdef WITH_THREADS
+#include "../moses/src/ThreadPool.h"
+#include "../moses/src/OutputCollector.h"
+#endif
+
 using namespace std;
 using namespace MosesTraining;
 
@@ -62,8 +67,19 @@ bool unalignedFWFlag = false;
 bool outputNTLengths = false;
 bool singletonFeature = false;
 bool crossedNonTerm = false;
-int countOfCounts[COC_MAX+1];
-int totalDistinct = 0;
+// count of count statistics for Good Turing and Kneser Ney discounting
+struct CountOfCounts {
+  int countOfCounts[COC_MAX+1];
+  int totalDistinct;
+  CountOfCounts() : totalDistinct(0) {
+    for(int i=0; i<=COC_MAX; i++) countOfCounts[i] = 0;
+  }
+  void add( const CountOfCounts &other ) {
+    totalDistinct += other.totalDistinct;
+    for(int i=0; i<=COC_MAX; i++) countOfCounts[i] += other.countOfCounts[i];
+  }
+};
+CountOfCounts countOfCounts;
 float minCountHierarchical = 0;
 bool domainFlag = false;
 bool domainRatioFlag = false;
@@ -74,15 +90,16 @@ bool includeSentenceIdFlag = false;
 
 Vocabulary vcbT;
 Vocabulary vcbS;
+WORD_ID nullS; // NULL in the lexical table, looked up once
   
 } // namespace
 
 vector<string> tokenize( const char [] );
 
 void writeCountOfCounts( const string &fileNameCountOfCounts );
-void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile, bool isSingleton);
+void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile, bool isSingleton, CountOfCounts &coc );
 const PhraseAlignment &findBestAlignment(const PhraseAlignmentCollection &phrasePair );
-void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float, int, ostream &phraseTableFile, bool isSingleton );
+void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float, int, ostream &phraseTableFile, bool isSingleton, CountOfCounts &coc );
 double computeLexicalTranslation( const PHRASE &, const PHRASE &, const PhraseAlignment & );
 double computeUnalignedPenalty( const PHRASE &, const PHRASE &, const PhraseAlignment & );
 set<string> functionWordList;
@@ -94,13 +111,64 @@ void calcNTLengthProb(const vector< PhraseAlignment* > &phrasePairs
 void printSourcePhrase(const PHRASE &, const PHRASE &, const PhraseAlignment &, ostream &);
 void printTargetPhrase(const PHRASE &, const PHRASE &, const PhraseAlignment &, ostream &);
 
+#ifdef WITH_THREADS
+/** Scores a chunk of the extract file, made of whole source phrases, so that
+ * chunks can be scored in parallel. The output is written in the order of
+ * the chunks, so the phrase table is the same as when scoring serially. */
+class ScoreTask : public Moses::Task
+{
+public:
+  ScoreTask(int id, Moses::OutputCollector &outputCollector, boost::mutex &cocMutex)
+    : m_id(id)
+    , m_outputCollector(outputCollector)
+    , m_cocMutex(cocMutex)
+    , m_size(0) {}
+
+  //! take over the phrase pairs of one source phrase
+  void add( vector< PhraseAlignment > &phrasePairs, bool isSingleton ) {
+    m_size += phrasePairs.size();
+    m_phrasePairs.push_back( vector< PhraseAlignment >() );
+    m_phrasePairs.back().swap( phrasePairs );
+    m_isSingleton.push_back( isSingleton );
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+
+  void Run() {
+    ostringstream out;
+    CountOfCounts coc;
+    for(size_t i=0; i<m_phrasePairs.size(); i++) {
+      processPhrasePairs( m_phrasePairs[i], out, m_isSingleton[i], coc );
+    }
+    {
+      boost::mutex::scoped_lock lock(m_cocMutex);
+      countOfCounts.add( coc );
+    }
+    m_outputCollector.Write( m_id, out.str() );
+  }
+
+private:
+  int m_id;
+  Moses::OutputCollector &m_outputCollector;
+  boost::mutex &m_cocMutex;
+  deque< vector< PhraseAlignment > > m_phrasePairs;
+  vector< bool > m_isSingleton;
+  size_t m_size;
+};
+
+// phrase pairs per task
+#define SCORE_CHUNK_SIZE 10000
+#endif
+
 int main(int argc, char* argv[])
 {
   cerr << "Score v2.0 written by Philipp Koehn\n"
        << "scoring methods for extracted rules\n";
 
   if (argc < 4) {
-    cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--WordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] [--PCFG] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--[Sparse]Domain[Indicator|Ratio|Subset|Bin] domain-file [bins]] [--Singleton] [--CrossedNonTerm] \n";
+    cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--WordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] [--PCFG] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--[Sparse]Domain[Indicator|Ratio|Subset|Bin] domain-file [bins]] [--Singleton] [--CrossedNonTerm] [--Threads num]\n";
     exit(1);
   }
   string fileNameExtract = argv[1];
@@ -109,6 +177,9 @@ int main(int argc, char* argv[])
   string fileNameCountOfCounts;
   char* fileNameFunctionWords = NULL;
   char* fileNameDomain = NULL;
+#ifdef WITH_THREADS
+  int threadCount = 1;
+#endif
 
   for(int i=4; i<argc; i++) {
     if (strcmp(argv[i],"inverse") == 0 || strcmp(argv[i],"--Inverse") == 0) {
@@ -186,6 +257,21 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--CrossedNonTerm") == 0) {
       crossedNonTerm = true;
       cerr << "crossed non-term reordering feature\n";
+    } else if (strcmp(argv[i],"-threads") == 0 ||
+               strcmp(argv[i],"--threads") == 0 ||
+               strcmp(argv[i],"--Threads") == 0) {
+#ifdef WITH_THREADS
+      if (i+1==argc) {
+        cerr << "ERROR: specify number of threads with " << argv[i] << endl;
+        exit(1);
+      }
+      threadCount = atoi(argv[++i]);
+      if (threadCount < 1) threadCount = 1;
+      cerr << "scoring with " << threadCount << " threads\n";
+#else
+      cerr << "thread support not compiled in." << '\n';
+      exit(1);
+#endif
     } else {
       cerr << "ERROR: unknown option " << argv[i] << endl;
       exit(1);
@@ -193,8 +279,10 @@ int main(int argc, char* argv[])
   }
 
   // lexical translation table
-  if (lexFlag)
+  if (lexFlag) {
     lexTable.load( fileNameLex );
+    nullS = vcbS.getWordID( "NULL" );
+  }
 
   // function word list
   if (unalignedFWFlag)
@@ -212,11 +300,6 @@ int main(int argc, char* argv[])
     }
   }
 
-  // compute count of counts for Good Turing discounting
-  if (goodTuringFlag || kneserNeyFlag) {
-    for(int i=1; i<=COC_MAX; i++) countOfCounts[i] = 0;
-  }
-
   // sorted phrase extraction file
   Moses::InputFileStream extractFile(fileNameExtract);
 
@@ -242,6 +325,23 @@ int main(int argc, char* argv[])
 		}
 		phraseTableFile = outputFile;
 	}
+
+#ifdef WITH_THREADS
+  // chunks of whole source phrases are scored by the pool, while this thread
+  // reads on. The vocabularies and the lexical table are only read by the
+  // tasks, except that this thread adds new words to the vocabularies
+  Moses::ThreadPool *pool = NULL;
+  Moses::OutputCollector *outputCollector = NULL;
+  boost::mutex cocMutex;
+  ScoreTask *task = NULL;
+  int taskId = 0;
+  if (threadCount > 1) {
+    pool = new Moses::ThreadPool(threadCount);
+    pool->SetQueueLimit(2 * threadCount);
+    outputCollector = new Moses::OutputCollector(phraseTableFile);
+    task = new ScoreTask(taskId++, *outputCollector, cocMutex);
+  }
+#endif
 	
   // loop through all extracted phrase translations
   float lastCount = 0.0f;
@@ -286,7 +386,17 @@ int main(int argc, char* argv[])
     // if new source phrase, process last batch
     if (lastPhrasePair != NULL &&
         lastPhrasePair->GetSource() != phrasePair.GetSource()) {
-      processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton );
+#ifdef WITH_THREADS
+      if (pool) {
+        task->add( phrasePairsWithSameF, isSingleton );
+        if (task->size() >= SCORE_CHUNK_SIZE) {
+          pool->Submit( task );
+          task = new ScoreTask(taskId++, *outputCollector, cocMutex);
+        }
+      }
+      else
+#endif
+      processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton, countOfCounts );
       
       phrasePairsWithSameF.clear();
       isSingleton = false;
@@ -301,7 +411,17 @@ int main(int argc, char* argv[])
     phrasePairsWithSameF.push_back( phrasePair );
     lastPhrasePair = &phrasePairsWithSameF.back();
   }
-  processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton );
+#ifdef WITH_THREADS
+  if (pool) {
+    task->add( phrasePairsWithSameF, isSingleton );
+    pool->Submit( task );
+    pool->Stop(true);
+    delete pool;
+    delete outputCollector;
+  }
+  else
+#endif
+  processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton, countOfCounts );
 	
 	phraseTableFile->flush();
 	if (phraseTableFile != &cout) {
@@ -326,16 +446,16 @@ void writeCountOfCounts( const string &fileNameCountOfCounts )
 	}
 
   // Kneser-Ney needs the total number of phrase pairs
-  countOfCountsFile << totalDistinct << endl;
+  countOfCountsFile << countOfCounts.totalDistinct << endl;
 
   // write out counts
   for(int i=1; i<=COC_MAX; i++) {
-    countOfCountsFile << countOfCounts[ i ] << endl;
+    countOfCountsFile << countOfCounts.countOfCounts[ i ] << endl;
   }
 	countOfCountsFile.Close();
 }
 
-void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile, bool isSingleton )
+void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile, bool isSingleton, CountOfCounts &coc )
 {
   if (phrasePair.size() == 0) return;
 
@@ -376,7 +496,7 @@ void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseT
   for(iter = sortedColl.begin(); iter != sortedColl.end(); ++iter) 
   {
     const PhraseAlignmentCollection &group = **iter;
-    outputPhrasePair( group, totalSource, phrasePairGroup.GetSize(), phraseTableFile, isSingleton );
+    outputPhrasePair( group, totalSource, phrasePairGroup.GetSize(), phraseTableFile, isSingleton, coc );
   }
   
 }
@@ -547,7 +667,7 @@ int calcCrossedNonTerm(const PHRASE &phraseS, const PhraseAlignment &bestAlignme
   return 0;
 }
 
-void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCount, int distinctCount, ostream &phraseTableFile, bool isSingleton )
+void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCount, int distinctCount, ostream &phraseTableFile, bool isSingleton, CountOfCounts &coc )
 {
   if (phrasePair.size() == 0) return;
 
@@ -573,10 +693,10 @@ void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCo
 
   // collect count of count statistics
   if (goodTuringFlag || kneserNeyFlag) {
-    totalDistinct++;
+    coc.totalDistinct++;
     int countInt = count + 0.99999;
     if(countInt <= COC_MAX)
-      countOfCounts[ countInt ]++;
+      coc.countOfCounts[ countInt ]++;
   }
 
   // compute PCFG score
@@ -780,7 +900,7 @@ void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCo
     }    
   }
   
-  phraseTableFile << endl;
+  phraseTableFile << "\n";
 }
 
 double computeUnalignedPenalty( const PHRASE &phraseS, const PHRASE &phraseT, const PhraseAlignment &alignment )
@@ -840,13 +960,12 @@ double computeLexicalTranslation( const PHRASE &phraseS, const PHRASE &phraseT,
 {
   // lexical translation probability
   double lexScore = 1.0;
-  int null = vcbS.getWordID("NULL");
   // all target words have to be explained
   for(size_t ti=0; ti<alignment.alignedToT.size(); ti++) {
     const set< size_t > & srcIndices = alignment.alignedToT[ ti ];
     if (srcIndices.empty()) {
       // explain unaligned word by NULL
-      lexScore *= lexTable.permissiveLookup( null, phraseT[ ti ] );
+      lexScore *= lexTable.permissiveLookup( nullS, phraseT[ ti ] );
     } else {
       // go through all the aligned words to compute average
       double thisWordScore = 0;
@@ -1,6 +1,7 @@
 // $Id$
 //#include "beammain.h"
 #include "tables-core.h"
+#include <algorithm>
 
 #define TABLE_LINE_MAX_LENGTH 1000
 #define UNKNOWNSTR	"UNK"
@@ -37,6 +38,18 @@ bool isNonTerminal( const WORD &symbol ) {
    return symbol.substr(0, 1) == "[" && symbol.substr(symbol.size()-1, 1) == "]";
 }
 
+Vocabulary::Vocabulary()
+  : vocabSize( 0 )
+{
+  fill( blocks, blocks + MAX_BLOCKS, (WORD*) NULL );
+}
+
+Vocabulary::~Vocabulary()
+{
+  for( size_t block = 0; block < MAX_BLOCKS && blocks[ block ] != NULL; block++ )
+    delete[] blocks[ block ];
+}
+
 WORD_ID Vocabulary::storeIfNew( const WORD& word )
 {
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
@@ -44,15 +57,20 @@ WORD_ID Vocabulary::storeIfNew( const WORD& word )
   if( i != lookup.end() )
     return i->second;
 
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  WORD_ID id = vocabSize;
+  size_t block = id >> BLOCK_BITS;
+  assert( block < MAX_BLOCKS );
+  if (blocks[ block ] == NULL)
+    blocks[ block ] = new WORD[ BLOCK_SIZE ];
+  blocks[ block ][ id & (BLOCK_SIZE-1) ] = word;
+  vocabSize++;
   lookup[ word ] = id;
   return id;
 }
 
-WORD_ID Vocabulary::getWordID( const WORD& word )
+WORD_ID Vocabulary::getWordID( const WORD& word ) const
 {
-  map<WORD, WORD_ID>::iterator i = lookup.find( word );
+  map<WORD, WORD_ID>::const_iterator i = lookup.find( word );
   if( i == lookup.end() )
     return 0;
   return i->second;
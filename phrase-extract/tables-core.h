@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 #include <queue>
 #include <map>
 #include <cmath>
@@ -20,16 +21,34 @@ namespace MosesTraining
 typedef std::string WORD;
 typedef unsigned int WORD_ID;
 
+/** Words are stored in blocks of fixed size, which stay where they are once
+ * allocated. So getWord() may be called by other threads while new words are
+ * stored, for ids they were handed after storeIfNew() returned them. */
 class Vocabulary
 {
 public:
+  Vocabulary();
+  ~Vocabulary();
   std::map<WORD, WORD_ID>  lookup;
-  std::vector< WORD > vocab;
   WORD_ID storeIfNew( const WORD& );
-  WORD_ID getWordID( const WORD& );
+  WORD_ID getWordID( const WORD& ) const;
   inline WORD &getWord( WORD_ID id ) {
-    return vocab[ id ];
+    return blocks[ id >> BLOCK_BITS ][ id & (BLOCK_SIZE-1) ];
   }
+  inline size_t size() const {
+    return vocabSize;
+  }
+
+private:
+  static const size_t BLOCK_BITS = 16;
+  static const size_t BLOCK_SIZE = 1 << BLOCK_BITS;
+  static const size_t MAX_BLOCKS = 1 << (32 - BLOCK_BITS);
+  WORD *blocks[ MAX_BLOCKS ];
+  size_t vocabSize;
+
+  // no copying
+  Vocabulary( const Vocabulary& );
+  Vocabulary &operator=( const Vocabulary& );
 };
 
 typedef std::vector< WORD_ID > PHRASE;
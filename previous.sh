@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam -j2 --notrace cxxflags=-std=gnu++03 moses/src//moses_test moses-cmd/src//programs moses-chart-cmd/src//moses_chart mert misc//benchmarkFuzzyMatch
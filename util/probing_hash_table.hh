@@ -126,6 +126,13 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       }    
     }
 
+    // Hint that key will be looked up soon, so the cache miss of its bucket overlaps with other work.  
+    template <class Key> void Prefetch(const Key key) const {
+#ifdef __GNUC__
+      __builtin_prefetch(begin_ + (hash_(key) % buckets_));
+#endif
+    }
+
   private:
     MutableIterator begin_;
     std::size_t buckets_;